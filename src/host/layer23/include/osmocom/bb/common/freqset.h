@@ -0,0 +1,55 @@
+#ifndef _FREQSET_H
+#define _FREQSET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Set of ARFCNs 0..1023, one bit per ARFCN
+ *
+ * Frequency lists (TS 44.018 10.5.2.13) are decoded directly into a set.
+ * Indexes into a list (mobile allocation, BA index of SI 10) refer to the
+ * ARFCNs in ascending order, except that ARFCN 0 comes last.
+ */
+struct gsm_freq_set {
+	uint64_t	bits[1024 / 64];
+};
+
+static inline void gsm_freq_set_clear(struct gsm_freq_set *set)
+{
+	memset(set, 0, sizeof(*set));
+}
+
+static inline void gsm_freq_set_add(struct gsm_freq_set *set, uint16_t arfcn)
+{
+	arfcn &= 1023;
+	set->bits[arfcn >> 6] |= 1ULL << (arfcn & 63);
+}
+
+static inline bool gsm_freq_set_has(const struct gsm_freq_set *set,
+				    uint16_t arfcn)
+{
+	arfcn &= 1023;
+	return (set->bits[arfcn >> 6] >> (arfcn & 63)) & 1;
+}
+
+static inline void gsm_freq_set_or(struct gsm_freq_set *dst,
+				   const struct gsm_freq_set *a,
+				   const struct gsm_freq_set *b)
+{
+	int i;
+
+	for (i = 0; i < 1024 / 64; i++)
+		dst->bits[i] = a->bits[i] | b->bits[i];
+}
+
+int gsm_freq_set_decode(struct gsm_freq_set *set, const uint8_t *cd,
+			uint8_t len, uint8_t mask);
+int gsm_freq_set_count(const struct gsm_freq_set *set);
+int gsm_freq_set_nth(const struct gsm_freq_set *set, unsigned int n);
+int gsm_freq_set_list(const struct gsm_freq_set *set, uint16_t *arfcn,
+		      unsigned int max);
+int gsm_freq_set_select(const struct gsm_freq_set *set, const uint8_t *ma,
+			uint8_t len, uint16_t *arfcn);
+
+#endif /* _FREQSET_H */
@@ -0,0 +1,41 @@
+#ifndef _MEAS_REP_H
+#define _MEAS_REP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Serving cell measurements in dedicated mode
+ *
+ * Samples of the dedicated channel are collected per reporting period,
+ * which ends with each block received on the SACCH (TS 45.008 8.4). The
+ * FULL set holds all blocks, the SUB set only those that are sent even
+ * with downlink DTX: SACCH blocks, the SID positions on a TCH and every
+ * block of an SDCCH. At the end of a period RXLEV and RXQUAL are computed,
+ * so the MEASUREMENT REPORT only copies them.
+ */
+
+struct rx_meas_set {
+	uint32_t blocks;
+	uint32_t rxlev; /* sum of RXLEV 0..63 */
+	uint32_t berr; /* sum of bit errors */
+	uint32_t bits; /* sum of coded bits */
+};
+
+struct rx_meas_rep {
+	/* current reporting period */
+	struct rx_meas_set full, sub;
+
+	/* results of the last complete period */
+	bool valid;
+	uint8_t rxlev_full, rxlev_sub;
+	uint8_t rxqual_full, rxqual_sub;
+	uint32_t periods;
+};
+
+void meas_rep_reset(struct rx_meas_rep *mr);
+void meas_rep_sample(struct rx_meas_rep *mr, uint8_t chan_nr, uint8_t link_id,
+		     uint32_t fn, uint8_t rx_level, uint8_t num_biterr,
+		     uint16_t bits);
+uint8_t meas_rep_rxqual(uint32_t berr, uint32_t bits);
+
+#endif /* _MEAS_REP_H */
@@ -19,6 +19,7 @@
 #include <osmocom/bb/mobile/mncc_sock.h>
 #include <osmocom/bb/common/sim.h>
 #include <osmocom/bb/common/l1ctl.h>
+#include <osmocom/bb/common/meas_rep.h>
 
 struct osmobb_ms_gmm_layer {
 	uint8_t ac_ref_nr;
@@ -68,6 +69,17 @@ struct rx_meas_stat {
 	int16_t s, rl_fail;
 };
 
+/* DRX in idle mode, see TS 45.002 §6.5 */
+struct rx_drx {
+	bool active; /* only pass our paging block */
+	bool all; /* extended paging or paging reorganization */
+	uint8_t bs_pa_mfrms;
+	uint8_t mf_index; /* (FN div 51) mod BS_PA_MFRMS of our block */
+	uint8_t fn51; /* first frame of our block */
+
+	uint32_t passed, dropped;
+};
+
 enum osmobb_ms_shutdown_st {
 	MS_SHUTDOWN_NONE = 0,
 	MS_SHUTDOWN_IMSI_DETACH = 1,
@@ -91,6 +103,8 @@ struct osmocom_ms {
 	struct lapdm_channel lapdm_channel;
 	struct osmosap_entity sap_entity;
 	struct rx_meas_stat meas;
+	struct rx_meas_rep meas_rep;
+	struct rx_drx drx;
 	struct gsm48_rrlayer rrlayer;
 	struct gsm322_plmn plmn;
 	struct gsm322_cellsel cellsel;
@@ -98,6 +112,9 @@ struct osmocom_ms {
 	struct gsm48_cclayer cclayer;
 	struct osmomncc_entity mncc_entity;
 	struct llist_head trans_list;
+	struct trans_index *trans_idx; /* see transaction.c */
+	struct sms_bulk *sms_bulk; /* see gsm411_sms.c */
+	struct sms_store *sms_store; /* see sms_store.c */
 
 	/* GPRS */
 	struct gprs_settings gprs;
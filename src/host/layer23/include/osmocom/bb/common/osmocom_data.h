@@ -24,6 +24,7 @@ enum osmobb_l1ctl_sig {
 	S_L1CTL_TCH_MODE_CONF,
 	S_L1CTL_LOSS_IND,
 	S_L1CTL_NEIGH_PM_IND,
+	S_L1CTL_CBCH_IND,
 };
 
 enum osmobb_global_sig {
@@ -97,3 +98,10 @@ struct osmobb_neigh_pm_ind {
 	uint16_t band_arfcn;
 	uint8_t rx_lev;
 };
+
+struct osmobb_cbch_ind {
+	struct osmocom_ms *ms;
+	uint16_t band_arfcn;
+	uint32_t fn;
+	const uint8_t *data; /* one CBCH block, 23 octets */
+};
@@ -0,0 +1,32 @@
+#ifndef _PAGING_MATCH_H
+#define _PAGING_MATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <osmocom/gsm/gsm23003.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+
+/* Our identities as they are coded in PAGING REQUEST
+ *
+ * paging_ids_update() is called once for each paging request. Each identity
+ * on the air is then compared octet by octet, without decoding it.
+ */
+struct paging_ids {
+	bool			tmsi_valid; /* TMSI assigned in this LA */
+	uint8_t			tmsi[4]; /* big endian */
+	char			imsi[OSMO_IMSI_BUF_SIZE]; /* encoded one */
+	uint8_t			imsi_mi[GSM48_MI_SIZE]; /* MI value */
+	uint8_t			imsi_mi_len; /* 0 if no IMSI */
+};
+
+void paging_ids_update(struct paging_ids *ids, uint32_t tmsi, bool tmsi_valid,
+		       const char *imsi);
+
+/* 'mi_lv' is a Mobile Identity IE without IEI, returns the MI type of a
+ * match, else 0 */
+uint8_t paging_match_mi(const struct paging_ids *ids, const uint8_t *mi_lv);
+/* 'tmsi' is the big endian TMSI of PAGING REQUEST 2 and 3 */
+bool paging_match_tmsi(const struct paging_ids *ids, const void *tmsi);
+
+#endif /* _PAGING_MATCH_H */
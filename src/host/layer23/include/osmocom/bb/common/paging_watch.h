@@ -0,0 +1,43 @@
+#ifndef _PAGING_WATCH_H
+#define _PAGING_WATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Watch list of TMSIs and IMSIs in paging
+ *
+ * Identities are kept in a hash set, coded as the value part of the Mobile
+ * Identity IE (TS 24.008 10.5.1.4). Identities from paging are looked up
+ * by their octets, without decoding, so the lookup does not depend on the
+ * size of the list. Only a match is decoded and written as one line to the
+ * event output.
+ */
+
+#define PAGING_WATCH_MI_MAX	9 /* IMSI of 15 digits */
+
+int paging_watch_add(const char *id);
+int paging_watch_load(const char *path);
+void paging_watch_clear(void);
+unsigned int paging_watch_count(void);
+
+int paging_watch_open(const char *path);
+void paging_watch_close(void);
+unsigned long paging_watch_events(void);
+
+/* 'mi' is the value part of a Mobile Identity IE */
+bool paging_watch_match(const uint8_t *mi, uint8_t len);
+void paging_watch_event(uint32_t fn, uint16_t arfcn, uint8_t chan_needed,
+			const uint8_t *mi, uint8_t len);
+
+/* check and report in one step, for the paging handlers */
+static inline bool paging_watch(uint32_t fn, uint16_t arfcn,
+				uint8_t chan_needed, const uint8_t *mi,
+				uint8_t len)
+{
+	if (!paging_watch_count() || !paging_watch_match(mi, len))
+		return false;
+	paging_watch_event(fn, arfcn, chan_needed, mi, len);
+	return true;
+}
+
+#endif /* _PAGING_WATCH_H */
@@ -4,6 +4,8 @@
 #include <osmocom/gsm/gsm48_ie.h>
 #include <osmocom/gsm/gsm23003.h>
 
+#include <osmocom/bb/common/freqset.h>
+
 /* collection of system information of the current cell */
 
 /* frequency mask flags of frequency type */
@@ -18,6 +20,19 @@
 #define	FREQ_TYPE_REP_5bis	0x40 /* sub channel of SI 5bis */
 #define	FREQ_TYPE_REP_5ter	0x80 /* sub channel of SI 5ter */
 
+/* sections of system information that may be decoded on demand */
+#define SI_DEC_SI1_CA		0x0001 /* cell allocation of SI 1 */
+#define SI_DEC_SI2_BA		0x0002 /* neighbor cells of SI 2 */
+#define SI_DEC_SI2bis_BA	0x0004 /* neighbor cells of SI 2bis */
+#define SI_DEC_SI2ter_BA	0x0008 /* neighbor cells of SI 2ter */
+#define SI_DEC_SI5_BA		0x0010 /* neighbor cells of SI 5 */
+#define SI_DEC_SI5bis_BA	0x0020 /* neighbor cells of SI 5bis */
+#define SI_DEC_SI5ter_BA	0x0040 /* neighbor cells of SI 5ter */
+#define SI_DEC_FREQ		0x007f /* all of the above */
+#define SI_DEC_SI4_MA		0x0080 /* CBCH mobile allocation of SI 4 */
+#define SI_DEC_SI10		0x0100 /* cell info of SI 10 */
+#define SI_DEC_ALL		0x01ff
+
 struct si10_cell_info {
 	uint8_t				index; /* frequency index of the frequencies received in SI5* */
 	int16_t				arfcn; /* ARFCN or -1 (if not found in SI5*) */
@@ -53,8 +68,19 @@ struct gsm48_sysinfo {
 	uint8_t				si6_msg[18];
 	uint8_t				si10_msg[21];
 	uint8_t				si13_msg[23];
+	uint8_t				si4_ma_ofs; /* CBCH MA in si4_msg, if not 0 */
+	uint8_t				si10_len;
+
+	/* If set, frequency lists, hopping and SI 10 cell info are only
+	 * decoded from the messages above, when accessed through
+	 * gsm48_sysinfo_freq() and friends. Scanners that only need the
+	 * cell identity set this after clearing the structure. */
+	bool				lazy;
+	uint16_t			pending; /* SI_DEC_* not decoded yet */
 
 	struct	gsm_sysinfo_freq	freq[1024]; /* all frequencies */
+	struct gsm_freq_set		ca; /* cell allocation (FREQ_TYPE_SERV) */
+	struct gsm_freq_set		ba_si5[3]; /* SI 5, SI 5bis, SI 5ter */
 	uint16_t			hopping[64]; /* hopping arfcn */
 	uint8_t				hopp_len;
 
@@ -217,9 +243,19 @@ int gsm48_decode_sysinfo10(struct gsm48_sysinfo *s,
 			   const struct gsm48_system_information_type_10 *si, int len);
 int gsm48_decode_sysinfo13(struct gsm48_sysinfo *s,
 			   const struct gsm48_system_information_type_13 *si, int len);
-int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
+int gsm48_decode_freq_set(struct gsm_sysinfo_freq *f, struct gsm_freq_set *set,
+			  const uint8_t *cd, uint8_t len, uint8_t mask,
+			  uint8_t frqt);
+int gsm48_decode_mobile_alloc(const struct gsm_freq_set *ca,
 			      const uint8_t *ma, uint8_t len,
-			      uint16_t *hopping, uint8_t *hopp_len, int si4);
+			      uint16_t *hopping, uint8_t *hopp_len);
 int16_t arfcn_from_freq_index(const struct gsm48_sysinfo *s, uint16_t index);
+int gsm48_sysinfo_paging_block(const struct gsm48_sysinfo *s, const char *imsi,
+			       uint8_t *mf_index, uint8_t *fn51);
+int gsm48_sysinfo_decode(struct gsm48_sysinfo *s, uint16_t sections);
+struct gsm_sysinfo_freq *gsm48_sysinfo_freq(struct gsm48_sysinfo *s);
+const uint16_t *gsm48_sysinfo_hopping(struct gsm48_sysinfo *s, uint8_t *len);
+const struct si10_cell_info *gsm48_sysinfo_si10_cells(struct gsm48_sysinfo *s,
+						      uint8_t *num);
 
 #endif /* _SYSINFO_H */
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include <osmocom/bb/misc/log.h>
+
+/* Binary cell log
+ *
+ * The file starts with a header, followed by records. Each record is a type
+ * octet and a 16 bit length, followed by the payload. All values are stored
+ * little endian, so logs can be copied between hosts. Records of unknown
+ * type are skipped.
+ *
+ * A sync record is written every BINLOG_SYNC_INTERVAL octets. If a record
+ * cannot be decoded, the reader searches for the next sync pattern and
+ * continues there. A record that was cut off at the end of the file (e.g.
+ * by a crash of the logger) is ignored.
+ */
+
+#define BINLOG_MAGIC		"OBBCLOG"
+#define BINLOG_VERSION		1
+#define BINLOG_HDR_LEN		16
+
+/* header flags, no compression is defined yet */
+#define BINLOG_F_KNOWN		0x0000
+
+enum binlog_rec_type {
+	BINLOG_REC_SYSINFO	= 0x01,
+	BINLOG_REC_POWER	= 0x02,
+	BINLOG_REC_SYNC		= 0xff,
+};
+
+#define BINLOG_SYNC_INTERVAL	65536
+#define BINLOG_SYNC_PATTERN	"\xa5\x5a\xc3\x3cSYNC"
+#define BINLOG_SYNC_LEN		8
+
+struct binlog_writer;
+
+struct binlog_writer *binlog_open(const char *filename,
+	unsigned int flush_interval);
+int binlog_write_sysinfo(struct binlog_writer *w, const struct sysinfo *si);
+int binlog_write_power(struct binlog_writer *w, const struct power *power);
+int binlog_flush(struct binlog_writer *w);
+int binlog_close(struct binlog_writer *w);
+
+int binlog_detect(const void *data, size_t len);
+int binlog_parse(const struct log_handler *h, void *priv, const uint8_t *data,
+	size_t len);
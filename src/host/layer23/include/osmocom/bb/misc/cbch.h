@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Reassembly of cell broadcast messages (3GPP TS 44.012, TS 23.041)
+ *
+ * Four CBCH blocks form one page of 88 octets, a message has up to 15
+ * pages. Because pages are repeated continuously, each page is identified
+ * by serial number, message identifier and page number, and only new
+ * messages are written. The output has one JSON object per line.
+ */
+
+#define CBCH_BLOCK_LEN		23
+#define CBCH_PAGE_LEN		88 /* header and content */
+#define CBCH_CONTENT_LEN	82
+#define CBCH_PAGES_MAX		15
+
+struct cbch_stats {
+	unsigned long blocks;
+	unsigned long bad_blocks; /* out of sequence */
+	unsigned long pages;
+	unsigned long dup_pages; /* suppressed duplicates */
+	unsigned long messages; /* written */
+};
+
+int cbch_open(const char *path);
+void cbch_close(void);
+void cbch_rx_block(uint16_t arfcn, uint32_t fn, const uint8_t *data);
+const struct cbch_stats *cbch_get_stats(void);
@@ -1,8 +1,16 @@
 
-struct probe {
-	struct probe *next;
-	double x, y, dist;
+/* Measurements of a cell on a flat surface around the first measurement.
+ * Positions and distances are in degrees of latitude. The values are
+ * stored in arrays, so the distance to all probes is computed in one pass
+ * over the arrays. */
+struct probe_set {
+	unsigned int num;
+	double *x, *y;
+	double *dist;
+	double *weight; /* 1 / variance of dist, in 1 / meter^2 */
 };
 
-int locate_cell(struct probe *probe_first, double *min_x, double *min_y);
-
+int locate_cell(const struct probe_set *ps, double *min_x, double *min_y);
+int locate_cell_circle(const struct probe_set *ps, double *min_x,
+	double *min_y);
+double locate_rms(const struct probe_set *ps, double x, double y);
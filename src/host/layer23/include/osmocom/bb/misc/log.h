@@ -1,5 +1,11 @@
 #pragma once
 
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include <osmocom/gsm/gsm23003.h>
 #include <osmocom/bb/common/sysinfo.h>
 
 enum {
@@ -20,25 +26,6 @@ struct node_power {
 	struct power power;
 };
 
-struct node_mcc {
-	struct node_mcc *next;
-	uint16_t mcc;
-	struct node_mnc *mnc;
-};
-
-struct node_mnc {
-	struct node_mnc *next;
-	uint16_t mnc;
-	bool mnc_3_digits;
-	struct node_lac *lac;
-};
-
-struct node_lac {
-	struct node_lac *next;
-	uint16_t lac;
-	struct node_cell *cell;
-};
-
 struct sysinfo {
 	uint16_t arfcn;
 	int8_t rxlev;
@@ -56,29 +43,64 @@ struct sysinfo {
 	uint8_t ta;
 };
 
+/* measurement flags */
+#define MEAS_F_GPS	0x01 /* longitude and latitude are valid */
+#define MEAS_F_TA	0x02 /* ta is valid */
+
+/* A cell and all its measurements. The measurements are stored column wise,
+ * so a pass over one value (e.g. all positions) only touches its array. */
 struct node_cell {
-	struct node_cell *next;
-	uint16_t cellid;
-	uint8_t content; /* indicates, if sysinfo is already applied */
-	struct node_meas *meas, **meas_last_p;
-	struct sysinfo sysinfo;
-	struct gsm48_sysinfo s;
+	struct osmo_cell_global_id cgi;
+	uint8_t changed; /* a later record had different sysinfo */
+	struct sysinfo sysinfo; /* record that created the cell */
+
+	unsigned int meas_num, meas_size;
+	time_t *gmt;
+	double *longitude, *latitude;
+	int8_t *rxlev;
+	uint8_t *ta;
+	uint8_t *flags; /* MEAS_F_* */
 };
 
-struct node_meas {
-	struct node_meas *next;
-	time_t gmt;
-	int8_t rxlev;
-	uint8_t gps_valid;
-	double longitude, latitude;
-	uint8_t ta_valid;
-	uint8_t ta;
+struct log_arena;
+
+/* all cells of one or more log files */
+struct log_db {
+	struct log_arena *arena;
+
+	/* hash index on CGI, open addressing */
+	struct node_cell **hash;
+	unsigned int hash_size;
+
+	/* cells in order of appearance, or sorted by log_db_sort() */
+	struct node_cell **cells;
+	unsigned int num_cells, cells_size;
+
+	struct node_power *power_first, **power_last_p;
+	unsigned long num_records;
 };
 
-struct node_mcc *get_node_mcc(uint16_t mcc);
-struct node_mnc *get_node_mnc(struct node_mcc *mcc, uint16_t mnc, bool mnc_3_digits);
-struct node_lac *get_node_lac(struct node_mnc *mnc, uint16_t lac);
-struct node_cell *get_node_cell(struct node_lac *lac, uint16_t cellid);
-struct node_meas *add_node_meas(struct node_cell *cell);
-int read_log(FILE *infp);
+/* receives the records of a log, in order of the file */
+struct log_handler {
+	int (*sysinfo)(void *priv, const struct sysinfo *si);
+	int (*power)(void *priv, const struct power *power);
+};
 
+int log_db_init(struct log_db *db);
+void log_db_free(struct log_db *db);
+struct node_cell *log_db_get_cell(struct log_db *db,
+	const struct osmo_cell_global_id *cgi, const struct sysinfo *si);
+int log_db_add_meas(struct log_db *db, struct node_cell *cell,
+	const struct sysinfo *si);
+int log_db_add_sysinfo(struct log_db *db, const struct sysinfo *si);
+int log_db_add_power(struct log_db *db, const struct power *power);
+int log_db_merge(struct log_db *db, struct log_db *from);
+void log_db_sort(struct log_db *db);
+int log_parse_buffer(const struct log_handler *h, void *priv, const char *data,
+	size_t len);
+int log_parse_file(const struct log_handler *h, void *priv,
+	const char *filename);
+int log_read_buffer(struct log_db *db, const char *data, size_t len);
+int log_read_file(struct log_db *db, const char *filename);
+void log_write_sysinfo(FILE *fp, const struct sysinfo *si);
+void log_write_power(FILE *fp, const struct power *power);
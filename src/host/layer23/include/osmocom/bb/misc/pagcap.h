@@ -0,0 +1,41 @@
+#ifndef _OSMOCOM_PAGCAP_H
+#define _OSMOCOM_PAGCAP_H
+
+#include <stdint.h>
+
+/* Capture of paging requests
+ *
+ * Each mobile identity of a paging request is stored as a fixed size
+ * record. Records are passed through a single producer, single consumer
+ * ring to a writer thread, which writes them in batches to a file or a
+ * unix socket. If the writer falls behind, records are dropped and
+ * counted.
+ *
+ * The output starts with a header, followed by the records. Multi octet
+ * fields are little endian.
+ */
+
+#define PAGCAP_MAGIC		"OBBPAGE"
+#define PAGCAP_VERSION		1
+#define PAGCAP_HDR_LEN		16
+
+#define PAGCAP_MI_MAX		9 /* longest Mobile Identity value (IMEISV) */
+#define PAGCAP_CNEED_NONE	0xff /* no channel needed for this identity */
+
+struct pagcap_rec {
+	uint32_t	fn;
+	uint16_t	arfcn;
+	uint8_t		msg_type; /* GSM48_MT_RR_PAG_REQ_1/2/3 */
+	uint8_t		pag_mode;
+	uint8_t		chan_needed; /* or PAGCAP_CNEED_NONE */
+	uint8_t		mi_type; /* GSM_MI_TYPE_* */
+	uint8_t		mi_len;
+	uint8_t		mi[PAGCAP_MI_MAX]; /* value part of the IE */
+} __attribute__((packed));
+
+int pagcap_open(const char *path);
+void pagcap_close(void);
+int pagcap_active(void);
+int pagcap_push(const struct pagcap_rec *rec);
+
+#endif /* _OSMOCOM_PAGCAP_H */
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <osmocom/bb/common/sysinfo.h>
+
+/* the decoder of system information before the rest octets were table
+ * driven, see sysinfo_ref.c */
+
+int ref_decode_sysinfo1(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_1 *si, int len);
+int ref_decode_sysinfo2(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_2 *si, int len);
+int ref_decode_sysinfo2bis(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_2bis *si, int len);
+int ref_decode_sysinfo2ter(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_2ter *si, int len);
+int ref_decode_sysinfo3(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_3 *si, int len);
+int ref_decode_sysinfo4(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_4 *si, int len);
+int ref_decode_sysinfo5(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_5 *si, int len);
+int ref_decode_sysinfo5bis(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_5bis *si, int len);
+int ref_decode_sysinfo5ter(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_5ter *si, int len);
+int ref_decode_sysinfo6(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_6 *si, int len);
+int ref_decode_sysinfo10(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_10 *si, int len);
+int ref_decode_sysinfo13(struct gsm48_sysinfo *s,
+	const struct gsm48_system_information_type_13 *si, int len);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <osmocom/bb/misc/log.h>
+
+/* Map tiles as used by web maps (spherical mercator): on zoom level z, the
+ * world is divided into 2^z * 2^z tiles. Tile x counts eastwards from 180
+ * degrees west, tile y counts southwards from about 85 degrees north. */
+
+#define TILE_ZOOM_MAX	24
+
+/* measurements of one cell within one tile */
+struct tile {
+	uint32_t x, y;
+	unsigned int count;
+	int8_t rxlev_median, rxlev_min, rxlev_max;
+};
+
+void tile_of(double longitude, double latitude, int zoom, uint32_t *x,
+	uint32_t *y);
+void tile_center(uint32_t x, uint32_t y, int zoom, double *longitude,
+	double *latitude);
+int tile_aggregate(const struct node_cell *cell, int zoom,
+	struct tile **tiles);
@@ -0,0 +1,61 @@
+#ifndef _CELLDB_H
+#define _CELLDB_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <osmocom/gsm/gsm23003.h>
+
+/* Persistent cell database
+ *
+ * The database is a file that is shared by all MS instances on the host. It
+ * starts with a header, followed by fixed size records. Records are only
+ * appended, so the latest record of a cell (PLMN + ARFCN) is valid. Each
+ * record carries a checksum, so a record that was torn by a crash is
+ * detected and discarded. The file is compacted from time to time, by
+ * writing the latest record of each cell into a new file and renaming it.
+ *
+ * The file is memory mapped for reading. Records are stored in host byte
+ * order, the database is not meant to be copied between hosts.
+ */
+
+#define CELLDB_MAGIC		"OBBCELL"
+#define CELLDB_VERSION		1
+
+struct celldb_file_hdr {
+	char		magic[8];
+	uint16_t	version;
+	uint16_t	rec_size;
+	uint32_t	reserved;
+} __attribute__((packed));
+
+#define CELLDB_F_BARRED		0x01 /* cell was barred */
+
+struct celldb_rec {
+	uint16_t	mcc;
+	uint16_t	mnc;
+	uint8_t		mnc_3_digits;
+	uint8_t		bsic;
+	uint16_t	arfcn;
+	uint16_t	lac;
+	uint16_t	cell_id;
+	int8_t		rxlev_acc_min_db; /* C1 input */
+	int8_t		ms_txpwr_max_cch; /* C1 input */
+	uint8_t		rxlev; /* last rx level, range format */
+	uint8_t		flags; /* see CELLDB_F_* */
+	uint32_t	last_seen; /* seconds since epoch */
+	uint16_t	reserved;
+	uint16_t	csum; /* checksum over all previous octets */
+} __attribute__((packed));
+
+struct gsm48_sysinfo;
+
+int celldb_open(const char *path);
+void celldb_close(void);
+int celldb_update(uint16_t arfcn, const struct gsm48_sysinfo *s,
+	uint8_t rxlev);
+int celldb_cells(const struct osmo_plmn_id *plmn,
+	const struct celldb_rec **recs, int max);
+int celldb_compact(void);
+
+#endif /* _CELLDB_H */
@@ -110,6 +110,7 @@ struct gsm322_ba_list {
 struct gsm322_cs_list {
 	uint8_t			flags; /* see GSM322_CS_FLAG_* */
 	uint8_t			rxlev; /* rx level range format */
+	uint8_t			stored; /* cell is in the cell database */
 	struct gsm48_sysinfo	*sysinfo;
 };
 
@@ -134,6 +135,12 @@ struct gsm322_plmn {
 #define GSM322_CCCH_ST_SYNC	2	/* got sync */
 #define GSM322_CCCH_ST_DATA	3	/* receiving data */
 
+/* number of neighbour cells to monitor */
+#define GSM58_NB_NUMBER		6
+
+/* number of samples in the sliding RLA_C window of each neighbour */
+#define GSM322_RLA_C_WIN	4
+
 /* neighbour cell info list entry */
 struct gsm322_neighbour {
 	struct llist_head	entry;
@@ -143,9 +150,16 @@ struct gsm322_neighbour {
 	uint8_t			state; /* GSM322_NB_* */
 	time_t			created; /* when was this neighbour created */
 	time_t			when; /* when did we sync / read */
-	int16_t			rxlev_sum_dbm; /* sum of received levels */
-	uint8_t			rxlev_count; /* number of received levels */
+	int8_t			rxlev_win_dbm[GSM322_RLA_C_WIN];
+					/* last received levels */
+	uint8_t			rxlev_win_pos; /* next slot in window */
+	uint8_t			rxlev_win_num; /* valid slots in window */
+	int16_t			rxlev_sum_dbm; /* sum of levels in window */
+	uint8_t			rxlev_count; /* new levels since last RLA_C */
 	int8_t			rla_c_dbm; /* average of the receive level */
+	int8_t			rank; /* index in ranked view, or -1 */
+	uint8_t			c1_offset_valid; /* c1_offset is calculated */
+	int16_t			c1_offset; /* C1 = RLA_C - c1_offset */
 	uint8_t			c12_valid; /* both C1 and C2 are calculated */
 	int16_t			c1, c2, crh;
 	uint8_t			checked_for_resel;
@@ -193,6 +207,14 @@ struct gsm322_cellsel {
 
 	/* cell re-selection */
 	struct llist_head	nb_list; /* list of neighbour cells */
+	struct gsm322_neighbour	*nb_index[1024+299];
+					/* neighbour cells per frequency */
+	struct gsm322_neighbour	*nb_ranked[GSM58_NB_NUMBER];
+					/* strongest neighbours, by RLA_C */
+	uint8_t			nb_ranked_num; /* entries in nb_ranked */
+	uint16_t		nb_pending; /* neighbours lacking samples */
+	uint16_t		nb_rotate; /* first unranked neighbour measured */
+	struct gsm322_neighbour	*nb_best; /* best re-selection candidate */
 	uint16_t		last_serving_arfcn; /* the ARFCN of last cell */
 	uint8_t			last_serving_valid; /* there is a last cell */
 	struct gsm322_neighbour	*neighbour; /* when selecting neighbour cell */
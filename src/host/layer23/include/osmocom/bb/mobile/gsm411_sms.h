@@ -5,10 +5,12 @@
 #define SMS_TEXT_SIZE	256
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <time.h>
 
 struct osmocom_ms;
 struct msgb;
+struct sms_store;
 
 struct gsm_sms {
 	unsigned long validity_minutes;
@@ -25,6 +27,10 @@ struct gsm_sms {
 	uint8_t user_data[SMS_TEXT_SIZE];
 
 	char text[SMS_TEXT_SIZE];
+
+	/* part of a bulk submission, see sms_bulk_queue() */
+	bool bulk;
+	struct timespec submitted;
 };
 
 int gsm411_sms_init(struct osmocom_ms *ms);
@@ -33,9 +39,17 @@ struct gsm_sms *sms_alloc(void);
 void sms_free(struct gsm_sms *sms);
 struct gsm_sms *sms_from_text(const char *receiver, int dcs, const char *text);
 int gsm411_rcv_sms(struct osmocom_ms *ms, struct msgb *msg);
+struct sms_store *gsm411_sms_store(struct osmocom_ms *ms);
 int sms_send(struct osmocom_ms *ms, const char *sms_sca, const char *number,
 	const char *text, uint8_t msg_ref);
 int gsm411_tx_sms_submit(struct osmocom_ms *ms, const char *sms_sca,
 	struct gsm_sms *sms);
+int sms_bulk_queue(struct osmocom_ms *ms, const char *sms_sca,
+	const char *number, const char *text);
+int sms_bulk_limit(struct osmocom_ms *ms, unsigned int concurrency,
+	unsigned int rate);
+void sms_bulk_flush(struct osmocom_ms *ms);
+void sms_bulk_dump(struct osmocom_ms *ms,
+	void (*print)(void *, const char *, ...), void *priv);
 
 #endif /* _GSM411_SMS_H */
@@ -1,9 +1,16 @@
 #ifndef _GSM48_RR_H
 #define _GSM48_RR_H
 
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
 #include <osmocom/core/timer.h>
+#include <osmocom/gsm/gsm23003.h>
 #include <osmocom/gsm/protocol/gsm_04_08.h>
 
+#include <osmocom/bb/common/paging_match.h>
+
 #define GSM_TA_CM			55385
 
 #define	T200_DCCH			1	/* SDCCH/FACCH */
@@ -127,11 +134,53 @@ struct gsm48_rr_cd {
 	uint8_t			cipher; /* ciphering of channel */
 };
 
-struct gsm48_cr_hist {
-	uint8_t			valid;
-	struct gsm48_req_ref	ref;
+/* history of confirmed CHANNEL REQUESTs, see gsm48_cr_key() */
+#define GSM48_CR_HIST_NUM		8 /* power of two */
+#define GSM48_CR_VALID			(1 << 24)
+
+/* latency from IMMEDIATE ASSIGNMENT to DM_EST_REQ, slot i counts
+ * latencies below 2^(i+4) us, the last one all above */
+#define GSM48_IA_LAT_NUM		12
+
+/* classes of the RR downlink queue, SAPI 0 is served first */
+enum gsm48_rr_dq_class {
+	GSM48_RR_DQ_SAPI0,
+	GSM48_RR_DQ_SAPI3,
+	GSM48_RR_DQ_NUM
+};
+
+/* a SAPI 3 message waits at most this long for SAPI 0 (ms) */
+#define GSM48_RR_DQ_SAPI3_WAIT		2000
+/* messages passed to layer 2 are outstanding until the network sends on
+ * the same SAPI, or this long after the last one (ms). Acknowledgements by
+ * RR frames are not seen by layer 3, so this is about two round trips of
+ * an SDCCH. */
+#define GSM48_RR_DQ_L2_WAIT		500
+
+struct gsm48_rr_dq {
+	struct llist_head	queue; /* of struct gsm48_rr_dq_msg */
+	uint32_t		depth, depth_max;
+	uint32_t		sent, dropped;
+	uint64_t		wait_sum; /* us */
+	uint32_t		wait_max; /* us */
+	uint32_t		l2_out; /* passed to layer 2, not answered */
+	struct timespec		l2_last; /* time of the last one */
+};
+
+/* strongest neighbours, as reported in the last MEASUREMENT REPORT */
+#define GSM48_HO_NB_NUM			6
+
+struct gsm48_rr_ho_nb {
+	uint16_t arfcn; /* with ARFCN_PCS, like nc_arfcn */
+	uint8_t bsic;
+	int8_t rxlev_dbm;
+	uint32_t fn; /* frame of the report */
 };
 
+/* handover interruption, slot i counts interruptions below 2^(i+4) ms,
+ * the last one all above */
+#define GSM48_HO_INT_NUM		10
+
 /* neighbor cell measurements */
 struct gsm48_rr_meas {
 	/* note: must be sorted by arfcn 1..1023,0 according to SI5* */
@@ -139,6 +188,13 @@ struct gsm48_rr_meas {
 	int8_t nc_rxlev_dbm[32]; /* -128 = no value */
 	uint8_t nc_bsic[32];
 	uint16_t nc_arfcn[32];
+
+	/* indexes of the strongest cells of a permitted NCC, by falling
+	 * RXLEV, kept up to date with each measurement */
+	uint8_t nc_top[6];
+	uint8_t nc_top_num;
+	bool nc_top_valid; /* if not, build it from all cells */
+	uint8_t nc_top_ncc; /* NCC PERMITTED it was built with */
 };
 
 /* RR sublayer instance */
@@ -149,8 +205,10 @@ struct gsm48_rrlayer {
 	/* queue for RSL-SAP message upwards */
 	struct llist_head	rsl_upqueue;
 
-	/* queue for messages while RR connection is built up */
-	struct llist_head       downqueue;
+	/* queues for messages to layer 2, while the link is suspended or
+	 * SAPI 3 would delay SAPI 0 on the same channel */
+	struct gsm48_rr_dq	dq[GSM48_RR_DQ_NUM];
+	struct osmo_timer_list	t_dq;
 
 	/* timers */
 	struct osmo_timer_list	t_starting; /* starting time for chan. access */
@@ -170,6 +228,9 @@ struct gsm48_rrlayer {
 	uint8_t			est_cause; /* cause used for establishment */
 	uint8_t			paging_mi_type; /* how did we got paged? */
 
+	/* our identities as coded in PAGING REQUEST, to match raw octets */
+	struct paging_ids	pag_id;
+
 	/* channel request states */
 	uint8_t			wait_assign; /* waiting for assignment state */
 	uint8_t			n_chan_req; /* number left, incl. current */
@@ -181,7 +242,13 @@ struct gsm48_rrlayer {
 
 	/* cr_hist */
 	uint8_t			cr_ra; /* stores requested ra until confirmed */
-	struct gsm48_cr_hist	cr_hist[5];
+	uint32_t		cr_hist[GSM48_CR_HIST_NUM]; /* ring */
+	uint8_t			cr_hist_next;
+	uint8_t			rach_s; /* S of 3.3.1.1.2, set on first RACH */
+
+	/* IMMEDIATE ASSIGNMENT latency */
+	struct timespec		ia_rx; /* reception of CCCH block, 0 if none */
+	uint32_t		ia_lat[GSM48_IA_LAT_NUM];
 
 	/* V(SD) sequence numbers */
 	uint16_t		v_sd; /* 16 PD 1-bit sequence numbers packed */
@@ -199,6 +266,19 @@ struct gsm48_rrlayer {
 	struct gsm48_rr_cd	cd_last; /* store last cd in case of failure */
 	struct gsm48_rr_cd	cd_before; /* before start time */
 	struct gsm48_rr_cd	cd_after; /* after start time */
+	/* MA of cd_before / cd_after, rendered when the command is checked */
+	uint16_t		ma_before[64], ma_after[64];
+	uint8_t			ma_before_len, ma_after_len;
+
+	/* handover context, so that the target cell is a lookup */
+	struct gsm48_rr_ho_nb	ho_nb[GSM48_HO_NB_NUM];
+	uint8_t			ho_nb_num;
+	uint32_t		ho_nb_hit, ho_nb_miss;
+
+	/* handover interruption: old channel released until link resumed */
+	struct timespec		ho_rel; /* 0 if no handover in progress */
+	uint32_t		ho_int[GSM48_HO_INT_NUM];
+	uint32_t		ho_int_last; /* ms */
 
 	/* BA range */
 	uint8_t			ba_ranges;
@@ -235,6 +315,45 @@ struct gsm48_rrlayer {
 	} vgcs;
 };
 
+/* request reference (10.5.2.30) with the given RA as one word, so that
+ * an assignment is matched with a single compare per entry */
+static inline uint32_t gsm48_cr_key(const struct gsm48_req_ref *ref,
+	uint8_t ra)
+{
+	const uint8_t *oct = (const uint8_t *)ref;
+
+	return GSM48_CR_VALID | (ra << 16) | (oct[1] << 8) | oct[2];
+}
+
+/* store the confirmed request of cr_ra, sent at the frame of 'ref' */
+static inline void gsm48_cr_hist_add(struct gsm48_rrlayer *rr,
+	const struct gsm48_req_ref *ref)
+{
+	rr->cr_hist[rr->cr_hist_next++ & (GSM48_CR_HIST_NUM - 1)] =
+		gsm48_cr_key(ref, rr->cr_ra);
+}
+
+static inline void gsm48_cr_hist_clear(struct gsm48_rrlayer *rr)
+{
+	memset(rr->cr_hist, 0, sizeof(rr->cr_hist));
+}
+
+/* match a request reference against the last 'num' requests */
+static inline bool gsm48_cr_hist_match(const struct gsm48_rrlayer *rr,
+	const struct gsm48_req_ref *ref, unsigned int num)
+{
+	uint32_t key = gsm48_cr_key(ref, ref->ra);
+	unsigned int i;
+
+	for (i = 1; i <= num && i <= GSM48_CR_HIST_NUM; i++) {
+		if (rr->cr_hist[(rr->cr_hist_next - i)
+				& (GSM48_CR_HIST_NUM - 1)] == key)
+			return true;
+	}
+
+	return false;
+}
+
 const char *get_rr_name(int value);
 extern int gsm48_rr_init(struct osmocom_ms *ms);
 extern int gsm48_rr_exit(struct osmocom_ms *ms);
@@ -253,5 +372,14 @@ int gsm48_rr_stop_monitor(struct osmocom_ms *ms);
 int gsm48_rr_alter_delay(struct osmocom_ms *ms);
 int gsm48_rr_tx_traffic(struct osmocom_ms *ms, struct msgb *msg);
 int gsm48_rr_audio_mode(struct osmocom_ms *ms, uint8_t mode);
+void gsm48_rr_drx_update(struct osmocom_ms *ms);
+void gsm48_rr_meas_ind(struct osmocom_ms *ms, uint16_t band_arfcn,
+	uint8_t rx_lev);
+void gsm48_rr_dump_ia_lat(struct osmocom_ms *ms,
+	void (*print)(void *, const char *, ...), void *priv);
+void gsm48_rr_dump_hando(struct osmocom_ms *ms,
+	void (*print)(void *, const char *, ...), void *priv);
+void gsm48_rr_dump_dq(struct osmocom_ms *ms,
+	void (*print)(void *, const char *, ...), void *priv);
 
 #endif /* _GSM48_RR_H */
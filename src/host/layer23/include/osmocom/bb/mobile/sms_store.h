@@ -0,0 +1,71 @@
+#ifndef _SMS_STORE_H
+#define _SMS_STORE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <osmocom/bb/mobile/gsm411_sms.h>
+
+/* Store of received SMS
+ *
+ * Each MS appends the SMS it receives to a file of its own. The file starts
+ * with a header, followed by records of variable length. A record is the
+ * length and a Fletcher-16 checksum of its payload, followed by the payload.
+ * Records that were torn by a crash are detected and cut off when the file
+ * is opened again. All values are stored little endian, so the file can be
+ * copied between hosts.
+ *
+ * Records are collected in a buffer that is written when it is full or
+ * SMS_STORE_FLUSH_MS after the first record was added. An SMS that was
+ * already acknowledged to the network is lost, if the process dies in
+ * between.
+ *
+ * An index of all records by receive time and by sender is kept in memory,
+ * it is built when the file is opened.
+ */
+
+#define SMS_STORE_MAGIC		"OBBSMS"
+#define SMS_STORE_VERSION	1
+#define SMS_STORE_HDR_LEN	16
+
+#define SMS_STORE_FLUSH_MS	1000
+
+#define SMS_STORE_F_UDHI	0x01 /* user data header present */
+#define SMS_STORE_F_SRI		0x02 /* status report indication */
+#define SMS_STORE_F_RP		0x04 /* reply path */
+#define SMS_STORE_F_CONCAT	0x08 /* part of a concatenated SMS */
+
+struct sms_store_rec {
+	time_t rx_time; /* time of reception */
+	time_t scts; /* service centre time stamp */
+	uint8_t protocol_id;
+	uint8_t data_coding_scheme;
+	uint8_t msg_ref;
+	uint8_t flags; /* see SMS_STORE_F_* */
+	/* concatenation information element, TS 23.040 9.2.3.24.1 */
+	uint16_t concat_ref;
+	uint8_t concat_total, concat_seq;
+	char address[20+1];
+	uint8_t user_data_len; /* TP-UDL */
+	uint8_t ud_octets; /* octets of user data stored */
+	uint8_t user_data[140];
+	char text[SMS_TEXT_SIZE]; /* decoded text, if 7 bit alphabet */
+};
+
+typedef int (*sms_store_cb)(void *priv, const struct sms_store_rec *rec);
+
+struct sms_store;
+
+struct sms_store *sms_store_open(void *ctx, const char *path);
+void sms_store_close(struct sms_store *st);
+int sms_store_add(struct sms_store *st, const struct gsm_sms *sms);
+int sms_store_flush(struct sms_store *st);
+unsigned int sms_store_count(const struct sms_store *st);
+int sms_store_query(struct sms_store *st, const char *sender, time_t from,
+	time_t to, unsigned int max, sms_store_cb cb, void *priv);
+
+int sms_store_read(const char *path, sms_store_cb cb, void *priv);
+void sms_store_print(const struct sms_store_rec *rec,
+	void (*print)(void *, const char *, ...), void *priv);
+
+#endif /* _SMS_STORE_H */
@@ -9,6 +9,8 @@
 struct gsm_trans {
 	/* Entry in list of all transactions */
 	struct llist_head entry;
+	/* Entry in the callref hash of the MS */
+	struct llist_head callref_entry;
 
 	/* The protocol within which we live */
 	uint8_t protocol;
@@ -89,6 +91,8 @@ struct gsm_trans *trans_alloc(struct osmocom_ms *ms,
 			      uint8_t protocol, uint8_t trans_id,
 			      uint32_t callref);
 void trans_free(struct gsm_trans *trans);
+void trans_set_id(struct gsm_trans *trans, uint8_t trans_id);
+void trans_set_callref(struct gsm_trans *trans, uint32_t callref);
 
 int trans_assign_trans_id(struct osmocom_ms *ms,
 			  uint8_t protocol, uint8_t ti_flag);
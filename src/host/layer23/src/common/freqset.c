@@ -0,0 +1,289 @@
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <errno.h>
+
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bb/common/freqset.h>
+
+/* W(k) fields are kept up to this index, which covers the longest
+ * Frequency List IE that fits into a message */
+#define W_MAX	256
+
+static inline int ilog2(unsigned int v)
+{
+	return 31 - __builtin_clz(v);
+}
+
+/* read up to 16 bits MSB first, -1 if beyond the end of the list */
+static int get_bits(const uint8_t *cd, uint8_t len, unsigned int *pos,
+		    unsigned int bits)
+{
+	unsigned int byte = *pos >> 3;
+	uint32_t w;
+
+	if (*pos + bits > (unsigned int)len << 3)
+		return -1;
+	w = cd[byte] << 16;
+	if (byte + 1 < len)
+		w |= cd[byte + 1] << 8;
+	if (byte + 2 < len)
+		w |= cd[byte + 2];
+	w >>= 24 - (*pos & 7) - bits;
+	*pos += bits;
+
+	return w & ((1 << bits) - 1);
+}
+
+/* get F(k) from W(1..k) of a range format, see TS 44.018 Annex J */
+static int range_freq(const uint16_t *w, unsigned int k, unsigned int range)
+{
+	unsigned int index = k;
+	unsigned int j = 1 << ilog2(k);
+	unsigned int m;
+	int n = w[index];
+
+	while (index > 1) {
+		m = 2 * range / j - 1;
+		if (2 * index < 3 * j) {
+			/* left child */
+			index -= j / 2;
+			n = (n + w[index] - range / j - 1 + m) % m + 1;
+		} else {
+			/* right child */
+			index -= j;
+			n = (n + w[index] - 1) % m + 1;
+		}
+		j >>= 1;
+	}
+
+	return n;
+}
+
+/* range formats: W(k) has 'ilog2(range) - ilog2(k)' bits, the list ends at
+ * the first W(k) that is 0 or at the end of the IE */
+static void decode_range(struct gsm_freq_set *set, const uint8_t *cd,
+			 uint8_t len, unsigned int pos, unsigned int range,
+			 uint16_t orig)
+{
+	uint16_t w[W_MAX];
+	int bits, v;
+	unsigned int k, num;
+
+	for (k = 1; k < W_MAX; k++) {
+		bits = ilog2(range) - ilog2(k);
+		if (bits <= 0)
+			break;
+		v = get_bits(cd, len, &pos, bits);
+		if (v <= 0)
+			break;
+		w[k] = v;
+	}
+	num = k - 1;
+
+	for (k = 1; k <= num; k++)
+		gsm_freq_set_add(set, orig + range_freq(w, k, range));
+}
+
+/* decode "Frequency List" / "Cell Channel Description" (10.5.2.13 / 10.5.2.1b)
+ * into a set of ARFCNs. 'mask' selects the bits of the first octet that
+ * identify the format, like gsm48_decode_freq_list() of libosmogsm. */
+int gsm_freq_set_decode(struct gsm_freq_set *set, const uint8_t *cd,
+			uint8_t len, uint8_t mask)
+{
+	unsigned int pos, i;
+	int v, orig;
+
+	gsm_freq_set_clear(set);
+
+	if (len < 1)
+		return -EINVAL;
+
+	/* 00..XXX. */
+	if ((cd[0] & 0xc0 & mask) == 0x00) {
+		/* Bit map 0 format, ARFCN 1..124 */
+		if (len < 16)
+			return -EINVAL;
+		for (i = 0; i < 16; i++) {
+			unsigned int a = (i << 3) + 1;
+			uint64_t v8 = cd[15 - i];
+
+			if (i == 15)
+				v8 &= 0x0f;
+			set->bits[a >> 6] |= v8 << (a & 63);
+			if ((a & 63) > 56)
+				set->bits[(a >> 6) + 1] |= v8 >> (64 - (a & 63));
+		}
+		return 0;
+	}
+
+	/* 10..0XX. */
+	if ((cd[0] & 0xc8 & mask) == 0x80) {
+		/* Range 1024 format, F0 indicates ARFCN 0 */
+		if (len < 2)
+			return -EINVAL;
+		if ((cd[0] & 0x04))
+			gsm_freq_set_add(set, 0);
+		decode_range(set, cd, len, 6, 1024, 0);
+		return 0;
+	}
+
+	/* all other formats start with the ORIG-ARFCN */
+	pos = 7;
+	orig = get_bits(cd, len, &pos, 10);
+	if (orig < 0)
+		return -EINVAL;
+
+	switch (cd[0] & 0xce & mask) {
+	case 0x88:
+		/* Range 512 format */
+		gsm_freq_set_add(set, orig);
+		decode_range(set, cd, len, pos, 512, orig);
+		return 0;
+	case 0x8a:
+		/* Range 256 format */
+		gsm_freq_set_add(set, orig);
+		decode_range(set, cd, len, pos, 256, orig);
+		return 0;
+	case 0x8c:
+		/* Range 128 format */
+		gsm_freq_set_add(set, orig);
+		decode_range(set, cd, len, pos, 128, orig);
+		return 0;
+	case 0x8e:
+		/* Variable bitmap format, RRFCN n is ORIG-ARFCN + n */
+		gsm_freq_set_add(set, orig);
+		for (i = 1; pos < ((unsigned int)len << 3); i++) {
+			v = get_bits(cd, len, &pos, 1);
+			if (v > 0)
+				gsm_freq_set_add(set, orig + i);
+		}
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+int gsm_freq_set_count(const struct gsm_freq_set *set)
+{
+	int i, num = 0;
+
+	for (i = 0; i < 1024 / 64; i++)
+		num += __builtin_popcountll(set->bits[i]);
+
+	return num;
+}
+
+/* bits of a word in list order, ARFCN 0 is moved to the end */
+static inline uint64_t set_word(const struct gsm_freq_set *set, int i)
+{
+	return (i == 0) ? (set->bits[0] & ~1ULL) : set->bits[i];
+}
+
+/* get the n-th ARFCN of the set (1..1023, 0), -1 if there are less */
+int gsm_freq_set_nth(const struct gsm_freq_set *set, unsigned int n)
+{
+	uint64_t word;
+	unsigned int cnt;
+	int i;
+
+	for (i = 0; i < 1024 / 64; i++) {
+		word = set_word(set, i);
+		cnt = __builtin_popcountll(word);
+		if (n < cnt) {
+			/* drop the n lowest bits */
+			while (n--)
+				word &= word - 1;
+			return (i << 6) + __builtin_ctzll(word);
+		}
+		n -= cnt;
+	}
+	if (n == 0 && (set->bits[0] & 1))
+		return 0;
+
+	return -1;
+}
+
+/* write up to 'max' ARFCNs of the set in list order (1..1023, 0) and return
+ * the total number of ARFCNs in the set */
+int gsm_freq_set_list(const struct gsm_freq_set *set, uint16_t *arfcn,
+		      unsigned int max)
+{
+	uint64_t word;
+	unsigned int num = 0;
+	int i;
+
+	for (i = 0; i < 1024 / 64; i++) {
+		for (word = set_word(set, i); word; word &= word - 1) {
+			if (num < max)
+				arfcn[num] = (i << 6) + __builtin_ctzll(word);
+			num++;
+		}
+	}
+	if ((set->bits[0] & 1)) {
+		if (num < max)
+			arfcn[num] = 0;
+		num++;
+	}
+
+	return num;
+}
+
+/* deposit the low bits of 'src' into the set bits of 'mask', in ascending
+ * order (what the PDEP instruction does) */
+static inline uint64_t deposit(uint64_t src, uint64_t mask)
+{
+	uint64_t result = 0, bit;
+
+	for (; src && mask; mask &= mask - 1, src >>= 1) {
+		bit = mask & -mask;
+		if ((src & 1))
+			result |= bit;
+	}
+
+	return result;
+}
+
+/* Select ARFCNs of the set by a bitmap of up to 64 bits, like the "Mobile
+ * Allocation" (10.5.2.21): bit n (starting at the last octet) selects the
+ * n-th ARFCN of the set. Bits beyond the size of the set are ignored.
+ * Return the number of selected ARFCNs. */
+int gsm_freq_set_select(const struct gsm_freq_set *set, const uint8_t *ma,
+			uint8_t len, uint16_t *arfcn)
+{
+	uint64_t map = 0, sel;
+	unsigned int idx = 0;
+	int i, num = 0;
+
+	if (len > 8)
+		return -EINVAL;
+	for (i = 0; i < len; i++)
+		map |= (uint64_t)ma[len - 1 - i] << (i << 3);
+
+	for (i = 0; i < 1024 / 64 && idx < 64 && (map >> idx); i++) {
+		sel = deposit(map >> idx, set_word(set, i));
+		idx += __builtin_popcountll(set_word(set, i));
+		for (; sel; sel &= sel - 1)
+			arfcn[num++] = (i << 6) + __builtin_ctzll(sel);
+	}
+	if ((set->bits[0] & 1) && idx < 64 && ((map >> idx) & 1))
+		arfcn[num++] = 0;
+
+	return num;
+}
@@ -56,6 +56,7 @@ int gsmtap_send(void *src, uint16_t arfcn, int8_t signal_dbm, int8_t snr,
 #include <osmocom/bb/common/ms.h>
 #include <osmocom/bb/common/l1l2_interface.h>
 #include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/common/meas_rep.h>
 
 /* determine the CCCH block number based on the frame number */
 static unsigned int fn2ccch_block(uint32_t fn)
@@ -195,10 +196,67 @@ static int rx_l1_rach_conf(struct osmocom_ms *ms, struct msgb *msg)
 	return lapdm_phsap_up(&pp.oph, le);
 }
 
+/* page mode, TS 44.018 §10.5.2.26 */
+#define PAGE_MODE_NORMAL	0
+#define PAGE_MODE_EXTENDED	1
+#define PAGE_MODE_REORG		2
+
+static inline bool drx_own_block(const struct rx_drx *drx, uint32_t fn)
+{
+	return (fn % 51) == drx->fn51
+		&& (fn / 51) % drx->bs_pa_mfrms == drx->mf_index;
+}
+
+/* DRX: check if a CCCH block can be dropped without decoding. The page mode
+ * of our paging block tells if all blocks must be read. */
+static bool drx_skip_block(struct osmocom_ms *ms, const struct l1ctl_info_dl *dl,
+			   uint32_t fn, const uint8_t *data)
+{
+	struct rx_drx *drx = &ms->drx;
+
+	if (!drx->active)
+		return false;
+
+	if (!drx_own_block(drx, fn)) {
+		if (drx->all) {
+			drx->passed++;
+			return false;
+		}
+		drx->dropped++;
+		return true;
+	}
+
+	/* octet 1 is the L2 pseudo length */
+	if (dl->fire_crc < 2 && (data[1] & 0x0f) == GSM48_PDISC_RR) {
+		switch (data[2]) {
+		case GSM48_MT_RR_PAG_REQ_1:
+		case GSM48_MT_RR_PAG_REQ_2:
+		case GSM48_MT_RR_PAG_REQ_3:
+		case GSM48_MT_RR_IMM_ASS:
+		case GSM48_MT_RR_IMM_ASS_EXT:
+		case GSM48_MT_RR_IMM_ASS_REJ:
+			switch (data[3] & 0x03) {
+			case PAGE_MODE_NORMAL:
+				drx->all = false;
+				break;
+			case PAGE_MODE_EXTENDED:
+			case PAGE_MODE_REORG:
+				drx->all = true;
+				break;
+			}
+			break;
+		}
+	}
+	drx->passed++;
+
+	return false;
+}
+
 /* Receive L1CTL_DATA_IND (Data Indication from L1) */
 static int rx_ph_data_ind(struct osmocom_ms *ms, struct msgb *msg)
 {
 	struct osmo_phsap_prim pp;
+	struct osmobb_cbch_ind ci;
 	struct l1ctl_info_dl *dl;
 	struct l1ctl_data_ind *ccch;
 	struct lapdm_entity *le;
@@ -227,27 +285,46 @@ static int rx_ph_data_ind(struct osmocom_ms *ms, struct msgb *msg)
 		return -EINVAL;
 	}
 
+	meas->last_fn = ntohl(dl->frame_nr);
+
+	/* in idle mode, blocks of other paging groups are of no use */
+	if (chan_type == RSL_CHAN_PCH_AGCH && !(dl->link_id & 0x40)
+	 && drx_skip_block(ms, dl, meas->last_fn, ccch->data)) {
+		msgb_free(msg);
+		return 0;
+	}
+
 	DEBUGP(DL1C, "%s (%.4u/%.2u/%.2u) %d dBm: %s\n",
 		rsl_chan_nr_str(dl->chan_nr), tm.t1, tm.t2, tm.t3,
 		(int)dl->rx_level-110,
 		osmo_hexdump(ccch->data, sizeof(ccch->data)));
 
-	meas->last_fn = ntohl(dl->frame_nr);
 	meas->frames++;
 	meas->snr += dl->snr;
 	meas->berr += dl->num_biterr;
 	meas->rxlev += dl->rx_level;
 
+	switch (chan_type) {
+	case RSL_CHAN_Bm_ACCHs:
+	case RSL_CHAN_Lm_ACCHs:
+	case RSL_CHAN_SDCCH4_ACCH:
+	case RSL_CHAN_SDCCH8_ACCH:
+		meas_rep_sample(&ms->meas_rep, dl->chan_nr, dl->link_id,
+				meas->last_fn, dl->rx_level, dl->num_biterr,
+				456);
+		break;
+	}
+
 	/* counting loss criteria */
 	if (!(dl->link_id & 0x40)) {
 		switch (chan_type) {
 		case RSL_CHAN_PCH_AGCH:
-			/* only look at one CCCH frame in each 51 multiframe.
-			 * FIXME: implement DRX
-			 * - select correct paging block that is for us.
-			 * - initialize ds_fail according to BS_PA_MFRMS.
-			 */
-			if ((meas->last_fn % 51) != 6)
+			/* with DRX, look at our paging block, TS 45.008 §6.5,
+			 * else at one CCCH frame in each 51 multiframe. */
+			if (ms->drx.active) {
+				if (!drx_own_block(&ms->drx, meas->last_fn))
+					break;
+			} else if ((meas->last_fn % 51) != 6)
 				break;
 			if (!meas->ds_fail)
 				break;
@@ -314,9 +391,16 @@ static int rx_ph_data_ind(struct osmocom_ms *ms, struct msgb *msg)
 
 	/* Do not pass PDCH and CBCH frames to LAPDm */
 	switch (chan_type) {
-	case RSL_CHAN_OSMO_PDCH:
 	case RSL_CHAN_OSMO_CBCH4:
 	case RSL_CHAN_OSMO_CBCH8:
+		ci.ms = ms;
+		ci.band_arfcn = ntohs(dl->band_arfcn);
+		ci.fn = tm.fn;
+		ci.data = ccch->data;
+		osmo_signal_dispatch(SS_L1CTL, S_L1CTL_CBCH_IND, &ci);
+		msgb_free(msg);
+		return 0;
+	case RSL_CHAN_OSMO_PDCH:
 		/* TODO: pass directly to l23 application */
 		msgb_free(msg);
 		return 0;
@@ -878,6 +962,11 @@ static int rx_l1_traffic_ind(struct osmocom_ms *ms, struct msgb *msg)
 	LOGP(DL1C, LOGL_DEBUG, "Rx TRAFFIC.ind (fn=%u, chan_nr=0x%02x, len=%u): %s\n",
 	     ntohl(dl->frame_nr), dl->chan_nr, msgb_l3len(msg), msgb_hexdump_l3(msg));
 
+	/* a half rate speech block has 228 coded bits */
+	meas_rep_sample(&ms->meas_rep, dl->chan_nr, dl->link_id,
+			ntohl(dl->frame_nr), dl->rx_level, dl->num_biterr,
+			(dl->chan_nr & 0xf0) == RSL_CHAN_Lm_ACCHs ? 228 : 456);
+
 	/* distribute or drop */
 	if (ms->l1_entity.l1_traffic_ind)
 		return ms->l1_entity.l1_traffic_ind(ms, msg);
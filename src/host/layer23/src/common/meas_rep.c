@@ -0,0 +1,113 @@
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <osmocom/gsm/rsl.h>
+#include <osmocom/gsm/protocol/gsm_08_58.h>
+
+#include <osmocom/bb/common/meas_rep.h>
+
+void meas_rep_reset(struct rx_meas_rep *mr)
+{
+	memset(mr, 0, sizeof(*mr));
+}
+
+/* RXQUAL of a bit error rate, TS 45.008 8.2.4: RXQUAL_0 is below 0.2 %,
+ * each further step doubles the limit, RXQUAL_7 is above 12.8 % */
+uint8_t meas_rep_rxqual(uint32_t berr, uint32_t bits)
+{
+	uint64_t limit = (uint64_t)bits * 2;
+	uint8_t q = 0;
+
+	while (q < 7 && (uint64_t)berr * 1000 >= limit) {
+		limit <<= 1;
+		q++;
+	}
+
+	return q;
+}
+
+/* blocks that are sent with downlink DTX, TS 45.008 8.4 table 1 */
+static bool sub_block(uint8_t chan_nr, uint8_t link_id, uint32_t fn)
+{
+	uint8_t ch_type, ch_subch, ch_ts;
+	uint32_t f = fn % 104;
+
+	if ((link_id & 0x40))
+		return true;
+	if (rsl_dec_chan_nr(chan_nr, &ch_type, &ch_subch, &ch_ts) != 0)
+		return false;
+
+	switch (ch_type) {
+	case RSL_CHAN_Bm_ACCHs:
+		/* one block, frames 52..59, fn is that of its first burst */
+		return f == 52;
+	case RSL_CHAN_Lm_ACCHs:
+		if (ch_subch)
+			f = (f + 104 - 14) % 104;
+		return !(f & 1) && (f <= 6 || (f >= 52 && f <= 58));
+	default:
+		/* no DTX on SDCCH */
+		return true;
+	}
+}
+
+static void set_add(struct rx_meas_set *set, uint8_t rx_level,
+		    uint8_t num_biterr, uint16_t bits)
+{
+	set->blocks++;
+	set->rxlev += rx_level;
+	set->berr += num_biterr;
+	set->bits += bits;
+}
+
+static uint8_t set_rxlev(const struct rx_meas_set *set)
+{
+	uint32_t rxlev = (set->rxlev + set->blocks / 2) / set->blocks;
+
+	return rxlev > 63 ? 63 : rxlev;
+}
+
+/* end of the reporting period */
+static void period_close(struct rx_meas_rep *mr)
+{
+	/* the SUB set contains the SACCH block, so it is never empty */
+	mr->rxlev_full = set_rxlev(&mr->full);
+	mr->rxlev_sub = set_rxlev(&mr->sub);
+	mr->rxqual_full = meas_rep_rxqual(mr->full.berr, mr->full.bits);
+	mr->rxqual_sub = meas_rep_rxqual(mr->sub.berr, mr->sub.bits);
+	mr->valid = true;
+	mr->periods++;
+
+	memset(&mr->full, 0, sizeof(mr->full));
+	memset(&mr->sub, 0, sizeof(mr->sub));
+}
+
+/* one block received on the dedicated channel, its FACCH or its SACCH */
+void meas_rep_sample(struct rx_meas_rep *mr, uint8_t chan_nr, uint8_t link_id,
+		     uint32_t fn, uint8_t rx_level, uint8_t num_biterr,
+		     uint16_t bits)
+{
+	set_add(&mr->full, rx_level, num_biterr, bits);
+	if (sub_block(chan_nr, link_id, fn))
+		set_add(&mr->sub, rx_level, num_biterr, bits);
+
+	if ((link_id & 0x40))
+		period_close(mr);
+}
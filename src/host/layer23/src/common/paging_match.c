@@ -0,0 +1,81 @@
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/gsm/gsm48.h>
+
+#include <osmocom/bb/common/paging_match.h>
+
+/* The IMSI is only encoded again after it changed, this costs one strcmp
+ * per paging request. */
+void paging_ids_update(struct paging_ids *ids, uint32_t tmsi, bool tmsi_valid,
+		       const char *imsi)
+{
+	struct osmo_mobile_identity mi = {
+		.type = GSM_MI_TYPE_IMSI,
+	};
+	int rc;
+
+	ids->tmsi_valid = tmsi_valid;
+	osmo_store32be(tmsi, ids->tmsi);
+
+	if (!strcmp(ids->imsi, imsi))
+		return;
+	OSMO_STRLCPY_ARRAY(ids->imsi, imsi);
+	ids->imsi_mi_len = 0;
+	if (!imsi[0])
+		return;
+	OSMO_STRLCPY_ARRAY(mi.imsi, imsi);
+	rc = osmo_mobile_identity_encode_buf(ids->imsi_mi,
+		sizeof(ids->imsi_mi), &mi, false);
+	if (rc > 0)
+		ids->imsi_mi_len = rc;
+}
+
+uint8_t paging_match_mi(const struct paging_ids *ids, const uint8_t *mi_lv)
+{
+	uint8_t mi_type;
+
+	if (mi_lv[0] < 1)
+		return 0;
+	mi_type = mi_lv[1] & GSM_MI_TYPE_MASK;
+
+	switch (mi_type) {
+	case GSM_MI_TYPE_TMSI:
+		if (ids->tmsi_valid && mi_lv[0] == 5
+		 && !memcmp(mi_lv + 2, ids->tmsi, 4))
+			return mi_type;
+		break;
+	case GSM_MI_TYPE_IMSI:
+		if (ids->imsi_mi_len && mi_lv[0] == ids->imsi_mi_len
+		 && !memcmp(mi_lv + 1, ids->imsi_mi, mi_lv[0]))
+			return mi_type;
+		break;
+	}
+
+	return 0;
+}
+
+bool paging_match_tmsi(const struct paging_ids *ids, const void *tmsi)
+{
+	return ids->tmsi_valid && !memcmp(tmsi, ids->tmsi, 4);
+}
@@ -0,0 +1,288 @@
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/gsm/gsm23003.h>
+#include <osmocom/gsm/gsm48.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/common/paging_watch.h>
+
+#define WATCH_MIN	64 /* initial size of the table */
+
+struct watch_entry {
+	uint8_t len; /* 0: empty */
+	uint8_t mi[PAGING_WATCH_MI_MAX];
+};
+
+static struct {
+	/* open addressing, at most half full */
+	struct watch_entry *table;
+	unsigned int size, num;
+
+	FILE *outfp;
+	unsigned long events;
+} pw;
+
+/* Bring an identity into the form of the table: the unused upper nibble
+ * of a TMSI and the filler of an even IMSI may be set to anything. */
+static int watch_key(struct watch_entry *e, const uint8_t *mi, uint8_t len)
+{
+	if (len < 1 || len > PAGING_WATCH_MI_MAX)
+		return -EINVAL;
+
+	switch (mi[0] & GSM_MI_TYPE_MASK) {
+	case GSM_MI_TYPE_TMSI:
+		if (len != 5)
+			return -EINVAL;
+		e->mi[0] = 0xf0 | GSM_MI_TYPE_TMSI;
+		memcpy(e->mi + 1, mi + 1, 4);
+		break;
+	case GSM_MI_TYPE_IMSI:
+		memcpy(e->mi, mi, len);
+		if (!(mi[0] & GSM_MI_ODD))
+			e->mi[len - 1] |= 0xf0;
+		break;
+	default:
+		return -EINVAL;
+	}
+	e->len = len;
+
+	return 0;
+}
+
+/* FNV-1a over the octets */
+static unsigned int watch_slot(const struct watch_entry *e, unsigned int size)
+{
+	uint32_t h = 2166136261u;
+	unsigned int i;
+
+	for (i = 0; i < e->len; i++) {
+		h ^= e->mi[i];
+		h *= 16777619u;
+	}
+
+	return h & (size - 1);
+}
+
+static struct watch_entry *watch_find(struct watch_entry *table,
+	unsigned int size, const struct watch_entry *e)
+{
+	struct watch_entry *t;
+	unsigned int i;
+
+	for (i = watch_slot(e, size); ; i = (i + 1) & (size - 1)) {
+		t = &table[i];
+		if (!t->len)
+			return t;
+		if (t->len == e->len && !memcmp(t->mi, e->mi, e->len))
+			return t;
+	}
+}
+
+static int watch_insert(const struct watch_entry *e)
+{
+	struct watch_entry *table, *t;
+	unsigned int i, size;
+
+	if ((pw.num + 1) * 2 > pw.size) {
+		size = pw.size ? pw.size * 2 : WATCH_MIN;
+		table = calloc(size, sizeof(*table));
+		if (!table)
+			return -ENOMEM;
+		for (i = 0; i < pw.size; i++) {
+			if (pw.table[i].len)
+				*watch_find(table, size, &pw.table[i]) =
+					pw.table[i];
+		}
+		free(pw.table);
+		pw.table = table;
+		pw.size = size;
+	}
+
+	t = watch_find(pw.table, pw.size, e);
+	if (t->len)
+		return 0;
+	*t = *e;
+	pw.num++;
+
+	return 1;
+}
+
+/* Add an identity given as IMSI digits or as TMSI in hex with "0x". The
+ * forms written by osmo_mobile_identity_to_str_buf() are accepted, too.
+ * Return 1 if added, 0 if already present. */
+int paging_watch_add(const char *id)
+{
+	struct osmo_mobile_identity omi = {};
+	struct watch_entry e;
+	uint8_t mi[GSM48_MI_SIZE];
+	unsigned long tmsi;
+	char *end;
+	int rc;
+
+	if (!strncmp(id, "IMSI-", 5) || !strncmp(id, "TMSI-", 5))
+		id += 5;
+
+	if (!strncmp(id, "0x", 2) || !strncmp(id, "0X", 2)) {
+		errno = 0;
+		tmsi = strtoul(id + 2, &end, 16);
+		if (errno || end == id + 2 || *end || tmsi > 0xffffffff)
+			return -EINVAL;
+		mi[0] = 0xf0 | GSM_MI_TYPE_TMSI;
+		osmo_store32be(tmsi, mi + 1);
+		rc = 5;
+	} else {
+		if (!osmo_imsi_str_valid(id))
+			return -EINVAL;
+		omi.type = GSM_MI_TYPE_IMSI;
+		OSMO_STRLCPY_ARRAY(omi.imsi, id);
+		rc = osmo_mobile_identity_encode_buf(mi, sizeof(mi), &omi,
+						     false);
+		if (rc < 0)
+			return rc;
+	}
+
+	rc = watch_key(&e, mi, rc);
+	if (rc < 0)
+		return rc;
+
+	return watch_insert(&e);
+}
+
+/* Load one identity per line, '#' starts a comment. Return the number of
+ * identities added. */
+int paging_watch_load(const char *path)
+{
+	char line[64], *p, *end;
+	unsigned int n = 0, lineno = 0;
+	FILE *fp;
+	int rc;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return -errno;
+
+	while (fgets(line, sizeof(line), fp)) {
+		lineno++;
+		if ((p = strchr(line, '#')))
+			*p = '\0';
+		for (p = line; isspace((unsigned char)*p); p++)
+			;
+		for (end = p + strlen(p); end > p
+		  && isspace((unsigned char)end[-1]); end--)
+			;
+		*end = '\0';
+		if (!*p)
+			continue;
+
+		rc = paging_watch_add(p);
+		if (rc == -ENOMEM) {
+			fclose(fp);
+			return rc;
+		}
+		if (rc < 0)
+			LOGP(DPAG, LOGL_ERROR, "%s:%u: invalid identity '%s'\n",
+				path, lineno, p);
+		else
+			n += rc;
+	}
+	fclose(fp);
+
+	LOGP(DPAG, LOGL_NOTICE, "Watching %u identities from '%s', %u in "
+		"total\n", n, path, pw.num);
+	return n;
+}
+
+void paging_watch_clear(void)
+{
+	free(pw.table);
+	pw.table = NULL;
+	pw.size = pw.num = 0;
+}
+
+unsigned int paging_watch_count(void)
+{
+	return pw.num;
+}
+
+bool paging_watch_match(const uint8_t *mi, uint8_t len)
+{
+	struct watch_entry e;
+
+	if (!pw.num || watch_key(&e, mi, len) < 0)
+		return false;
+
+	return watch_find(pw.table, pw.size, &e)->len != 0;
+}
+
+/* report a match */
+void paging_watch_event(uint32_t fn, uint16_t arfcn, uint8_t chan_needed,
+			const uint8_t *mi, uint8_t len)
+{
+	struct osmo_mobile_identity omi;
+	char buf[32];
+
+	pw.events++;
+	if (osmo_mobile_identity_decode(&omi, mi, len, false) < 0)
+		return;
+	osmo_mobile_identity_to_str_buf(buf, sizeof(buf), &omi);
+
+	LOGP(DPAG, LOGL_NOTICE, "Watched %s paged (ARFCN %u, fn %u, channel "
+		"needed %u)\n", buf, arfcn, fn, chan_needed);
+	if (pw.outfp) {
+		fprintf(pw.outfp, "%lu %u %u %u %s\n", (unsigned long)time(NULL),
+			fn, arfcn, chan_needed, buf);
+		fflush(pw.outfp);
+	}
+}
+
+unsigned long paging_watch_events(void)
+{
+	return pw.events;
+}
+
+/* open the event output, "-" is stdout */
+int paging_watch_open(const char *path)
+{
+	paging_watch_close();
+	if (!strcmp(path, "-"))
+		pw.outfp = stdout;
+	else
+		pw.outfp = fopen(path, "a");
+	if (!pw.outfp)
+		return -errno;
+
+	return 0;
+}
+
+void paging_watch_close(void)
+{
+	if (pw.outfp && pw.outfp != stdout)
+		fclose(pw.outfp);
+	pw.outfp = NULL;
+}
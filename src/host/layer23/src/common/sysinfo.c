@@ -17,11 +17,12 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
+#include <errno.h>
 #include <arpa/inet.h>
 
 #include <osmocom/core/utils.h>
-#include <osmocom/core/bitvec.h>
 #include <osmocom/gsm/gsm48.h>
 #include <osmocom/gsm/gsm48_rest_octets.h>
 
@@ -392,11 +393,34 @@ int gsm48_decode_chan_h1(const struct gsm48_chan_desc *cd,
 	return 0;
 }
 
-/* decode "Cell Channel Description" (10.5.2.1b) and other frequency lists */
+/* decode "Cell Channel Description" (10.5.2.1b) and other frequency lists
+ * into a set and mark the ARFCNs of the set with 'frqt' */
+int gsm48_decode_freq_set(struct gsm_sysinfo_freq *f, struct gsm_freq_set *set,
+			  const uint8_t *cd, uint8_t len, uint8_t mask,
+			  uint8_t frqt)
+{
+	uint64_t word;
+	int rc, i, j;
+
+	rc = gsm_freq_set_decode(set, cd, len, mask);
+
+	for (i = 0; i < 1024 / 64; i++) {
+		word = set->bits[i];
+		for (j = 0; j < 64; j++, word >>= 1)
+			f[(i << 6) + j].mask = (f[(i << 6) + j].mask & ~frqt)
+						| ((word & 1) ? frqt : 0);
+	}
+
+	return rc;
+}
+
 static int decode_freq_list(struct gsm_sysinfo_freq *f,
+			    struct gsm_freq_set *set,
 			    const uint8_t *cd, uint8_t len,
 			    uint8_t mask, uint8_t frqt)
 {
+	struct gsm_freq_set tmp;
+
 #if 0
 	/* only Bit map 0 format for P-GSM */
 	if ((cd[0] & 0xc0 & mask) != 0x00 &&
@@ -404,7 +428,7 @@ static int decode_freq_list(struct gsm_sysinfo_freq *f,
 		return 0;
 #endif
 
-	return gsm48_decode_freq_list(f, cd, len, mask, frqt);
+	return gsm48_decode_freq_set(f, set ? : &tmp, cd, len, mask, frqt);
 }
 
 /* decode "Cell Selection Parameters" (10.5.2.4) */
@@ -456,55 +480,32 @@ static int gsm48_decode_ccd(struct gsm48_sysinfo *s,
 }
 
 /* decode "Mobile Allocation" (10.5.2.21) */
-int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
+int gsm48_decode_mobile_alloc(const struct gsm_freq_set *ca,
 			      const uint8_t *ma, uint8_t len,
-			      uint16_t *hopping, uint8_t *hopp_len, int si4)
+			      uint16_t *hopping, uint8_t *hopp_len)
 {
-	int i, j = 0;
-	uint16_t f[len << 3];
+	int i, num;
 
 	/* not more than 64 hopping indexes allowed in IE */
 	if (len > 8)
 		return -EINVAL;
 
-	/* tabula rasa */
-	*hopp_len = 0;
-	if (si4) {
-		for (i = 0; i < 1024; i++)
-			freq[i].mask &= ~FREQ_TYPE_HOPP;
-	}
+	num = gsm_freq_set_select(ca, ma, len, hopping);
+	*hopp_len = num;
+	for (i = 0; i < num; i++)
+		LOGP(DRR, LOGL_INFO, "Hopping ARFCN: %d\n", hopping[i]);
 
-	/* generating list of all frequencies (1..1023,0) */
-	for (i = 1; i <= 1024; i++) {
-		if ((freq[i & 1023].mask & FREQ_TYPE_SERV)) {
-			LOGP(DRR, LOGL_INFO, "Serving cell ARFCN #%d: %d\n",
-				j, i & 1023);
-			f[j++] = i & 1023;
-			if (j == (len << 3))
-				break;
-		}
+	/* index higher than entries in list ? */
+	for (i = (len << 3) - 1; i >= 0; i--) {
+		if ((ma[len - 1 - (i >> 3)] & (1 << (i & 7))))
+			break;
 	}
-
-	/* fill hopping table with frequency index given by IE
-	 * and set hopping type bits
-	 */
-	for (i = 0; i < (len << 3); i++) {
-		/* if bit is set, this frequency index is used for hopping */
-		if ((ma[len - 1 - (i >> 3)] & (1 << (i & 7)))) {
-			LOGP(DRR, LOGL_INFO, "Hopping ARFCN: %d (bit %d)\n",
-				i, f[i]);
-			/* index higher than entries in list ? */
-			if (i >= j) {
-				LOGP(DRR, LOGL_NOTICE, "Mobile Allocation "
-					"hopping index %d exceeds maximum "
-					"number of cell frequencies. (%d)\n",
-					i + 1, j);
-				break;
-			}
-			hopping[(*hopp_len)++] = f[i];
-			if (si4)
-				freq[f[i]].mask |= FREQ_TYPE_HOPP;
-		}
+	num = gsm_freq_set_count(ca);
+	if (i >= num) {
+		LOGP(DRR, LOGL_NOTICE, "Mobile Allocation "
+			"hopping index %d exceeds maximum "
+			"number of cell frequencies. (%d)\n",
+			i + 1, num);
 	}
 
 	return 0;
@@ -542,111 +543,254 @@ static int gsm48_decode_rach_ctl_neigh(struct gsm48_sysinfo *s,
 	return 0;
 }
 
+/*
+ * Rest octets decoding
+ *
+ * The rest octets are described by tables of fields, similar to their CSN.1
+ * description. The decoder walks the table and stores each field into the
+ * member of the target structure at the given offset. All members are single
+ * octets.
+ *
+ * An H/L bit is H, if it differs from the bit of the padding pattern 0x2b at
+ * the same position. Bits beyond the end of the rest octets are read as L,
+ * just like padding.
+ */
+
+enum rest_op {
+	REST_END = 0,
+	REST_FLAG,	/* H/L stored as 1/0, if L skip 'bits' entries */
+	REST_OPT,	/* H/L, 1 stored if H, if L skip 'bits' entries */
+	REST_OPT_DFLT,	/* H/L, if L store 'dflt' in the member of the next
+			 * entry and skip it */
+	REST_COND,	/* H/L, if L end of decoding */
+	REST_BREAK,	/* H/L, if H store 1 and end of decoding */
+	REST_UINT,	/* field of 'bits' */
+	REST_UINT_X2,	/* field of 'bits', multiplied by 2 */
+	REST_RXLEV,	/* RXLEV field of 'bits', converted to dBm */
+};
+
+struct rest_field {
+	uint8_t		op;	/* see enum rest_op */
+	uint8_t		bits;	/* field size or number of entries to skip */
+	int16_t		offset;	/* offset of target member, -1 for none */
+	int8_t		dflt;	/* value for REST_OPT_DFLT */
+};
+
+struct rest_reader {
+	const uint8_t	*data;
+	unsigned int	len;	/* octets */
+	unsigned int	pos;	/* current bit */
+};
+
+#define SI_OFS(member)	offsetof(struct gsm48_sysinfo, member)
+#define CI_OFS(member)	offsetof(struct si10_cell_info, member)
+
+static inline int rest_get_hl(struct rest_reader *r)
+{
+	unsigned int pos = r->pos++;
+	uint8_t mask = 0x80 >> (pos & 7);
+
+	if ((pos >> 3) >= r->len)
+		return 0;
+	return ((r->data[pos >> 3] ^ 0x2b) & mask) != 0;
+}
+
+/* read up to 8 bits, MSB first */
+static inline int rest_get_uint(struct rest_reader *r, unsigned int bits)
+{
+	unsigned int byte = r->pos >> 3;
+	uint16_t w;
+
+	if (r->pos + bits > (r->len << 3))
+		return -EINVAL;
+	w = r->data[byte] << 8;
+	if (byte + 1 < r->len)
+		w |= r->data[byte + 1];
+	w >>= 16 - (r->pos & 7) - bits;
+	r->pos += bits;
+
+	return w & ((1 << bits) - 1);
+}
+
+static int rest_decode(struct rest_reader *r, const struct rest_field *f,
+		       void *target)
+{
+	uint8_t *t = target;
+	int rc;
+
+	for (; f->op != REST_END; f++) {
+		switch (f->op) {
+		case REST_FLAG:
+		case REST_OPT:
+			rc = rest_get_hl(r);
+			if (f->offset >= 0 && (rc || f->op == REST_FLAG))
+				t[f->offset] = rc;
+			if (!rc)
+				f += f->bits;
+			break;
+		case REST_OPT_DFLT:
+			if (!rest_get_hl(r)) {
+				f++;
+				t[f->offset] = f[-1].dflt;
+			}
+			break;
+		case REST_COND:
+			if (!rest_get_hl(r))
+				return 0;
+			break;
+		case REST_BREAK:
+			if (rest_get_hl(r)) {
+				if (f->offset >= 0)
+					t[f->offset] = 1;
+				return 0;
+			}
+			break;
+		default:
+			rc = rest_get_uint(r, f->bits);
+			if (rc < 0)
+				return rc;
+			if (f->op == REST_UINT_X2)
+				rc *= 2;
+			else if (f->op == REST_RXLEV)
+				rc = rxlev2dbm(rc);
+			t[f->offset] = rc;
+		}
+	}
+
+	return 0;
+}
+
+/* "SI 1 Rest Octets" (10.5.2.32) */
+static const struct rest_field si1_rest[] = {
+	/* Optional NCH position */
+	{ REST_FLAG,	1, SI_OFS(nch) },
+	{ REST_UINT,	5, SI_OFS(nch_position) },
+	/* Band Indicator */
+	{ REST_FLAG,	0, SI_OFS(band_ind) },
+	{ REST_END },
+};
+
+/* "SI 3 Rest Octets" (10.5.2.34) */
+static const struct rest_field si3_rest[] = {
+	/* Optional Selection Parameters */
+	{ REST_FLAG,	4, SI_OFS(sp) },
+	{ REST_UINT,	1, SI_OFS(sp_cbq) },
+	{ REST_UINT,	6, SI_OFS(sp_cro) },
+	{ REST_UINT,	3, SI_OFS(sp_to) },
+	{ REST_UINT,	5, SI_OFS(sp_pt) },
+	/* Optional Power Offset */
+	{ REST_FLAG,	1, SI_OFS(po) },
+	{ REST_UINT,	2, SI_OFS(po_value) },
+	/* System Information 2ter Indicator */
+	{ REST_FLAG,	0, SI_OFS(si2ter_ind) },
+	/* Early Classmark Sending Control */
+	{ REST_FLAG,	0, SI_OFS(ecsm) },
+	/* Scheduling if and where */
+	{ REST_FLAG,	1, SI_OFS(sched) },
+	{ REST_UINT,	3, SI_OFS(sched_where) },
+	/* GPRS Indicator */
+	{ REST_FLAG,	2, SI_OFS(gprs.supported) },
+	{ REST_UINT,	3, SI_OFS(gprs.ra_colour) },
+	{ REST_UINT,	1, SI_OFS(gprs.si13_pos) },
+	{ REST_END },
+};
+
+/* "SI 4 Rest Octets" (10.5.2.35) */
+static const struct rest_field si4_rest[] = {
+	/* Optional Selection Parameters */
+	{ REST_FLAG,	4, SI_OFS(sp) },
+	{ REST_UINT,	1, SI_OFS(sp_cbq) },
+	{ REST_UINT,	6, SI_OFS(sp_cro) },
+	{ REST_UINT,	3, SI_OFS(sp_to) },
+	{ REST_UINT,	5, SI_OFS(sp_pt) },
+	/* Optional Power Offset */
+	{ REST_FLAG,	1, SI_OFS(po) },
+	{ REST_UINT,	3, SI_OFS(po_value) },
+	/* GPRS Indicator */
+	{ REST_FLAG,	2, SI_OFS(gprs.supported) },
+	{ REST_UINT,	3, SI_OFS(gprs.ra_colour) },
+	{ REST_UINT,	1, SI_OFS(gprs.si13_pos) },
+	// todo: more rest octet bits
+	{ REST_END },
+};
+
+/* "SI 10 Rest Octets" (10.5.2.44), <cell parameters> of the first cell */
+static const struct rest_field si10_cell_pars[] = {
+	/* <cell barred (H)> | L <further cell info> */
+	{ REST_BREAK,	0, CI_OFS(barred) },
+	/* { H <cell reselect hysteresis : bit(3)> | L } */
+	{ REST_OPT,	1, CI_OFS(la_different) },
+	{ REST_UINT_X2,	3, CI_OFS(cell_resel_hyst_db) },
+	{ REST_UINT,	5, CI_OFS(ms_txpwr_max_cch) },
+	{ REST_RXLEV,	6, CI_OFS(rxlev_acc_min_db) },
+	{ REST_UINT,	6, CI_OFS(cell_resel_offset) },
+	{ REST_UINT,	3, CI_OFS(temp_offset) },
+	{ REST_UINT,	5, CI_OFS(penalty_time) },
+	{ REST_END },
+};
+
+/* "SI 10 Rest Octets" (10.5.2.44), <differential cell info> of other cells,
+ * absent parameters are the same as the previous cell */
+static const struct rest_field si10_diff_cell_pars[] = {
+	/* { H <diff cell pars> | L } */
+	{ REST_COND },
+	/* <cell barred (H)> | L <further cell info> */
+	{ REST_BREAK,	0, CI_OFS(barred) },
+	/* { H <cell reselect hysteresis : bit(3)> | L } */
+	{ REST_OPT,	1, CI_OFS(la_different) },
+	{ REST_UINT_X2,	3, CI_OFS(cell_resel_hyst_db) },
+	/* { H <ms txpwr max cch : bit(5)> | L } */
+	{ REST_OPT,	1, -1 },
+	{ REST_UINT,	5, CI_OFS(ms_txpwr_max_cch) },
+	/* { H <rxlev access min : bit(6)> | L } */
+	{ REST_OPT_DFLT, 0, -1, -110 },
+	{ REST_RXLEV,	6, CI_OFS(rxlev_acc_min_db) },
+	/* { H <cell reselect offset : bit(6)> | L } */
+	{ REST_OPT,	1, -1 },
+	{ REST_UINT,	6, CI_OFS(cell_resel_offset) },
+	/* { H <temporary offset : bit(3)> | L } */
+	{ REST_OPT,	1, -1 },
+	{ REST_UINT,	3, CI_OFS(temp_offset) },
+	/* { H <penalty time : bit(5)> | L } */
+	{ REST_OPT,	1, -1 },
+	{ REST_UINT,	5, CI_OFS(penalty_time) },
+	{ REST_END },
+};
+
 /* decode "SI 1 Rest Octets" (10.5.2.32) */
 static int gsm48_decode_si1_rest(struct gsm48_sysinfo *s,
 				 const uint8_t *si, uint8_t len)
 {
-	struct bitvec bv = {
-		.data_len = len,
-		.data = (uint8_t *)si,
+	struct rest_reader r = {
+		.data = si,
+		.len = len,
 	};
 
-	/* Optional Selection Parameters */
-	if (bitvec_get_bit_high(&bv) == H) {
-		s->nch = 1;
-		s->nch_position = bitvec_get_uint(&bv, 5);
-	} else
-		s->nch = 0;
-	s->band_ind = (bitvec_get_bit_high(&bv) == H);
-
-	return 0;
+	return rest_decode(&r, si1_rest, s);
 }
 
 /* decode "SI 3 Rest Octets" (10.5.2.34) */
 static int gsm48_decode_si3_rest(struct gsm48_sysinfo *s,
 				 const uint8_t *si, uint8_t len)
 {
-	struct bitvec bv = {
-		.data_len = len,
-		.data = (uint8_t *)si,
+	struct rest_reader r = {
+		.data = si,
+		.len = len,
 	};
 
-	/* Optional Selection Parameters */
-	if (bitvec_get_bit_high(&bv) == H) {
-		s->sp = 1;
-		s->sp_cbq = bitvec_get_uint(&bv, 1);
-		s->sp_cro = bitvec_get_uint(&bv, 6);
-		s->sp_to = bitvec_get_uint(&bv, 3);
-		s->sp_pt = bitvec_get_uint(&bv, 5);
-	} else
-		s->sp = 0;
-	/* Optional Power Offset */
-	if (bitvec_get_bit_high(&bv) == H) {
-		s->po = 1;
-		s->po_value = bitvec_get_uint(&bv, 2);
-	} else
-		s->po = 0;
-	/* System Onformation 2ter Indicator */
-	if (bitvec_get_bit_high(&bv) == H)
-		s->si2ter_ind = 1;
-	else
-		s->si2ter_ind = 0;
-	/* Early Classark Sending Control */
-	if (bitvec_get_bit_high(&bv) == H)
-		s->ecsm = 1;
-	else
-		s->ecsm = 0;
-	/* Scheduling if and where */
-	if (bitvec_get_bit_high(&bv) == H) {
-		s->sched = 1;
-		s->sched_where = bitvec_get_uint(&bv, 3);
-	} else
-		s->sched = 0;
-	/* GPRS Indicator */
-	if (bitvec_get_bit_high(&bv) == H) {
-		s->gprs.supported = 1;
-		s->gprs.ra_colour = bitvec_get_uint(&bv, 3);
-		s->gprs.si13_pos = bitvec_get_uint(&bv, 1);
-	} else
-		s->gprs.supported = 0;
-
-	return 0;
+	return rest_decode(&r, si3_rest, s);
 }
 
 /* decode "SI 4 Rest Octets" (10.5.2.35) */
 static int gsm48_decode_si4_rest(struct gsm48_sysinfo *s,
 				 const uint8_t *si, uint8_t len)
 {
-	struct bitvec bv = {
-		.data_len = len,
-		.data = (uint8_t *)si,
+	struct rest_reader r = {
+		.data = si,
+		.len = len,
 	};
 
-	/* Optional Selection Parameters */
-	if (bitvec_get_bit_high(&bv) == H) {
-		s->sp = 1;
-		s->sp_cbq = bitvec_get_uint(&bv, 1);
-		s->sp_cro = bitvec_get_uint(&bv, 6);
-		s->sp_to = bitvec_get_uint(&bv, 3);
-		s->sp_pt = bitvec_get_uint(&bv, 5);
-	} else
-		s->sp = 0;
-	/* Optional Power Offset */
-	if (bitvec_get_bit_high(&bv) == H) {
-		s->po = 1;
-		s->po_value = bitvec_get_uint(&bv, 3);
-	} else
-		s->po = 0;
-	/* GPRS Indicator */
-	if (bitvec_get_bit_high(&bv) == H) {
-		s->gprs.supported = 1;
-		s->gprs.ra_colour = bitvec_get_uint(&bv, 3);
-		s->gprs.si13_pos = bitvec_get_uint(&bv, 1);
-	} else
-		s->gprs.supported = 0;
-	// todo: more rest octet bits
-
-	return 0;
+	return rest_decode(&r, si4_rest, s);
 }
 
 /* TODO: decode "SI 6 Rest Octets" (10.5.2.35a) */
@@ -657,184 +801,224 @@ static int gsm48_decode_si6_rest(struct gsm48_sysinfo *s,
 }
 
 /* Decode "SI 10 Rest Octets" (10.5.2.44) */
-static int gsm48_decode_si10_rest_first(struct gsm48_sysinfo *s, struct bitvec *bv,
+static int gsm48_decode_si10_rest_first(struct gsm48_sysinfo *s,
+					struct rest_reader *r,
 					struct si10_cell_info *c)
 {
-	uint8_t ba_ind;
+	int ba_ind;
 
 	/* <BA ind : bit(1)> */
-	ba_ind = bitvec_get_uint(bv, 1);
+	ba_ind = rest_get_uint(r, 1);
 	if (ba_ind != s->nb_ba_ind_si5) {
-		LOGP(DRR, LOGL_NOTICE, "SI10: BA_IND %u != BA_IND %u of SI5!\n", ba_ind, s->nb_ba_ind_si5);
+		LOGP(DRR, LOGL_NOTICE, "SI10: BA_IND %d != BA_IND %u of SI5!\n", ba_ind, s->nb_ba_ind_si5);
 		return EOF;
 	}
 
 	/* { L <spare padding> | H <neighbour information> } */
-	if (bitvec_get_bit_high(bv) != H) {
+	if (!rest_get_hl(r)) {
 		LOGP(DRR, LOGL_INFO, "SI10: No neighbor cell defined.\n");
 		return EOF;
 	}
 
-	/* <first frequency: bit(5)> */
-	c->index = bitvec_get_uint(bv, 5);
-
-	/* <bsic : bit(6)> */
-	c->bsic = bitvec_get_uint(bv, 6);
+	/* <first frequency: bit(5)> <bsic : bit(6)> */
+	c->index = rest_get_uint(r, 5);
+	c->bsic = rest_get_uint(r, 6);
 
 	/* { H <cell parameters> | L } */
-	if (bitvec_get_bit_high(bv) != H) {
+	if (!rest_get_hl(r)) {
 		LOGP(DRR, LOGL_NOTICE, "SI10: No cell parameters for first cell, cannot continue to decode!\n");
 		return EOF;
 	}
 
-	/* <cell barred (H)> | L <further cell info> */
-	if (bitvec_get_bit_high(bv) == H) {
-		c->barred = true;
-		return 0;
-	}
-
-	/* { H <cell reselect hysteresis : bit(3)> | L } */
-	if (bitvec_get_bit_high(bv) == H) {
-		c->la_different = true;
-		c->cell_resel_hyst_db = bitvec_get_uint(bv, 3) * 2;
+	if (rest_decode(r, si10_cell_pars, c) < 0) {
+		LOGP(DRR, LOGL_NOTICE, "SI10: Short read of cell parameters.\n");
+		return -EINVAL;
 	}
 
-	/* <ms txpwr max cch : bit(5)> */
-	c->ms_txpwr_max_cch = bitvec_get_uint(bv, 5);
-	/* <rxlev access min : bit(6)> */
-	c->rxlev_acc_min_db = rxlev2dbm(bitvec_get_uint(bv, 6));
-	/* <cell reselect offset : bit(6)> */
-	c->cell_resel_offset = bitvec_get_uint(bv, 6);
-	/* <temporary offset : bit(3)> */
-	c->temp_offset = bitvec_get_uint(bv, 3);
-	/* <penalty time : bit(5)> */
-	c->penalty_time = bitvec_get_uint(bv, 5);
-
 	return 0;
 }
 
-static int gsm48_decode_si10_rest_other(struct gsm48_sysinfo *s, struct bitvec *bv,
+static int gsm48_decode_si10_rest_other(struct gsm48_sysinfo *s,
+					struct rest_reader *r,
 					struct si10_cell_info *c)
 {
 	int rc;
 
 	/* { H <info field> }** L <spare padding> */
-	if (bitvec_get_bit_high(bv) != H)
+	if (!rest_get_hl(r))
 		return EOF;
 
 	c->index = (c->index + 1) & 0x1f;
 	/* <next frequency (H)>** L <differential cell info> */
 	/* Increment frequency number for every <info field> and every <next frequency> occurrence. */
-	while ((rc = bitvec_get_bit_high(bv)) == H)
+	while (rest_get_hl(r))
 		c->index = (c->index + 1) & 0x1f;
-	if (rc < 0)
-		goto short_read;
 
 	/* { H <BCC : bit(3)> | L <bsic : bit(6)> } */
-	rc = bitvec_get_bit_high(bv);
-	if (rc < 0)
-		goto short_read;
-	if (rc == H) {
-		rc = bitvec_get_uint(bv, 3);
+	if (rest_get_hl(r)) {
+		rc = rest_get_uint(r, 3);
 		if (rc < 0)
 			goto short_read;
-		c->bsic = (c->bsic & 0x07) | rc;
+		/* NCC is the same as the previous cell */
+		c->bsic = (c->bsic & 0x38) | rc;
 	} else {
-		rc = bitvec_get_uint(bv, 6);
+		rc = rest_get_uint(r, 6);
 		if (rc < 0)
 			goto short_read;
 		c->bsic = rc;
 	}
 
-	/* { H <diff cell pars> | L } */
-	rc = bitvec_get_bit_high(bv);
-	if (rc < 0)
+	if (rest_decode(r, si10_diff_cell_pars, c) < 0)
 		goto short_read;
-	if (rc != H)
-		return 0;
 
-	/* <cell barred (H)> | L <further cell info> */
-	rc = bitvec_get_bit_high(bv);
-	if (rc < 0)
-		goto short_read;
-	if (rc == H) {
-		c->barred = true;
+	return 0;
+
+short_read:
+	LOGP(DRR, LOGL_NOTICE, "SI10: Short read of differential cell info.\n");
+	return -EINVAL;
+}
+
+/* decode neighbor cell info of SI 10, requires the lists of SI 5* */
+static int gsm48_decode_si10_cells(struct gsm48_sysinfo *s)
+{
+	const struct gsm48_system_information_type_10 *si = (void *)s->si10_msg;
+	int payload_len = s->si10_len - sizeof(*si);
+	struct rest_reader r;
+	int i;
+	int rc;
+
+	r = (struct rest_reader) {
+		.data = si->rest_octets,
+		.len = (payload_len > 0) ? payload_len : 0,
+	};
+
+	/* Clear cell list. */
+	s->si10_cell_num = 0;
+	memset(s->si10_cell, 0, sizeof(s->si10_cell));
+
+	/* SI 10 Rest Octets of first neighbor cell, if included. */
+	rc = gsm48_decode_si10_rest_first(s, &r, &s->si10_cell[0]);
+	if (rc == EOF) {
+		s->si10 = true;
 		return 0;
 	}
-
-	/* { H <cell reselect hysteresis : bit(3)> | L } */
-	rc = bitvec_get_bit_high(bv);
 	if (rc < 0)
-		goto short_read;
-	if (rc == H) {
-		c->la_different = true;
-		rc = bitvec_get_uint(bv, 3);
-		if (rc < 0)
-			goto short_read;
-		c->cell_resel_hyst_db = bitvec_get_uint(bv, 3) * 2;
-	}
+		return rc;
+	s->si10_cell[0].arfcn = arfcn_from_freq_index(s, s->si10_cell[0].index);
+	s->si10_cell_num++;
 
-	/* { H <ms txpwr max cch : bit(5)> | L } */
-	rc = bitvec_get_bit_high(bv);
-	if (rc < 0)
-		goto short_read;
-	if (rc == H) {
-		rc = bitvec_get_uint(bv, 5);
+	for (i = 1; i < ARRAY_SIZE(s->si10_cell); i++) {
+		/* Clone last cell info and then store differential elements. */
+		memcpy(&s->si10_cell[i], &s->si10_cell[i - 1], sizeof(s->si10_cell[i]));
+		/* SI 10 Rest Octets of other neighbor cell, if included. */
+		rc = gsm48_decode_si10_rest_other(s, &r, &s->si10_cell[i]);
+		if (rc == EOF)
+			break;
 		if (rc < 0)
-			goto short_read;
-		c->ms_txpwr_max_cch = rc;
+			return rc;
+		s->si10_cell[i].arfcn = arfcn_from_freq_index(s, s->si10_cell[i].index);
+		s->si10_cell_num++;
 	}
 
-	/* { H <rxlev access min : bit(6)> | L } */
-	rc = bitvec_get_bit_high(bv);
-	if (rc < 0)
-		goto short_read;
-	if (rc == H) {
-		rc = bitvec_get_uint(bv, 6);
-		if (rc < 0)
-			goto short_read;
-		c->rxlev_acc_min_db = rxlev2dbm(rc);
-	} else
-		c->rxlev_acc_min_db = -110;
+	s->si10 = true;
+	return 0;
+}
 
-	/* { H <cell reselect offset : bit(6)> | L } */
-	rc = bitvec_get_bit_high(bv);
-	if (rc < 0)
-		goto short_read;
-	if (rc == H) {
-		rc = bitvec_get_uint(bv, 6);
-		if (rc < 0)
-			goto short_read;
-		c->cell_resel_offset = rc;
-	}
+/* Decode the given sections of the stored system information messages, if
+ * they are pending. Sections that depend on others (hopping and SI 10 on the
+ * frequency lists) pull them in. */
+int gsm48_sysinfo_decode(struct gsm48_sysinfo *s, uint16_t sections)
+{
+	const struct gsm48_system_information_type_1 *si1 = (void *)s->si1_msg;
+	const struct gsm48_system_information_type_2 *si2 = (void *)s->si2_msg;
+	const struct gsm48_system_information_type_2bis *si2b = (void *)s->si2b_msg;
+	const struct gsm48_system_information_type_2ter *si2t = (void *)s->si2t_msg;
+	const struct gsm48_system_information_type_5 *si5 = (void *)s->si5_msg;
+	const struct gsm48_system_information_type_5bis *si5b = (void *)s->si5b_msg;
+	const struct gsm48_system_information_type_5ter *si5t = (void *)s->si5t_msg;
+	uint16_t todo;
+	int rc = 0;
+
+	if (sections & (SI_DEC_SI4_MA | SI_DEC_SI10))
+		sections |= SI_DEC_FREQ;
+	todo = s->pending & sections;
+	if (!todo)
+		return 0;
 
-	/* { H <temporary offset : bit(3)> | L } */
-	rc = bitvec_get_bit_high(bv);
-	if (rc < 0)
-		goto short_read;
-	if (rc == H) {
-		rc = bitvec_get_uint(bv, 3);
-		if (rc < 0)
-			goto short_read;
-		c->temp_offset = rc;
+	/* Cell Channel Description */
+	if ((todo & SI_DEC_SI1_CA))
+		decode_freq_list(s->freq, &s->ca, si1->cell_channel_description,
+				 sizeof(si1->cell_channel_description),
+				 0xce, FREQ_TYPE_SERV);
+	/* Neighbor Cell Description */
+	if ((todo & SI_DEC_SI2_BA))
+		decode_freq_list(s->freq, NULL, si2->bcch_frequency_list,
+				 sizeof(si2->bcch_frequency_list),
+				 0xce, FREQ_TYPE_NCELL_2);
+	if ((todo & SI_DEC_SI2bis_BA))
+		decode_freq_list(s->freq, NULL, si2b->bcch_frequency_list,
+				 sizeof(si2b->bcch_frequency_list),
+				 0xce, FREQ_TYPE_NCELL_2bis);
+	/* Neighbor Cell Description 2 */
+	if ((todo & SI_DEC_SI2ter_BA))
+		decode_freq_list(s->freq, NULL, si2t->ext_bcch_frequency_list,
+				 sizeof(si2t->ext_bcch_frequency_list),
+				 0x8e, FREQ_TYPE_NCELL_2ter);
+	if ((todo & SI_DEC_SI5_BA))
+		decode_freq_list(s->freq, &s->ba_si5[0], si5->bcch_frequency_list,
+				 sizeof(si5->bcch_frequency_list),
+				 0xce, FREQ_TYPE_REP_5);
+	if ((todo & SI_DEC_SI5bis_BA))
+		decode_freq_list(s->freq, &s->ba_si5[1], si5b->bcch_frequency_list,
+				 sizeof(si5b->bcch_frequency_list),
+				 0xce, FREQ_TYPE_REP_5bis);
+	if ((todo & SI_DEC_SI5ter_BA))
+		decode_freq_list(s->freq, &s->ba_si5[2], si5t->bcch_frequency_list,
+				 sizeof(si5t->bcch_frequency_list),
+				 0x8e, FREQ_TYPE_REP_5ter);
+	s->pending &= ~(todo & SI_DEC_FREQ);
+
+	/* CBCH Mobile Allocation */
+	if ((todo & SI_DEC_SI4_MA)) {
+		if (!s->si1) {
+			LOGP(DRR, LOGL_NOTICE, "Ignoring CBCH allocation of "
+			     "SYSTEM INFORMATION 4 until SI 1 is received.\n");
+		} else {
+			const uint8_t *data = s->si4_msg + s->si4_ma_ofs;
+			uint16_t hopping[64];
+			uint8_t hopp_len;
+			int i;
+
+			s->pending &= ~SI_DEC_SI4_MA;
+			if (gsm48_decode_mobile_alloc(&s->ca, data + 2, data[1],
+						      hopping, &hopp_len) == 0) {
+				for (i = 0; i < s->hopp_len; i++)
+					s->freq[s->hopping[i]].mask &= ~FREQ_TYPE_HOPP;
+				memcpy(s->hopping, hopping, sizeof(s->hopping));
+				s->hopp_len = hopp_len;
+				for (i = 0; i < s->hopp_len; i++)
+					s->freq[s->hopping[i]].mask |= FREQ_TYPE_HOPP;
+			}
+		}
 	}
 
-	/* { H <penalty time : bit(5)> | L } */
-	rc = bitvec_get_bit_high(bv);
-	if (rc < 0)
-		goto short_read;
-	if (rc == H) {
-		rc = bitvec_get_uint(bv, 5);
-		if (rc < 0)
-			goto short_read;
-		c->penalty_time = rc;
+	/* SI 10 Rest Octets */
+	if ((todo & SI_DEC_SI10)) {
+		s->pending &= ~SI_DEC_SI10;
+		rc = gsm48_decode_si10_cells(s);
 	}
 
-	return 0;
+	return rc;
+}
 
-short_read:
-	LOGP(DRR, LOGL_NOTICE, "SI10: Short read of differential cell info.\n");
-	return -EINVAL;
+/* mark sections as pending, decode them now, unless decoding is lazy */
+static int si_decode_later(struct gsm48_sysinfo *s, uint16_t sections)
+{
+	s->pending |= sections;
+	if (s->lazy)
+		return 0;
+
+	return gsm48_sysinfo_decode(s, sections);
 }
 
 int gsm48_decode_sysinfo1(struct gsm48_sysinfo *s,
@@ -844,26 +1028,21 @@ int gsm48_decode_sysinfo1(struct gsm48_sysinfo *s,
 
 	memcpy(s->si1_msg, si, OSMO_MIN(len, sizeof(s->si1_msg)));
 
-	/* Cell Channel Description */
-	decode_freq_list(s->freq, si->cell_channel_description,
-			 sizeof(si->cell_channel_description),
-			 0xce, FREQ_TYPE_SERV);
 	/* RACH Control Parameter */
 	gsm48_decode_rach_ctl_param(s, &si->rach_control);
 	/* SI 1 Rest Octets */
-	if (payload_len)
+	if (payload_len > 0)
 		gsm48_decode_si1_rest(s, si->rest_octets, payload_len);
 
 	s->si1 = 1;
 
-	if (s->si4) {
-		const struct gsm48_system_information_type_4 *si4 = (void *)s->si4_msg;
-		LOGP(DRR, LOGL_NOTICE,
-		     "Now updating previously received SYSTEM INFORMATION 4\n");
-		gsm48_decode_sysinfo4(s, si4, sizeof(s->si4_msg));
+	/* Cell Channel Description, the CBCH hopping sequence depends on it */
+	if (s->si4 && s->si4_ma_ofs) {
+		LOGP(DRR, LOGL_NOTICE, "Now updating CBCH allocation of "
+		     "previously received SYSTEM INFORMATION 4\n");
+		return si_decode_later(s, SI_DEC_SI1_CA | SI_DEC_SI4_MA);
 	}
-
-	return 0;
+	return si_decode_later(s, SI_DEC_SI1_CA);
 }
 
 int gsm48_decode_sysinfo2(struct gsm48_sysinfo *s,
@@ -874,9 +1053,6 @@ int gsm48_decode_sysinfo2(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si2 = (si->bcch_frequency_list[0] >> 5) & 1;
 	s->nb_ba_ind_si2 = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-			 sizeof(si->bcch_frequency_list),
-			 0xce, FREQ_TYPE_NCELL_2);
 	/* NCC Permitted */
 	s->nb_ncc_permitted_si2 = si->ncc_permitted;
 	/* RACH Control Parameter */
@@ -884,7 +1060,7 @@ int gsm48_decode_sysinfo2(struct gsm48_sysinfo *s,
 
 	s->si2 = 1;
 
-	return 0;
+	return si_decode_later(s, SI_DEC_SI2_BA);
 }
 
 int gsm48_decode_sysinfo2bis(struct gsm48_sysinfo *s,
@@ -895,14 +1071,12 @@ int gsm48_decode_sysinfo2bis(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si2bis = (si->bcch_frequency_list[0] >> 5) & 1;
 	s->nb_ba_ind_si2bis = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-		sizeof(si->bcch_frequency_list), 0xce, FREQ_TYPE_NCELL_2bis);
 	/* RACH Control Parameter */
 	gsm48_decode_rach_ctl_neigh(s, &si->rach_control);
 
 	s->si2bis = 1;
 
-	return 0;
+	return si_decode_later(s, SI_DEC_SI2bis_BA);
 }
 
 int gsm48_decode_sysinfo2ter(struct gsm48_sysinfo *s,
@@ -913,13 +1087,10 @@ int gsm48_decode_sysinfo2ter(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description 2 */
 	s->nb_multi_rep_si2ter = (si->ext_bcch_frequency_list[0] >> 5) & 3;
 	s->nb_ba_ind_si2ter = (si->ext_bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->ext_bcch_frequency_list,
-		sizeof(si->ext_bcch_frequency_list), 0x8e,
-			FREQ_TYPE_NCELL_2ter);
 
 	s->si2ter = 1;
 
-	return 0;
+	return si_decode_later(s, SI_DEC_SI2ter_BA);
 }
 
 int gsm48_decode_sysinfo3(struct gsm48_sysinfo *s,
@@ -962,6 +1133,8 @@ int gsm48_decode_sysinfo4(struct gsm48_sysinfo *s,
 	const struct gsm48_chan_desc *cd;
 
 	memcpy(s->si4_msg, si, OSMO_MIN(len, sizeof(s->si4_msg)));
+	s->si4_ma_ofs = 0;
+	s->pending &= ~SI_DEC_SI4_MA;
 
 	/* LAI */
 	gsm48_decode_lai2(&si->lai, &s->lai);
@@ -991,13 +1164,7 @@ short_read:
 	if (payload_len >= 1 && data[0] == GSM48_IE_CBCH_MOB_AL) {
 		if (payload_len < 1 || payload_len < 2 + data[1])
 			goto short_read;
-		if (!s->si1) {
-			LOGP(DRR, LOGL_NOTICE, "Ignoring CBCH allocation of "
-			     "SYSTEM INFORMATION 4 until SI 1 is received.\n");
-		} else {
-			gsm48_decode_mobile_alloc(s->freq, data + 2, data[1],
-						  s->hopping, &s->hopp_len, 1);
-		}
+		s->si4_ma_ofs = data - (const uint8_t *)si;
 		payload_len -= 2 + data[1];
 		data += 2 + data[1];
 	}
@@ -1007,6 +1174,8 @@ short_read:
 
 	s->si4 = 1;
 
+	if (s->si4_ma_ofs)
+		return si_decode_later(s, SI_DEC_SI4_MA);
 	return 0;
 }
 
@@ -1018,14 +1187,12 @@ int gsm48_decode_sysinfo5(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si5 = (si->bcch_frequency_list[0] >> 5) & 1;
 	s->nb_ba_ind_si5 = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-			 sizeof(si->bcch_frequency_list),
-			 0xce, FREQ_TYPE_REP_5);
 
 	s->si5 = 1;
 	s->si10 = false;
+	s->pending &= ~SI_DEC_SI10;
 
-	return 0;
+	return si_decode_later(s, SI_DEC_SI5_BA);
 }
 
 int gsm48_decode_sysinfo5bis(struct gsm48_sysinfo *s,
@@ -1036,14 +1203,12 @@ int gsm48_decode_sysinfo5bis(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si5bis = (si->bcch_frequency_list[0] >> 5) & 1;
 	s->nb_ba_ind_si5bis = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-			 sizeof(si->bcch_frequency_list),
-			 0xce, FREQ_TYPE_REP_5bis);
 
 	s->si5bis = 1;
 	s->si10 = false;
+	s->pending &= ~SI_DEC_SI10;
 
-	return 0;
+	return si_decode_later(s, SI_DEC_SI5bis_BA);
 }
 
 int gsm48_decode_sysinfo5ter(struct gsm48_sysinfo *s,
@@ -1054,14 +1219,12 @@ int gsm48_decode_sysinfo5ter(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_multi_rep_si5ter = (si->bcch_frequency_list[0] >> 5) & 3;
 	s->nb_ba_ind_si5ter = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-			 sizeof(si->bcch_frequency_list),
-			 0x8e, FREQ_TYPE_REP_5ter);
 
 	s->si5ter = 1;
 	s->si10 = false;
+	s->pending &= ~SI_DEC_SI10;
 
-	return 0;
+	return si_decode_later(s, SI_DEC_SI5ter_BA);
 }
 
 int gsm48_decode_sysinfo6(struct gsm48_sysinfo *s,
@@ -1094,75 +1257,82 @@ int gsm48_decode_sysinfo6(struct gsm48_sysinfo *s,
 /* Get ARFCN from BCCH allocation found in SI5/SI5bis an SI5ter. See TS 44.018 §10.5.2.20. */
 int16_t arfcn_from_freq_index(const struct gsm48_sysinfo *s, uint16_t index)
 {
-	uint16_t arfcn, i = 0;
+	struct gsm_freq_set first;
+	int num;
 
 	/* Search for ARFCN found in SI5 or SI5bis. (first sub list) */
-	for (arfcn = 1; arfcn <= 1024; arfcn++) {
-		if (!(s->freq[arfcn & 1023].mask & (FREQ_TYPE_REP_5 | FREQ_TYPE_REP_5bis)))
-			continue;
-		if (index == i++)
-			return arfcn & 1023;
-	}
-
-	/* Search for ARFCN found in SI5ter. (second sub list) */
-	for (arfcn = 1; arfcn <= 1024; arfcn++) {
-		if (!(s->freq[arfcn & 1023].mask & FREQ_TYPE_REP_5ter))
-			continue;
-		if (index == i++)
-			return arfcn & 1023;
-	}
-
-	/* If not found, return EOF (-1) as idicator. */
-	return EOF;
+	gsm_freq_set_or(&first, &s->ba_si5[0], &s->ba_si5[1]);
+	num = gsm_freq_set_count(&first);
+	if (index < num)
+		return gsm_freq_set_nth(&first, index);
+
+	/* Search for ARFCN found in SI5ter. (second sub list)
+	 * If not found, return EOF (-1) as idicator. */
+	return gsm_freq_set_nth(&s->ba_si5[2], index - num);
 }
 
-int gsm48_decode_sysinfo10(struct gsm48_sysinfo *s,
-			   const struct gsm48_system_information_type_10 *si, int len)
+/* Get the paging block of an IMSI from the control channel description of SI3.
+ * See TS 45.002 §6.5.2 and §6.5.3. The block is given as first frame in the
+ * 51-multiframe and as multiframe index, (FN div 51) mod BS_PA_MFRMS.
+ * Return -ENOTSUP if the CCCH of the IMSI is not on timeslot 0. */
+int gsm48_sysinfo_paging_block(const struct gsm48_sysinfo *s, const char *imsi,
+			       uint8_t *mf_index, uint8_t *fn51)
 {
-	int payload_len = len - sizeof(*si);
-	struct bitvec bv;
-	int i;
-	int rc;
-
-	bv = (struct bitvec) {
-		.data_len = payload_len,
-		.data = (uint8_t *)si->rest_octets,
+	/* first frame of CCCH blocks 0..8 */
+	static const uint8_t ccch_fn51[9] = {
+		6, 12, 16, 22, 26, 32, 36, 42, 46
 	};
+	size_t len = strlen(imsi);
+	int bs_cc_chans, blocks, n, imsi_mod, group;
 
-	memcpy(s->si10_msg, si, OSMO_MIN(len, sizeof(s->si10_msg)));
-
-	/* Clear cell list. */
-	s->si10_cell_num = 0;
-	memset(s->si10_cell, 0, sizeof(s->si10_cell));
+	if (!s->si3 || len < 3)
+		return -EINVAL;
 
-	/* SI 10 Rest Octets of first neighbor cell, if included. */
-	rc = gsm48_decode_si10_rest_first(s, &bv, &s->si10_cell[0]);
-	if (rc == EOF) {
-		s->si10 = true;
-		return 0;
+	switch (s->ccch_conf) {
+	case 1: /* combined with SDCCH/4 */
+		bs_cc_chans = 1;
+		blocks = 3 - s->bs_ag_blks_res;
+		break;
+	case 0:
+	case 2:
+	case 4:
+	case 6:
+		bs_cc_chans = s->ccch_conf / 2 + 1;
+		blocks = 9 - s->bs_ag_blks_res;
+		break;
+	default:
+		return -EINVAL;
 	}
-	if (rc < 0)
-		return rc;
-	s->si10_cell[0].arfcn = arfcn_from_freq_index(s, s->si10_cell[0].index);
-	s->si10_cell_num++;
+	if (blocks <= 0)
+		return -EINVAL;
 
-	for (i = 1; i < ARRAY_SIZE(s->si10_cell); i++) {
-		/* Clone last cell info and then store differential elements. */
-		memcpy(&s->si10_cell[i], &s->si10_cell[i - 1], sizeof(s->si10_cell[i]));
-		/* SI 10 Rest Octets of other neighbor cell, if included. */
-		rc = gsm48_decode_si10_rest_other(s, &bv, &s->si10_cell[i]);
-		if (rc == EOF)
-			break;
-		if (rc < 0)
-			return rc;
-		s->si10_cell[i].arfcn = arfcn_from_freq_index(s, s->si10_cell[i].index);
-		s->si10_cell_num++;
-	}
+	/* paging blocks on one CCCH in BS_PA_MFRMS multiframes */
+	n = blocks * s->pag_mf_periods;
+	imsi_mod = (imsi[len - 3] - '0') * 100 + (imsi[len - 2] - '0') * 10
+		 + (imsi[len - 1] - '0');
+	imsi_mod %= bs_cc_chans * n;
+
+	/* CCCH_GROUP */
+	if (imsi_mod / n != 0)
+		return -ENOTSUP;
+	/* PAGING_GROUP */
+	group = imsi_mod % n;
+
+	*mf_index = group / blocks;
+	*fn51 = ccch_fn51[group % blocks + s->bs_ag_blks_res];
 
-	s->si10 = true;
 	return 0;
 }
 
+int gsm48_decode_sysinfo10(struct gsm48_sysinfo *s,
+			   const struct gsm48_system_information_type_10 *si, int len)
+{
+	memcpy(s->si10_msg, si, OSMO_MIN(len, sizeof(s->si10_msg)));
+	s->si10_len = OSMO_MIN(len, sizeof(s->si10_msg));
+
+	return si_decode_later(s, SI_DEC_SI10);
+}
+
 int gsm48_decode_sysinfo13(struct gsm48_sysinfo *s,
 		   const struct gsm48_system_information_type_13 *si, int len)
 {
@@ -1175,3 +1345,33 @@ int gsm48_decode_sysinfo13(struct gsm48_sysinfo *s,
 	return 0;
 #endif
 }
+
+/* all frequencies of the cell, with frequency lists decoded */
+struct gsm_sysinfo_freq *gsm48_sysinfo_freq(struct gsm48_sysinfo *s)
+{
+	gsm48_sysinfo_decode(s, SI_DEC_FREQ);
+
+	return s->freq;
+}
+
+/* hopping sequence of the CBCH */
+const uint16_t *gsm48_sysinfo_hopping(struct gsm48_sysinfo *s, uint8_t *len)
+{
+	gsm48_sysinfo_decode(s, SI_DEC_SI4_MA);
+	*len = s->hopp_len;
+
+	return s->hopping;
+}
+
+/* neighbor cell info of SI 10, NULL if not (yet) available */
+const struct si10_cell_info *gsm48_sysinfo_si10_cells(struct gsm48_sysinfo *s,
+						      uint8_t *num)
+{
+	if (gsm48_sysinfo_decode(s, SI_DEC_SI10) < 0 || !s->si10) {
+		*num = 0;
+		return NULL;
+	}
+	*num = s->si10_cell_num;
+
+	return s->si10_cell;
+}
@@ -25,6 +25,9 @@
 #include <osmocom/bb/common/ms.h>
 #include <osmocom/bb/misc/layer3.h>
 
+#include <stdlib.h>
+#include <getopt.h>
+
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/select.h>
@@ -33,7 +36,12 @@
 #include <l1ctl_proto.h>
 #include "bcch_scan.h"
 
-static struct osmocom_ms *g_ms;
+#define MAX_PHONES	8
+
+/* layer2 sockets of the phones given by -p */
+static char *phone_socket[MAX_PHONES];
+static unsigned int num_phones;
+static struct osmocom_ms *g_ms[MAX_PHONES];
 
 static int signal_cb(unsigned int subsys, unsigned int signal,
 		     void *handler_data, void *signal_data)
@@ -53,30 +61,89 @@ static int signal_cb(unsigned int subsys, unsigned int signal,
 
 static int _bcch_scan_start(void)
 {
+	unsigned int i;
 	int rc;
 
-	rc = layer2_open(g_ms, g_ms->settings.layer2_socket_path);
-	if (rc < 0) {
-		fprintf(stderr, "Failed during layer2_open()\n");
-		return rc;
-	}
+	for (i = 0; i < num_phones; i++) {
+		rc = layer2_open(g_ms[i], g_ms[i]->settings.layer2_socket_path);
+		if (rc < 0) {
+			fprintf(stderr, "Failed during layer2_open(%s)\n",
+				g_ms[i]->settings.layer2_socket_path);
+			return rc;
+		}
 
-	l1ctl_tx_reset_req(g_ms, L1CTL_RES_T_FULL);
+		l1ctl_tx_reset_req(g_ms[i], L1CTL_RES_T_FULL);
+	}
 	return 0;
 }
 
 int l23_app_init(void)
 {
-	g_ms = osmocom_ms_alloc(l23_ctx, "1");
-	OSMO_ASSERT(g_ms);
-	/* don't do layer3_init() as we don't want an actual L3 */
+	char name[8];
+	unsigned int i;
+
+	/* without -p, use the socket of -s */
+	if (!num_phones)
+		num_phones = 1;
+
 	fps_init();
+	for (i = 0; i < num_phones; i++) {
+		snprintf(name, sizeof(name), "%u", i + 1);
+		g_ms[i] = osmocom_ms_alloc(l23_ctx, name);
+		OSMO_ASSERT(g_ms[i]);
+		if (phone_socket[i])
+			OSMO_STRLCPY_ARRAY(g_ms[i]->settings.layer2_socket_path,
+					   phone_socket[i]);
+		/* don't do layer3_init() as we don't want an actual L3 */
+		fps_add_ms(g_ms[i]);
+	}
 	l23_app_start = _bcch_scan_start;
 	return osmo_signal_register_handler(SS_L1CTL, &signal_cb, NULL);
 }
 
+static int l23_getopt_options(struct option **options)
+{
+	static struct option opts [] = {
+		{"phone", 1, 0, 'p'},
+	};
+
+	*options = opts;
+	return ARRAY_SIZE(opts);
+}
+
+static int l23_cfg_print_help(void)
+{
+	printf("\nApplication specific\n");
+	printf("  -p --phone SOCKET	Scan with the phone on layer2 SOCKET.\n");
+	printf("			Repeat for up to %d phones, which share\n",
+	       MAX_PHONES);
+	printf("			the ARFCNs to test.\n");
+
+	return 0;
+}
+
+static int l23_cfg_handle(int c, const char *optarg)
+{
+	switch (c) {
+	case 'p':
+		if (num_phones == MAX_PHONES) {
+			fprintf(stderr, "Too many phones, maximum is %d\n",
+				MAX_PHONES);
+			exit(1);
+		}
+		phone_socket[num_phones++] = talloc_strdup(l23_ctx, optarg);
+		break;
+	}
+
+	return 0;
+}
+
 const struct l23_app_info l23_app_info = {
 	.copyright	= "Copyright (C) 2010 Harald Welte <laforge@gnumonks.org>\n",
 	.contribution	= "Contributions by Holger Hans Peter Freyther\n",
+	.getopt_string	= "p:",
 	.opt_supported = L23_OPT_ARFCN | L23_OPT_TAP | L23_OPT_DBG,
+	.cfg_getopt_opt = l23_getopt_options,
+	.cfg_handle_opt	= l23_cfg_handle,
+	.cfg_print_help	= l23_cfg_print_help,
 };
@@ -18,12 +18,16 @@
  *
  */
 
+#include <stdlib.h>
+#include <getopt.h>
+
 #include <osmocom/bb/common/osmocom_data.h>
 #include <osmocom/bb/common/ms.h>
 #include <osmocom/bb/common/l1ctl.h>
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/common/l23_app.h>
 #include <osmocom/bb/misc/layer3.h>
+#include <osmocom/bb/misc/cbch.h>
 #include <osmocom/bb/common/sysinfo.h>
 #include <osmocom/bb/common/l1l2_interface.h>
 #include <osmocom/bb/common/ms.h>
@@ -32,14 +36,22 @@
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/select.h>
 #include <osmocom/core/signal.h>
+#include <osmocom/core/timer.h>
 #include <osmocom/gsm/rsl.h>
 #include <osmocom/gsm/protocol/gsm_08_58.h>
 #include <osmocom/gsm/lapdm.h>
 
 #include <l1ctl_proto.h>
 
+#define STATS_INTERVAL	60 /* seconds */
+
 static struct osmocom_ms *g_ms;
-struct gsm48_sysinfo g_sysinfo = {};
+/* only the CBCH is used, the hopping sequence is decoded when needed */
+struct gsm48_sysinfo g_sysinfo = {
+	.lazy = true,
+};
+static char *output = "-";
+static struct osmo_timer_list stats_timer;
 
 static int try_cbch(struct osmocom_ms *ms, struct gsm48_sysinfo *s)
 {
@@ -60,6 +72,7 @@ static int try_cbch(struct osmocom_ms *ms, struct gsm48_sysinfo *s)
 		chan_nr = RSL_CHAN_OSMO_CBCH4;
 
 	if (s->h) {
+		gsm48_sysinfo_decode(s, SI_DEC_SI4_MA);
 		LOGP(DRR, LOGL_INFO, "chan_nr = 0x%02x TSC = %d  MAIO = %d  "
 			"HSN = %d  hseq (%d): %s\n",
 			s->chan_nr, s->tsc, s->maio, s->hsn,
@@ -177,15 +190,36 @@ static int rcv_rsl(struct msgb *msg, struct lapdm_entity *le, void *l3ctx)
 	return rc;
 }
 
+static void log_stats(void)
+{
+	const struct cbch_stats *st = cbch_get_stats();
+
+	LOGP(DRR, LOGL_INFO, "CBCH: %lu blocks (%lu out of sequence), %lu "
+		"pages, %lu duplicates suppressed, %lu messages written\n",
+		st->blocks, st->bad_blocks, st->pages, st->dup_pages,
+		st->messages);
+}
+
+static void stats_cb(void *data)
+{
+	log_stats();
+	osmo_timer_schedule(&stats_timer, STATS_INTERVAL, 0);
+}
+
 static int signal_cb(unsigned int subsys, unsigned int signal,
 		     void *handler_data, void *signal_data)
 {
 	struct osmocom_ms *ms;
+	struct osmobb_cbch_ind *ci;
 
 	if (subsys != SS_L1CTL)
 		return 0;
 
 	switch (signal) {
+	case S_L1CTL_CBCH_IND:
+		ci = signal_data;
+		cbch_rx_block(ci->band_arfcn, ci->fn, ci->data);
+		return 0;
 	case S_L1CTL_RESET:
 	case S_L1CTL_FBSB_ERR:
 		ms = g_ms;
@@ -212,13 +246,33 @@ static int _cbch_sniff_start(void)
 	/* FIXME: L1CTL_RES_T_FULL doesn't reset dedicated mode
 	 * (if previously set), so we release it here. */
 	l1ctl_tx_dm_rel_req(g_ms);
+
+	osmo_timer_setup(&stats_timer, stats_cb, NULL);
+	osmo_timer_schedule(&stats_timer, STATS_INTERVAL, 0);
+	return 0;
+}
+
+static int _cbch_sniff_exit(void)
+{
+	log_stats();
+	cbch_close();
 	return 0;
 }
 
 int l23_app_init(void)
 {
+	int rc;
+
 	/* don't do layer3_init() as we don't want an actual L3 */
 	l23_app_start = _cbch_sniff_start;
+	l23_app_exit = _cbch_sniff_exit;
+
+	rc = cbch_open(output);
+	if (rc < 0) {
+		fprintf(stderr, "Failed to open output '%s': %s\n", output,
+			strerror(-rc));
+		return rc;
+	}
 
 	g_ms = osmocom_ms_alloc(l23_ctx, "1");
 	OSMO_ASSERT(g_ms);
@@ -227,8 +281,42 @@ int l23_app_init(void)
 	return osmo_signal_register_handler(SS_L1CTL, &signal_cb, NULL);
 }
 
+static int l23_getopt_options(struct option **options)
+{
+	static struct option opts [] = {
+		{"output", 1, 0, 'o'},
+	};
+
+	*options = opts;
+	return ARRAY_SIZE(opts);
+}
+
+static int l23_cfg_print_help(void)
+{
+	printf("\nApplication specific\n");
+	printf("  -o --output FILE	-. Append each new cell broadcast message\n");
+	printf("			as one JSON line to FILE.\n");
+
+	return 0;
+}
+
+static int l23_cfg_handle(int c, const char *optarg)
+{
+	switch (c) {
+	case 'o':
+		output = talloc_strdup(l23_ctx, optarg);
+		break;
+	}
+
+	return 0;
+}
+
 const struct l23_app_info l23_app_info = {
 	.copyright	= "Copyright (C) 2010 Harald Welte <laforge@gnumonks.org>\n",
 	.contribution	= "Contributions by Holger Hans Peter Freyther\n",
+	.getopt_string	= "o:",
 	.opt_supported = L23_OPT_ARFCN | L23_OPT_TAP | L23_OPT_DBG,
+	.cfg_getopt_opt = l23_getopt_options,
+	.cfg_handle_opt	= l23_cfg_handle,
+	.cfg_print_help	= l23_cfg_print_help,
 };
@@ -17,8 +17,11 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <stdio.h>
+#include <getopt.h>
 
 #include <osmocom/core/msgb.h>
 #include <osmocom/gsm/rsl.h>
@@ -26,11 +29,15 @@
 #include <osmocom/gsm/gsm48_ie.h>
 #include <osmocom/gsm/gsm48.h>
 #include <osmocom/core/signal.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
 #include <osmocom/gsm/protocol/gsm_04_08.h>
 
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/misc/rslms.h>
 #include <osmocom/bb/misc/layer3.h>
+#include <osmocom/bb/misc/pagcap.h>
+#include <osmocom/bb/common/paging_watch.h>
 #include <osmocom/bb/common/osmocom_data.h>
 #include <osmocom/bb/common/ms.h>
 #include <osmocom/bb/common/l1ctl.h>
@@ -40,11 +47,42 @@
 
 #include <l1ctl_proto.h>
 
-static struct {
+#define MAX_INST	8 /* L1 instances of one process */
+#define STATS_INTERVAL	10 /* seconds */
+
+/* One phone, following one ARFCN. All instances are served by the same
+ * select loop, so their messages are handled in the order of arrival. */
+struct ccch_inst {
 	struct osmocom_ms *ms;
+	uint16_t arfcn;
+	const char *socket_path; /* NULL: the default L2 socket */
+	char prefix[16]; /* to tell the instances apart in the log */
 	int ccch_mode;
+
+	/* counters since start */
+	unsigned int pag_req, pag_mi, imm_ass;
+};
+
+static struct {
+	struct ccch_inst inst[MAX_INST];
+	unsigned int num_inst;
+	char *capture_path;
+	char *watch_path, *watch_log_path;
+	struct osmo_timer_list stats_timer;
 } app_state;
 
+static struct ccch_inst *ms_inst(struct osmocom_ms *ms)
+{
+	unsigned int i;
+
+	for (i = 0; i < app_state.num_inst; i++) {
+		if (app_state.inst[i].ms == ms)
+			return &app_state.inst[i];
+	}
+	OSMO_ASSERT(0);
+	return NULL;
+}
+
 static int bcch_check_tc(uint8_t si_type, uint8_t tc)
 {
 	/* FIXME: there is no tc information (always 0) */
@@ -119,15 +157,17 @@ static int bcch_check_tc(uint8_t si_type, uint8_t tc)
 static void handle_si3(struct osmocom_ms *ms,
 	struct gsm48_system_information_type_3 *si)
 {
-	if (app_state.ccch_mode != CCCH_MODE_NONE)
+	struct ccch_inst *inst = ms_inst(ms);
+
+	if (inst->ccch_mode != CCCH_MODE_NONE)
 		return;
 
 	if (si->control_channel_desc.ccch_conf == RSL_BCCH_CCCH_CONF_1_C)
-		app_state.ccch_mode = CCCH_MODE_COMBINED;
+		inst->ccch_mode = CCCH_MODE_COMBINED;
 	else
-		app_state.ccch_mode = CCCH_MODE_NON_COMBINED;
+		inst->ccch_mode = CCCH_MODE_NON_COMBINED;
 
-	l1ctl_tx_ccch_mode_req(ms, app_state.ccch_mode);
+	l1ctl_tx_ccch_mode_req(ms, inst->ccch_mode);
 }
 
 static void dump_bcch(struct osmocom_ms *ms, uint8_t tc, const uint8_t *data)
@@ -164,12 +204,15 @@ static void dump_bcch(struct osmocom_ms *ms, uint8_t tc, const uint8_t *data)
 static int gsm48_rx_imm_ass(struct msgb *msg, struct osmocom_ms *ms)
 {
 	struct gsm48_imm_ass *ia = msgb_l3(msg);
+	struct ccch_inst *inst = ms_inst(ms);
 	uint8_t ch_type, ch_subch, ch_ts;
 
 	/* Discard packet TBF assignment */
 	if (ia->page_mode & 0xf0)
 		return 0;
 
+	inst->imm_ass++;
+
 	if (rsl_dec_chan_nr(ia->chan_desc.chan_nr, &ch_type, &ch_subch, &ch_ts) != 0) {
 		LOGP(DRR, LOGL_ERROR,
 		     "%s(): rsl_dec_chan_nr(chan_nr=0x%02x) failed\n",
@@ -183,8 +226,9 @@ static int gsm48_rx_imm_ass(struct msgb *msg, struct osmocom_ms *ms)
 
 		arfcn = ia->chan_desc.h0.arfcn_low | (ia->chan_desc.h0.arfcn_high << 8);
 
-		LOGP(DRR, LOGL_NOTICE, "GSM48 IMM ASS (ra=0x%02x, chan_nr=0x%02x, "
-			"ARFCN=%u, TS=%u, SS=%u, TSC=%u)\n", ia->req_ref.ra,
+		LOGP(DRR, LOGL_NOTICE, "%sGSM48 IMM ASS (ra=0x%02x, chan_nr=0x%02x, "
+			"ARFCN=%u, TS=%u, SS=%u, TSC=%u)\n", inst->prefix,
+			ia->req_ref.ra,
 			ia->chan_desc.chan_nr, arfcn, ch_ts, ch_subch,
 			ia->chan_desc.h0.tsc);
 
@@ -195,8 +239,9 @@ static int gsm48_rx_imm_ass(struct msgb *msg, struct osmocom_ms *ms)
 		hsn = ia->chan_desc.h1.hsn;
 		maio = ia->chan_desc.h1.maio_low | (ia->chan_desc.h1.maio_high << 2);
 
-		LOGP(DRR, LOGL_NOTICE, "GSM48 IMM ASS (ra=0x%02x, chan_nr=0x%02x, "
-			"HSN=%u, MAIO=%u, TS=%u, SS=%u, TSC=%u)\n", ia->req_ref.ra,
+		LOGP(DRR, LOGL_NOTICE, "%sGSM48 IMM ASS (ra=0x%02x, chan_nr=0x%02x, "
+			"HSN=%u, MAIO=%u, TS=%u, SS=%u, TSC=%u)\n", inst->prefix,
+			ia->req_ref.ra,
 			ia->chan_desc.chan_nr, hsn, maio, ch_ts, ch_subch,
 			ia->chan_desc.h1.tsc);
 	}
@@ -223,6 +268,8 @@ static const char *pag_print_mode(int mode)
 static char *chan_need(int need)
 {
 	switch (need) {
+	case PAGCAP_CNEED_NONE:
+		return "n/a";
 	case 0:
 		return "any";
 	case 1:
@@ -236,6 +283,63 @@ static char *chan_need(int need)
 	}
 }
 
+/* Capture or log the n-th identity of a paging request. 'mi' is the value
+ * part of a Mobile Identity IE. In capture mode, nothing is decoded, only
+ * identities on the watch list are. */
+static void paging_mi(struct osmocom_ms *ms, int n, uint8_t msg_type,
+		      uint8_t pag_mode, uint8_t cneed, const uint8_t *mi,
+		      uint8_t len)
+{
+	struct ccch_inst *inst = ms_inst(ms);
+	struct osmo_mobile_identity omi;
+	char mi_string[GSM48_MI_SIZE];
+
+	inst->pag_mi++;
+	paging_watch(ms->meas.last_fn, ms->test_arfcn, cneed, mi, len);
+	if (pagcap_active()) {
+		struct pagcap_rec rec = {
+			.fn = ms->meas.last_fn,
+			.arfcn = ms->test_arfcn,
+			.msg_type = msg_type,
+			.pag_mode = pag_mode,
+			.chan_needed = cneed,
+			.mi_type = mi[0] & GSM_MI_TYPE_MASK,
+			.mi_len = OSMO_MIN(len, PAGCAP_MI_MAX),
+		};
+
+		memcpy(rec.mi, mi, rec.mi_len);
+		pagcap_push(&rec);
+		return;
+	}
+
+	osmo_mobile_identity_decode(&omi, mi, len, false);
+	osmo_mobile_identity_to_str_buf(mi_string, sizeof(mi_string), &omi);
+	LOGP(DRR, LOGL_NOTICE, "%sPaging%d: %s chan %s to M(%s)\n",
+	     inst->prefix, n, pag_print_mode(pag_mode), chan_need(cneed),
+	     mi_string);
+}
+
+/* Paging Request Type 2 and 3 carry TMSIs without IE header */
+static void paging_tmsi(struct osmocom_ms *ms, int n, uint8_t msg_type,
+			uint8_t pag_mode, uint8_t cneed, const uint8_t *tmsi)
+{
+	struct ccch_inst *inst;
+	uint8_t mi[5] = { 0xf0 | GSM_MI_TYPE_TMSI };
+
+	memcpy(mi + 1, tmsi, 4);
+	if (pagcap_active()) {
+		paging_mi(ms, n, msg_type, pag_mode, cneed, mi, sizeof(mi));
+		return;
+	}
+
+	inst = ms_inst(ms);
+	inst->pag_mi++;
+	paging_watch(ms->meas.last_fn, ms->test_arfcn, cneed, mi, sizeof(mi));
+	LOGP(DRR, LOGL_NOTICE, "%sPaging%d: %s chan %s to M(TMSI-0x%08x)\n",
+	     inst->prefix, n, pag_print_mode(pag_mode), chan_need(cneed),
+	     osmo_load32be(tmsi));
+}
+
 /**
  * This can contain two MIs. The size checking is a bit of a mess.
  */
@@ -243,8 +347,6 @@ static int gsm48_rx_paging_p1(struct msgb *msg, struct osmocom_ms *ms)
 {
 	struct gsm48_paging1 *pag;
 	int len1, len2, mi_type, tag;
-	struct osmo_mobile_identity mi;
-	char mi_string[GSM48_MI_SIZE];
 
 	/* is there enough room for the header + LV? */
 	if (msgb_l3len(msg) < sizeof(*pag) + 2) {
@@ -261,14 +363,9 @@ static int gsm48_rx_paging_p1(struct msgb *msg, struct osmocom_ms *ms)
 		return -1;
 	}
 
-	if (mi_type != GSM_MI_TYPE_NONE) {
-		osmo_mobile_identity_decode(&mi, &pag->data[1], len1, false);
-		osmo_mobile_identity_to_str_buf(mi_string, sizeof(mi_string), &mi);
-		LOGP(DRR, LOGL_NOTICE, "Paging1: %s chan %s to M(%s)\n",
-		     pag_print_mode(pag->pag_mode),
-		     chan_need(pag->cneed1),
-		     mi_string);
-	}
+	if (mi_type != GSM_MI_TYPE_NONE)
+		paging_mi(ms, 1, pag->msg_type, pag->pag_mode, pag->cneed1,
+			  &pag->data[1], len1);
 
 	/* check if we have a MI type in here */
 	if (msgb_l3len(msg) < sizeof(*pag) + 2 + len1 + 3)
@@ -283,12 +380,8 @@ static int gsm48_rx_paging_p1(struct msgb *msg, struct osmocom_ms *ms)
 			return -1;
 		}
 
-		osmo_mobile_identity_decode(&mi, &pag->data[2 + len1 + 2], len2, false);
-		osmo_mobile_identity_to_str_buf(mi_string, sizeof(mi_string), &mi);
-		LOGP(DRR, LOGL_NOTICE, "Paging2: %s chan %s to M(%s)\n",
-		     pag_print_mode(pag->pag_mode),
-		     chan_need(pag->cneed2),
-		     mi_string);
+		paging_mi(ms, 2, pag->msg_type, pag->pag_mode, pag->cneed2,
+			  &pag->data[2 + len1 + 2], len2);
 	}
 	return 0;
 }
@@ -296,8 +389,6 @@ static int gsm48_rx_paging_p1(struct msgb *msg, struct osmocom_ms *ms)
 static int gsm48_rx_paging_p2(struct msgb *msg, struct osmocom_ms *ms)
 {
 	struct gsm48_paging2 *pag;
-	struct osmo_mobile_identity mi;
-	char mi_string[GSM48_MI_SIZE];
 	int tag, len;
 
 	if (msgb_l3len(msg) < sizeof(*pag)) {
@@ -306,14 +397,10 @@ static int gsm48_rx_paging_p2(struct msgb *msg, struct osmocom_ms *ms)
 	}
 
 	pag = msgb_l3(msg);
-	LOGP(DRR, LOGL_NOTICE, "Paging1: %s chan %s to M(TMSI-0x%08x)\n",
-	     pag_print_mode(pag->pag_mode),
-	     chan_need(pag->cneed1),
-	     osmo_load32be(&pag->tmsi1));
-	LOGP(DRR, LOGL_NOTICE, "Paging2: %s chan %s to M(TMSI-0x%08x)\n",
-	     pag_print_mode(pag->pag_mode),
-	     chan_need(pag->cneed2),
-	     osmo_load32be(&pag->tmsi2));
+	paging_tmsi(ms, 1, pag->msg_type, pag->pag_mode, pag->cneed1,
+		    (const uint8_t *)&pag->tmsi1);
+	paging_tmsi(ms, 2, pag->msg_type, pag->pag_mode, pag->cneed2,
+		    (const uint8_t *)&pag->tmsi2);
 
 	/* no optional element */
 	if (msgb_l3len(msg) < sizeof(*pag) + 3)
@@ -330,11 +417,8 @@ static int gsm48_rx_paging_p2(struct msgb *msg, struct osmocom_ms *ms)
 		return -1;
 	}
 
-	osmo_mobile_identity_decode(&mi, &pag->data[2], len, false);
-	osmo_mobile_identity_to_str_buf(mi_string, sizeof(mi_string), &mi);
-	LOGP(DRR, LOGL_NOTICE, "Paging3: %s chan n/a to M(%s)\n",
-	     pag_print_mode(pag->pag_mode),
-	     mi_string);
+	paging_mi(ms, 3, pag->msg_type, pag->pag_mode, PAGCAP_CNEED_NONE,
+		  &pag->data[2], len);
 
 	return 0;
 }
@@ -349,20 +433,14 @@ static int gsm48_rx_paging_p3(struct msgb *msg, struct osmocom_ms *ms)
 	}
 
 	pag = msgb_l3(msg);
-	LOGP(DRR, LOGL_NOTICE, "Paging1: %s chan %s to M(TMSI-0x%08x)\n",
-	     pag_print_mode(pag->pag_mode),
-	     chan_need(pag->cneed1),
-	     osmo_load32be(&pag->tmsi1));
-	LOGP(DRR, LOGL_NOTICE, "Paging2: %s chan %s to M(TMSI-0x%08x)\n",
-	     pag_print_mode(pag->pag_mode),
-	     chan_need(pag->cneed2),
-	     osmo_load32be(&pag->tmsi2));
-	LOGP(DRR, LOGL_NOTICE, "Paging3: %s chan n/a to M(TMSI-0x%08x)\n",
-	     pag_print_mode(pag->pag_mode),
-	     osmo_load32be(&pag->tmsi3));
-	LOGP(DRR, LOGL_NOTICE, "Paging4: %s chan n/a to M(TMSI-0x%08x)\n",
-	     pag_print_mode(pag->pag_mode),
-	     osmo_load32be(&pag->tmsi4));
+	paging_tmsi(ms, 1, pag->msg_type, pag->pag_mode, pag->cneed1,
+		    (const uint8_t *)&pag->tmsi1);
+	paging_tmsi(ms, 2, pag->msg_type, pag->pag_mode, pag->cneed2,
+		    (const uint8_t *)&pag->tmsi2);
+	paging_tmsi(ms, 3, pag->msg_type, pag->pag_mode, PAGCAP_CNEED_NONE,
+		    (const uint8_t *)&pag->tmsi3);
+	paging_tmsi(ms, 4, pag->msg_type, pag->pag_mode, PAGCAP_CNEED_NONE,
+		    (const uint8_t *)&pag->tmsi4);
 
 	return 0;
 }
@@ -417,12 +495,15 @@ int gsm48_rx_ccch(struct msgb *msg, struct osmocom_ms *ms)
 
 	switch (sih->system_information) {
 	case GSM48_MT_RR_PAG_REQ_1:
+		ms_inst(ms)->pag_req++;
 		gsm48_rx_paging_p1(msg, ms);
 		break;
 	case GSM48_MT_RR_PAG_REQ_2:
+		ms_inst(ms)->pag_req++;
 		gsm48_rx_paging_p2(msg, ms);
 		break;
 	case GSM48_MT_RR_PAG_REQ_3:
+		ms_inst(ms)->pag_req++;
 		gsm48_rx_paging_p3(msg, ms);
 		break;
 	case GSM48_MT_RR_IMM_ASS:
@@ -456,8 +537,30 @@ int gsm48_rx_bcch(struct msgb *msg, struct osmocom_ms *ms)
 
 void layer3_app_reset(void)
 {
+	unsigned int i;
+
 	/* Reset state */
-	app_state.ccch_mode = CCCH_MODE_NONE;
+	for (i = 0; i < app_state.num_inst; i++)
+		app_state.inst[i].ccch_mode = CCCH_MODE_NONE;
+}
+
+static void inst_reset(struct osmocom_ms *ms)
+{
+	ms_inst(ms)->ccch_mode = CCCH_MODE_NONE;
+}
+
+static void stats_cb(void *data)
+{
+	struct ccch_inst *inst;
+	unsigned int i;
+
+	for (i = 0; i < app_state.num_inst; i++) {
+		inst = &app_state.inst[i];
+		LOGP(DRR, LOGL_INFO, "ARFCN %u: %u paging requests, %u "
+			"identities, %u IMM ASS\n", inst->arfcn, inst->pag_req,
+			inst->pag_mi, inst->imm_ass);
+	}
+	osmo_timer_schedule(&app_state.stats_timer, STATS_INTERVAL, 0);
 }
 
 static int signal_cb(unsigned int subsys, unsigned int signal,
@@ -471,7 +574,7 @@ static int signal_cb(unsigned int subsys, unsigned int signal,
 	switch (signal) {
 	case S_L1CTL_RESET:
 		ms = signal_data;
-		layer3_app_reset();
+		inst_reset(ms);
 		return l1ctl_tx_fbsb_req(ms, ms->test_arfcn,
 		                         L1CTL_FBSB_F_FB01SB, 100, 0,
 		                         CCCH_MODE_NONE, dbm2rxlev(-85));
@@ -482,31 +585,182 @@ static int signal_cb(unsigned int subsys, unsigned int signal,
 
 static int _ccch_scan_start(void)
 {
+	struct ccch_inst *inst;
+	unsigned int i;
 	int rc;
 
-	rc = layer2_open(app_state.ms, app_state.ms->settings.layer2_socket_path);
-	if (rc < 0) {
-		fprintf(stderr, "Failed during layer2_open()\n");
-		return rc;
+	for (i = 0; i < app_state.num_inst; i++) {
+		inst = &app_state.inst[i];
+		rc = layer2_open(inst->ms, inst->ms->settings.layer2_socket_path);
+		if (rc < 0) {
+			fprintf(stderr, "Failed during layer2_open(%s)\n",
+				inst->ms->settings.layer2_socket_path);
+			return rc;
+		}
+
+		l1ctl_tx_reset_req(inst->ms, L1CTL_RES_T_FULL);
 	}
 
-	l1ctl_tx_reset_req(app_state.ms, L1CTL_RES_T_FULL);
+	osmo_timer_setup(&app_state.stats_timer, stats_cb, NULL);
+	osmo_timer_schedule(&app_state.stats_timer, STATS_INTERVAL, 0);
+
+	return 0;
+}
+
+static int _ccch_scan_exit(void)
+{
+	pagcap_close();
+	paging_watch_close();
+	return 0;
+}
+
+/* add an instance from "ARFCN:SOCKET" */
+static int add_inst(const char *arg)
+{
+	struct ccch_inst *inst;
+	char *end;
+	long arfcn;
+
+	if (app_state.num_inst == MAX_INST) {
+		fprintf(stderr, "Too many instances, maximum is %d\n",
+			MAX_INST);
+		return -ENOSPC;
+	}
+
+	arfcn = strtol(arg, &end, 10);
+	if (end == arg || *end != ':' || !end[1] || arfcn < 0
+	 || arfcn > 0xffff) {
+		fprintf(stderr, "Instance '%s' is not ARFCN:SOCKET\n", arg);
+		return -EINVAL;
+	}
+
+	inst = &app_state.inst[app_state.num_inst++];
+	inst->arfcn = arfcn;
+	inst->socket_path = talloc_strdup(l23_ctx, end + 1);
+
 	return 0;
 }
 
 int l23_app_init(void)
 {
+	struct ccch_inst *inst;
+	char name[8];
+	unsigned int i;
+	int rc;
+
 	l23_app_start = _ccch_scan_start;
+	l23_app_exit = _ccch_scan_exit;
+
+	/* without -m, follow the ARFCN given by -a on the socket of -s */
+	if (!app_state.num_inst) {
+		app_state.inst[0].arfcn = cfg_test_arfcn;
+		app_state.num_inst = 1;
+	}
 
-	app_state.ms = osmocom_ms_alloc(l23_ctx, "1");
-	OSMO_ASSERT(app_state.ms);
+	if (app_state.capture_path) {
+		rc = pagcap_open(app_state.capture_path);
+		if (rc < 0)
+			return rc;
+	}
+
+	if (app_state.watch_path) {
+		rc = paging_watch_load(app_state.watch_path);
+		if (rc < 0) {
+			LOGP(DRR, LOGL_ERROR, "Failed to load watch list '%s': "
+				"%s\n", app_state.watch_path, strerror(-rc));
+			return rc;
+		}
+		/* matches go to stdout, unless given otherwise */
+		if (!app_state.watch_log_path)
+			app_state.watch_log_path = "-";
+	}
+	if (app_state.watch_log_path) {
+		rc = paging_watch_open(app_state.watch_log_path);
+		if (rc < 0) {
+			LOGP(DRR, LOGL_ERROR, "Failed to open '%s': %s\n",
+				app_state.watch_log_path, strerror(-rc));
+			return rc;
+		}
+	}
+
+	for (i = 0; i < app_state.num_inst; i++) {
+		inst = &app_state.inst[i];
+		snprintf(name, sizeof(name), "%u", i + 1);
+		inst->ms = osmocom_ms_alloc(l23_ctx, name);
+		OSMO_ASSERT(inst->ms);
+		inst->ms->test_arfcn = inst->arfcn;
+		if (inst->socket_path)
+			OSMO_STRLCPY_ARRAY(inst->ms->settings.layer2_socket_path,
+					   inst->socket_path);
+		if (app_state.num_inst > 1)
+			snprintf(inst->prefix, sizeof(inst->prefix),
+				 "(ARFCN %u) ", inst->arfcn);
+
+		rc = layer3_init(inst->ms);
+		if (rc < 0)
+			return rc;
+	}
 
 	osmo_signal_register_handler(SS_L1CTL, &signal_cb, NULL);
-	return layer3_init(app_state.ms);
+	return 0;
+}
+
+static int l23_getopt_options(struct option **options)
+{
+	static struct option opts [] = {
+		{"capture", 1, 0, 'C'},
+		{"monitor", 1, 0, 'm'},
+		{"watch", 1, 0, 'w'},
+		{"watch-log", 1, 0, 'W'},
+	};
+
+	*options = opts;
+	return ARRAY_SIZE(opts);
+}
+
+static int l23_cfg_print_help(void)
+{
+	printf("\nApplication specific\n");
+	printf("  -C --capture FILE	Write paging requests as binary records to FILE,\n");
+	printf("			or to a unix socket with unix:PATH.\n");
+	printf("  -m --monitor ARFCN:SOCKET	Follow ARFCN with the phone on\n");
+	printf("			layer2 SOCKET. Repeat for up to %d phones,\n",
+	       MAX_INST);
+	printf("			instead of -a and -s.\n");
+	printf("  -w --watch FILE	Report paging of the IMSIs and TMSIs (0x...)\n");
+	printf("			listed in FILE, one per line.\n");
+	printf("  -W --watch-log FILE	Append reports of -w to FILE instead of stdout.\n");
+
+	return 0;
+}
+
+static int l23_cfg_handle(int c, const char *optarg)
+{
+	switch (c) {
+	case 'C':
+		app_state.capture_path = talloc_strdup(l23_ctx, optarg);
+		break;
+	case 'm':
+		if (add_inst(optarg) < 0)
+			exit(1);
+		break;
+	case 'w':
+		app_state.watch_path = talloc_strdup(l23_ctx, optarg);
+		break;
+	case 'W':
+		app_state.watch_log_path = talloc_strdup(l23_ctx, optarg);
+		break;
+	}
+
+	return 0;
 }
 
 const struct l23_app_info l23_app_info = {
 	.copyright	= "Copyright (C) 2010 Harald Welte <laforge@gnumonks.org>\n",
 	.contribution	= "Contributions by Holger Hans Peter Freyther\n",
+	.getopt_string	= "C:m:w:W:",
 	.opt_supported = L23_OPT_ARFCN | L23_OPT_TAP | L23_OPT_DBG,
+	.cfg_getopt_opt = l23_getopt_options,
+	.cfg_handle_opt	= l23_cfg_handle,
+	.cfg_print_help	= l23_cfg_print_help,
 };
@@ -40,7 +40,10 @@ extern uint16_t basic_band_range[][2];
 extern uint16_t (*band_range)[][2];
 
 char *logname = "/dev/null";
+int log_binary = 0;
+unsigned int log_flush_interval = 10;
 int RACH_MAX = 2;
+unsigned int cell_window = 300;
 static struct osmocom_ms *g_ms;
 
 
@@ -105,8 +108,11 @@ static int l23_getopt_options(struct option **options)
 {
 	static struct option opts [] = {
 		{"logfile", 1, 0, 'l'},
+		{"binary", 0, 0, 'B'},
+		{"flush", 1, 0, 'F'},
 		{"rach", 1, 0, 'r'},
 		{"no-rach", 1, 0, 'n'},
+		{"window", 1, 0, 'W'},
 #ifdef _HAVE_GPSD
 		{"gpsd-host", 1, 0, 'g'},
 		{"gpsd-port", 1, 0, 'p'},
@@ -165,8 +171,13 @@ static int l23_cfg_print_help(void)
 {
 	printf("\nApplication specific\n");
 	printf("  -l --logfile LOGFILE	Logfile for the cell log.\n");
+	printf("  -B --binary		Write the cell log in binary format.\n");
+	printf("  -F --flush SECONDS	10. Flush interval of the binary log.\n");
 	printf("  -r --rach RACH	Nr. of RACH bursts to send.\n");
 	printf("  -n --no-rach		Send no rach bursts.\n");
+	printf("  -W --window SECONDS	300. Don't log a cell again within\n");
+	printf("			this time, 0 logs every time. RACH is only\n");
+	printf("			sent if the cell has no TA sample nearby.\n");
 	printf("  -g --gpsd-host HOST	127.0.0.1. gpsd host.\n");
 	printf("  -p --port PORT	2947. gpsd port\n");
 	printf("  -f --gps DEVICE	/dev/ttyACM0. GPS serial device.\n");
@@ -184,12 +195,21 @@ static int l23_cfg_handle(int c, const char *optarg)
 	case 'l':
 		logname = talloc_strdup(l23_ctx, optarg);
 		break;
+	case 'B':
+		log_binary = 1;
+		break;
+	case 'F':
+		log_flush_interval = atoi(optarg);
+		break;
 	case 'r':
 		RACH_MAX = atoi(optarg);
 		break;
 	case 'n':
 		RACH_MAX = 0;
 		break;
+	case 'W':
+		cell_window = atoi(optarg);
+		break;
 	case 'g':
 #ifdef _HAVE_GPSD
 		snprintf(g.gpsd_host, ARRAY_SIZE(g.gpsd_host), "%s", optarg);
@@ -244,7 +264,7 @@ cmd_line_error:
 
 const struct l23_app_info l23_app_info = {
 	.copyright	= "Copyright (C) 2010 Andreas Eversberg\n",
-	.getopt_string	= "g:p:l:r:nf:b:A:",
+	.getopt_string	= "g:p:l:BF:r:nW:f:b:A:",
 	.opt_supported	= L23_OPT_TAP | L23_OPT_DBG,
 	.cfg_getopt_opt = l23_getopt_options,
 	.cfg_handle_opt	= l23_cfg_handle,
@@ -76,58 +76,127 @@ struct arfcn_state {
 
 enum bscan_state {
 	BSCAN_S_NONE,
+	BSCAN_S_WAIT_PM,
 	BSCAN_S_WAIT_DATA,
 	BSCAN_S_DONE,
 };
 
 enum fps_state {
 	FPS_S_NONE,
-	FPS_S_PM_GSM900,
-	FPS_S_PM_EGSM900,
-	FPS_S_PM_GSM1800,
+	FPS_S_PM,
 	FPS_S_BINFO,
+	FPS_S_DONE,
+};
+
+#define MAX_WORKERS	8
+
+/* one L1 instance taking part in the scan */
+struct bscan_worker {
+	struct osmocom_ms *ms;
+
+	enum bscan_state state;
+	struct cell_info *cur_cell;
+	uint16_t cur_arfcn;
+	struct osmo_timer_list timer;
+};
+
+/* bands to measure, each range is measured by one worker */
+static const struct {
+	uint16_t from, to;
+} pm_ranges[] = {
+	{ 0, 124 },	/* GSM900 */
+	{ 955, 1023 },	/* E-GSM900 */
+	{ 512, 885 },	/* DCS1800 */
 };
 
 struct full_power_scan {
 	/* Full Power Scan */
 	enum fps_state fps_state;
 	struct arfcn_state arfcn_state[1024];
+	unsigned int pm_next; /* next entry of pm_ranges */
 
-	struct osmocom_ms *ms;
+	/* measured ARFCNs not yet tested, max-heap by rxlev */
+	uint16_t pending[1024];
+	unsigned int pending_num;
+
+	struct bscan_worker worker[MAX_WORKERS];
+	unsigned int num_workers;
 
 	/* BCCH info part */
-	enum bscan_state state;
 	struct llist_head cell_list;
-	struct cell_info *cur_cell;
-	uint16_t cur_arfcn;
-	struct osmo_timer_list timer;
 };
 
 static struct full_power_scan fps;
 
-static int get_next_arfcn(struct full_power_scan *fps)
+static struct bscan_worker *ms_worker(struct osmocom_ms *ms)
+{
+	unsigned int i;
+
+	for (i = 0; i < fps.num_workers; i++) {
+		if (fps.worker[i].ms == ms)
+			return &fps.worker[i];
+	}
+
+	return NULL;
+}
+
+static inline uint8_t pending_rxlev(unsigned int i)
+{
+	return fps.arfcn_state[fps.pending[i]].rxlev;
+}
+
+static void pending_sift_down(unsigned int i)
+{
+	unsigned int child;
+	uint16_t tmp;
+
+	while ((child = 2 * i + 1) < fps.pending_num) {
+		if (child + 1 < fps.pending_num
+		 && pending_rxlev(child + 1) > pending_rxlev(child))
+			child++;
+		if (pending_rxlev(i) >= pending_rxlev(child))
+			break;
+		tmp = fps.pending[i];
+		fps.pending[i] = fps.pending[child];
+		fps.pending[child] = tmp;
+		i = child;
+	}
+}
+
+/* collect all measured ARFCNs into the heap */
+static void pending_build(void)
 {
 	unsigned int i;
-	uint8_t best_rxlev = 0;
-	int best_arfcn = -1;
 
-	for (i = 0; i < ARRAY_SIZE(fps->arfcn_state); i++) {
-		struct arfcn_state *af = &fps->arfcn_state[i];
-		/* skip ARFCN's where we don't have a PM */
-		if (!(af->flags & AFS_F_PM_DONE))
+	fps.pending_num = 0;
+	for (i = 0; i < ARRAY_SIZE(fps.arfcn_state); i++) {
+		struct arfcn_state *af = &fps.arfcn_state[i];
+		/* skip ARFCN's where we don't have a PM or that are tested */
+		if (!(af->flags & AFS_F_PM_DONE) || (af->flags & AFS_F_TESTED))
 			continue;
-		/* skip ARFCN's that we already tested */
-		if (af->flags & AFS_F_TESTED)
+		/* nothing to sync to */
+		if (!af->rxlev)
 			continue;
-		/* if current arfcn_state is better than best so far,
-		 * select it */
-		if (af->rxlev > best_rxlev) {
-			best_rxlev = af->rxlev;
-			best_arfcn = i;
-		}
+		fps.pending[fps.pending_num++] = i;
 	}
-	printf("arfcn=%d rxlev=%u\n", best_arfcn, best_rxlev);
-	return best_arfcn;
+	for (i = fps.pending_num / 2; i-- > 0; )
+		pending_sift_down(i);
+}
+
+static int get_next_arfcn(void)
+{
+	uint16_t arfcn;
+
+	if (!fps.pending_num)
+		return -1;
+
+	arfcn = fps.pending[0];
+	fps.pending[0] = fps.pending[--fps.pending_num];
+	pending_sift_down(0);
+
+	LOGP(DRR, LOGL_INFO, "arfcn=%u rxlev=%u, %u pending\n", arfcn,
+		fps.arfcn_state[arfcn].rxlev, fps.pending_num);
+	return arfcn;
 }
 
 static struct cell_info *cell_info_alloc(void)
@@ -141,66 +210,127 @@ static void cell_info_free(struct cell_info *ci)
 	talloc_free(ci);
 }
 
+static void fps_check_done(void)
+{
+	struct cell_info *ci;
+	unsigned int i, num = 0;
+
+	for (i = 0; i < fps.num_workers; i++) {
+		if (fps.worker[i].state == BSCAN_S_WAIT_DATA)
+			return;
+	}
+
+	fps.fps_state = FPS_S_DONE;
+	llist_for_each_entry(ci, &fps.cell_list, list)
+		num++;
+	LOGP(DRR, LOGL_NOTICE, "BCCH scan done, %u cells found\n", num);
+}
+
 /* start to scan for one ARFCN */
-static int _cinfo_start_arfcn(unsigned int band_arfcn)
+static int _cinfo_start_arfcn(struct bscan_worker *w, unsigned int band_arfcn)
 {
 	int rc;
 
 	/* ask L1 to try to tune to new ARFCN */
 	/* FIXME: decode band */
-	rc = l1ctl_tx_fbsb_req(fps.ms, band_arfcn,
+	rc = l1ctl_tx_fbsb_req(w->ms, band_arfcn,
 	                       L1CTL_FBSB_F_FB01SB, 100, 0, CCCH_MODE_COMBINED,
 			       fps.arfcn_state[band_arfcn].rxlev);
 	if (rc < 0)
 		return rc;
 
 	/* allocate new cell info structure */
-	fps.cur_cell = cell_info_alloc();
-	fps.cur_arfcn = band_arfcn;
-	fps.cur_cell->band_arfcn = band_arfcn;
+	w->cur_cell = cell_info_alloc();
+	w->cur_arfcn = band_arfcn;
+	w->cur_cell->band_arfcn = band_arfcn;
 	/* FIXME: start timer in case we never get a sync */
-	fps.state = BSCAN_S_WAIT_DATA;
-	osmo_timer_schedule(&fps.timer, 2, 0);
+	w->state = BSCAN_S_WAIT_DATA;
+	osmo_timer_schedule(&w->timer, 2, 0);
 
 	return 0;
 }
 
-
-static void cinfo_next_cell(void *data)
+/* let the worker sync to the best ARFCN that nobody has claimed */
+static void cinfo_claim_next(struct bscan_worker *w)
 {
 	int rc;
 
+	rc = get_next_arfcn();
+	if (rc < 0) {
+		w->state = BSCAN_S_DONE;
+		fps_check_done();
+		return;
+	}
+	/* start syncing to the next ARFCN */
+	_cinfo_start_arfcn(w, rc);
+}
+
+static void cinfo_next_cell(struct bscan_worker *w)
+{
+	osmo_timer_del(&w->timer);
+
 	/* we've been waiting for BCCH info */
-	fps.arfcn_state[fps.cur_arfcn].flags |= AFS_F_TESTED;
+	fps.arfcn_state[w->cur_arfcn].flags |= AFS_F_TESTED;
 	/* if there is a BCCH, we need to add the collected BCCH
 	 * information to our list */
 
-	if (fps.arfcn_state[fps.cur_arfcn].flags & AFS_F_BCCH)
-		llist_add(&fps.cur_cell->list, &fps.cell_list);
+	if (fps.arfcn_state[w->cur_arfcn].flags & AFS_F_BCCH)
+		llist_add(&w->cur_cell->list, &fps.cell_list);
 	else
-		cell_info_free(fps.cur_cell);
+		cell_info_free(w->cur_cell);
+	w->cur_cell = NULL;
 
-	rc = get_next_arfcn(&fps);
-	if (rc < 0) {
-		fps.state = BSCAN_S_DONE;
-		return;
-	}
-	/* start syncing to the next ARFCN */
-	_cinfo_start_arfcn(rc);
+	cinfo_claim_next(w);
 }
 
 static void cinfo_timer_cb(void *data)
 {
-	switch (fps.state) {
+	struct bscan_worker *w = data;
+
+	switch (w->state) {
 	case BSCAN_S_WAIT_DATA:
-		cinfo_next_cell(data);
+		cinfo_next_cell(w);
 		break;
 	case BSCAN_S_NONE:
+	case BSCAN_S_WAIT_PM:
 	case BSCAN_S_DONE:
 		break;
 	}
 }
 
+/* Give the worker the next band to measure. When all bands are measured
+ * by all workers, every worker starts to sync to BCCHs. */
+static int pm_next_range(struct bscan_worker *w)
+{
+	unsigned int i;
+
+	if (fps.pm_next < ARRAY_SIZE(pm_ranges)) {
+		i = fps.pm_next++;
+		w->state = BSCAN_S_WAIT_PM;
+		return l1ctl_tx_pm_req_range(w->ms, pm_ranges[i].from,
+					     pm_ranges[i].to);
+	}
+
+	w->state = BSCAN_S_NONE;
+	for (i = 0; i < fps.num_workers; i++) {
+		if (fps.worker[i].state == BSCAN_S_WAIT_PM)
+			return 0;
+	}
+
+	/* power measurement has finished, we can start to actually
+	 * iterate over the ARFCN's and try to sync to BCCHs */
+	fps.fps_state = FPS_S_BINFO;
+	pending_build();
+	LOGP(DRR, LOGL_NOTICE, "Power measurement done, %u ARFCNs to test "
+		"with %u phones\n", fps.pending_num, fps.num_workers);
+	for (i = 0; i < fps.num_workers; i++) {
+		if (fps.worker[i].state == BSCAN_S_NONE)
+			cinfo_claim_next(&fps.worker[i]);
+	}
+
+	return 0;
+}
+
 #if 0
 /* Update cell_info for current cell with received BCCH info */
 static int rx_bcch_info(const uint8_t *data)
@@ -240,10 +370,10 @@ static int rx_sch_info()
 static int bscan_sig_cb(unsigned int subsys, unsigned int signal,
 		     void *handler_data, void *signal_data)
 {
-	struct osmocom_ms *ms;
+	struct bscan_worker *w;
 	struct osmobb_meas_res *mr;
+	struct osmobb_fbsb_res *fr;
 	uint16_t arfcn;
-	int rc;
 
 	if (subsys != SS_L1CTL)
 		return 0;
@@ -251,8 +381,8 @@ static int bscan_sig_cb(unsigned int subsys, unsigned int signal,
 	switch (signal) {
 	case S_L1CTL_PM_RES:
 		mr = signal_data;
-		/* check if PM result is for same MS */
-		if (fps.ms != mr->ms)
+		/* check if PM result is for one of our MS */
+		if (!ms_worker(mr->ms))
 			return 0;
 		arfcn = mr->band_arfcn & 0x3ff;
 		/* update RxLev and notice that PM was done */
@@ -260,31 +390,10 @@ static int bscan_sig_cb(unsigned int subsys, unsigned int signal,
 		fps.arfcn_state[arfcn].flags |= AFS_F_PM_DONE;
 		break;
 	case S_L1CTL_PM_DONE:
-		ms = signal_data;
-		switch (fps.fps_state) {
-		case FPS_S_PM_GSM900:
-			fps.fps_state = FPS_S_PM_EGSM900;
-			return l1ctl_tx_pm_req_range(ms, 955, 1023);
-		case FPS_S_PM_EGSM900:
-			fps.fps_state = FPS_S_PM_GSM1800;
-			return l1ctl_tx_pm_req_range(ms, 512, 885);
-		case FPS_S_PM_GSM1800:
-			/* power measurement has finished, we can start
-			 * to actually iterate over the ARFCN's and try
-			 * to sync to BCCHs */
-			fps.fps_state = FPS_S_BINFO;
-			rc = get_next_arfcn(&fps);
-			if (rc < 0) {
-				fps.state = BSCAN_S_DONE;
-				return 0;
-			}
-			_cinfo_start_arfcn(rc);
-			break;
-		case FPS_S_NONE:
-		case FPS_S_BINFO:
-			break;
-		}
-		break;
+		w = ms_worker(signal_data);
+		if (!w || w->state != BSCAN_S_WAIT_PM)
+			return 0;
+		return pm_next_range(w);
 	case S_L1CTL_FBSB_RESP:
 		/* We actually got a FCCH/SCH burst */
 #if 0
@@ -295,28 +404,61 @@ static int bscan_sig_cb(unsigned int subsys, unsigned int signal,
 #endif
 	case S_L1CTL_FBSB_ERR:
 		/* We timed out, move on */
-		if (fps.state == BSCAN_S_WAIT_DATA)
-			cinfo_next_cell(NULL);
+		fr = signal_data;
+		w = ms_worker(fr->ms);
+		if (w && w->state == BSCAN_S_WAIT_DATA)
+			cinfo_next_cell(w);
 		break;
 	}
 	return 0;
 }
 
-/* start the full power scan */
+/* add a phone to the scan, before the first fps_start() */
+int fps_add_ms(struct osmocom_ms *ms)
+{
+	struct bscan_worker *w;
+
+	if (fps.num_workers == MAX_WORKERS)
+		return -ENOSPC;
+
+	w = &fps.worker[fps.num_workers++];
+	w->ms = ms;
+	osmo_timer_setup(&w->timer, cinfo_timer_cb, w);
+
+	return 0;
+}
+
+/* start the full power scan on a phone, after its L1 was reset */
 int fps_start(struct osmocom_ms *ms)
 {
-	memset(&fps, 0, sizeof(fps));
-	fps.ms = ms;
+	struct bscan_worker *w = ms_worker(ms);
 
-	fps.timer.cb = cinfo_timer_cb;
-	fps.timer.data = &fps;
+	if (!w)
+		return -EINVAL;
 
-	/* Start by scanning the good old GSM900 band */
-	fps.fps_state = FPS_S_PM_GSM900;
-	return l1ctl_tx_pm_req_range(ms, 0, 124);
+	switch (fps.fps_state) {
+	case FPS_S_NONE:
+		fps.fps_state = FPS_S_PM;
+		/* fallthrough */
+	case FPS_S_PM:
+		return pm_next_range(w);
+	case FPS_S_BINFO:
+		/* joined late, help testing ARFCNs, or the L1 was reset
+		 * while syncing */
+		if (w->state == BSCAN_S_WAIT_DATA)
+			cinfo_next_cell(w);
+		else
+			cinfo_claim_next(w);
+		return 0;
+	case FPS_S_DONE:
+		break;
+	}
+
+	return 0;
 }
 
 int fps_init(void)
 {
+	INIT_LLIST_HEAD(&fps.cell_list);
 	return osmo_signal_register_handler(SS_L1CTL, &bscan_sig_cb, NULL);
 }
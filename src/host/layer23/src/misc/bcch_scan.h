@@ -2,5 +2,6 @@
 
 struct osmocom_ms;
 
+int fps_add_ms(struct osmocom_ms *ms);
 int fps_start(struct osmocom_ms *ms);
 int fps_init(void);
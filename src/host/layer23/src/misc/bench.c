@@ -0,0 +1,1225 @@
+/* Benchmarks and fuzzing of layer23 decoders */
+
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/gsm/gsm48.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/common/sysinfo.h>
+#include <osmocom/bb/common/freqset.h>
+#include <osmocom/bb/common/paging_match.h>
+#include <osmocom/bb/misc/log.h>
+#include <osmocom/bb/misc/sysinfo_ref.h>
+
+/* Each benchmark runs 'iterations' rounds over a set of messages that is
+ * generated from the seed, and prints the time it took. With -f, each round
+ * uses new random messages of random length instead. This is meant to be
+ * run under valgrind or built with -fsanitize=address, so the decoders see
+ * input they were not written for. With -c, the sysinfo benchmark takes
+ * its messages from the files of a corpus directory instead. */
+struct bench {
+	const char *name;
+	const char *help;
+	int (*run)(unsigned long iterations, bool fuzz);
+};
+
+static struct timespec start_time;
+static const char *output; /* file to write generated input to */
+
+static void bench_start(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+/* returns the seconds since bench_start() */
+static double bench_stop(const char *what, unsigned long count)
+{
+	struct timespec now;
+	double secs;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	secs = (now.tv_sec - start_time.tv_sec)
+		+ (now.tv_nsec - start_time.tv_nsec) / 1e9;
+	printf("%-32s %10lu in %8.3f s, %8.1f ns each\n", what, count, secs,
+		count ? secs * 1e9 / count : 0.0);
+
+	return secs;
+}
+
+static void random_fill(uint8_t *data, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		data[i] = random();
+}
+
+/*
+ * system information
+ */
+
+#define SI_SET		4096 /* messages of the set */
+#define SI_CELL		16 /* messages per cell, before sysinfo is cleared */
+
+enum si_type {
+	SI_1, SI_2, SI_2bis, SI_2ter, SI_3, SI_4,
+	SI_5, SI_5bis, SI_5ter, SI_6, SI_10, SI_13,
+	SI_NUM
+};
+
+static const uint8_t si_mt[SI_NUM] = {
+	[SI_1] = GSM48_MT_RR_SYSINFO_1,
+	[SI_2] = GSM48_MT_RR_SYSINFO_2,
+	[SI_2bis] = GSM48_MT_RR_SYSINFO_2bis,
+	[SI_2ter] = GSM48_MT_RR_SYSINFO_2ter,
+	[SI_3] = GSM48_MT_RR_SYSINFO_3,
+	[SI_4] = GSM48_MT_RR_SYSINFO_4,
+	[SI_5] = GSM48_MT_RR_SYSINFO_5,
+	[SI_5bis] = GSM48_MT_RR_SYSINFO_5bis,
+	[SI_5ter] = GSM48_MT_RR_SYSINFO_5ter,
+	[SI_6] = GSM48_MT_RR_SYSINFO_6,
+	[SI_13] = GSM48_MT_RR_SYSINFO_13,
+};
+
+/* tags of the messages in a corpus, those of SI 1..4 are the ones of the
+ * cell_log text format */
+static const char *si_tag[SI_NUM] = {
+	[SI_1] = "si1",
+	[SI_2] = "si2",
+	[SI_2bis] = "si2bis",
+	[SI_2ter] = "si2ter",
+	[SI_3] = "si3",
+	[SI_4] = "si4",
+	[SI_5] = "si5",
+	[SI_5bis] = "si5bis",
+	[SI_5ter] = "si5ter",
+	[SI_6] = "si6",
+	[SI_10] = "si10",
+	[SI_13] = "si13",
+};
+
+struct si_msg {
+	enum si_type type;
+	uint8_t len;
+	uint8_t max_len; /* length before fuzzing */
+	uint8_t data[23];
+};
+
+static const char *corpus; /* directory of SI messages to decode */
+
+/* random content with a valid header. SI 5* and 6 are SACCH messages
+ * without L2 pseudo length, SI 10 has a short L2 header only. The format
+ * of the frequency lists is chosen from all formats, so every decoder
+ * gets its share. */
+static void si_generate(struct si_msg *m, bool fuzz)
+{
+	static const uint8_t formats[] = {
+		0x00, 0x80, 0x88, 0x8a, 0x8c, 0x8e,
+	};
+	uint8_t *hdr = m->data;
+
+	m->type = random() % SI_NUM;
+	random_fill(m->data, sizeof(m->data));
+
+	switch (m->type) {
+	case SI_10:
+		m->len = 21;
+		goto out;
+	case SI_5:
+	case SI_5bis:
+	case SI_5ter:
+	case SI_6:
+		m->len = 18;
+		break;
+	default:
+		m->len = 23;
+		*hdr++ = (m->len - 2) << 2 | 1;
+		break;
+	}
+	hdr[0] = GSM48_PDISC_RR;
+	hdr[1] = si_mt[m->type];
+	/* format ID of the first list, it follows the message type */
+	hdr[2] = (hdr[2] & 0x31) | formats[random() % ARRAY_SIZE(formats)];
+
+out:
+	m->max_len = m->len;
+	if (fuzz)
+		m->len = random() % (m->len + 1);
+}
+
+/* read one corpus file, a message per line: the tag and the octets in hex,
+ * as cell_log writes them. Other lines are skipped, so a text cell log can
+ * be used as it is. */
+static int si_read_file(const char *filename, struct si_msg **set,
+	unsigned int *num, unsigned int *size)
+{
+	char line[256], *p, *end;
+	struct si_msg *m;
+	unsigned long v;
+	size_t n;
+	FILE *fp;
+	int t;
+
+	fp = fopen(filename, "r");
+	if (!fp)
+		return -errno;
+
+	while (fgets(line, sizeof(line), fp)) {
+		n = strcspn(line, " \t\n");
+		for (t = 0; t < SI_NUM; t++) {
+			if (strlen(si_tag[t]) == n && !strncmp(line, si_tag[t], n))
+				break;
+		}
+		if (t == SI_NUM)
+			continue;
+
+		if (*num == *size) {
+			m = realloc(*set, (*size + SI_SET) * sizeof(*m));
+			if (!m) {
+				fclose(fp);
+				return -ENOMEM;
+			}
+			*set = m;
+			*size += SI_SET;
+		}
+		m = &(*set)[*num];
+		memset(m, 0, sizeof(*m));
+		m->type = t;
+		for (p = line + n; m->len < sizeof(m->data); p = end) {
+			v = strtoul(p, &end, 16);
+			if (end == p || v > 0xff)
+				break;
+			m->data[m->len++] = v;
+		}
+		m->max_len = m->len;
+		if (m->len)
+			(*num)++;
+	}
+
+	fclose(fp);
+
+	return 0;
+}
+
+/* read all regular files of the corpus directory */
+static int si_read_corpus(struct si_msg **set, unsigned int *num)
+{
+	char filename[PATH_MAX];
+	unsigned int size = 0;
+	struct dirent *ent;
+	struct stat st;
+	DIR *dir;
+	int rc = 0;
+
+	*set = NULL;
+	*num = 0;
+
+	dir = opendir(corpus);
+	if (!dir)
+		return -errno;
+	while ((ent = readdir(dir))) {
+		snprintf(filename, sizeof(filename), "%s/%s", corpus,
+			ent->d_name);
+		if (stat(filename, &st) || !S_ISREG(st.st_mode))
+			continue;
+		rc = si_read_file(filename, set, num, &size);
+		if (rc < 0) {
+			fprintf(stderr, "Failed to read '%s'\n", filename);
+			break;
+		}
+	}
+	closedir(dir);
+
+	if (rc == 0 && *num == 0) {
+		fprintf(stderr, "No messages in '%s'\n", corpus);
+		rc = -ENOENT;
+	}
+	if (rc < 0) {
+		free(*set);
+		*set = NULL;
+	}
+
+	return rc;
+}
+
+/* corpus messages keep their octets, fuzzing only cuts them */
+static void si_fuzz(struct si_msg *m)
+{
+	if (corpus)
+		m->len = random() % (m->max_len + 1);
+	else
+		si_generate(m, true);
+}
+
+static int si_decode(struct gsm48_sysinfo *s, const struct si_msg *m,
+	bool ref)
+{
+	const void *data = m->data;
+
+	switch (m->type) {
+	case SI_1:
+		return ref ? ref_decode_sysinfo1(s, data, m->len)
+			: gsm48_decode_sysinfo1(s, data, m->len);
+	case SI_2:
+		return ref ? ref_decode_sysinfo2(s, data, m->len)
+			: gsm48_decode_sysinfo2(s, data, m->len);
+	case SI_2bis:
+		return ref ? ref_decode_sysinfo2bis(s, data, m->len)
+			: gsm48_decode_sysinfo2bis(s, data, m->len);
+	case SI_2ter:
+		return ref ? ref_decode_sysinfo2ter(s, data, m->len)
+			: gsm48_decode_sysinfo2ter(s, data, m->len);
+	case SI_3:
+		return ref ? ref_decode_sysinfo3(s, data, m->len)
+			: gsm48_decode_sysinfo3(s, data, m->len);
+	case SI_4:
+		return ref ? ref_decode_sysinfo4(s, data, m->len)
+			: gsm48_decode_sysinfo4(s, data, m->len);
+	case SI_5:
+		return ref ? ref_decode_sysinfo5(s, data, m->len)
+			: gsm48_decode_sysinfo5(s, data, m->len);
+	case SI_5bis:
+		return ref ? ref_decode_sysinfo5bis(s, data, m->len)
+			: gsm48_decode_sysinfo5bis(s, data, m->len);
+	case SI_5ter:
+		return ref ? ref_decode_sysinfo5ter(s, data, m->len)
+			: gsm48_decode_sysinfo5ter(s, data, m->len);
+	case SI_6:
+		return ref ? ref_decode_sysinfo6(s, data, m->len)
+			: gsm48_decode_sysinfo6(s, data, m->len);
+	case SI_10:
+		return ref ? ref_decode_sysinfo10(s, data, m->len)
+			: gsm48_decode_sysinfo10(s, data, m->len);
+	case SI_13:
+		return ref ? ref_decode_sysinfo13(s, data, m->len)
+			: gsm48_decode_sysinfo13(s, data, m->len);
+	default:
+		return -EINVAL;
+	}
+}
+
+/* Decode the set with sysinfo.c and with the decoder from before the rest
+ * octets were table driven, and compare the structures after each message.
+ * The fields only sysinfo.c has are cleared in the copy that is compared.
+ * The old decoder decoded SI 4 again on each SI 1, so the messages are
+ * taken in groups with one message of each type at most, and decoded in
+ * the order of the types. The SI 10 cell info is counted apart: the old
+ * decoder read the cell reselect hysteresis of differential cell info
+ * twice, and kept the BCC on a BCC update. */
+static int si_compare(const struct si_msg *set, unsigned int num)
+{
+	struct gsm48_sysinfo *s, *ref, *cmp;
+	const struct si_msg *group[SI_NUM];
+	unsigned int i, j, t, differ = 0, si10_differ = 0;
+	const uint8_t *a, *b;
+	uint16_t types;
+	size_t ofs;
+
+	s = calloc(1, sizeof(*s));
+	ref = calloc(1, sizeof(*ref));
+	cmp = calloc(1, sizeof(*cmp));
+	if (!s || !ref || !cmp) {
+		free(s);
+		free(ref);
+		free(cmp);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < num; ) {
+		memset(group, 0, sizeof(group));
+		for (types = 0; i < num; i++) {
+			if (types & (1 << set[i].type))
+				break;
+			types |= 1 << set[i].type;
+			group[set[i].type] = &set[i];
+		}
+
+		memset(s, 0, sizeof(*s));
+		memset(ref, 0, sizeof(*ref));
+		for (t = 0; t < SI_NUM; t++) {
+			if (!group[t])
+				continue;
+			si_decode(s, group[t], false);
+			si_decode(ref, group[t], true);
+
+			memcpy(cmp, s, sizeof(*cmp));
+			cmp->si4_ma_ofs = 0;
+			cmp->si10_len = 0;
+			cmp->lazy = false;
+			cmp->pending = 0;
+			memset(&cmp->ca, 0, sizeof(cmp->ca));
+			memset(cmp->ba_si5, 0, sizeof(cmp->ba_si5));
+			if (cmp->si10_cell_num != ref->si10_cell_num ||
+			    memcmp(cmp->si10_cell, ref->si10_cell,
+				   sizeof(cmp->si10_cell))) {
+				if (t == SI_10)
+					si10_differ++;
+				cmp->si10_cell_num = ref->si10_cell_num;
+				memcpy(cmp->si10_cell, ref->si10_cell,
+					sizeof(cmp->si10_cell));
+			}
+			if (!memcmp(cmp, ref, sizeof(*cmp)))
+				continue;
+
+			a = (const uint8_t *)cmp;
+			b = (const uint8_t *)ref;
+			for (ofs = 0; a[ofs] == b[ofs]; ofs++)
+				;
+			if (differ++ < 10) {
+				fprintf(stderr, "%s differs at offset %zu:",
+					si_tag[t], ofs);
+				for (j = 0; j < group[t]->len; j++)
+					fprintf(stderr, " %02x",
+						group[t]->data[j]);
+				fprintf(stderr, "\n");
+			}
+		}
+	}
+	printf("%-32s %10u messages, %u differ, %u in SI 10 cells\n",
+		"sysinfo against old decoder", num, differ, si10_differ);
+
+	free(cmp);
+	free(ref);
+	free(s);
+
+	return differ ? -EFAULT : 0;
+}
+
+/* all messages of the set in their order, as a cell is read */
+static int bench_sysinfo_run(struct si_msg *set, unsigned int num,
+	unsigned long iterations, bool fuzz, bool lazy)
+{
+	struct gsm48_sysinfo *s;
+	unsigned long i, count = 0;
+	unsigned int j;
+	uint8_t n;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < num; j++) {
+			if (j % SI_CELL == 0) {
+				memset(s, 0, sizeof(*s));
+				s->lazy = lazy;
+			}
+			if (fuzz)
+				si_fuzz(&set[j]);
+			si_decode(s, &set[j], false);
+			/* the SI 10 cell info needs the SI 5 lists */
+			if (set[j].type == SI_10)
+				gsm48_sysinfo_si10_cells(s, &n);
+			count++;
+		}
+	}
+	bench_stop(lazy ? "sysinfo (lazy)" : "sysinfo", count);
+
+	free(s);
+
+	return 0;
+}
+
+/* the messages of one type, each of the gsm48_decode_sysinfo*() entry
+ * points on its own. The structure holds the first message of each type, so
+ * the lists that SI 4 and SI 10 depend on are there. */
+static int bench_sysinfo_type(struct si_msg *set, unsigned int num,
+	unsigned long iterations, bool lazy)
+{
+	struct gsm48_sysinfo *s;
+	unsigned long i, count;
+	unsigned int j, t;
+	uint16_t types;
+	char what[40];
+	uint8_t n;
+
+	s = calloc(1, sizeof(*s));
+	if (!s)
+		return -ENOMEM;
+
+	for (t = 0; t < SI_NUM; t++) {
+		memset(s, 0, sizeof(*s));
+		s->lazy = lazy;
+		types = 0;
+		for (j = 0; j < num; j++) {
+			if (types & (1 << set[j].type))
+				continue;
+			types |= 1 << set[j].type;
+			si_decode(s, &set[j], false);
+		}
+
+		count = 0;
+		bench_start();
+		for (i = 0; i < iterations; i++) {
+			for (j = 0; j < num; j++) {
+				if (set[j].type != t)
+					continue;
+				si_decode(s, &set[j], false);
+				if (t == SI_10)
+					gsm48_sysinfo_si10_cells(s, &n);
+				count++;
+			}
+		}
+		if (!count)
+			continue;
+		snprintf(what, sizeof(what), "%s%s", si_tag[t],
+			lazy ? " (lazy)" : "");
+		bench_stop(what, count);
+	}
+
+	free(s);
+
+	return 0;
+}
+
+static int bench_sysinfo(unsigned long iterations, bool fuzz)
+{
+	struct si_msg *set;
+	unsigned int num, j;
+	int rc;
+
+	if (corpus) {
+		rc = si_read_corpus(&set, &num);
+		if (rc < 0)
+			return rc;
+	} else {
+		num = SI_SET;
+		set = calloc(num, sizeof(*set));
+		if (!set)
+			return -ENOMEM;
+		for (j = 0; j < num; j++)
+			si_generate(&set[j], false);
+	}
+
+	/* fuzzed messages are cut, the old decoder reads bits beyond the end
+	 * as errors */
+	if (!fuzz) {
+		rc = si_compare(set, num);
+		if (rc < 0)
+			goto out;
+	}
+
+	rc = bench_sysinfo_run(set, num, iterations, fuzz, false);
+	if (rc < 0)
+		goto out;
+	rc = bench_sysinfo_run(set, num, iterations, fuzz, true);
+	if (rc < 0 || fuzz)
+		goto out;
+	rc = bench_sysinfo_type(set, num, iterations, false);
+	if (rc < 0)
+		goto out;
+	rc = bench_sysinfo_type(set, num, iterations, true);
+
+out:
+	free(set);
+
+	return rc;
+}
+
+/*
+ * frequency lists and mobile allocation
+ */
+
+#define FREQ_SET	1024 /* lists of the set */
+
+static const struct {
+	const char *name;
+	uint8_t format; /* format ID in the first octet */
+} freq_formats[] = {
+	{ "bit map 0", 0x00 },
+	{ "range 1024", 0x80 },
+	{ "range 512", 0x88 },
+	{ "range 256", 0x8a },
+	{ "range 128", 0x8c },
+	{ "variable bit map", 0x8e },
+};
+
+/* select by walking all ARFCNs in list order, this is what the decoder of
+ * the mobile allocation did before the sets were used */
+static int select_scan(const struct gsm_freq_set *set, const uint8_t *ma,
+	uint8_t len, uint16_t *arfcn)
+{
+	unsigned int idx = 0;
+	int i, num = 0;
+
+	for (i = 1; i <= 1024; i++) {
+		if (!gsm_freq_set_has(set, i & 1023))
+			continue;
+		if (idx < len * 8 && ((ma[len - 1 - (idx >> 3)] >> (idx & 7)) & 1))
+			arfcn[num++] = i & 1023;
+		idx++;
+	}
+
+	return num;
+}
+
+static int bench_freqset(unsigned long iterations, bool fuzz)
+{
+	struct gsm_freq_set set, *sets;
+	uint8_t (*lists)[16], (*ma)[8], *len;
+	uint16_t arfcn[64], ref[64];
+	unsigned long i, count;
+	char what[64];
+	int f, j, k, num, rc = 0;
+
+	sets = calloc(FREQ_SET, sizeof(*sets));
+	lists = calloc(FREQ_SET, sizeof(*lists));
+	ma = calloc(FREQ_SET, sizeof(*ma));
+	len = calloc(FREQ_SET, sizeof(*len));
+	if (!sets || !lists || !ma || !len) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	/* decode lists of each format */
+	for (f = 0; f < ARRAY_SIZE(freq_formats); f++) {
+		for (j = 0; j < FREQ_SET; j++) {
+			random_fill(lists[j], sizeof(lists[j]));
+			lists[j][0] = (lists[j][0] & 0x31)
+				| freq_formats[f].format;
+			len[j] = fuzz ? random() % 17 : 16;
+		}
+		count = 0;
+		bench_start();
+		for (i = 0; i < iterations; i++) {
+			for (j = 0; j < FREQ_SET; j++) {
+				gsm_freq_set_decode(&set, lists[j], len[j],
+					0xce);
+				count++;
+			}
+		}
+		snprintf(what, sizeof(what), "decode %s",
+			freq_formats[f].name);
+		bench_stop(what, count);
+	}
+
+	/* sets of up to 64 ARFCNs, mobile allocations over them */
+	for (j = 0; j < FREQ_SET; j++) {
+		gsm_freq_set_clear(&sets[j]);
+		num = 1 + random() % 64;
+		for (k = 0; k < num; k++)
+			gsm_freq_set_add(&sets[j], random() % 1024);
+		num = gsm_freq_set_count(&sets[j]);
+		len[j] = fuzz ? random() % 9 : (num + 7) / 8;
+		random_fill(ma[j], sizeof(ma[j]));
+	}
+
+	/* both ways must select the same ARFCNs */
+	for (j = 0; j < FREQ_SET; j++) {
+		num = gsm_freq_set_select(&sets[j], ma[j], len[j], arfcn);
+		if (num != select_scan(&sets[j], ma[j], len[j], ref)
+		 || memcmp(arfcn, ref, num * sizeof(*arfcn))) {
+			fprintf(stderr, "Mobile allocation %s of set %d "
+				"differs\n", osmo_hexdump(ma[j], len[j]), j);
+			rc = -EFAULT;
+			goto out;
+		}
+	}
+
+	count = 0;
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < FREQ_SET; j++) {
+			gsm_freq_set_select(&sets[j], ma[j], len[j], arfcn);
+			count++;
+		}
+	}
+	bench_stop("mobile allocation", count);
+
+	count = 0;
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < FREQ_SET; j++) {
+			select_scan(&sets[j], ma[j], len[j], arfcn);
+			count++;
+		}
+	}
+	bench_stop("mobile allocation (scan)", count);
+
+out:
+	free(len);
+	free(ma);
+	free(lists);
+	free(sets);
+
+	return rc;
+}
+
+/*
+ * paging identities
+ */
+
+#define PAG_SET		4096 /* identities of the set */
+
+/* our identities, as the mobile kept them before */
+struct pag_ref {
+	struct osmo_location_area_id lai, sel_lai;
+	char imsi[OSMO_IMSI_BUF_SIZE];
+	uint32_t tmsi;
+};
+
+/* the way the mobile matched before: decode, format, compare */
+static uint8_t pag_match_decode(const struct pag_ref *ref,
+	const uint8_t *mi_lv)
+{
+	struct osmo_mobile_identity mi;
+	char buf[32];
+
+	if (osmo_mobile_identity_decode(&mi, mi_lv + 1, mi_lv[0], false) < 0)
+		return 0;
+	osmo_mobile_identity_to_str_buf(buf, sizeof(buf), &mi);
+
+	switch (mi.type) {
+	case GSM_MI_TYPE_TMSI:
+		if (ref->tmsi == mi.tmsi
+		 && osmo_lai_cmp(&ref->lai, &ref->sel_lai) == 0)
+			return mi.type;
+		break;
+	case GSM_MI_TYPE_IMSI:
+		if (!strcmp(mi.imsi, ref->imsi))
+			return mi.type;
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static void pag_random_imsi(char *imsi)
+{
+	int i;
+
+	for (i = 0; i < 15; i++)
+		imsi[i] = '0' + random() % 10;
+	imsi[i] = '\0';
+}
+
+/* 3 of 4 identities are TMSIs, 1 of 64 is ours */
+static void pag_generate(const struct pag_ref *ref, uint8_t *mi_lv, bool fuzz)
+{
+	struct osmo_mobile_identity mi;
+	bool ours = random() % 64 == 0;
+	int rc;
+
+	if (fuzz) {
+		random_fill(mi_lv, 10);
+		mi_lv[0] %= 10;
+		return;
+	}
+
+	if (random() % 4) {
+		mi.type = GSM_MI_TYPE_TMSI;
+		mi.tmsi = ours ? ref->tmsi : (uint32_t)random();
+	} else {
+		mi.type = GSM_MI_TYPE_IMSI;
+		if (ours)
+			OSMO_STRLCPY_ARRAY(mi.imsi, ref->imsi);
+		else
+			pag_random_imsi(mi.imsi);
+	}
+	rc = osmo_mobile_identity_encode_buf(mi_lv + 1, 9, &mi, false);
+	mi_lv[0] = (rc > 0) ? rc : 0;
+}
+
+static int bench_paging(unsigned long iterations, bool fuzz)
+{
+	struct pag_ref ref = {
+		.lai = {
+			.plmn = { .mcc = 262, .mnc = 1, },
+			.lac = 1000,
+		},
+	};
+	struct paging_ids ids = {};
+	static uint8_t set[PAG_SET][10];
+	uint8_t expect[PAG_SET];
+	unsigned long i, j, count;
+
+	ref.sel_lai = ref.lai;
+	pag_random_imsi(ref.imsi);
+	ref.tmsi = random();
+	/* as gsm48_rr.c does for each paging request */
+	paging_ids_update(&ids, ref.tmsi, true, ref.imsi);
+	if (!ids.imsi_mi_len)
+		return -EINVAL;
+
+	for (j = 0; j < PAG_SET; j++)
+		pag_generate(&ref, set[j], fuzz);
+
+	/* both must find the same identities, fuzzed ones need not be
+	 * coded the canonical way */
+	count = 0;
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < PAG_SET; j++) {
+			expect[j] = pag_match_decode(&ref, set[j]);
+			count++;
+		}
+	}
+	bench_stop("paging decode and compare", count);
+
+	count = 0;
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < PAG_SET; j++) {
+			if (paging_match_mi(&ids, set[j]) != expect[j]
+			 && !fuzz) {
+				fprintf(stderr, "Paging identity %lu matches "
+					"differently\n", j);
+				return -EFAULT;
+			}
+			count++;
+		}
+	}
+	bench_stop("paging compare coded", count);
+
+	return 0;
+}
+
+/*
+ * cell log
+ */
+
+#define LOG_CELLS	5000 /* different cells in the log */
+#define LOG_POWER	100 /* sysinfo records per power record */
+
+static size_t log_size = 32 << 20; /* octets of the generated log */
+
+/* a drive test of a cell_log, as text, of about log_size octets. Each
+ * record is one of LOG_CELLS cells of three networks, with SI 1, 3 and 4. */
+static char *log_generate(size_t *len)
+{
+	struct osmo_location_area_id lai;
+	struct gsm48_loc_area_id *lai48;
+	struct sysinfo si;
+	struct power power;
+	char *data = NULL;
+	FILE *fp;
+	int i, cell;
+
+	fp = open_memstream(&data, len);
+	if (!fp)
+		return NULL;
+
+	memset(&si, 0, sizeof(si));
+	si.gps_valid = 1;
+	si.ta_valid = 1;
+	random_fill(si.si1, sizeof(si.si1));
+	si.si1[0] = 0x55;
+	si.si1[1] = GSM48_PDISC_RR;
+	si.si1[2] = GSM48_MT_RR_SYSINFO_1;
+	memset(&power, 0, sizeof(power));
+	power.gps_valid = 1;
+	memset(power.rxlev, -128, sizeof(power.rxlev));
+	for (i = 1; i <= 124; i++)
+		power.rxlev[i] = -110 + random() % 64;
+
+	for (i = 0; (size_t)ftell(fp) < log_size; i++) {
+		cell = random() % LOG_CELLS;
+		lai = (struct osmo_location_area_id) {
+			.plmn = {
+				.mcc = 262,
+				.mnc = 1 + cell % 3,
+			},
+			.lac = 1000 + cell / 100,
+		};
+		si.arfcn = 1 + cell % 124;
+		si.bsic = cell & 0x3f;
+		si.rxlev = -110 + random() % 64;
+		si.ta = random() % 64;
+		si.gmt = 1700000000 + i;
+		si.longitude = 13.0 + (random() % 100000) / 1e5;
+		si.latitude = 52.0 + (random() % 100000) / 1e5;
+
+		memset(si.si3, 0x2b, sizeof(si.si3));
+		si.si3[0] = 0x49;
+		si.si3[1] = GSM48_PDISC_RR;
+		si.si3[2] = GSM48_MT_RR_SYSINFO_3;
+		si.si3[3] = cell >> 8;
+		si.si3[4] = cell;
+		lai48 = (struct gsm48_loc_area_id *)(si.si3 + 5);
+		gsm48_generate_lai2(lai48, &lai);
+		memset(si.si4, 0x2b, sizeof(si.si4));
+		si.si4[0] = 0x31;
+		si.si4[1] = GSM48_PDISC_RR;
+		si.si4[2] = GSM48_MT_RR_SYSINFO_4;
+		memcpy(si.si4 + 3, lai48, sizeof(*lai48));
+		log_write_sysinfo(fp, &si);
+
+		if (i % LOG_POWER == 0) {
+			power.gmt = si.gmt;
+			power.longitude = si.longitude;
+			power.latitude = si.latitude;
+			log_write_power(fp, &power);
+		}
+	}
+
+	if (fclose(fp)) {
+		free(data);
+		return NULL;
+	}
+
+	return data;
+}
+
+static int bench_logdb(unsigned long iterations, bool fuzz)
+{
+	struct log_db db;
+	unsigned long i, j, count = 0;
+	double secs;
+	size_t len;
+	char *data, *input = NULL;
+	FILE *fp;
+	int rc = 0;
+
+	data = log_generate(&len);
+	if (!data)
+		return -ENOMEM;
+	if (output) {
+		fp = fopen(output, "w");
+		if (!fp || fwrite(data, len, 1, fp) != 1) {
+			fprintf(stderr, "Failed to write '%s'\n", output);
+			rc = -EIO;
+		}
+		if (fp)
+			fclose(fp);
+		if (rc < 0)
+			goto out;
+	}
+
+	/* the fuzzer damages a copy of the log in each round */
+	input = fuzz ? malloc(len) : data;
+	if (!input) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		if (fuzz) {
+			memcpy(input, data, len);
+			for (j = 0; j < len / 64; j++)
+				input[random() % len] = random();
+		}
+		rc = log_db_init(&db);
+		if (rc < 0)
+			goto out;
+		rc = log_read_buffer(&db, input, len);
+		if (rc == 0)
+			log_db_sort(&db);
+		count += db.num_records;
+		log_db_free(&db);
+		if (rc < 0)
+			goto out;
+	}
+	secs = bench_stop("log records", count);
+	printf("%-32s %10zu octets, %8.1f MB/s\n", "log", len,
+		secs > 0 ? len * iterations / secs / 1e6 : 0.0);
+
+out:
+	if (fuzz)
+		free(input);
+	free(data);
+
+	return rc;
+}
+
+/* a part of the log, parsed by a thread of its own, as gsmmap does with
+ * the log files */
+struct log_part {
+	pthread_t thread;
+	const char *data;
+	size_t len;
+	struct log_db db;
+	int rc;
+};
+
+static void *log_part_read(void *arg)
+{
+	struct log_part *part = arg;
+
+	part->rc = log_db_init(&part->db);
+	if (part->rc == 0)
+		part->rc = log_read_buffer(&part->db, part->data, part->len);
+
+	return NULL;
+}
+
+/* parse the log in 'num' parts, split at records, and merge them in order */
+static int log_read_parts(struct log_db *db, const char *data, size_t len,
+	struct log_part *parts, unsigned int num)
+{
+	const char *p = data, *end = data + len, *next;
+	unsigned int i;
+	int rc = 0;
+
+	for (i = 0; i < num; i++) {
+		next = data + len * (i + 1) / num;
+		while (next < end && !(next[0] == '[' && next[-1] == '\n'))
+			next++;
+		if (next < p)
+			next = p;
+		parts[i].data = p;
+		parts[i].len = next - p;
+		p = next;
+		if (pthread_create(&parts[i].thread, NULL, log_part_read,
+				&parts[i])) {
+			num = i;
+			rc = -EAGAIN;
+			break;
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		pthread_join(parts[i].thread, NULL);
+		if (rc == 0 && parts[i].rc < 0)
+			rc = parts[i].rc;
+		if (rc == 0)
+			rc = log_db_merge(db, &parts[i].db);
+		log_db_free(&parts[i].db);
+	}
+
+	return rc;
+}
+
+static unsigned long log_power_count(const struct log_db *db)
+{
+	const struct node_power *power;
+	unsigned long count = 0;
+
+	for (power = db->power_first; power; power = power->next)
+		count++;
+
+	return count;
+}
+
+/* the merged database must be the one of a single parse */
+static int log_db_compare(const struct log_db *a, const struct log_db *b)
+{
+	const struct node_cell *x, *y;
+	unsigned int i, n;
+
+	if (a->num_cells != b->num_cells || a->num_records != b->num_records
+	 || log_power_count(a) != log_power_count(b))
+		return -1;
+	for (i = 0; i < a->num_cells; i++) {
+		x = a->cells[i];
+		y = b->cells[i];
+		n = x->meas_num;
+		if (x->cgi.lai.plmn.mcc != y->cgi.lai.plmn.mcc
+		 || x->cgi.lai.plmn.mnc != y->cgi.lai.plmn.mnc
+		 || x->cgi.lai.lac != y->cgi.lai.lac
+		 || x->cgi.cell_identity != y->cgi.cell_identity
+		 || n != y->meas_num
+		 || memcmp(x->gmt, y->gmt, n * sizeof(*x->gmt))
+		 || memcmp(x->longitude, y->longitude, n * sizeof(*x->longitude))
+		 || memcmp(x->latitude, y->latitude, n * sizeof(*x->latitude))
+		 || memcmp(x->rxlev, y->rxlev, n * sizeof(*x->rxlev))
+		 || memcmp(x->ta, y->ta, n * sizeof(*x->ta))
+		 || memcmp(x->flags, y->flags, n * sizeof(*x->flags)))
+			return -1;
+	}
+
+	return 0;
+}
+
+static int bench_logmerge(unsigned long iterations, bool fuzz)
+{
+	struct log_db single, db;
+	struct log_part *parts = NULL;
+	unsigned long i, j, count;
+	unsigned int num, max;
+	char what[32];
+	size_t len;
+	char *data;
+	int rc;
+
+	data = log_generate(&len);
+	if (!data)
+		return -ENOMEM;
+	/* damaged once, the parts must still give the same database */
+	if (fuzz) {
+		for (j = 0; j < len / 64; j++)
+			data[random() % len] = random();
+	}
+
+	rc = log_db_init(&single);
+	if (rc < 0)
+		goto out_data;
+	rc = log_read_buffer(&single, data, len);
+	if (rc < 0)
+		goto out;
+
+	/* at least two parts, so the merge is checked on any host */
+	max = OSMO_MAX(sysconf(_SC_NPROCESSORS_ONLN), 2);
+	parts = calloc(max, sizeof(*parts));
+	if (!parts) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	num = 0;
+	do {
+		num = OSMO_MIN(num ? num * 2 : 1, max);
+		count = 0;
+		bench_start();
+		for (i = 0; i < iterations; i++) {
+			rc = log_db_init(&db);
+			if (rc < 0)
+				goto out;
+			rc = log_read_parts(&db, data, len, parts, num);
+			if (rc == 0 && i == 0 && log_db_compare(&db, &single)) {
+				fprintf(stderr, "%u parts differ from a single "
+					"parse\n", num);
+				rc = -EFAULT;
+			}
+			count += db.num_records;
+			log_db_free(&db);
+			if (rc < 0)
+				goto out;
+		}
+		snprintf(what, sizeof(what), "log records, %u threads", num);
+		bench_stop(what, count);
+	} while (num < max);
+
+out:
+	free(parts);
+	log_db_free(&single);
+out_data:
+	free(data);
+
+	return rc;
+}
+
+static const struct bench benches[] = {
+	{ "sysinfo", "decode SI 1..6, 10 and 13 messages, compare with the old "
+		"decoder", bench_sysinfo },
+	{ "freqset", "decode frequency lists, select mobile allocations",
+		bench_freqset },
+	{ "paging", "match paging identities, decoded and coded",
+		bench_paging },
+	{ "logdb", "parse a cell log into the database of gsmmap",
+		bench_logdb },
+	{ "logmerge", "parse a cell log in threads and merge the parts",
+		bench_logmerge },
+	{ NULL, NULL, NULL }
+};
+
+static void usage(const char *name)
+{
+	const struct bench *b;
+
+	fprintf(stderr, "Usage: %s [-n <iterations>] [-s <seed>] [-f] "
+		"[-o <file>] [-c <dir>] [-l <size>] <bench> [<bench> ...]\n",
+		name);
+	fprintf(stderr, "-n: Rounds over the message set (default: 100)\n");
+	fprintf(stderr, "-s: Seed for the random messages (default: 1)\n");
+	fprintf(stderr, "-f: Fuzz, use new messages of random length in each "
+		"round\n");
+	fprintf(stderr, "-o: Write the generated cell log to a file, to run "
+		"gsmmap on it\n");
+	fprintf(stderr, "-l: Size of the generated cell log in MiB "
+		"(default: %zu)\n", log_size >> 20);
+	fprintf(stderr, "-c: Decode the SI messages of the files in <dir>, "
+		"lines as 'si3 49 06 1b ...'\n");
+	fprintf(stderr, "Benchmarks ('all' runs all of them):\n");
+	for (b = benches; b->name; b++)
+		fprintf(stderr, "  %-12s %s\n", b->name, b->help);
+}
+
+int main(int argc, char *argv[])
+{
+	const struct bench *b;
+	unsigned long iterations = 100;
+	bool fuzz = false, found;
+	int i, rc;
+
+	/* no log target, the decoders complain about most of the random
+	 * input */
+	log_init(&log_info, NULL);
+
+	srandom(1);
+	while ((i = getopt(argc, argv, "n:s:fo:c:l:h")) != -1) {
+		switch (i) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			srandom(strtoul(optarg, NULL, 0));
+			break;
+		case 'f':
+			fuzz = true;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'c':
+			corpus = optarg;
+			break;
+		case 'l':
+			log_size = (size_t)strtoul(optarg, NULL, 0) << 20;
+			break;
+		default:
+			usage(argv[0]);
+			return 0;
+		}
+	}
+	if (optind == argc) {
+		usage(argv[0]);
+		return 0;
+	}
+
+	for (i = optind; i < argc; i++) {
+		found = false;
+		for (b = benches; b->name; b++) {
+			if (strcmp(argv[i], "all") && strcmp(argv[i], b->name))
+				continue;
+			found = true;
+			rc = b->run(iterations, fuzz);
+			if (rc < 0) {
+				fprintf(stderr, "Benchmark '%s' failed: %s\n",
+					b->name, strerror(-rc));
+				return rc;
+			}
+		}
+		if (!found) {
+			fprintf(stderr, "No benchmark '%s'\n", argv[i]);
+			usage(argv[0]);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
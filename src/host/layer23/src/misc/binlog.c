@@ -0,0 +1,510 @@
+/* Binary format of the cell log */
+
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bits.h>
+
+#include <osmocom/bb/misc/log.h>
+#include <osmocom/bb/misc/binlog.h>
+
+/* flags of sysinfo and power records */
+#define REC_F_GPS	0x01 /* longitude and latitude follow */
+#define REC_F_TA	0x02 /* ta follows */
+
+#define REC_HDR_LEN	3
+/* the largest record: a power record with every other ARFCN measured */
+#define REC_MAX_LEN	(REC_HDR_LEN + 8 + 1 + 16 + 512 * 5)
+
+#define WRITER_BUF_SIZE	65536
+
+struct binlog_writer {
+	int fd;
+	unsigned int flush_interval; /* seconds, 0 flushes every record */
+	time_t last_flush;
+	size_t since_sync;
+	size_t len;
+	uint8_t buf[WRITER_BUF_SIZE];
+};
+
+/* system information messages in the order of the record */
+static const size_t si_offset[] = {
+	offsetof(struct sysinfo, si1),
+	offsetof(struct sysinfo, si2),
+	offsetof(struct sysinfo, si2bis),
+	offsetof(struct sysinfo, si2ter),
+	offsetof(struct sysinfo, si3),
+	offsetof(struct sysinfo, si4),
+};
+
+static inline uint8_t *store_double(uint8_t *p, double v)
+{
+	uint64_t u;
+
+	memcpy(&u, &v, sizeof(u));
+	osmo_store64le(u, p);
+	return p + 8;
+}
+
+static inline double load_double(const uint8_t *p)
+{
+	uint64_t u = osmo_load64le(p);
+	double v;
+
+	memcpy(&v, &u, sizeof(v));
+	return v;
+}
+
+static inline int is_sync(const uint8_t *data, size_t len, size_t pos)
+{
+	return pos + REC_HDR_LEN + BINLOG_SYNC_LEN <= len
+	    && data[pos] == BINLOG_REC_SYNC
+	    && osmo_load16le(data + pos + 1) == BINLOG_SYNC_LEN
+	    && !memcmp(data + pos + REC_HDR_LEN, BINLOG_SYNC_PATTERN,
+		       BINLOG_SYNC_LEN);
+}
+
+/*
+ * writer
+ */
+
+static int write_all(int fd, const uint8_t *data, size_t len)
+{
+	ssize_t rc;
+
+	while (len) {
+		rc = write(fd, data, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		data += rc;
+		len -= rc;
+	}
+
+	return 0;
+}
+
+/* length of the complete records of an existing log, so a record that
+ * was cut off by a crash is not continued by the records appended now. The
+ * walk follows the writer: once BINLOG_SYNC_INTERVAL octets were written
+ * since the last sync record, the next record must be one. A crash tears at
+ * most the record that was written last, if more is left behind the walk,
+ * a record in between is damaged and the log is not cut. 0 is returned if
+ * the header itself was cut off. */
+static off_t valid_length(int fd, off_t size)
+{
+	const uint8_t *data;
+	off_t pos = BINLOG_HDR_LEN, rc;
+	size_t rlen, since_sync = 0;
+
+	data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+		return -errno;
+
+	if (size < BINLOG_HDR_LEN) {
+		rc = memcmp(data, BINLOG_MAGIC, OSMO_MIN(size, 8)) ? -EINVAL : 0;
+		goto out;
+	}
+	if (!binlog_detect(data, size)) {
+		rc = -EINVAL;
+		goto out;
+	}
+	if (osmo_load16le(data + 8) != BINLOG_VERSION
+	 || (osmo_load16le(data + 10) & ~BINLOG_F_KNOWN)) {
+		rc = -EPROTONOSUPPORT;
+		goto out;
+	}
+
+	while (pos + REC_HDR_LEN <= size) {
+		rlen = REC_HDR_LEN + osmo_load16le(data + pos + 1);
+		if (pos + rlen > size)
+			break;
+		if (data[pos] == BINLOG_REC_SYNC) {
+			if (!is_sync(data, size, pos))
+				break;
+			since_sync = 0;
+		} else {
+			if (since_sync >= BINLOG_SYNC_INTERVAL)
+				break;
+			since_sync += rlen;
+		}
+		pos += rlen;
+	}
+
+	rc = size - pos > REC_MAX_LEN ? -EBADMSG : pos;
+out:
+	munmap((void *)data, size);
+
+	return rc;
+}
+
+static void write_hdr(struct binlog_writer *w)
+{
+	memcpy(w->buf, BINLOG_MAGIC, 8);
+	osmo_store16le(BINLOG_VERSION, w->buf + 8);
+	osmo_store16le(BINLOG_F_KNOWN, w->buf + 10);
+	osmo_store32le(0, w->buf + 12);
+	w->len = BINLOG_HDR_LEN;
+}
+
+/* open a binary log for appending, "-" writes to stdout */
+struct binlog_writer *binlog_open(const char *filename,
+	unsigned int flush_interval)
+{
+	struct binlog_writer *w;
+	struct stat st;
+	off_t len;
+	int rc;
+
+	w = calloc(1, sizeof(*w));
+	if (!w)
+		return NULL;
+	w->flush_interval = flush_interval;
+	time(&w->last_flush);
+
+	if (!strcmp(filename, "-")) {
+		w->fd = STDOUT_FILENO;
+		st.st_size = 0;
+	} else {
+		w->fd = open(filename, O_RDWR | O_CREAT, 0644);
+		if (w->fd < 0)
+			goto error;
+		if (fstat(w->fd, &st) < 0)
+			goto error;
+	}
+
+	if (st.st_size == 0) {
+		write_hdr(w);
+		return w;
+	}
+
+	len = valid_length(w->fd, st.st_size);
+	if (len < 0) {
+		errno = -len;
+		goto error;
+	}
+	if (len < st.st_size && ftruncate(w->fd, len) < 0)
+		goto error;
+	if (lseek(w->fd, len, SEEK_SET) < 0)
+		goto error;
+	/* the header was cut off, it is written again */
+	if (len == 0) {
+		write_hdr(w);
+		return w;
+	}
+	/* start with a sync record */
+	w->since_sync = BINLOG_SYNC_INTERVAL;
+
+	return w;
+
+error:
+	rc = errno;
+	if (w->fd > STDOUT_FILENO)
+		close(w->fd);
+	free(w);
+	errno = rc;
+	return NULL;
+}
+
+int binlog_flush(struct binlog_writer *w)
+{
+	int rc;
+
+	time(&w->last_flush);
+	rc = write_all(w->fd, w->buf, w->len);
+	w->len = 0;
+
+	return rc;
+}
+
+int binlog_close(struct binlog_writer *w)
+{
+	int rc;
+
+	rc = binlog_flush(w);
+	if (w->fd > STDOUT_FILENO)
+		close(w->fd);
+	free(w);
+
+	return rc;
+}
+
+/* get room for a record, the payload is written behind the header */
+static uint8_t *rec_start(struct binlog_writer *w, uint8_t type)
+{
+	uint8_t *p;
+
+	if (w->len + REC_HDR_LEN + BINLOG_SYNC_LEN + REC_MAX_LEN > sizeof(w->buf)
+	 && binlog_flush(w) < 0)
+		return NULL;
+
+	if (w->since_sync >= BINLOG_SYNC_INTERVAL) {
+		p = w->buf + w->len;
+		p[0] = BINLOG_REC_SYNC;
+		osmo_store16le(BINLOG_SYNC_LEN, p + 1);
+		memcpy(p + REC_HDR_LEN, BINLOG_SYNC_PATTERN, BINLOG_SYNC_LEN);
+		w->len += REC_HDR_LEN + BINLOG_SYNC_LEN;
+		w->since_sync = 0;
+	}
+
+	p = w->buf + w->len;
+	p[0] = type;
+
+	return p + REC_HDR_LEN;
+}
+
+/* complete the record that ends at 'end' */
+static int rec_end(struct binlog_writer *w, uint8_t *end)
+{
+	uint8_t *rec = w->buf + w->len;
+	size_t len = end - rec;
+
+	osmo_store16le(len - REC_HDR_LEN, rec + 1);
+	w->len += len;
+	w->since_sync += len;
+
+	if (time(NULL) - w->last_flush >= (time_t)w->flush_interval)
+		return binlog_flush(w);
+
+	return 0;
+}
+
+int binlog_write_sysinfo(struct binlog_writer *w, const struct sysinfo *si)
+{
+	uint8_t *p, *flags, *mask;
+	const uint8_t *data;
+	int i;
+
+	p = rec_start(w, BINLOG_REC_SYSINFO);
+	if (!p)
+		return -EIO;
+
+	osmo_store16le(si->arfcn, p);
+	osmo_store64le(si->gmt, p + 2);
+	p += 10;
+	flags = p++;
+	*flags = 0;
+	if (si->gps_valid) {
+		*flags |= REC_F_GPS;
+		p = store_double(p, si->longitude);
+		p = store_double(p, si->latitude);
+	}
+	*p++ = si->bsic;
+	*p++ = si->rxlev;
+	if (si->ta_valid) {
+		*flags |= REC_F_TA;
+		*p++ = si->ta;
+	}
+	mask = p++;
+	*mask = 0;
+	for (i = 0; i < ARRAY_SIZE(si_offset); i++) {
+		data = (const uint8_t *)si + si_offset[i];
+		/* the first octet is the L2 pseudo length, never 0 */
+		if (!data[0])
+			continue;
+		*mask |= 1 << i;
+		memcpy(p, data, 23);
+		p += 23;
+	}
+
+	return rec_end(w, p);
+}
+
+/* the levels are stored as runs of measured ARFCNs */
+int binlog_write_power(struct binlog_writer *w, const struct power *power)
+{
+	uint8_t *p;
+	int i, start;
+
+	p = rec_start(w, BINLOG_REC_POWER);
+	if (!p)
+		return -EIO;
+
+	osmo_store64le(power->gmt, p);
+	p += 8;
+	*p++ = power->gps_valid ? REC_F_GPS : 0;
+	if (power->gps_valid) {
+		p = store_double(p, power->longitude);
+		p = store_double(p, power->latitude);
+	}
+	for (i = 0; i < 1024; i++) {
+		if (power->rxlev[i] == -128)
+			continue;
+		for (start = i; i < 1024 && power->rxlev[i] != -128; i++)
+			;
+		osmo_store16le(start, p);
+		osmo_store16le(i - start, p + 2);
+		memcpy(p + 4, power->rxlev + start, i - start);
+		p += 4 + i - start;
+	}
+
+	return rec_end(w, p);
+}
+
+/*
+ * reader
+ */
+
+int binlog_detect(const void *data, size_t len)
+{
+	return len >= BINLOG_HDR_LEN && !memcmp(data, BINLOG_MAGIC, 8);
+}
+
+static int decode_sysinfo(const uint8_t *p, size_t len, struct sysinfo *si)
+{
+	const uint8_t *end = p + len;
+	uint8_t flags, mask;
+	int i;
+
+	memset(si, 0, sizeof(*si));
+	if (len < 11)
+		return -EBADMSG;
+	si->arfcn = osmo_load16le(p);
+	si->gmt = osmo_load64le(p + 2);
+	flags = p[10];
+	p += 11;
+	if ((flags & REC_F_GPS)) {
+		if (end - p < 16)
+			return -EBADMSG;
+		si->gps_valid = 1;
+		si->longitude = load_double(p);
+		si->latitude = load_double(p + 8);
+		p += 16;
+	}
+	if (end - p < 3 + !!(flags & REC_F_TA))
+		return -EBADMSG;
+	si->bsic = *p++;
+	si->rxlev = *p++;
+	if ((flags & REC_F_TA)) {
+		si->ta_valid = 1;
+		si->ta = *p++;
+	}
+	mask = *p++;
+	for (i = 0; i < ARRAY_SIZE(si_offset); i++) {
+		if (!(mask & (1 << i)))
+			continue;
+		if (end - p < 23)
+			return -EBADMSG;
+		memcpy((uint8_t *)si + si_offset[i], p, 23);
+		p += 23;
+	}
+
+	return (p == end) ? 0 : -EBADMSG;
+}
+
+static int decode_power(const uint8_t *p, size_t len, struct power *power)
+{
+	const uint8_t *end = p + len;
+	unsigned int start, count;
+
+	memset(power, 0, sizeof(*power));
+	memset(power->rxlev, -128, sizeof(power->rxlev));
+	if (len < 9)
+		return -EBADMSG;
+	power->gmt = osmo_load64le(p);
+	if ((p[8] & REC_F_GPS)) {
+		if (len < 25)
+			return -EBADMSG;
+		power->gps_valid = 1;
+		power->longitude = load_double(p + 9);
+		power->latitude = load_double(p + 17);
+		p += 16;
+	}
+	p += 9;
+	while (p < end) {
+		if (end - p < 4)
+			return -EBADMSG;
+		start = osmo_load16le(p);
+		count = osmo_load16le(p + 2);
+		p += 4;
+		if (start + count > 1024 || end - p < count)
+			return -EBADMSG;
+		memcpy(power->rxlev + start, p, count);
+		p += count;
+	}
+
+	return 0;
+}
+
+/* parse all records of a binary log in memory */
+int binlog_parse(const struct log_handler *h, void *priv, const uint8_t *data,
+	size_t len)
+{
+	struct sysinfo si;
+	struct power power;
+	size_t pos, rlen;
+	int rc;
+
+	if (!binlog_detect(data, len))
+		return -EINVAL;
+	if (osmo_load16le(data + 8) != BINLOG_VERSION
+	 || (osmo_load16le(data + 10) & ~BINLOG_F_KNOWN))
+		return -EPROTONOSUPPORT;
+
+	pos = BINLOG_HDR_LEN;
+	while (pos + REC_HDR_LEN <= len) {
+		rlen = osmo_load16le(data + pos + 1);
+		/* a record that was cut off */
+		if (pos + REC_HDR_LEN + rlen > len)
+			break;
+
+		switch (data[pos]) {
+		case BINLOG_REC_SYSINFO:
+			rc = decode_sysinfo(data + pos + REC_HDR_LEN, rlen, &si);
+			if (rc == 0)
+				rc = h->sysinfo(priv, &si);
+			break;
+		case BINLOG_REC_POWER:
+			rc = decode_power(data + pos + REC_HDR_LEN, rlen, &power);
+			if (rc == 0)
+				rc = h->power(priv, &power);
+			break;
+		case BINLOG_REC_SYNC:
+			rc = is_sync(data, len, pos) ? 0 : -EBADMSG;
+			break;
+		default:
+			/* record of a later version */
+			rc = 0;
+		}
+
+		if (rc == -EBADMSG) {
+			/* continue at the next sync record */
+			for (pos++; pos + REC_HDR_LEN <= len; pos++) {
+				if (is_sync(data, len, pos))
+					break;
+			}
+			continue;
+		}
+		if (rc < 0)
+			return rc;
+		pos += REC_HDR_LEN + rlen;
+	}
+
+	return 0;
+}
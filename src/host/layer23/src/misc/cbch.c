@@ -0,0 +1,352 @@
+/* Reassembly and deduplication of cell broadcast messages */
+
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm_utils.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/misc/cbch.h>
+
+/* block type octet, TS 44.012 section 3.3.1 */
+#define CBCH_LB			0x10 /* last block */
+#define CBCH_SEQ_MASK		0x0f
+#define CBCH_SEQ_NULL		0x0f /* null message */
+#define CBCH_SEQ_SCHEDULE	0x08 /* first block of a schedule message */
+
+#define PENDING_MAX		8 /* multipage messages being collected */
+#define SEEN_MIN		1024 /* initial size of the seen set */
+
+/* pages of one message, until all are received */
+struct cbch_pending {
+	int used;
+	unsigned long age;
+	uint16_t serial, msg_id;
+	uint8_t dcs, pages;
+	uint16_t got; /* bitmap of received pages */
+	uint8_t content[CBCH_PAGES_MAX][CBCH_CONTENT_LEN];
+};
+
+static struct {
+	FILE *outfp;
+
+	/* the page being reassembled */
+	uint8_t page[CBCH_PAGE_LEN];
+	int next_seq; /* -1: wait for the first block */
+
+	struct cbch_pending pending[PENDING_MAX];
+	unsigned long age;
+
+	/* pages of written messages, open addressing, 0 is empty */
+	uint64_t *seen;
+	unsigned int seen_size, seen_num;
+
+	struct cbch_stats stats;
+} cb = {
+	.next_seq = -1,
+};
+
+static uint64_t page_key(uint16_t serial, uint16_t msg_id, uint8_t page)
+{
+	return (((uint64_t)serial << 20) | ((uint64_t)msg_id << 4) | page) + 1;
+}
+
+static unsigned int seen_slot(uint64_t key)
+{
+	return (key * 0x9e3779b97f4a7c15ULL) >> 32 & (cb.seen_size - 1);
+}
+
+static int seen_find(uint64_t key)
+{
+	unsigned int i;
+
+	if (!cb.seen_size)
+		return 0;
+	for (i = seen_slot(key); cb.seen[i]; i = (i + 1) & (cb.seen_size - 1)) {
+		if (cb.seen[i] == key)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void seen_put(uint64_t *table, unsigned int size, uint64_t key)
+{
+	unsigned int i;
+
+	for (i = seen_slot(key); table[i]; i = (i + 1) & (size - 1))
+		;
+	table[i] = key;
+}
+
+static int seen_add(uint64_t key)
+{
+	uint64_t *table;
+	unsigned int i, size;
+
+	/* keep the load below one half */
+	if ((cb.seen_num + 1) * 2 > cb.seen_size) {
+		size = cb.seen_size ? cb.seen_size * 2 : SEEN_MIN;
+		table = calloc(size, sizeof(*table));
+		if (!table)
+			return -ENOMEM;
+		/* seen_slot() masks with the new size */
+		i = cb.seen_size;
+		cb.seen_size = size;
+		while (i--) {
+			if (cb.seen[i])
+				seen_put(table, size, cb.seen[i]);
+		}
+		free(cb.seen);
+		cb.seen = table;
+	}
+
+	seen_put(cb.seen, cb.seen_size, key);
+	cb.seen_num++;
+
+	return 0;
+}
+
+/* check if the data coding scheme uses the GSM 7 bit default alphabet,
+ * TS 23.038 section 5 */
+static int dcs_7bit(uint8_t dcs)
+{
+	switch (dcs >> 4) {
+	case 0x0:
+	case 0x2:
+	case 0x3:
+		return 1;
+	case 0x1:
+		/* 0x11 is UCS2 with language indication */
+		return dcs != 0x11;
+	case 0x4:
+	case 0x5:
+	case 0x6:
+	case 0x7:
+		return ((dcs >> 2) & 3) == 0;
+	case 0xf:
+		return !(dcs & 0x04);
+	default:
+		return 0;
+	}
+}
+
+static void json_string(FILE *fp, const char *s)
+{
+	fputc('"', fp);
+	for (; *s; s++) {
+		switch (*s) {
+		case '"':
+		case '\\':
+			fprintf(fp, "\\%c", *s);
+			break;
+		case '\n':
+			fputs("\\n", fp);
+			break;
+		case '\r':
+			fputs("\\r", fp);
+			break;
+		default:
+			if ((unsigned char)*s < 0x20)
+				fprintf(fp, "\\u%04x", (unsigned char)*s);
+			else
+				fputc(*s, fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+static void write_message(struct cbch_pending *p, uint16_t arfcn, uint32_t fn)
+{
+	/* 93 septets per page */
+	char text[CBCH_PAGES_MAX * 93 + 1], *t = text;
+	unsigned int i, j;
+	size_t len;
+
+	fprintf(cb.outfp, "{\"time\":%lu,\"arfcn\":%u,\"fn\":%u,"
+		"\"serial\":%u,\"gs\":%u,\"code\":%u,\"update\":%u,"
+		"\"msg_id\":%u,\"dcs\":%u,\"pages\":%u,",
+		(unsigned long)time(NULL), arfcn, fn, p->serial,
+		p->serial >> 14, (p->serial >> 4) & 0x3ff, p->serial & 0xf,
+		p->msg_id, p->dcs, p->pages);
+
+	if (dcs_7bit(p->dcs)) {
+		for (i = 0; i < p->pages; i++) {
+			gsm_7bit_decode_n(t, sizeof(text) - (t - text),
+					  p->content[i], 93);
+			/* each page is padded with CR */
+			len = strlen(t);
+			while (len && t[len - 1] == '\r')
+				len--;
+			t += len;
+			*t = '\0';
+		}
+		fputs("\"text\":", cb.outfp);
+		json_string(cb.outfp, text);
+	} else {
+		fputs("\"data\":\"", cb.outfp);
+		for (i = 0; i < p->pages; i++) {
+			for (j = 0; j < CBCH_CONTENT_LEN; j++)
+				fprintf(cb.outfp, "%02x", p->content[i][j]);
+		}
+		fputc('"', cb.outfp);
+	}
+	fputs("}\n", cb.outfp);
+	fflush(cb.outfp);
+}
+
+static struct cbch_pending *pending_get(uint16_t serial, uint16_t msg_id,
+	uint8_t dcs, uint8_t pages)
+{
+	struct cbch_pending *p, *oldest = NULL;
+	unsigned int i;
+
+	for (i = 0; i < PENDING_MAX; i++) {
+		p = &cb.pending[i];
+		if (p->used && p->serial == serial && p->msg_id == msg_id
+		 && p->pages == pages)
+			return p;
+		if (!oldest || !p->used
+		 || (oldest->used && p->age < oldest->age))
+			oldest = p;
+	}
+
+	/* replace a free or the oldest entry, its pages are lost */
+	p = oldest;
+	memset(p, 0, sizeof(*p));
+	p->used = 1;
+	p->age = cb.age++;
+	p->serial = serial;
+	p->msg_id = msg_id;
+	p->dcs = dcs;
+	p->pages = pages;
+
+	return p;
+}
+
+static void rx_page(uint16_t arfcn, uint32_t fn)
+{
+	struct cbch_pending *p;
+	uint16_t serial, msg_id;
+	uint8_t dcs, page, pages;
+	unsigned int i;
+
+	serial = (cb.page[0] << 8) | cb.page[1];
+	msg_id = (cb.page[2] << 8) | cb.page[3];
+	dcs = cb.page[4];
+	page = cb.page[5] >> 4;
+	pages = cb.page[5] & 0x0f;
+	/* 0000 is treated as page 1 of 1 */
+	if (!page || !pages) {
+		page = 1;
+		pages = 1;
+	}
+	if (page > pages)
+		return;
+
+	cb.stats.pages++;
+	if (seen_find(page_key(serial, msg_id, page))) {
+		cb.stats.dup_pages++;
+		return;
+	}
+
+	p = pending_get(serial, msg_id, dcs, pages);
+	if (p->got & (1 << page)) {
+		cb.stats.dup_pages++;
+		return;
+	}
+	p->got |= 1 << page;
+	memcpy(p->content[page - 1], cb.page + 6, CBCH_CONTENT_LEN);
+	if (p->got != ((1 << (pages + 1)) - 2))
+		return;
+
+	/* all pages are here */
+	write_message(p, arfcn, fn);
+	cb.stats.messages++;
+	for (i = 1; i <= pages; i++) {
+		if (seen_add(page_key(serial, msg_id, i)) < 0)
+			LOGP(DRR, LOGL_ERROR, "No memory for CBCH dedup\n");
+	}
+	p->used = 0;
+}
+
+void cbch_rx_block(uint16_t arfcn, uint32_t fn, const uint8_t *data)
+{
+	uint8_t seq = data[0] & CBCH_SEQ_MASK;
+
+	cb.stats.blocks++;
+
+	/* schedule messages and null messages are not collected */
+	if (seq == CBCH_SEQ_NULL || (seq & CBCH_SEQ_SCHEDULE)) {
+		cb.next_seq = -1;
+		return;
+	}
+
+	if (seq != 0 && seq != cb.next_seq) {
+		/* a block is missing, drop the page */
+		if (cb.next_seq >= 0)
+			cb.stats.bad_blocks++;
+		cb.next_seq = -1;
+		return;
+	}
+
+	memcpy(cb.page + seq * 22, data + 1, 22);
+	if (seq < 3 && !(data[0] & CBCH_LB)) {
+		cb.next_seq = seq + 1;
+		return;
+	}
+
+	cb.next_seq = -1;
+	if (seq == 3)
+		rx_page(arfcn, fn);
+}
+
+const struct cbch_stats *cbch_get_stats(void)
+{
+	return &cb.stats;
+}
+
+/* open the output, "-" is stdout */
+int cbch_open(const char *path)
+{
+	if (!strcmp(path, "-"))
+		cb.outfp = stdout;
+	else
+		cb.outfp = fopen(path, "a");
+	if (!cb.outfp)
+		return -errno;
+
+	return 0;
+}
+
+void cbch_close(void)
+{
+	if (cb.outfp && cb.outfp != stdout)
+		fclose(cb.outfp);
+	cb.outfp = NULL;
+	free(cb.seen);
+	cb.seen = NULL;
+	cb.seen_size = cb.seen_num = 0;
+}
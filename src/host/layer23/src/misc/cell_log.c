@@ -44,6 +44,8 @@
 #include <osmocom/bb/common/sysinfo.h>
 #include <osmocom/bb/mobile/gsm48_rr.h>
 #include <osmocom/bb/misc/cell_log.h>
+#include <osmocom/bb/misc/log.h>
+#include <osmocom/bb/misc/binlog.h>
 #include <osmocom/bb/misc/geo.h>
 
 #define READ_WAIT	2, 0
@@ -88,8 +90,26 @@ static double pm_gps_x, pm_gps_y, pm_gps_z;
 static int arfcn;
 static int rach_count;
 static FILE *logfp = NULL;
+static struct binlog_writer *binlog = NULL;
 extern char *logname;
+extern int log_binary;
+extern unsigned int log_flush_interval;
 extern int RACH_MAX;
+extern unsigned int cell_window;
+
+/* cells logged recently, by ARFCN and BSIC */
+static struct cell_cache {
+	uint8_t valid;
+	uint8_t bsic;
+	time_t logged;
+	/* position of the last TA sample */
+	uint8_t ta_valid, ta_gps_valid;
+	double ta_x, ta_y, ta_z;
+} cell_cache[1024];
+
+/* statistics of this run */
+static time_t stat_start;
+static unsigned int stat_logged, stat_skipped, stat_no_rach;
 
 
 static struct gsm48_sysinfo sysinfo;
@@ -117,6 +137,7 @@ struct rach_ref {
 static void start_sync(void);
 static void start_rach(void);
 static void start_pm(void);
+static void stop_timer(void);
 
 static void log_gps(void)
 {
@@ -125,7 +146,7 @@ static void log_gps(void)
 	LOGFILE("position %.8f %.8f\n", g.longitude, g.latitude);
 }
 
-static void log_time(void)
+static time_t log_now(void)
 {
 	time_t now;
 
@@ -133,7 +154,12 @@ static void log_time(void)
 		now = g.gmt;
 	else
 		time(&now);
-	LOGFILE("time %lu\n", now);
+	return now;
+}
+
+static void log_time(void)
+{
+	LOGFILE("time %lu\n", log_now());
 }
 
 static void log_frame(char *tag, uint8_t *data)
@@ -146,10 +172,37 @@ static void log_frame(char *tag, uint8_t *data)
 	LOGFILE("\n");
 }
 
+static void log_pm_binary(void)
+{
+	struct power power;
+	int i;
+
+	memset(&power, 0, sizeof(power));
+	power.gmt = log_now();
+	if (g.enable && g.valid) {
+		power.gps_valid = 1;
+		power.longitude = g.longitude;
+		power.latitude = g.latitude;
+	}
+	for (i = 0; i <= 1023; i++) {
+		if ((pm[i].flags & INFO_FLG_PM))
+			power.rxlev[i] = pm[i].rxlev_dbm;
+		else
+			power.rxlev[i] = -128;
+	}
+	if (binlog_write_power(binlog, &power) < 0)
+		LOGP(DSUM, LOGL_ERROR, "Failed to write logfile\n");
+}
+
 static void log_pm(void)
 {
 	int count = 0, i;
 
+	if (binlog) {
+		log_pm_binary();
+		return;
+	}
+
 	LOGFILE("[power]\n");
 	log_time();
 	log_gps();
@@ -177,6 +230,41 @@ static void log_pm(void)
 	LOGFLUSH();
 }
 
+static void log_sysinfo_binary(int8_t rxlev_dbm)
+{
+	struct gsm48_sysinfo *s = &sysinfo;
+	struct sysinfo si;
+
+	memset(&si, 0, sizeof(si));
+	si.arfcn = s->arfcn;
+	si.gmt = log_now();
+	if (g.enable && g.valid) {
+		si.gps_valid = 1;
+		si.longitude = g.longitude;
+		si.latitude = g.latitude;
+	}
+	si.bsic = s->bsic;
+	si.rxlev = rxlev_dbm;
+	if (s->si1)
+		memcpy(si.si1, s->si1_msg, sizeof(si.si1));
+	if (s->si2)
+		memcpy(si.si2, s->si2_msg, sizeof(si.si2));
+	if (s->si2bis)
+		memcpy(si.si2bis, s->si2b_msg, sizeof(si.si2bis));
+	if (s->si2ter)
+		memcpy(si.si2ter, s->si2t_msg, sizeof(si.si2ter));
+	if (s->si3)
+		memcpy(si.si3, s->si3_msg, sizeof(si.si3));
+	if (s->si4)
+		memcpy(si.si4, s->si4_msg, sizeof(si.si4));
+	if (log_si.ta != 0xff) {
+		si.ta_valid = 1;
+		si.ta = log_si.ta;
+	}
+	if (binlog_write_sysinfo(binlog, &si) < 0)
+		LOGP(DSUM, LOGL_ERROR, "Failed to write logfile\n");
+}
+
 static void log_sysinfo(void)
 {
 	struct rx_meas_stat *meas = &ms->meas;
@@ -192,12 +280,17 @@ static void log_sysinfo(void)
 		gsm_get_mcc(s->lai.plmn.mcc),
 		gsm_get_mnc(&s->lai.plmn), ta_str);
 
+	rxlev_dbm = meas->rxlev / meas->frames - 110;
+	if (binlog) {
+		log_sysinfo_binary(rxlev_dbm);
+		return;
+	}
+
 	LOGFILE("[sysinfo]\n");
 	LOGFILE("arfcn %d\n", s->arfcn);
 	log_time();
 	log_gps();
 	LOGFILE("bsic %d,%d\n", s->bsic >> 3, s->bsic & 7);
-	rxlev_dbm = meas->rxlev / meas->frames - 110;
 	LOGFILE("rxlev %d\n", rxlev_dbm);
 	if (s->si1)
 		log_frame("si1", s->si1_msg);
@@ -218,10 +311,97 @@ static void log_sysinfo(void)
 	LOGFLUSH();
 }
 
+static void log_stats(void)
+{
+	time_t elapsed = log_now() - stat_start;
+
+	if (elapsed <= 0)
+		return;
+	LOGP(DSUM, LOGL_INFO, "%u cells logged in %lu s (%.1f cells/hour), "
+		"%u skipped as logged recently, %u without RACH\n",
+		stat_logged, (unsigned long)elapsed,
+		stat_logged * 3600.0 / elapsed, stat_skipped, stat_no_rach);
+}
+
+/* check if the cell was logged within the window */
+static int cell_recent(uint16_t arfcn, uint8_t bsic)
+{
+	struct cell_cache *c = &cell_cache[arfcn];
+
+	if (!cell_window || !c->valid || c->bsic != bsic)
+		return 0;
+	return log_now() - c->logged < cell_window;
+}
+
+/* check if the cell lacks a TA sample near the current position */
+static int cell_need_ta(uint16_t arfcn, uint8_t bsic)
+{
+	struct cell_cache *c = &cell_cache[arfcn];
+	double x, y, z;
+
+	if (!RACH_MAX)
+		return 0;
+	if (!c->valid || c->bsic != bsic || !c->ta_valid)
+		return 1;
+	/* without position, one sample is as good as another */
+	if (!c->ta_gps_valid || !g.enable || !g.valid)
+		return 0;
+	geo2space(&x, &y, &z, g.longitude, g.latitude);
+	return distinspace(c->ta_x, c->ta_y, c->ta_z, x, y, z) > MAX_DIST;
+}
+
+/* log the cell, remember it and go to the next one */
+static void cell_done(void)
+{
+	struct cell_cache *c = &cell_cache[sysinfo.arfcn];
+
+	log_sysinfo();
+	stat_logged++;
+
+	if (!c->valid || c->bsic != sysinfo.bsic)
+		c->ta_valid = 0;
+	c->valid = 1;
+	c->bsic = sysinfo.bsic;
+	c->logged = log_now();
+	if (log_si.ta != 0xff) {
+		c->ta_valid = 1;
+		c->ta_gps_valid = g.enable && g.valid;
+		if (c->ta_gps_valid)
+			geo2space(&c->ta_x, &c->ta_y, &c->ta_z, g.longitude,
+				g.latitude);
+	}
+
+	start_sync();
+}
+
+/* all SI are read, or at least the mandatory ones on timeout */
+static void sysinfo_done(void)
+{
+	stop_timer();
+
+	if (!cell_need_ta(sysinfo.arfcn, sysinfo.bsic)) {
+		if (RACH_MAX)
+			stat_no_rach++;
+		cell_done();
+		return;
+	}
+
+	rach_count = 0;
+	start_rach();
+}
+
 static void timeout_cb(void *arg)
 {
+	struct gsm48_sysinfo *s = &sysinfo;
+
 	switch (state) {
 	case SCAN_STATE_READ:
+		/* don't lose the cell if only optional SI are missing */
+		if (s->si1 && s->si2 && s->si3 && s->si4) {
+			LOGP(DRR, LOGL_INFO, "Timeout reading optional SI\n");
+			sysinfo_done();
+			break;
+		}
 		LOGP(DRR, LOGL_INFO, "Timeout reading BCCH\n");
 		start_sync();
 		break;
@@ -255,8 +435,7 @@ static void start_rach(void)
 	struct abis_rsl_cchan_hdr *ncch;
 
 	if (rach_count == RACH_MAX) {
-		log_sysinfo();
-		start_sync();
+		cell_done();
 		return;
 	}
 
@@ -342,6 +521,8 @@ static void start_sync(void)
 	LOGP(DSUM, LOGL_INFO, "Sync ARFCN %d (rxlev %d, %d syncs left)%s\n",
 		arfcn, pm[arfcn].rxlev_dbm, sync_count--, dist_str);
 	memset(&sysinfo, 0, sizeof(sysinfo));
+	/* only raw messages are logged, don't decode lists */
+	sysinfo.lazy = true;
 	sysinfo.arfcn = arfcn;
 	state = SCAN_STATE_SYNC;
 	l1ctl_tx_reset_req(ms, L1CTL_RES_T_FULL);
@@ -359,6 +540,7 @@ static void start_pm(void)
 
 	if (from == 0 && to == 0) {
 		LOGP(DSUM, LOGL_INFO, "Measurement done\n");
+		log_stats();
 		pm_gps_valid = g.enable && g.valid;
 		if (pm_gps_valid)
 			geo2space(&pm_gps_x, &pm_gps_y, &pm_gps_z,
@@ -399,6 +581,13 @@ static int signal_cb(unsigned int subsys, unsigned int signal,
 	case S_L1CTL_FBSB_RESP:
 		fr = signal_data;
 		sysinfo.bsic = fr->bsic;
+		/* the PM of this round was logged, that is enough */
+		if (cell_recent(arfcn, fr->bsic)) {
+			LOGP(DRR, LOGL_INFO, "Cell logged recently, skipping\n");
+			stat_skipped++;
+			start_sync();
+			break;
+		}
 		state = SCAN_STATE_READ;
 		memset(&ms->meas, 0, sizeof(ms->meas));
 		memset(&log_si, 0, sizeof(log_si));
@@ -415,6 +604,7 @@ static int signal_cb(unsigned int subsys, unsigned int signal,
 		if (started)
 			break;
 		started = 1;
+		stat_start = log_now();
 		memset(pm, 0, sizeof(pm));
 		pm_index = 0;
 		sync_count = 0;
@@ -434,8 +624,7 @@ static int ta_result(uint8_t ta)
 		log_si.ta = ta;
 	}
 
-	log_sysinfo();
-	start_sync();
+	cell_done();
 
 	return 0;
 }
@@ -589,10 +778,7 @@ static int new_sysinfo(void)
 
 	LOGP(DRR, LOGL_INFO, "Sysinfo complete\n");
 
-	stop_timer();
-
-	rach_count = 0;
-	start_rach();
+	sysinfo_done();
 
 	return 0;
 }
@@ -804,11 +990,19 @@ int scan_init(struct osmocom_ms *_ms)
 	if (osmo_gps_open())
 		g.enable = 0;
 
-	if (!strcmp(logname, "-"))
+	if (log_binary) {
+		binlog = binlog_open(logname, log_flush_interval);
+		if (!binlog) {
+			fprintf(stderr, "Failed to open logfile '%s': %s\n",
+				logname, strerror(errno));
+			scan_exit();
+			return -errno;
+		}
+	} else if (!strcmp(logname, "-"))
 		logfp = stdout;
 	else
 		logfp = fopen(logname, "a");
-	if (!logfp) {
+	if (!logfp && !binlog) {
 		fprintf(stderr, "Failed to open logfile '%s'\n", logname);
 		scan_exit();
 		return -errno;
@@ -821,10 +1015,16 @@ int scan_init(struct osmocom_ms *_ms)
 int scan_exit(void)
 {
 	LOGP(DSUM, LOGL_INFO, "Scanner exit\n");
+	if (started)
+		log_stats();
 	if (g.valid)
 		osmo_gps_close();
 	if (logfp)
 		fclose(logfp);
+	if (binlog)
+		binlog_close(binlog);
+	logfp = NULL;
+	binlog = NULL;
 	osmo_signal_unregister_handler(SS_L1CTL, &signal_cb, NULL);
 	stop_timer();
 
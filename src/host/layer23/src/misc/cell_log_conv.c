@@ -0,0 +1,142 @@
+/* Conversion between text and binary cell log */
+
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <osmocom/bb/misc/log.h>
+#include <osmocom/bb/misc/binlog.h>
+
+static int text_sysinfo(void *priv, const struct sysinfo *si)
+{
+	log_write_sysinfo(priv, si);
+	return 0;
+}
+
+static int text_power(void *priv, const struct power *power)
+{
+	log_write_power(priv, power);
+	return 0;
+}
+
+static const struct log_handler text_handler = {
+	.sysinfo = text_sysinfo,
+	.power = text_power,
+};
+
+static int binary_sysinfo(void *priv, const struct sysinfo *si)
+{
+	return binlog_write_sysinfo(priv, si);
+}
+
+static int binary_power(void *priv, const struct power *power)
+{
+	return binlog_write_power(priv, power);
+}
+
+static const struct log_handler binary_handler = {
+	.sysinfo = binary_sysinfo,
+	.power = binary_power,
+};
+
+/* check the format of the input, so the output gets the other one */
+static int input_is_binary(const char *filename)
+{
+	char hdr[BINLOG_HDR_LEN];
+	ssize_t len;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	len = read(fd, hdr, sizeof(hdr));
+	close(fd);
+	if (len < 0)
+		return -errno;
+
+	return binlog_detect(hdr, len);
+}
+
+int main(int argc, char *argv[])
+{
+	struct binlog_writer *w;
+	FILE *outfp;
+	int binary, rc;
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <input> <output>\n", argv[0]);
+		fprintf(stderr, "A text log is converted to binary format, "
+			"a binary log to text format.\n");
+		fprintf(stderr, "Use '-' as output to write to stdout.\n");
+		return 0;
+	}
+
+	binary = input_is_binary(argv[1]);
+	if (binary < 0) {
+		fprintf(stderr, "Failed to read '%s': %s\n", argv[1],
+			strerror(-binary));
+		return -EIO;
+	}
+
+	if (binary) {
+		if (!strcmp(argv[2], "-"))
+			outfp = stdout;
+		else
+			outfp = fopen(argv[2], "w");
+		if (!outfp) {
+			fprintf(stderr, "Failed to open '%s' for writing\n",
+				argv[2]);
+			return -EIO;
+		}
+		rc = log_parse_file(&text_handler, outfp, argv[1]);
+		if (outfp != stdout)
+			fclose(outfp);
+	} else {
+		/* the writer appends, but the output shall be a new log */
+		if (strcmp(argv[2], "-") && truncate(argv[2], 0) < 0
+		 && errno != ENOENT) {
+			fprintf(stderr, "Failed to open '%s' for writing: %s\n",
+				argv[2], strerror(errno));
+			return -EIO;
+		}
+		/* flush when the buffer is full */
+		w = binlog_open(argv[2], UINT_MAX);
+		if (!w) {
+			fprintf(stderr, "Failed to open '%s' for writing: %s\n",
+				argv[2], strerror(errno));
+			return -EIO;
+		}
+		rc = log_parse_file(&binary_handler, w, argv[1]);
+		if (binlog_close(w) < 0 && rc == 0)
+			rc = -EIO;
+	}
+
+	if (rc < 0) {
+		fprintf(stderr, "Failed to convert '%s': %s\n", argv[1],
+			strerror(-rc));
+		return -EIO;
+	}
+
+	return 0;
+}
@@ -22,6 +22,11 @@
 #include <errno.h>
 #include <math.h>
 #include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #define GSM_TA_M 553.85
 #define PI 3.1415926536
@@ -33,16 +38,10 @@
 #include <osmocom/bb/misc/log.h>
 #include <osmocom/bb/misc/geo.h>
 #include <osmocom/bb/misc/locate.h>
+#include <osmocom/bb/misc/tile.h>
 
-/*
- * structure of power and cell infos
- */
+#define OUTPUT_BUF_SIZE	(1024 * 1024)
 
-struct power power;
-struct sysinfo sysinfo;
-static struct node_power *node_power_first = NULL;
-static struct node_power **node_power_last_p = &node_power_first;
-struct node_mcc *node_mcc_first = NULL;
 int log_lines = 0, log_debug = 0;
 
 
@@ -52,20 +51,6 @@ static void nomem(void)
 	exit(-ENOMEM);
 }
 
-static void add_power(void)
-{
-	struct node_power *node_power;
-
-//	printf("New Power\n");
-	/* append or insert to list */
-	node_power = calloc(1, sizeof(struct node_power));
-	if (!node_power)
-		nomem();
-	*node_power_last_p = node_power;
-	node_power_last_p = &node_power->next;
-	memcpy(&node_power->power, &power, sizeof(power));
-}
-
 static void print_si(void *priv, const char *fmt, ...)
 {
 	char buffer[1000];
@@ -81,91 +66,40 @@ static void print_si(void *priv, const char *fmt, ...)
 		fprintf(outfp, "%s", buffer);
 }
 
-static void add_sysinfo(void)
+/* decode sysinfo of a cell, only done when writing it */
+static void decode_sysinfo(struct gsm48_sysinfo *s, const struct sysinfo *sysinfo)
 {
-	struct gsm48_sysinfo s;
-	struct node_mcc *mcc;
-	struct node_mnc *mnc;
-	struct node_lac *lac;
-	struct node_cell *cell;
-	struct node_meas *meas;
-
-	memset(&s, 0, sizeof(s));
+	memset(s, 0, sizeof(*s));
 
-	/* decode sysinfo */
-	if (sysinfo.si1[2])
-		gsm48_decode_sysinfo1(&s,
-			(struct gsm48_system_information_type_1 *) sysinfo.si1,
+	if (sysinfo->si1[2])
+		gsm48_decode_sysinfo1(s,
+			(struct gsm48_system_information_type_1 *) sysinfo->si1,
 			23);
-	if (sysinfo.si2[2])
-		gsm48_decode_sysinfo2(&s,
-			(struct gsm48_system_information_type_2 *) sysinfo.si2,
+	if (sysinfo->si2[2])
+		gsm48_decode_sysinfo2(s,
+			(struct gsm48_system_information_type_2 *) sysinfo->si2,
 			23);
-	if (sysinfo.si2bis[2])
-		gsm48_decode_sysinfo2bis(&s,
+	if (sysinfo->si2bis[2])
+		gsm48_decode_sysinfo2bis(s,
 			(struct gsm48_system_information_type_2bis *)
-				sysinfo.si2bis,
+				sysinfo->si2bis,
 			23);
-	if (sysinfo.si2ter[2])
-		gsm48_decode_sysinfo2ter(&s,
+	if (sysinfo->si2ter[2])
+		gsm48_decode_sysinfo2ter(s,
 			(struct gsm48_system_information_type_2ter *)
-				sysinfo.si2ter,
+				sysinfo->si2ter,
 			23);
-	if (sysinfo.si3[2])
-		gsm48_decode_sysinfo3(&s,
-			(struct gsm48_system_information_type_3 *) sysinfo.si3,
+	if (sysinfo->si3[2])
+		gsm48_decode_sysinfo3(s,
+			(struct gsm48_system_information_type_3 *) sysinfo->si3,
 			23);
-	if (sysinfo.si4[2])
-		gsm48_decode_sysinfo4(&s,
-			(struct gsm48_system_information_type_4 *) sysinfo.si4,
+	if (sysinfo->si4[2])
+		gsm48_decode_sysinfo4(s,
+			(struct gsm48_system_information_type_4 *) sysinfo->si4,
 			23);
-	printf("--------------------------------------------------------------------------\n");
-	gsm48_sysinfo_dump(&s, sysinfo.arfcn, print_si, stdout, NULL);
-	mcc = get_node_mcc(s.lai.plmn.mcc);
-	if (!mcc)
-		nomem();
-	mnc = get_node_mnc(mcc, s.lai.plmn.mnc, s.lai.plmn.mnc_3_digits);
-	if (!mnc)
-		nomem();
-	lac = get_node_lac(mnc, s.lai.lac);
-	if (!lac)
-		nomem();
-	cell = get_node_cell(lac, s.cell_id);
-	if (!cell)
-		nomem();
-	meas = add_node_meas(cell);
-	if (!meas)
-		nomem();
-	if (!cell->content) {
-		cell->content = 1;
-		memcpy(&cell->sysinfo, &sysinfo, sizeof(sysinfo));
-		memcpy(&cell->s, &s, sizeof(s));
-	} else {
-		if (memcmp(&cell->sysinfo.si1, sysinfo.si1,
-			sizeof(sysinfo.si1))) {
-new_sysinfo:
-			fprintf(stderr, "FIXME: the cell changed sysinfo\n");
-			return;
-		}
-		if (memcmp(&cell->sysinfo.si2, sysinfo.si2,
-			sizeof(sysinfo.si2)))
-			goto new_sysinfo;
-		if (memcmp(&cell->sysinfo.si2bis, sysinfo.si2bis,
-			sizeof(sysinfo.si2bis)))
-			goto new_sysinfo;
-		if (memcmp(&cell->sysinfo.si2ter, sysinfo.si2ter,
-			sizeof(sysinfo.si2ter)))
-			goto new_sysinfo;
-		if (memcmp(&cell->sysinfo.si3, sysinfo.si3,
-			sizeof(sysinfo.si3)))
-			goto new_sysinfo;
-		if (memcmp(&cell->sysinfo.si4, sysinfo.si4,
-			sizeof(sysinfo.si4)))
-			goto new_sysinfo;
-	}
 }
 
-void kml_header(FILE *outfp, char *name)
+void kml_header(FILE *outfp, const char *name)
 {
 	/* XML header */
 	fprintf(outfp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
@@ -296,12 +230,13 @@ void kml_footer(FILE *outfp)
 
 }
 
-static void kml_meas(FILE *outfp, struct node_meas *meas, int n, const struct osmo_cell_global_id *cgi)
+static void kml_meas(FILE *outfp, const struct node_cell *cell, unsigned int i, int n)
 {
-	struct tm *tm = localtime(&meas->gmt);
+	const struct osmo_cell_global_id *cgi = &cell->cgi;
+	struct tm *tm = localtime(&cell->gmt[i]);
 
 	fprintf(outfp, "\t\t\t\t\t<Placemark>\n");
-	fprintf(outfp, "\t\t\t\t\t\t<name>%d: %d</name>\n", n, meas->rxlev);
+	fprintf(outfp, "\t\t\t\t\t\t<name>%d: %d</name>\n", n, cell->rxlev[i]);
 	fprintf(outfp, "\t\t\t\t\t\t<description>\n");
 	fprintf(outfp, "MCC=%s MNC=%s\nLAC=%04x CELL-ID=%04x\n(%s %s)\n",
 		osmo_mcc_name(cgi->lai.plmn.mcc),
@@ -310,17 +245,17 @@ static void kml_meas(FILE *outfp, struct node_meas *meas, int n, const struct os
 		gsm_get_mcc(cgi->lai.plmn.mcc),
 		gsm_get_mnc(&cgi->lai.plmn));
 	fprintf(outfp, "\n%s", asctime(tm));
-	fprintf(outfp, "RX-LEV %d dBm\n", meas->rxlev);
-	if (meas->ta_valid)
-		fprintf(outfp, "TA=%d (%d-%d meter)\n", meas->ta,
-			(int)(GSM_TA_M * meas->ta),
-			(int)(GSM_TA_M * (meas->ta + 1)));
+	fprintf(outfp, "RX-LEV %d dBm\n", cell->rxlev[i]);
+	if ((cell->flags[i] & MEAS_F_TA))
+		fprintf(outfp, "TA=%d (%d-%d meter)\n", cell->ta[i],
+			(int)(GSM_TA_M * cell->ta[i]),
+			(int)(GSM_TA_M * (cell->ta[i] + 1)));
 	fprintf(outfp, "\t\t\t\t\t\t</description>\n");
 	fprintf(outfp, "\t\t\t\t\t\t<LookAt>\n");
 	fprintf(outfp, "\t\t\t\t\t\t\t<longitude>%.8f</longitude>\n",
-		meas->longitude);
+		cell->longitude[i]);
 	fprintf(outfp, "\t\t\t\t\t\t\t<latitude>%.8f</latitude>\n",
-		meas->latitude);
+		cell->latitude[i]);
 	fprintf(outfp, "\t\t\t\t\t\t\t<altitude>0</altitude>\n");
 	fprintf(outfp, "\t\t\t\t\t\t\t<tilt>0</tilt>\n");
 	fprintf(outfp, "\t\t\t\t\t\t\t<altitudeMode>relativeToGround"
@@ -332,106 +267,175 @@ static void kml_meas(FILE *outfp, struct node_meas *meas, int n, const struct os
 		"</styleUrl>\n");
 	fprintf(outfp, "\t\t\t\t\t\t<Point>\n");
 	fprintf(outfp, "\t\t\t\t\t\t\t<coordinates>%.8f,%.8f</coordinates>\n",
-		meas->longitude, meas->latitude);
+		cell->longitude[i], cell->latitude[i]);
 	fprintf(outfp, "\t\t\t\t\t\t</Point>\n");
 	fprintf(outfp, "\t\t\t\t\t</Placemark>\n");
 }
 
-double debug_long, debug_lat, debug_x_scale;
-FILE *debug_fp;
+/* measurements of a cell within a tile */
+static void kml_tile(FILE *outfp, const struct tile *tile, int zoom)
+{
+	double longitude, latitude;
 
-void kml_cell(FILE *outfp, struct node_cell *cell)
+	tile_center(tile->x, tile->y, zoom, &longitude, &latitude);
+	fprintf(outfp, "\t\t\t\t\t<Placemark>\n");
+	fprintf(outfp, "\t\t\t\t\t\t<name>%d</name>\n",
+		tile->rxlev_median);
+	fprintf(outfp, "\t\t\t\t\t\t<description>\n");
+	fprintf(outfp, "Tile %d/%u/%u\n", zoom, tile->x, tile->y);
+	fprintf(outfp, "%u measurements\n", tile->count);
+	fprintf(outfp, "RX-LEV median %d dBm (%d..%d dBm)\n",
+		tile->rxlev_median, tile->rxlev_min, tile->rxlev_max);
+	fprintf(outfp, "\t\t\t\t\t\t</description>\n");
+	fprintf(outfp, "\t\t\t\t\t\t<styleUrl>#msn_placemark_circle"
+		"</styleUrl>\n");
+	fprintf(outfp, "\t\t\t\t\t\t<Point>\n");
+	fprintf(outfp, "\t\t\t\t\t\t\t<coordinates>%.8f,%.8f</coordinates>\n",
+		longitude, latitude);
+	fprintf(outfp, "\t\t\t\t\t\t</Point>\n");
+	fprintf(outfp, "\t\t\t\t\t</Placemark>\n");
+}
+
+/* origin of the flat surface and output of the locator debugging */
+__thread double debug_long, debug_lat, debug_x_scale;
+__thread FILE *debug_fp;
+
+/* TA gives the distance in steps of GSM_TA_M, the error is distributed
+ * evenly over one step */
+#define TA_SIGMA_M	(GSM_TA_M / 3.4641016)
+/* Without TA, the distance is estimated from the RX level by a log-distance
+ * path loss model. Shadowing makes this estimate rough. */
+#define RXLEV_1KM	-75.0	/* dBm at 1 km */
+#define RXLEV_EXP	3.5	/* path loss exponent */
+#define RXLEV_SIGMA	0.7	/* error relative to the distance */
+
+#define MEAS_F_POS	(MEAS_F_GPS | MEAS_F_TA)
+
+struct cell_pos {
+	double longitude, latitude;
+	int known; /* the cell was located */
+};
+
+/* Put the measurements with position of a cell on a flat surface around the
+ * first of them. Return the number of probes with TA, or -ENOMEM. */
+static int cell_probes(const struct node_cell *cell, struct probe_set *ps,
+	double *longitude, double *latitude, double *x_scale)
 {
-	struct node_meas *meas;
-	double x, y, z, sum_x = 0, sum_y = 0, sum_z = 0, longitude, latitude;
-	int n, known = 0;
+	unsigned int i, n = 0;
+	int num_ta = 0;
+	double dist_m, sigma_m, dlon;
 
-	meas = cell->meas;
-	n = 0;
-	while (meas) {
-		if (meas->gps_valid && meas->ta_valid) {
-			geo2space(&x, &y, &z, meas->longitude, meas->latitude);
-			sum_x += x;
-			sum_y += y;
-			sum_z += z;
+	for (i = 0; i < cell->meas_num; i++) {
+		if ((cell->flags[i] & MEAS_F_GPS))
 			n++;
-		}
-		meas = meas->next;
 	}
+	memset(ps, 0, sizeof(*ps));
 	if (!n)
+		return 0;
+	ps->x = calloc(4 * n, sizeof(double));
+	if (!ps->x)
+		return -ENOMEM;
+	ps->y = ps->x + n;
+	ps->dist = ps->y + n;
+	ps->weight = ps->dist + n;
+
+	*x_scale = 1.0 / cos(cell->latitude[0] / 180.0 * PI);
+	*longitude = cell->longitude[0];
+	*latitude = cell->latitude[0];
+	for (i = 0; i < cell->meas_num; i++) {
+		if (!(cell->flags[i] & MEAS_F_GPS))
+			continue;
+		dlon = cell->longitude[i] - *longitude;
+		if (dlon < -180)
+			dlon += 360;
+		else if (dlon > 180)
+			dlon -= 360;
+		if ((cell->flags[i] & MEAS_F_TA)) {
+			dist_m = GSM_TA_M * (0.5 + (double)cell->ta[i]);
+			sigma_m = TA_SIGMA_M;
+			num_ta++;
+		} else {
+			dist_m = 1000.0 * pow(10.0, (RXLEV_1KM - cell->rxlev[i])
+				/ (10.0 * RXLEV_EXP));
+			sigma_m = RXLEV_SIGMA * dist_m;
+		}
+		ps->x[ps->num] = dlon / *x_scale;
+		ps->y[ps->num] = cell->latitude[i] - *latitude;
+		ps->dist[ps->num] = dist_m / (EQUATOR_RADIUS * PI / 180.0);
+		ps->weight[ps->num] = 1.0 / (sigma_m * sigma_m);
+		ps->num++;
+	}
+
+	return num_ta;
+}
+
+/* Locate a cell, if there is at least one measurement with TA and at least
+ * three measurements with position. */
+static void cell_position(const struct node_cell *cell, struct cell_pos *pos)
+{
+	struct probe_set ps;
+	double x, y, longitude, latitude, x_scale;
+	int num_ta;
+
+	memset(pos, 0, sizeof(*pos));
+	num_ta = cell_probes(cell, &ps, &longitude, &latitude, &x_scale);
+	if (num_ta == -ENOMEM)
+		nomem();
+	if (num_ta < 1 || ps.num < 3) {
+		free(ps.x);
 		return;
-	if (n < 3) {
-		x = sum_x / n;
-		y = sum_y / n;
-		z = sum_z / n;
-		space2geo(&longitude, &latitude, x, y, z);
-	} else {
-		struct probe *probe_first = NULL, *probe,
-			     **probe_last_p = &probe_first;
-		double x_scale;
-
-		/* translate to flat surface */
-		meas = cell->meas;
-		x_scale = 1.0 / cos(meas->latitude / 180.0 * PI);
-		longitude = meas->longitude;
-		latitude = meas->latitude;
+	}
+
+	if (debug_fp) {
 		debug_x_scale = x_scale;
 		debug_long = longitude;
 		debug_lat = latitude;
-		debug_fp = outfp;
-		while (meas) {
-			if (meas->gps_valid && meas->ta_valid) {
-				probe = calloc(1, sizeof(struct probe));
-				if (!probe)
-					nomem();
-				probe->x = (meas->longitude - longitude) /
-						x_scale;
-				if (x < -180)
-					x += 360;
-				else if (x > 180)
-					x -= 360;
-				probe->y = meas->latitude - latitude;
-				probe->dist = GSM_TA_M * (0.5 +
-					(double)meas->ta) /
-					(EQUATOR_RADIUS * PI / 180.0);
-				*probe_last_p = probe;
-				probe_last_p = &probe->next;
-			}
-			meas = meas->next;
-		}
-
-		/* locate */
-		locate_cell(probe_first, &x, &y);
+	}
 
+	/* locate */
+	if (locate_cell(&ps, &x, &y) == 0) {
 		/* translate from flat surface */
 		longitude += x * x_scale;
-		if (longitude < 0)
+		if (longitude < -180)
 			longitude += 360;
-		else if (longitude >= 360)
+		else if (longitude >= 180)
 			longitude -= 360;
-		latitude += y;
+		pos->longitude = longitude;
+		pos->latitude = latitude + y;
+		pos->known = 1;
+	}
 
-		/* remove probes */
-		while (probe_first) {
-			probe = probe_first;
-			probe_first = probe->next;
-			free(probe);
-		}
+	/* remove probes */
+	free(ps.x);
+}
 
-		known = 1;
-	}
+void kml_cell(FILE *outfp, struct node_cell *cell, struct cell_pos *pos)
+{
+	struct gsm48_sysinfo s;
+	double x, y, z, longitude, latitude;
+	unsigned int i;
 
-	if (!known)
+	/* the debug output of the locator goes in front of the cell */
+	if (log_debug) {
+		debug_fp = outfp;
+		cell_position(cell, pos);
+		debug_fp = NULL;
+	}
+	if (!pos->known)
 		return;
+	longitude = pos->longitude;
+	latitude = pos->latitude;
+
+	decode_sysinfo(&s, &cell->sysinfo);
 
 	fprintf(outfp, "\t\t\t\t\t<Placemark>\n");
 	fprintf(outfp, "\t\t\t\t\t\t<name>LAI=%s "
 		"CELL-ID=%04x\n(%s %s)</name>\n",
-		osmo_lai_name(&cell->s.lai), cell->s.cell_id,
-		gsm_get_mcc(cell->s.lai.plmn.mcc),
-		gsm_get_mnc(&cell->s.lai.plmn));
+		osmo_lai_name(&cell->cgi.lai), cell->cgi.cell_identity,
+		gsm_get_mcc(cell->cgi.lai.plmn.mcc),
+		gsm_get_mnc(&cell->cgi.lai.plmn));
 	fprintf(outfp, "\t\t\t\t\t\t<description>\n");
-	gsm48_sysinfo_dump(&cell->s, cell->sysinfo.arfcn, print_si, outfp,
+	gsm48_sysinfo_dump(&s, cell->sysinfo.arfcn, print_si, outfp,
 		NULL);
 	fprintf(outfp, "\t\t\t\t\t\t</description>\n");
 	fprintf(outfp, "\t\t\t\t\t\t<LookAt>\n");
@@ -445,12 +449,8 @@ void kml_cell(FILE *outfp, struct node_cell *cell)
 	fprintf(outfp, "\t\t\t\t\t\t\t<gx:altitudeMode>relativeToSeaFloor"
 		"</gx:altitudeMode>\n");
 	fprintf(outfp, "\t\t\t\t\t\t</LookAt>\n");
-	if (known)
-		fprintf(outfp, "\t\t\t\t\t\t<styleUrl>#msn_placemark_grn_"
-			"pushpin</styleUrl>\n");
-	else
-		fprintf(outfp, "\t\t\t\t\t\t<styleUrl>#msn_placemark_red_"
-			"pushpin</styleUrl>\n");
+	fprintf(outfp, "\t\t\t\t\t\t<styleUrl>#msn_placemark_grn_"
+		"pushpin</styleUrl>\n");
 	fprintf(outfp, "\t\t\t\t\t\t<Point>\n");
 	fprintf(outfp, "\t\t\t\t\t\t\t<coordinates>%.8f,%.8f</coordinates>\n",
 		longitude, latitude);
@@ -466,191 +466,473 @@ void kml_cell(FILE *outfp, struct node_cell *cell)
 	fprintf(outfp, "\t\t<visibility>0</visibility>\n");
 
 	geo2space(&x, &y, &z, longitude, latitude);
-	meas = cell->meas;
-	n = 0;
-	while (meas) {
-		if (meas->gps_valid) {
+	for (i = 0; i < cell->meas_num; i++) {
+		if ((cell->flags[i] & MEAS_F_GPS)) {
 			double mx, my, mz, dist;
 
-			geo2space(&mx, &my, &mz, meas->longitude,
-				meas->latitude);
+			geo2space(&mx, &my, &mz, cell->longitude[i],
+				cell->latitude[i]);
 			dist = distinspace(x, y, z, mx, my, mz);
 			fprintf(outfp, "\t\t<Placemark>\n");
 			fprintf(outfp, "\t\t\t<name>Range</name>\n");
 			fprintf(outfp, "\t\t\t<description>\n");
 			fprintf(outfp, "Distance: %d\n", (int)dist);
-			fprintf(outfp, "TA=%d (%d-%d meter)\n", meas->ta,
-				(int)(GSM_TA_M * meas->ta),
-				(int)(GSM_TA_M * (meas->ta + 1)));
+			fprintf(outfp, "TA=%d (%d-%d meter)\n", cell->ta[i],
+				(int)(GSM_TA_M * cell->ta[i]),
+				(int)(GSM_TA_M * (cell->ta[i] + 1)));
 			fprintf(outfp, "\t\t\t</description>\n");
 			fprintf(outfp, "\t\t\t<visibility>0</visibility>\n");
 			fprintf(outfp, "\t\t\t<LineString>\n");
 			fprintf(outfp, "\t\t\t\t<tessellate>1</tessellate>\n");
 			fprintf(outfp, "\t\t\t\t<coordinates>\n");
 			fprintf(outfp, "%.8f,%.8f\n", longitude, latitude);
-			fprintf(outfp, "%.8f,%.8f\n", meas->longitude,
-				meas->latitude);
+			fprintf(outfp, "%.8f,%.8f\n", cell->longitude[i],
+				cell->latitude[i]);
 			fprintf(outfp, "\t\t\t\t</coordinates>\n");
 			fprintf(outfp, "\t\t\t</LineString>\n");
 			fprintf(outfp, "\t\t</Placemark>\n");
 		}
-		meas = meas->next;
 	}
 	fprintf(outfp, "\t</Folder>\n");
 }
 
 struct log_target *stderr_target;
 
-int main(int argc, char *argv[])
+/*
+ * reading of log files
+ *
+ * Each file is parsed by a worker thread into a database of its own. The
+ * main thread merges them in the order of the files, so the result does
+ * not depend on the number of threads.
+ */
+
+struct log_job {
+	char *filename;
+	struct log_db db;
+	int rc;
+	int done;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct log_job *job;
+	unsigned int num, next;
+} jobs = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void *log_worker(void *arg)
 {
-	FILE *infp, *outfp;
-	int type, n, i;
-	char *p;
-	struct node_mcc *mcc;
-	struct node_mnc *mnc;
-	struct node_lac *lac;
-	struct node_cell *cell;
-	struct node_meas *meas;
+	struct log_job *job;
 
-	log_init(&log_info, NULL);
-	stderr_target = log_target_create_stderr();
-	log_add_target(stderr_target);
-	log_set_all_filter(stderr_target, 1);
-	log_parse_category_mask(stderr_target, "Dxxx");
-	log_set_log_level(stderr_target, LOGL_INFO);
+	while (1) {
+		pthread_mutex_lock(&jobs.lock);
+		job = (jobs.next < jobs.num) ? &jobs.job[jobs.next++] : NULL;
+		pthread_mutex_unlock(&jobs.lock);
+		if (!job)
+			break;
 
-	if (argc <= 2) {
-usage:
-		fprintf(stderr, "Usage: %s <file.log> <file.kml> "
-			"[lines] [debug]\n", argv[0]);
-		fprintf(stderr, "lines: Add lines between cell and "
-			"Measurement point\n");
-		fprintf(stderr, "debug: Add debugging of location algorithm.\n"
-			);
-		return 0;
+		job->rc = log_db_init(&job->db);
+		if (job->rc == 0)
+			job->rc = log_read_file(&job->db, job->filename);
+
+		pthread_mutex_lock(&jobs.lock);
+		job->done = 1;
+		pthread_cond_broadcast(&jobs.cond);
+		pthread_mutex_unlock(&jobs.lock);
 	}
 
-	for (i = 3; i < argc; i++) {
-		if (!strcmp(argv[i], "lines"))
-			log_lines = 1;
-		else if (!strcmp(argv[i], "debug"))
-			log_debug = 1;
-		else goto usage;
+	return NULL;
+}
+
+static void add_job(const char *filename)
+{
+	struct log_job *job;
+
+	job = realloc(jobs.job, (jobs.num + 1) * sizeof(*jobs.job));
+	if (!job)
+		nomem();
+	jobs.job = job;
+	job = &jobs.job[jobs.num++];
+	memset(job, 0, sizeof(*job));
+	job->filename = strdup(filename);
+	if (!job->filename)
+		nomem();
+}
+
+static int filename_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct log_job *)a)->filename,
+		((const struct log_job *)b)->filename);
+}
+
+/* add a log file, or all files of a directory in order of their names */
+static int add_input(const char *path)
+{
+	struct dirent *de;
+	struct stat st;
+	char *filename;
+	unsigned int first = jobs.num;
+	DIR *dir;
+
+	if (stat(path, &st) < 0) {
+		fprintf(stderr, "Failed to open '%s': %s\n", path,
+			strerror(errno));
+		return -EIO;
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		add_job(path);
+		return 0;
 	}
 
-	infp = fopen(argv[1], "r");
-	if (!infp) {
-		fprintf(stderr, "Failed to open '%s' for reading\n", argv[1]);
+	dir = opendir(path);
+	if (!dir) {
+		fprintf(stderr, "Failed to open '%s': %s\n", path,
+			strerror(errno));
 		return -EIO;
 	}
+	while ((de = readdir(dir))) {
+		if (de->d_name[0] == '.')
+			continue;
+		filename = malloc(strlen(path) + strlen(de->d_name) + 2);
+		if (!filename)
+			nomem();
+		sprintf(filename, "%s/%s", path, de->d_name);
+		if (stat(filename, &st) == 0 && S_ISREG(st.st_mode))
+			add_job(filename);
+		free(filename);
+	}
+	closedir(dir);
+	qsort(jobs.job + first, jobs.num - first, sizeof(*jobs.job),
+		filename_cmp);
 
-	while ((type = read_log(infp))) {
-		switch (type) {
-		case LOG_TYPE_SYSINFO:
-			add_sysinfo();
-			break;
-		case LOG_TYPE_POWER:
-			add_power();
+	return 0;
+}
+
+static pthread_t *start_threads(unsigned int num, void *(*worker)(void *))
+{
+	pthread_t *threads;
+	unsigned int i;
+	int rc;
+
+	threads = calloc(num, sizeof(*threads));
+	if (!threads)
+		nomem();
+	for (i = 0; i < num; i++) {
+		rc = pthread_create(&threads[i], NULL, worker, NULL);
+		if (rc) {
+			fprintf(stderr, "Failed to create thread: %s\n",
+				strerror(rc));
+			exit(-rc);
+		}
+	}
+
+	return threads;
+}
+
+static void join_threads(pthread_t *threads, unsigned int num)
+{
+	unsigned int i;
+
+	for (i = 0; i < num; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+}
+
+static void read_logs(struct log_db *db, unsigned int num_threads)
+{
+	pthread_t *threads;
+	struct log_job *job;
+	unsigned int i;
+
+	if (num_threads > jobs.num)
+		num_threads = jobs.num;
+	if (num_threads < 1)
+		num_threads = 1;
+	threads = start_threads(num_threads, log_worker);
+
+	/* merge results in order of the files */
+	for (i = 0; i < jobs.num; i++) {
+		job = &jobs.job[i];
+		pthread_mutex_lock(&jobs.lock);
+		while (!job->done)
+			pthread_cond_wait(&jobs.cond, &jobs.lock);
+		pthread_mutex_unlock(&jobs.lock);
+
+		if (job->rc == -ENOMEM)
+			nomem();
+		if (job->rc < 0) {
+			fprintf(stderr, "Failed to read '%s': %s\n",
+				job->filename, strerror(-job->rc));
+		} else if (log_db_merge(db, &job->db) < 0)
+			nomem();
+		log_db_free(&job->db);
+		free(job->filename);
+	}
+
+	join_threads(threads, num_threads);
+	free(jobs.job);
+	jobs.job = NULL;
+	jobs.num = jobs.next = 0;
+}
+
+/*
+ * locating of cells
+ *
+ * Cells are independent, so they are located by all threads. Each thread
+ * takes the next chunk of cells.
+ */
+
+#define LOCATE_CHUNK	16
+
+static struct {
+	pthread_mutex_t lock;
+	struct log_db *db;
+	struct cell_pos *pos;
+	unsigned int next;
+} locator = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void *locate_worker(void *arg)
+{
+	unsigned int c, end;
+
+	while (1) {
+		pthread_mutex_lock(&locator.lock);
+		c = locator.next;
+		locator.next += LOCATE_CHUNK;
+		pthread_mutex_unlock(&locator.lock);
+		if (c >= locator.db->num_cells)
 			break;
+
+		end = OSMO_MIN(c + LOCATE_CHUNK, locator.db->num_cells);
+		for (; c < end; c++)
+			cell_position(locator.db->cells[c], &locator.pos[c]);
+	}
+
+	return NULL;
+}
+
+static struct cell_pos *locate_cells(struct log_db *db,
+	unsigned int num_threads)
+{
+	pthread_t *threads;
+
+	locator.db = db;
+	locator.pos = calloc(db->num_cells + 1, sizeof(*locator.pos));
+	if (!locator.pos)
+		nomem();
+	locator.next = 0;
+
+	/* the debug output is written while writing the cells */
+	if (log_debug)
+		return locator.pos;
+
+	if (num_threads < 1)
+		num_threads = 1;
+	threads = start_threads(num_threads, locate_worker);
+	join_threads(threads, num_threads);
+
+	return locator.pos;
+}
+
+static double elapsed(const struct timespec *t1, const struct timespec *t2)
+{
+	return (t2->tv_sec - t1->tv_sec) + (t2->tv_nsec - t1->tv_nsec) / 1e9;
+}
+
+/* run the least squares and the former circle search on all cells and print
+ * how long they take and how well they fit the measurements */
+static void compare_locators(struct log_db *db)
+{
+	struct probe_set ps;
+	struct timespec t0, t1, t2;
+	double x1, y1, x2, y2, longitude, latitude, x_scale, d;
+	double t_lsq = 0, t_circle = 0, rms_lsq = 0, rms_circle = 0;
+	double sum_d = 0, max_d = 0;
+	unsigned int c, n = 0;
+	int num_ta;
+
+	for (c = 0; c < db->num_cells; c++) {
+		num_ta = cell_probes(db->cells[c], &ps, &longitude, &latitude,
+			&x_scale);
+		if (num_ta == -ENOMEM)
+			nomem();
+		/* the circle search only uses TA */
+		if (num_ta < 3 || num_ta != ps.num) {
+			free(ps.x);
+			continue;
 		}
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		locate_cell(&ps, &x1, &y1);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		locate_cell_circle(&ps, &x2, &y2);
+		clock_gettime(CLOCK_MONOTONIC, &t2);
+
+		t_lsq += elapsed(&t0, &t1);
+		t_circle += elapsed(&t1, &t2);
+		rms_lsq += locate_rms(&ps, x1, y1);
+		rms_circle += locate_rms(&ps, x2, y2);
+		d = distonplane(x1, y1, x2, y2) * (EQUATOR_RADIUS * PI / 180.0);
+		sum_d += d;
+		if (d > max_d)
+			max_d = d;
+		n++;
+		free(ps.x);
 	}
 
-	fclose(infp);
+	printf("Locator comparison on %u cells with TA only:\n", n);
+	if (!n)
+		return;
+	printf(" least squares: %.3f ms, mean RMS error %.1f m\n",
+		t_lsq * 1000.0, rms_lsq / n);
+	printf(" circle search: %.3f ms, mean RMS error %.1f m\n",
+		t_circle * 1000.0, rms_circle / n);
+	printf(" distance between results: mean %.1f m, max %.1f m\n",
+		sum_d / n, max_d);
+}
 
-	if (!strcmp(argv[2], "-"))
-		outfp = stdout;
-	else
-		outfp = fopen(argv[2], "w");
-	if (!outfp) {
-		fprintf(stderr, "Failed to open '%s' for writing\n", argv[2]);
-		return -EIO;
+/* close the innermost folders of LAC, MNC and MCC */
+static void kml_folder_close(FILE *outfp, int levels)
+{
+	int depth;
+
+	for (depth = 3; depth > 3 - levels; depth--)
+		fprintf(outfp, "%.*s</Folder>\n", depth, "\t\t\t");
+}
+
+/* print the system information of all cells */
+static void print_cells(struct log_db *db)
+{
+	const struct osmo_cell_global_id *cgi, *prev = NULL;
+	struct gsm48_sysinfo s;
+	struct node_cell *cell;
+	unsigned int c, m;
+
+	for (c = 0; c < db->num_cells; c++) {
+		cell = db->cells[c];
+		cgi = &cell->cgi;
+
+		if (!prev || cgi->lai.plmn.mcc != prev->lai.plmn.mcc) {
+			printf("MCC: %02x\n", cgi->lai.plmn.mcc);
+			prev = NULL;
+		}
+		if (!prev || cgi->lai.plmn.mnc != prev->lai.plmn.mnc
+		 || cgi->lai.plmn.mnc_3_digits != prev->lai.plmn.mnc_3_digits) {
+			printf(" MNC: %02x\n", cgi->lai.plmn.mnc);
+			prev = NULL;
+		}
+		if (!prev || cgi->lai.lac != prev->lai.lac)
+			printf("  LAC: %04x\n", cgi->lai.lac);
+		prev = cgi;
+
+		printf("   CELL: %04x\n", cgi->cell_identity);
+		printf("--------------------------------------------------------------------------\n");
+		decode_sysinfo(&s, &cell->sysinfo);
+		gsm48_sysinfo_dump(&s, cell->sysinfo.arfcn, print_si, stdout,
+			NULL);
+		for (m = 0; m < cell->meas_num; m++) {
+			if ((cell->flags[m] & MEAS_F_TA))
+				printf("    TA: %d\n", cell->ta[m]);
+		}
 	}
+}
 
-	/* document name */
-	p = argv[2];
-	while (strchr(p, '/'))
-		p = strchr(p, '/') + 1;
-
-	kml_header(outfp, p);
-	mcc = node_mcc_first;
-	while (mcc) {
-	  printf("MCC: %02x\n", mcc->mcc);
-	 /* folder open */
-	  fprintf(outfp, "\t<Folder>\n");
-	  fprintf(outfp, "\t\t<name>MCC %s (%s)</name>\n",
-		osmo_mcc_name(mcc->mcc), gsm_get_mcc(mcc->mcc));
-	  fprintf(outfp, "\t\t<open>0</open>\n");
-	  mnc = mcc->mnc;
-	  while (mnc) {
-		struct osmo_plmn_id plmn = {
-			.mcc = mcc->mcc,
-			.mnc = mnc->mnc,
-			.mnc_3_digits = mnc->mnc_3_digits,
-		};
-	    printf(" MNC: %02x\n", mnc->mnc);
-	    /* folder open */
-	    fprintf(outfp, "\t\t<Folder>\n");
-	    fprintf(outfp, "\t\t\t<name>MNC %s (%s)</name>\n",
-		    osmo_mnc_name(mnc->mnc, mnc->mnc_3_digits), gsm_get_mnc(&plmn));
-	    fprintf(outfp, "\t\t\t<open>0</open>\n");
-	    lac = mnc->lac;
-	    while (lac) {
-	      printf("  LAC: %04x\n", lac->lac);
-	      /* folder open */
-	      fprintf(outfp, "\t\t\t<Folder>\n");
-	      fprintf(outfp, "\t\t\t\t<name>LAC %04x</name>\n", lac->lac);
-	      fprintf(outfp, "\t\t\t\t<open>0</open>\n");
-	      cell = lac->cell;
-	      while (cell) {
-		printf("   CELL: %04x\n", cell->cellid);
-		fprintf(outfp, "\t\t\t\t<Folder>\n");
-		fprintf(outfp, "\t\t\t\t\t<name>CELL-ID %04x</name>\n", cell->cellid);
-		fprintf(outfp, "\t\t\t\t\t<open>0</open>\n");
-		meas = cell->meas;
+/* measurements of a cell, each one or summarized by tiles */
+static void kml_cell_meas(FILE *outfp, struct node_cell *cell, int zoom)
+{
+	struct tile *tiles;
+	unsigned int m;
+	int i, n;
+
+	if (zoom < 0) {
 		n = 0;
-		while (meas) {
-			if (meas->ta_valid)
-				printf("    TA: %d\n", meas->ta);
-			if (meas->gps_valid) {
-				struct osmo_cell_global_id cgi = {
-					.lai = {
-						.plmn = {
-							.mcc = mcc->mcc,
-							.mnc = mnc->mnc,
-							.mnc_3_digits = mnc->mnc_3_digits,
-						},
-						.lac = lac->lac,
-					},
-					.cell_identity = cell->cellid,
-				};
-				kml_meas(outfp, meas, ++n, &cgi);
-			}
-			meas = meas->next;
+		for (m = 0; m < cell->meas_num; m++) {
+			if ((cell->flags[m] & MEAS_F_GPS))
+				kml_meas(outfp, cell, m, ++n);
+		}
+		return;
+	}
+
+	n = tile_aggregate(cell, zoom, &tiles);
+	if (n < 0)
+		nomem();
+	for (i = 0; i < n; i++)
+		kml_tile(outfp, &tiles[i], zoom);
+	free(tiles);
+}
+
+static void kml_map(FILE *outfp, struct log_db *db, struct cell_pos *pos,
+	const char *name, int zoom)
+{
+	const struct osmo_cell_global_id *cgi, *prev = NULL;
+	struct node_cell *cell;
+	unsigned int c;
+
+	kml_header(outfp, name);
+	for (c = 0; c < db->num_cells; c++) {
+		cell = db->cells[c];
+		cgi = &cell->cgi;
+
+		/* close and open the folders of MCC, MNC and LAC that differ
+		 * from the previous cell, cells are sorted */
+		if (!prev || cgi->lai.plmn.mcc != prev->lai.plmn.mcc) {
+			if (prev)
+				kml_folder_close(outfp, 3);
+			/* folder open */
+			fprintf(outfp, "\t<Folder>\n");
+			fprintf(outfp, "\t\t<name>MCC %s (%s)</name>\n",
+				osmo_mcc_name(cgi->lai.plmn.mcc),
+				gsm_get_mcc(cgi->lai.plmn.mcc));
+			fprintf(outfp, "\t\t<open>0</open>\n");
+			prev = NULL;
 		}
-		kml_cell(outfp, cell);
+		if (!prev || cgi->lai.plmn.mnc != prev->lai.plmn.mnc
+		 || cgi->lai.plmn.mnc_3_digits != prev->lai.plmn.mnc_3_digits) {
+			if (prev)
+				kml_folder_close(outfp, 2);
+			/* folder open */
+			fprintf(outfp, "\t\t<Folder>\n");
+			fprintf(outfp, "\t\t\t<name>MNC %s (%s)</name>\n",
+				osmo_mnc_name(cgi->lai.plmn.mnc,
+					cgi->lai.plmn.mnc_3_digits),
+				gsm_get_mnc(&cgi->lai.plmn));
+			fprintf(outfp, "\t\t\t<open>0</open>\n");
+			prev = NULL;
+		}
+		if (!prev || cgi->lai.lac != prev->lai.lac) {
+			if (prev)
+				kml_folder_close(outfp, 1);
+			/* folder open */
+			fprintf(outfp, "\t\t\t<Folder>\n");
+			fprintf(outfp, "\t\t\t\t<name>LAC %04x</name>\n",
+				cgi->lai.lac);
+			fprintf(outfp, "\t\t\t\t<open>0</open>\n");
+		}
+		prev = cgi;
+
+		fprintf(outfp, "\t\t\t\t<Folder>\n");
+		fprintf(outfp, "\t\t\t\t\t<name>CELL-ID %04x</name>\n",
+			cgi->cell_identity);
+		fprintf(outfp, "\t\t\t\t\t<open>0</open>\n");
+		kml_cell_meas(outfp, cell, zoom);
+		kml_cell(outfp, cell, &pos[c]);
 		/* folder close */
 		fprintf(outfp, "\t\t\t\t</Folder>\n");
-		cell = cell->next;
-	      }
-	      /* folder close */
-	      fprintf(outfp, "\t\t\t</Folder>\n");
-	      lac = lac->next;
-	    }
-	    /* folder close */
-	    fprintf(outfp, "\t\t</Folder>\n");
-	    mnc = mnc->next;
-	  }
-	  /* folder close */
-	  fprintf(outfp, "\t</Folder>\n");
-	  mcc = mcc->next;
 	}
+	if (prev)
+		kml_folder_close(outfp, 3);
 #if 0
 	FIXME: power
 	/* folder open */
 	fprintf(outfp, "\t<Folder>\n");
 	fprintf(outfp, "\t\t<name>Power</name>\n");
 	fprintf(outfp, "\t\t<open>0</open>\n");
-	power = node_power_first;
+	power = db.power_first;
 	n = 0;
 	while (power) {
 		/* folder open */
@@ -665,8 +947,268 @@ usage:
 	fprintf(outfp, "\t</Folder>\n");
 #endif
 	kml_footer(outfp);
+}
+
+/*
+ * GeoJSON output
+ *
+ * All cells, measurements and tiles are point features of one feature
+ * collection. The "kind" property tells them apart.
+ */
+
+static void geojson_feature(FILE *outfp, int *first, double longitude,
+	double latitude, const struct node_cell *cell, const char *kind)
+{
+	const struct osmo_cell_global_id *cgi = &cell->cgi;
+
+	fprintf(outfp, "%s\n{\"type\":\"Feature\",\"geometry\":{"
+		"\"type\":\"Point\",\"coordinates\":[%.8f,%.8f]},"
+		"\"properties\":{\"kind\":\"%s\",\"mcc\":\"%s\","
+		"\"mnc\":\"%s\",\"lac\":%u,\"cell_id\":%u",
+		*first ? "" : ",", longitude, latitude, kind,
+		osmo_mcc_name(cgi->lai.plmn.mcc),
+		osmo_mnc_name(cgi->lai.plmn.mnc, cgi->lai.plmn.mnc_3_digits),
+		cgi->lai.lac, cgi->cell_identity);
+	*first = 0;
+}
+
+static void geojson_map(FILE *outfp, struct log_db *db, struct cell_pos *pos,
+	int zoom)
+{
+	struct node_cell *cell;
+	struct tile *tiles;
+	double longitude, latitude;
+	unsigned int c, m;
+	int first = 1, i, n;
+
+	fprintf(outfp, "{\"type\":\"FeatureCollection\",\"features\":[");
+	for (c = 0; c < db->num_cells; c++) {
+		cell = db->cells[c];
+		/* located while writing, but the debug output is KML only */
+		if (log_debug)
+			cell_position(cell, &pos[c]);
+		if (pos[c].known) {
+			geojson_feature(outfp, &first, pos[c].longitude,
+				pos[c].latitude, cell, "cell");
+			fprintf(outfp, ",\"arfcn\":%u}}", cell->sysinfo.arfcn);
+		}
+
+		if (zoom < 0) {
+			for (m = 0; m < cell->meas_num; m++) {
+				if (!(cell->flags[m] & MEAS_F_GPS))
+					continue;
+				geojson_feature(outfp, &first,
+					cell->longitude[m], cell->latitude[m],
+					cell, "meas");
+				fprintf(outfp, ",\"time\":%lu,\"rxlev\":%d",
+					(unsigned long)cell->gmt[m],
+					cell->rxlev[m]);
+				if ((cell->flags[m] & MEAS_F_TA))
+					fprintf(outfp, ",\"ta\":%u",
+						cell->ta[m]);
+				fprintf(outfp, "}}");
+			}
+			continue;
+		}
+
+		n = tile_aggregate(cell, zoom, &tiles);
+		if (n < 0)
+			nomem();
+		for (i = 0; i < n; i++) {
+			tile_center(tiles[i].x, tiles[i].y, zoom, &longitude,
+				&latitude);
+			geojson_feature(outfp, &first, longitude, latitude,
+				cell, "tile");
+			fprintf(outfp, ",\"tile\":\"%d/%u/%u\",\"count\":%u,"
+				"\"rxlev_median\":%d,\"rxlev_min\":%d,"
+				"\"rxlev_max\":%d}}", zoom, tiles[i].x,
+				tiles[i].y, tiles[i].count,
+				tiles[i].rxlev_median, tiles[i].rxlev_min,
+				tiles[i].rxlev_max);
+		}
+		free(tiles);
+	}
+	fprintf(outfp, "\n]}\n");
+}
+
+static int is_geojson(const char *filename)
+{
+	const char *ext = strrchr(filename, '.');
+
+	return ext && (!strcmp(ext, ".geojson") || !strcmp(ext, ".json"));
+}
+
+/* "map.kml" on zoom level 12 is written to "map-z12.kml" */
+static char *zoom_filename(const char *filename, int zoom)
+{
+	const char *ext = strrchr(filename, '.');
+	char *name;
+	int len;
+
+	if (!ext || strchr(ext, '/'))
+		ext = filename + strlen(filename);
+	len = ext - filename;
+	name = malloc(len + strlen(ext) + 8);
+	if (name)
+		sprintf(name, "%.*s-z%d%s", len, filename, zoom, ext);
+
+	return name;
+}
+
+static int write_map(struct log_db *db, struct cell_pos *pos,
+	const char *filename, int zoom)
+{
+	FILE *outfp;
+	char *buf = NULL;
+	const char *p;
+
+	if (!strcmp(filename, "-"))
+		outfp = stdout;
+	else
+		outfp = fopen(filename, "w");
+	if (!outfp) {
+		fprintf(stderr, "Failed to open '%s' for writing\n", filename);
+		return -EIO;
+	}
+	/* the output consists of many small writes */
+	if (outfp != stdout) {
+		buf = malloc(OUTPUT_BUF_SIZE);
+		if (!buf)
+			nomem();
+		setvbuf(outfp, buf, _IOFBF, OUTPUT_BUF_SIZE);
+	}
+
+	if (is_geojson(filename))
+		geojson_map(outfp, db, pos, zoom);
+	else {
+		/* document name */
+		p = filename;
+		while (strchr(p, '/'))
+			p = strchr(p, '/') + 1;
+		kml_map(outfp, db, pos, p, zoom);
+	}
+
+	if (outfp == stdout)
+		fflush(outfp);
+	else if (fclose(outfp)) {
+		fprintf(stderr, "Failed to write '%s'\n", filename);
+		free(buf);
+		return -EIO;
+	}
+	free(buf);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct log_db db;
+	int i, last, rc, compare = 0;
+	int zoom[TILE_ZOOM_MAX + 1], num_zoom = 0;
+	long num_threads;
+	char *kml, *filename, *p;
+	struct cell_pos *pos;
+
+	log_init(&log_info, NULL);
+	stderr_target = log_target_create_stderr();
+	log_add_target(stderr_target);
+	log_set_all_filter(stderr_target, 1);
+	log_parse_category_mask(stderr_target, "Dxxx");
+	log_set_log_level(stderr_target, LOGL_INFO);
+
+	num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	while ((i = getopt(argc, argv, "+j:cz:h")) != -1) {
+		switch (i) {
+		case 'j':
+			num_threads = atol(optarg);
+			break;
+		case 'c':
+			compare = 1;
+			break;
+		case 'z':
+			for (p = strtok(optarg, ","); p; p = strtok(NULL, ",")) {
+				if (num_zoom > TILE_ZOOM_MAX || atoi(p) < 0
+				 || atoi(p) > TILE_ZOOM_MAX)
+					goto usage;
+				zoom[num_zoom++] = atoi(p);
+			}
+			break;
+		default:
+			goto usage;
+		}
+	}
+
+	/* options at the end, then the KML file after the log files */
+	for (last = argc - 1; last >= optind; last--) {
+		if (!strcmp(argv[last], "lines"))
+			log_lines = 1;
+		else if (!strcmp(argv[last], "debug"))
+			log_debug = 1;
+		else
+			break;
+	}
+
+	if (last - optind < 1) {
+usage:
+		fprintf(stderr, "Usage: %s [-j <threads>] [-c] [-z <zoom>[,...]] "
+			"<file.log|dir> [<file.log|dir> ...] <file.kml> "
+			"[lines] [debug]\n", argv[0]);
+		fprintf(stderr, "-j: Number of threads to read log files "
+			"(default: number of CPUs)\n");
+		fprintf(stderr, "-c: Compare the locator against the former "
+			"circle search\n");
+		fprintf(stderr, "-z: Summarize measurements by map tiles of "
+			"the given zoom levels (0..%d),\n    one output file per "
+			"level, e.g. map-z12.kml\n", TILE_ZOOM_MAX);
+		fprintf(stderr, "The output is GeoJSON, if the file name ends "
+			"with .geojson or .json\n");
+		fprintf(stderr, "lines: Add lines between cell and "
+			"Measurement point\n");
+		fprintf(stderr, "debug: Add debugging of location algorithm.\n"
+			);
+		return 0;
+	}
+	kml = argv[last];
+	if (num_zoom > 1 && !strcmp(kml, "-")) {
+		fprintf(stderr, "Only one zoom level can be written to "
+			"stdout\n");
+		return -EINVAL;
+	}
+
+	for (i = optind; i < last; i++) {
+		if (add_input(argv[i]) < 0)
+			return -EIO;
+	}
+
+	if (log_db_init(&db) < 0)
+		nomem();
+
+	read_logs(&db, num_threads);
+	printf("%lu records of %u cells\n", db.num_records, db.num_cells);
+	log_db_sort(&db);
+	pos = locate_cells(&db, num_threads);
+	if (compare)
+		compare_locators(&db);
+
+	print_cells(&db);
+
+	if (num_zoom == 0)
+		zoom[num_zoom++] = -1;
+	for (i = 0; i < num_zoom; i++) {
+		if (num_zoom > 1)
+			filename = zoom_filename(kml, zoom[i]);
+		else
+			filename = strdup(kml);
+		if (!filename)
+			nomem();
+		rc = write_map(&db, pos, filename, zoom[i]);
+		free(filename);
+		if (rc < 0)
+			return rc;
+	}
 
-	fclose(outfp);
+	free(pos);
+	log_db_free(&db);
 
 	return 0;
 }
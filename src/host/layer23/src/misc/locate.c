@@ -1,4 +1,14 @@
 /* Algorithm to locate a destination by distance measurement:
+ *
+ * The location is the point with the least sum of weighted squared
+ * differences between its distance to each probe and the measured distance.
+ * It is found by Levenberg-Marquardt iteration. Because probes along a road
+ * leave the side of the road ambiguous, the iteration starts at the center
+ * of the probes and at points around the probe of the smallest distance.
+ * The best result is taken.
+ *
+ * The former search on a circle around the nearest probe is kept as
+ * locate_cell_circle(), to compare the results.
  */
 
 #include <stdio.h>
@@ -11,105 +21,279 @@
 #define CIRCLE_PROBE	30.0
 #define FINETUNE_RADIUS	5.0
 
-extern double debug_long, debug_lat, debug_x_scale;
-extern FILE *debug_fp;
-extern int log_debug;
+#define LSQ_STARTS	8	/* start points around the nearest probe */
+#define LSQ_ITER	50
+#define LSQ_EPS		0.01	/* meters, stop iteration */
 
-static double finetune_x[6], finetune_y[6], finetune_dist[6];
+/* debug output goes to debug_fp, if set. Both are thread local, so only
+ * the thread that writes the debug output sees them. */
+extern __thread double debug_long, debug_lat, debug_x_scale;
+extern __thread FILE *debug_fp;
 
-int locate_cell(struct probe *probe_first, double *min_x, double *min_y)
+static void debug_open(void)
 {
-	struct probe *probe, *min_probe;
-	int i, test_steps, optimized;
-	double min_dist, dist, x, y, rad, temp;
-	double circle_probe, finetune_radius;
+	fprintf(debug_fp, "<Folder>\n");
+	fprintf(debug_fp, "\t<name>Debug Locator</name>\n");
+	fprintf(debug_fp, "\t<open>0</open>\n");
+	fprintf(debug_fp, "\t<visibility>0</visibility>\n");
+}
 
-	/* convert meters into degrees */
-	circle_probe = CIRCLE_PROBE / (EQUATOR_RADIUS * PI / 180.0);
-	finetune_radius = FINETUNE_RADIUS / (EQUATOR_RADIUS * PI / 180.0);
+static void debug_line_open(const char *name)
+{
+	fprintf(debug_fp, "\t<Placemark>\n");
+	fprintf(debug_fp, "\t\t<name>%s</name>\n", name);
+	fprintf(debug_fp, "\t\t<visibility>0</visibility>\n");
+	fprintf(debug_fp, "\t\t<LineString>\n");
+	fprintf(debug_fp, "\t\t\t<tessellate>1</tessellate>\n");
+	fprintf(debug_fp, "\t\t\t<coordinates>\n");
+}
+
+static void debug_point(double x, double y)
+{
+	fprintf(debug_fp, "%.8f,%.8f\n", debug_long + x * debug_x_scale,
+		debug_lat + y);
+}
 
-	if (log_debug) {
-		fprintf(debug_fp, "<Folder>\n");
-		fprintf(debug_fp, "\t<name>Debug Locator</name>\n");
-		fprintf(debug_fp, "\t<open>0</open>\n");
-		fprintf(debug_fp, "\t<visibility>0</visibility>\n");
+static void debug_line_close(void)
+{
+	fprintf(debug_fp, "\t\t\t</coordinates>\n");
+	fprintf(debug_fp, "\t\t</LineString>\n");
+	fprintf(debug_fp, "\t</Placemark>\n");
+}
+
+/* draw the circle of each measurement */
+static void debug_probes(const struct probe_set *ps)
+{
+	double rad = 2.0 * 3.1415927 / 35;
+	unsigned int i;
+	int j;
+
+	for (i = 0; i < ps->num; i++) {
+		debug_line_open("MEAS");
+		for (j = 0; j < 35; j++)
+			debug_point(ps->x[i] + ps->dist[i] * sin(rad * j),
+				ps->y[i] + ps->dist[i] * cos(rad * j));
+		debug_line_close();
 	}
+}
 
-	/* get probe of minimum distance */
-	min_probe = NULL;
-	probe = probe_first;
-	min_dist = 42;
-	i = 0;
-	while (probe) {
-		if (log_debug) {
-			fprintf(debug_fp, "\t<Placemark>\n");
-			fprintf(debug_fp, "\t\t<name>MEAS</name>\n");
-			fprintf(debug_fp, "\t\t<visibility>0</visibility>\n");
-			fprintf(debug_fp, "\t\t<LineString>\n");
-			fprintf(debug_fp, "\t\t\t<tessellate>1</tessellate>\n");
-			fprintf(debug_fp, "\t\t\t<coordinates>\n");
-			rad = 2.0 * 3.1415927 / 35;
-			for (i = 0; i < 35; i++) {
-				x = probe->x + probe->dist * sin(rad * i);
-				y = probe->y + probe->dist * cos(rad * i);
-				fprintf(debug_fp, "%.8f,%.8f\n", debug_long +
-					x * debug_x_scale, debug_lat + y);
-			}
-			fprintf(debug_fp, "\t\t\t</coordinates>\n");
-			fprintf(debug_fp, "\t\t</LineString>\n");
-			fprintf(debug_fp, "\t</Placemark>\n");
+static unsigned int nearest_probe(const struct probe_set *ps)
+{
+	unsigned int i, min = 0;
+
+	for (i = 1; i < ps->num; i++) {
+		if (ps->dist[i] < ps->dist[min])
+			min = i;
+	}
+
+	return min;
+}
+
+/* weighted sum of squared differences to the measured distances */
+static double lsq_cost(const struct probe_set *ps, double x, double y)
+{
+	const double *px = ps->x, *py = ps->y, *pd = ps->dist, *pw = ps->weight;
+	double cost = 0, dx, dy, r;
+	unsigned int i, num = ps->num;
+
+	for (i = 0; i < num; i++) {
+		dx = x - px[i];
+		dy = y - py[i];
+		r = sqrt(dx * dx + dy * dy) - pd[i];
+		cost += pw[i] * r * r;
+	}
+
+	return cost;
+}
+
+/* Levenberg-Marquardt iteration from (x, y), return the cost at the end */
+static double lsq_solve(const struct probe_set *ps, double *x, double *y,
+	int debug)
+{
+	const double *px = ps->x, *py = ps->y, *pd = ps->dist, *pw = ps->weight;
+	unsigned int i, num = ps->num;
+	double eps = LSQ_EPS / (EQUATOR_RADIUS * PI / 180.0);
+	double a11, a12, a22, g1, g2, b11, b22, det, sx, sy;
+	double dx, dy, d, r, jx, jy, cost, new_cost, lambda = 1e-3;
+	int iter;
+
+	cost = lsq_cost(ps, *x, *y);
+	for (iter = 0; iter < LSQ_ITER; iter++) {
+		if (debug)
+			debug_point(*x, *y);
+
+		/* normal equations of the linearized problem */
+		a11 = a12 = a22 = g1 = g2 = 0;
+		for (i = 0; i < num; i++) {
+			dx = *x - px[i];
+			dy = *y - py[i];
+			/* avoid division by zero on top of a probe */
+			d = sqrt(dx * dx + dy * dy) + 1e-12;
+			jx = dx / d;
+			jy = dy / d;
+			r = d - pd[i];
+			a11 += pw[i] * jx * jx;
+			a12 += pw[i] * jx * jy;
+			a22 += pw[i] * jy * jy;
+			g1 += pw[i] * jx * r;
+			g2 += pw[i] * jy * r;
 		}
 
-		if (!min_probe || probe->dist < min_dist) {
-			min_probe = probe;
-			min_dist = probe->dist;
+		/* increase damping until the step reduces the cost */
+		while (1) {
+			b11 = a11 * (1.0 + lambda) + 1e-12;
+			b22 = a22 * (1.0 + lambda) + 1e-12;
+			det = b11 * b22 - a12 * a12;
+			sx = -(b22 * g1 - a12 * g2) / det;
+			sy = -(b11 * g2 - a12 * g1) / det;
+			new_cost = lsq_cost(ps, *x + sx, *y + sy);
+			if (new_cost < cost)
+				break;
+			lambda *= 10.0;
+			if (lambda > 1e10)
+				return cost;
 		}
-		probe = probe->next;
-		i++;
+		*x += sx;
+		*y += sy;
+		cost = new_cost;
+		lambda *= 0.1;
+
+		if (sx * sx + sy * sy < eps * eps)
+			break;
 	}
 
-	if (i < 3) {
+	return cost;
+}
+
+int locate_cell(const struct probe_set *ps, double *min_x, double *min_y)
+{
+	unsigned int i, near;
+	double x, y, cost, min_cost, sum_w = 0, rad;
+	double start_x[LSQ_STARTS + 1], start_y[LSQ_STARTS + 1];
+	int best = 0;
+
+	if (ps->num < 3) {
 		fprintf(stderr, "Need at least 3 points\n");
 		return -EINVAL;
 	}
 
+	/* center of the probes */
+	start_x[0] = start_y[0] = 0;
+	for (i = 0; i < ps->num; i++) {
+		start_x[0] += ps->weight[i] * ps->x[i];
+		start_y[0] += ps->weight[i] * ps->y[i];
+		sum_w += ps->weight[i];
+	}
+	start_x[0] /= sum_w;
+	start_y[0] /= sum_w;
+
+	/* points on the circle of the nearest probe */
+	near = nearest_probe(ps);
+	rad = 2.0 * 3.1415927 / LSQ_STARTS;
+	for (i = 0; i < LSQ_STARTS; i++) {
+		start_x[i + 1] = ps->x[near] + ps->dist[near] * sin(rad * i);
+		start_y[i + 1] = ps->y[near] + ps->dist[near] * cos(rad * i);
+	}
+
+	min_cost = 0;
+	for (i = 0; i <= LSQ_STARTS; i++) {
+		x = start_x[i];
+		y = start_y[i];
+		cost = lsq_solve(ps, &x, &y, 0);
+		if (i == 0 || cost < min_cost) {
+			min_cost = cost;
+			*min_x = x;
+			*min_y = y;
+			best = i;
+		}
+	}
+
+	if (debug_fp) {
+		debug_open();
+		debug_probes(ps);
+		/* the way of the iteration that gave the result */
+		debug_line_open("Least squares");
+		x = start_x[best];
+		y = start_y[best];
+		lsq_solve(ps, &x, &y, 1);
+		debug_point(x, y);
+		debug_line_close();
+		fprintf(debug_fp, "</Folder>\n");
+	}
+
+	return 0;
+}
+
+/* root mean square of the differences to the measured distances in meters */
+double locate_rms(const struct probe_set *ps, double x, double y)
+{
+	double sum = 0, r;
+	unsigned int i;
+
+	if (!ps->num)
+		return 0;
+	for (i = 0; i < ps->num; i++) {
+		r = distonplane(ps->x[i], ps->y[i], x, y) - ps->dist[i];
+		sum += r * r;
+	}
+
+	return sqrt(sum / ps->num) * (EQUATOR_RADIUS * PI / 180.0);
+}
+
+int locate_cell_circle(const struct probe_set *ps, double *min_x,
+	double *min_y)
+{
+	unsigned int i, j, min_probe;
+	int test_steps, optimized;
+	double min_dist, dist, x, y, rad, temp;
+	double finetune_x[6], finetune_y[6], finetune_dist[6];
+	double circle_probe, finetune_radius;
+
+	/* convert meters into degrees */
+	circle_probe = CIRCLE_PROBE / (EQUATOR_RADIUS * PI / 180.0);
+	finetune_radius = FINETUNE_RADIUS / (EQUATOR_RADIUS * PI / 180.0);
+
+	if (ps->num < 3) {
+		fprintf(stderr, "Need at least 3 points\n");
+		return -EINVAL;
+	}
+
+	if (debug_fp) {
+		debug_open();
+		debug_probes(ps);
+	}
+
+	/* get probe of minimum distance */
+	min_probe = nearest_probe(ps);
+
 	/* calculate the number of steps to search for destination point */
-	test_steps = 2.0 * 3.1415927 * min_probe->dist / circle_probe;
+	test_steps = 2.0 * 3.1415927 * ps->dist[min_probe] / circle_probe;
 	rad = 2.0 * 3.1415927 / test_steps;
 
-	if (log_debug) {
-		fprintf(debug_fp, "\t<Placemark>\n");
-		fprintf(debug_fp, "\t\t<name>Smallest MEAS</name>\n");
-		fprintf(debug_fp, "\t\t<visibility>0</visibility>\n");
-		fprintf(debug_fp, "\t\t<LineString>\n");
-		fprintf(debug_fp, "\t\t\t<tessellate>1</tessellate>\n");
-		fprintf(debug_fp, "\t\t\t<coordinates>\n");
-	}
+	if (debug_fp)
+		debug_line_open("Smallest MEAS");
 
 	/* search on a circle for the location of the lowest distance
 	 * to the radius with the greatest distance */
 	min_dist = 42;
 	*min_x = *min_y = 42;
 	for (i = 0; i < test_steps; i++) {
-		x = min_probe->x + min_probe->dist * sin(rad * i);
-		y = min_probe->y + min_probe->dist * cos(rad * i);
-		if (log_debug)
-			fprintf(debug_fp, "%.8f,%.8f\n", debug_long +
-				x * debug_x_scale, debug_lat + y);
+		x = ps->x[min_probe] + ps->dist[min_probe] * sin(rad * i);
+		y = ps->y[min_probe] + ps->dist[min_probe] * cos(rad * i);
+		if (debug_fp)
+			debug_point(x, y);
 		/* look for greatest distance */
 		dist = 0;
-		probe = probe_first;
-		while (probe) {
-			if (probe != min_probe) {
-				/* distance to the radius */
-				temp = distonplane(probe->x, probe->y, x, y);
-				temp -= probe->dist;
-				if (temp < 0)
-					temp = -temp;
-				if (temp > dist)
-					dist = temp;
-			}
-			probe = probe->next;
+		for (j = 0; j < ps->num; j++) {
+			if (j == min_probe)
+				continue;
+			/* distance to the radius */
+			temp = distonplane(ps->x[j], ps->y[j], x, y);
+			temp -= ps->dist[j];
+			if (temp < 0)
+				temp = -temp;
+			if (temp > dist)
+				dist = temp;
 		}
 		if (i == 0 || dist < min_dist) {
 			min_dist = dist;
@@ -118,24 +302,15 @@ int locate_cell(struct probe *probe_first, double *min_x, double *min_y)
 		}
 	}
 
-	if (log_debug) {
-		fprintf(debug_fp, "\t\t\t</coordinates>\n");
-		fprintf(debug_fp, "\t\t</LineString>\n");
-		fprintf(debug_fp, "\t</Placemark>\n");
-
-		fprintf(debug_fp, "\t<Placemark>\n");
-		fprintf(debug_fp, "\t\t<name>Finetune</name>\n");
-		fprintf(debug_fp, "\t\t<visibility>0</visibility>\n");
-		fprintf(debug_fp, "\t\t<LineString>\n");
-		fprintf(debug_fp, "\t\t\t<tessellate>1</tessellate>\n");
-		fprintf(debug_fp, "\t\t\t<coordinates>\n");
+	if (debug_fp) {
+		debug_line_close();
+		debug_line_open("Finetune");
 	}
 
 	min_dist = 9999999999.0;
 tune_again:
-	if (log_debug)
-		fprintf(debug_fp, "%.8f,%.8f\n", debug_long +
-			*min_x * debug_x_scale, debug_lat + *min_y);
+	if (debug_fp)
+		debug_point(*min_x, *min_y);
 
 	/* finetune the point */
 	rad = 2.0 * 3.1415927 / 6;
@@ -144,15 +319,13 @@ tune_again:
 		y = *min_y + finetune_radius * cos(rad * i);
 		/* search for the point with the lowest sum of distances */
 		dist = 0;
-		probe = probe_first;
-		while (probe) {
+		for (j = 0; j < ps->num; j++) {
 			/* distance to the radius */
-			temp = distonplane(probe->x, probe->y, x, y);
-			temp -= probe->dist;
+			temp = distonplane(ps->x[j], ps->y[j], x, y);
+			temp -= ps->dist[j];
 			if (temp < 0)
 				temp = -temp;
 			dist += temp;
-			probe = probe->next;
 		}
 		finetune_dist[i] = dist;
 		finetune_x[i] = x;
@@ -171,10 +344,8 @@ tune_again:
 	if (optimized)
 		goto tune_again;
 
-	if (log_debug) {
-		fprintf(debug_fp, "\t\t\t</coordinates>\n");
-		fprintf(debug_fp, "\t\t</LineString>\n");
-		fprintf(debug_fp, "\t</Placemark>\n");
+	if (debug_fp) {
+		debug_line_close();
 		fprintf(debug_fp, "</Folder>\n");
 	}
 
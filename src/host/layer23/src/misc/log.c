@@ -18,150 +18,435 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm48.h>
 
 #include <osmocom/bb/common/osmocom_data.h>
 #include <osmocom/bb/misc/log.h>
+#include <osmocom/bb/misc/binlog.h>
 
-extern struct power power;
-extern struct sysinfo sysinfo;
-extern struct node_power *node_power_first;
-extern struct node_power **node_power_last_p;
-extern struct node_mcc *node_mcc_first;
+/*
+ * arena
+ *
+ * Cells and measurement columns are never freed individually, so they are
+ * taken from large chunks that are released together with the database.
+ */
+
+#define ARENA_CHUNK	(1024 * 1024)
 
-struct node_mcc *get_node_mcc(uint16_t mcc)
+struct log_arena {
+	struct log_arena *next;
+	size_t used, size;
+	char data[0] __attribute__((aligned(16)));
+};
+
+static void *arena_alloc(struct log_db *db, size_t size)
 {
-	struct node_mcc *node_mcc;
-	struct node_mcc **node_mcc_p = &node_mcc_first;
+	struct log_arena *chunk = db->arena;
+	void *p;
+
+	size = (size + 15) & ~(size_t)15;
+	if (!chunk || chunk->used + size > chunk->size) {
+		size_t chunk_size = OSMO_MAX(size, (size_t)ARENA_CHUNK);
+
+		chunk = malloc(sizeof(*chunk) + chunk_size);
+		if (!chunk)
+			return NULL;
+		chunk->used = 0;
+		chunk->size = chunk_size;
+		/* a huge allocation must not waste the current chunk */
+		if (db->arena && size >= ARENA_CHUNK) {
+			chunk->next = db->arena->next;
+			db->arena->next = chunk;
+		} else {
+			chunk->next = db->arena;
+			db->arena = chunk;
+		}
+	}
+	p = chunk->data + chunk->used;
+	chunk->used += size;
+	memset(p, 0, size);
 
-//printf("add mcc %d\n", mcc);
-	while (*node_mcc_p) {
-		/* found in list */
-		if ((*node_mcc_p)->mcc == mcc)
-			return *node_mcc_p;
-		/* insert into list */
-		if ((*node_mcc_p)->mcc > mcc)
-			break;
-		node_mcc_p = &((*node_mcc_p)->next);
+	return p;
+}
+
+/*
+ * cell database
+ */
+
+int log_db_init(struct log_db *db)
+{
+	memset(db, 0, sizeof(*db));
+	db->power_last_p = &db->power_first;
+	db->hash_size = 1024;
+	db->hash = calloc(db->hash_size, sizeof(*db->hash));
+	if (!db->hash)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void log_db_free(struct log_db *db)
+{
+	struct log_arena *chunk;
+
+	while ((chunk = db->arena)) {
+		db->arena = chunk->next;
+		free(chunk);
 	}
+	free(db->hash);
+	free(db->cells);
+	memset(db, 0, sizeof(*db));
+}
 
-//printf("new mcc %d\n", mcc);
-	/* append or insert to list */
-	node_mcc = calloc(1, sizeof(struct node_mcc));
-	if (!node_mcc)
-		return NULL;
-	node_mcc->mcc = mcc;
-	node_mcc->next = *node_mcc_p;
-	*node_mcc_p = node_mcc;
-	return node_mcc;
-}
-
-struct node_mnc *get_node_mnc(struct node_mcc *mcc, uint16_t mnc, bool mnc_3_digits)
-{
-	struct node_mnc *node_mnc;
-	struct node_mnc **node_mnc_p = &mcc->mnc;
-
-	while (*node_mnc_p) {
-		/* found in list */
-		if ((*node_mnc_p)->mnc == mnc &&
-		    (*node_mnc_p)->mnc_3_digits == mnc_3_digits)
-			return *node_mnc_p;
-		/* insert into list */
-		if (((*node_mnc_p)->mnc > mnc) ||
-		    ((*node_mnc_p)->mnc == mnc &&
-		     (*node_mnc_p)->mnc_3_digits > mnc_3_digits)) {
-			break;
-		}
-		node_mnc_p = &((*node_mnc_p)->next);
+static uint32_t cgi_hash(const struct osmo_cell_global_id *cgi)
+{
+	uint64_t key;
+
+	key = ((uint64_t)cgi->lai.plmn.mcc << 48)
+	    | ((uint64_t)cgi->lai.plmn.mnc << 36)
+	    | ((uint64_t)cgi->lai.plmn.mnc_3_digits << 35)
+	    | ((uint64_t)cgi->lai.lac << 16)
+	    | cgi->cell_identity;
+
+	return (key * 0x9e3779b97f4a7c15ULL) >> 32;
+}
+
+static bool cgi_equal(const struct osmo_cell_global_id *a,
+		      const struct osmo_cell_global_id *b)
+{
+	return a->cell_identity == b->cell_identity
+	    && a->lai.lac == b->lai.lac
+	    && a->lai.plmn.mcc == b->lai.plmn.mcc
+	    && a->lai.plmn.mnc == b->lai.plmn.mnc
+	    && a->lai.plmn.mnc_3_digits == b->lai.plmn.mnc_3_digits;
+}
+
+static void hash_insert(struct node_cell **hash, unsigned int size,
+			struct node_cell *cell)
+{
+	unsigned int i = cgi_hash(&cell->cgi) & (size - 1);
+
+	while (hash[i])
+		i = (i + 1) & (size - 1);
+	hash[i] = cell;
+}
+
+/* keep load factor of the index below 1/2 */
+static int hash_grow(struct log_db *db)
+{
+	struct node_cell **hash;
+	unsigned int size = db->hash_size * 2, i;
+
+	hash = calloc(size, sizeof(*hash));
+	if (!hash)
+		return -ENOMEM;
+	for (i = 0; i < db->num_cells; i++)
+		hash_insert(hash, size, db->cells[i]);
+	free(db->hash);
+	db->hash = hash;
+	db->hash_size = size;
+
+	return 0;
+}
+
+static struct node_cell *hash_lookup(struct log_db *db,
+	const struct osmo_cell_global_id *cgi)
+{
+	struct node_cell *cell;
+	unsigned int i;
+
+	i = cgi_hash(cgi) & (db->hash_size - 1);
+	while ((cell = db->hash[i])) {
+		if (cgi_equal(&cell->cgi, cgi))
+			return cell;
+		i = (i + 1) & (db->hash_size - 1);
 	}
 
-	/* append or insert to list */
-	node_mnc = calloc(1, sizeof(struct node_mnc));
-	if (!node_mnc)
+	return NULL;
+}
+
+/* add cell to list and index, it must not exist yet */
+static int db_insert_cell(struct log_db *db, struct node_cell *cell)
+{
+	if (db->num_cells == db->cells_size) {
+		unsigned int size = db->cells_size ? db->cells_size * 2 : 1024;
+		struct node_cell **cells;
+
+		cells = realloc(db->cells, size * sizeof(*cells));
+		if (!cells)
+			return -ENOMEM;
+		db->cells = cells;
+		db->cells_size = size;
+	}
+	if ((db->num_cells + 1) * 2 > db->hash_size) {
+		if (hash_grow(db) < 0)
+			return -ENOMEM;
+	}
+
+	db->cells[db->num_cells++] = cell;
+	hash_insert(db->hash, db->hash_size, cell);
+
+	return 0;
+}
+
+/* find cell, create it from the given record, if it does not exist */
+struct node_cell *log_db_get_cell(struct log_db *db,
+	const struct osmo_cell_global_id *cgi, const struct sysinfo *si)
+{
+	struct node_cell *cell;
+
+	cell = hash_lookup(db, cgi);
+	if (cell)
+		return cell;
+
+	cell = arena_alloc(db, sizeof(*cell));
+	if (!cell)
+		return NULL;
+	memcpy(&cell->cgi, cgi, sizeof(cell->cgi));
+	memcpy(&cell->sysinfo, si, sizeof(cell->sysinfo));
+	if (db_insert_cell(db, cell) < 0)
 		return NULL;
-	node_mnc->mnc = mnc;
-	node_mnc->mnc_3_digits = mnc_3_digits;
-	node_mnc->next = *node_mnc_p;
-	*node_mnc_p = node_mnc;
-	return node_mnc;
+
+	return cell;
 }
 
-struct node_lac *get_node_lac(struct node_mnc *mnc, uint16_t lac)
+/* make room for more measurements, old columns stay in the arena */
+static int meas_grow(struct log_db *db, struct node_cell *cell,
+		     unsigned int min_size)
 {
-	struct node_lac *node_lac;
-	struct node_lac **node_lac_p = &mnc->lac;
+	unsigned int size = cell->meas_size ? cell->meas_size * 2 : 4;
+	unsigned int num = cell->meas_num;
+	char *p;
 
-	while (*node_lac_p) {
-		/* found in list */
-		if ((*node_lac_p)->lac == lac)
-			return *node_lac_p;
-		/* insert into list */
-		if ((*node_lac_p)->lac > lac)
-			break;
-		node_lac_p = &((*node_lac_p)->next);
+	while (size < min_size)
+		size *= 2;
+
+	p = arena_alloc(db, size * (sizeof(*cell->gmt)
+		+ sizeof(*cell->longitude) + sizeof(*cell->latitude)
+		+ sizeof(*cell->rxlev) + sizeof(*cell->ta)
+		+ sizeof(*cell->flags)));
+	if (!p)
+		return -ENOMEM;
+
+#define MOVE_COLUMN(col) \
+	do { \
+		if (num) \
+			memcpy(p, cell->col, num * sizeof(*cell->col)); \
+		cell->col = (void *)p; \
+		p += size * sizeof(*cell->col); \
+	} while (0)
+	/* largest alignment first */
+	MOVE_COLUMN(gmt);
+	MOVE_COLUMN(longitude);
+	MOVE_COLUMN(latitude);
+	MOVE_COLUMN(rxlev);
+	MOVE_COLUMN(ta);
+	MOVE_COLUMN(flags);
+#undef MOVE_COLUMN
+	cell->meas_size = size;
+
+	return 0;
+}
+
+int log_db_add_meas(struct log_db *db, struct node_cell *cell,
+	const struct sysinfo *si)
+{
+	unsigned int i;
+
+	if (cell->meas_num == cell->meas_size) {
+		if (meas_grow(db, cell, cell->meas_num + 1) < 0)
+			return -ENOMEM;
 	}
 
-	/* append or insert to list */
-	node_lac = calloc(1, sizeof(struct node_lac));
-	if (!node_lac)
-		return NULL;
-	node_lac->lac = lac;
-	node_lac->next = *node_lac_p;
-	*node_lac_p = node_lac;
-	return node_lac;
+	i = cell->meas_num++;
+	cell->gmt[i] = si->gmt;
+	cell->rxlev[i] = si->rxlev;
+	cell->flags[i] = 0;
+	if (si->ta_valid) {
+		cell->flags[i] |= MEAS_F_TA;
+		cell->ta[i] = si->ta;
+	}
+	if (si->gps_valid) {
+		cell->flags[i] |= MEAS_F_GPS;
+		cell->longitude[i] = si->longitude;
+		cell->latitude[i] = si->latitude;
+	}
+
+	return 0;
 }
 
-struct node_cell *get_node_cell(struct node_lac *lac, uint16_t cellid)
+/* get CGI from the raw SI 3, or LAI from SI 4 if SI 3 is missing */
+static void sysinfo_cgi(const struct sysinfo *si,
+			struct osmo_cell_global_id *cgi)
 {
-	struct node_cell *node_cell;
-	struct node_cell **node_cell_p = &lac->cell;
+	memset(cgi, 0, sizeof(*cgi));
+	if (si->si3[2]) {
+		const struct gsm48_system_information_type_3 *si3 =
+			(const void *)si->si3;
+
+		cgi->cell_identity = ntohs(si3->cell_identity);
+		gsm48_decode_lai2(&si3->lai, &cgi->lai);
+	} else if (si->si4[2]) {
+		const struct gsm48_system_information_type_4 *si4 =
+			(const void *)si->si4;
+
+		gsm48_decode_lai2(&si4->lai, &cgi->lai);
+	}
+}
 
-	while (*node_cell_p) {
-		/* found in list */
-		if ((*node_cell_p)->cellid == cellid)
-			return *node_cell_p;
-		/* insert into list */
-		if ((*node_cell_p)->cellid > cellid)
-			break;
-		node_cell_p = &((*node_cell_p)->next);
+static void check_changed(struct node_cell *cell, const struct sysinfo *si)
+{
+	if (!cell->changed
+	 && (memcmp(cell->sysinfo.si1, si->si1, sizeof(si->si1))
+	  || memcmp(cell->sysinfo.si2, si->si2, sizeof(si->si2))
+	  || memcmp(cell->sysinfo.si2bis, si->si2bis, sizeof(si->si2bis))
+	  || memcmp(cell->sysinfo.si2ter, si->si2ter, sizeof(si->si2ter))
+	  || memcmp(cell->sysinfo.si3, si->si3, sizeof(si->si3))
+	  || memcmp(cell->sysinfo.si4, si->si4, sizeof(si->si4)))) {
+		fprintf(stderr, "FIXME: the cell changed sysinfo\n");
+		cell->changed = 1;
 	}
+}
 
-	/* append or insert to list */
-	node_cell = calloc(1, sizeof(struct node_cell));
-	if (!node_cell)
-		return NULL;
-	node_cell->meas_last_p = &node_cell->meas;
-	node_cell->cellid = cellid;
-	node_cell->next = *node_cell_p;
-	*node_cell_p = node_cell;
-	return node_cell;
+int log_db_add_sysinfo(struct log_db *db, const struct sysinfo *si)
+{
+	struct osmo_cell_global_id cgi;
+	struct node_cell *cell;
+
+	db->num_records++;
+	sysinfo_cgi(si, &cgi);
+	cell = log_db_get_cell(db, &cgi, si);
+	if (!cell)
+		return -ENOMEM;
+	if (log_db_add_meas(db, cell, si) < 0)
+		return -ENOMEM;
+
+	check_changed(cell, si);
+
+	return 0;
 }
 
-struct node_meas *add_node_meas(struct node_cell *cell)
+int log_db_add_power(struct log_db *db, const struct power *power)
 {
-	struct node_meas *node_meas;
+	struct node_power *node_power;
 
-	/* append to list */
-	node_meas = calloc(1, sizeof(struct node_meas));
-	if (!node_meas)
-		return NULL;
-	node_meas->gmt = sysinfo.gmt;
-	node_meas->rxlev = sysinfo.rxlev;
-	if (sysinfo.ta_valid) {
-		node_meas->ta_valid = 1;
-		node_meas->ta = sysinfo.ta;
+	node_power = arena_alloc(db, sizeof(*node_power));
+	if (!node_power)
+		return -ENOMEM;
+	memcpy(&node_power->power, power, sizeof(*power));
+	*db->power_last_p = node_power;
+	db->power_last_p = &node_power->next;
+
+	return 0;
+}
+
+/* Move all cells, measurements and power records of 'from' into 'db'. The
+ * memory of 'from' is taken over, so cells that are new to 'db' are not
+ * copied. 'from' is empty afterwards. */
+int log_db_merge(struct log_db *db, struct log_db *from)
+{
+	struct log_arena *chunk;
+	struct node_cell *cell, *to;
+	unsigned int i, num;
+	int rc = 0;
+
+	/* take over the arena, keep the current chunk of 'db' in front */
+	while ((chunk = from->arena)) {
+		from->arena = chunk->next;
+		if (db->arena) {
+			chunk->next = db->arena->next;
+			db->arena->next = chunk;
+		} else {
+			chunk->next = NULL;
+			db->arena = chunk;
+		}
+	}
+
+	for (i = 0; i < from->num_cells; i++) {
+		cell = from->cells[i];
+		to = hash_lookup(db, &cell->cgi);
+		if (!to) {
+			rc = db_insert_cell(db, cell);
+			if (rc < 0)
+				break;
+			continue;
+		}
+		check_changed(to, &cell->sysinfo);
+		if (cell->changed)
+			to->changed = 1;
+		num = cell->meas_num;
+		if (to->meas_num + num > to->meas_size) {
+			rc = meas_grow(db, to, to->meas_num + num);
+			if (rc < 0)
+				break;
+		}
+		memcpy(to->gmt + to->meas_num, cell->gmt, num * sizeof(*to->gmt));
+		memcpy(to->longitude + to->meas_num, cell->longitude,
+			num * sizeof(*to->longitude));
+		memcpy(to->latitude + to->meas_num, cell->latitude,
+			num * sizeof(*to->latitude));
+		memcpy(to->rxlev + to->meas_num, cell->rxlev,
+			num * sizeof(*to->rxlev));
+		memcpy(to->ta + to->meas_num, cell->ta, num * sizeof(*to->ta));
+		memcpy(to->flags + to->meas_num, cell->flags,
+			num * sizeof(*to->flags));
+		to->meas_num += num;
 	}
-	if (sysinfo.gps_valid) {
-		node_meas->gps_valid = 1;
-		node_meas->longitude = sysinfo.longitude;
-		node_meas->latitude = sysinfo.latitude;
+
+	if (from->power_first) {
+		*db->power_last_p = from->power_first;
+		db->power_last_p = from->power_last_p;
 	}
-	*cell->meas_last_p = node_meas;
-	cell->meas_last_p = &node_meas->next;
-	return node_meas;
+	db->num_records += from->num_records;
+
+	free(from->hash);
+	free(from->cells);
+	memset(from, 0, sizeof(*from));
+
+	return rc;
+}
+
+static int cell_cmp(const void *a, const void *b)
+{
+	const struct osmo_cell_global_id *x = &(*(struct node_cell **)a)->cgi;
+	const struct osmo_cell_global_id *y = &(*(struct node_cell **)b)->cgi;
+
+	if (x->lai.plmn.mcc != y->lai.plmn.mcc)
+		return x->lai.plmn.mcc < y->lai.plmn.mcc ? -1 : 1;
+	if (x->lai.plmn.mnc != y->lai.plmn.mnc)
+		return x->lai.plmn.mnc < y->lai.plmn.mnc ? -1 : 1;
+	if (x->lai.plmn.mnc_3_digits != y->lai.plmn.mnc_3_digits)
+		return x->lai.plmn.mnc_3_digits < y->lai.plmn.mnc_3_digits ? -1 : 1;
+	if (x->lai.lac != y->lai.lac)
+		return x->lai.lac < y->lai.lac ? -1 : 1;
+	if (x->cell_identity != y->cell_identity)
+		return x->cell_identity < y->cell_identity ? -1 : 1;
+	return 0;
 }
 
+/* sort cells by MCC, MNC, LAC and cell ID, the index stays valid */
+void log_db_sort(struct log_db *db)
+{
+	if (db->num_cells)
+		qsort(db->cells, db->num_cells, sizeof(*db->cells), cell_cmp);
+}
+
+/*
+ * parser
+ */
+
 /* read "<ncc>,<bcc>" */
-static void read_log_bsic(char *buffer)
+static void read_log_bsic(char *buffer, struct sysinfo *sysinfo)
 {
 	char *p;
 	uint8_t bsic;
@@ -183,7 +468,7 @@ static void read_log_bsic(char *buffer)
 	/* read latitude */
 	bsic |= atoi(buffer);
 
-	sysinfo.bsic = bsic;
+	sysinfo->bsic = bsic;
 }
 
 /* read "<longitude> <latitude>" */
@@ -217,7 +502,7 @@ static void read_log_pos(char *buffer, double *longitude, double *latitude,
 }
 
 /* read "<arfcn> <value> <next value> ...." */
-static void read_log_power(char *buffer)
+static void read_log_power(char *buffer, struct power *power)
 {
 	char *p;
 	int arfcn;
@@ -249,11 +534,11 @@ static void read_log_power(char *buffer)
 			p++;
 		/* last value */
 		if (*p == '\0') {
-			power.rxlev[arfcn] = atoi(buffer);
+			power->rxlev[arfcn] = atoi(buffer);
 			break;
 		}
 		*p++ = '\0';
-		power.rxlev[arfcn] = atoi(buffer);
+		power->rxlev[arfcn] = atoi(buffer);
 		arfcn++;
 		buffer = p;
 	}
@@ -295,83 +580,262 @@ static void read_log_si(char *buffer, uint8_t *data)
 		memcpy(data, si, 23);
 }
 
-/* read next record from log file */
-int read_log(FILE *infp)
+struct log_parser {
+	const struct log_handler *h;
+	void *priv;
+	int type;
+	struct sysinfo sysinfo;
+	struct power power;
+};
+
+static void parser_reset(struct log_parser *lp, int type)
 {
-	static int type = LOG_TYPE_NONE, ret;
-	char buffer[256];
+	lp->type = type;
+	switch (type) {
+	case LOG_TYPE_SYSINFO:
+		memset(&lp->sysinfo, 0, sizeof(lp->sysinfo));
+		break;
+	case LOG_TYPE_POWER:
+		memset(&lp->power, 0, sizeof(lp->power));
+		memset(&lp->power.rxlev, -128, sizeof(lp->power.rxlev));
+		break;
+	}
+}
 
-	memset(&sysinfo, 0, sizeof(sysinfo));
-	memset(&power, 0, sizeof(power));
-	memset(&power.rxlev, -128, sizeof(power.rxlev));
-
-	if (feof(infp))
-		return LOG_TYPE_NONE;
-
-	while (fgets(buffer, sizeof(buffer), infp)) {
-		buffer[sizeof(buffer) - 1] = 0;
-		if (buffer[0])
-			buffer[strlen(buffer) - 1] = '\0';
-		if (buffer[0] == '[') {
-			if (!strcmp(buffer, "[sysinfo]")) {
-				ret = type;
-				type = LOG_TYPE_SYSINFO;
-				if (ret != LOG_TYPE_NONE)
-					return ret;
-			} else
-			if (!strcmp(buffer, "[power]")) {
-				ret = type;
-				type = LOG_TYPE_POWER;
-				if (ret != LOG_TYPE_NONE)
-					return ret;
-			} else {
-				type = LOG_TYPE_NONE;
-			}
-			continue;
-		}
-		switch (type) {
-		case LOG_TYPE_SYSINFO:
-			if (!strncmp(buffer, "arfcn ", 6))
-				sysinfo.arfcn = atoi(buffer + 6);
-			else if (!strncmp(buffer, "si1 ", 4))
-				read_log_si(buffer + 4, sysinfo.si1);
-			else if (!strncmp(buffer, "si2 ", 4))
-				read_log_si(buffer + 4, sysinfo.si2);
-			else if (!strncmp(buffer, "si2bis ", 7))
-				read_log_si(buffer + 7, sysinfo.si2bis);
-			else if (!strncmp(buffer, "si2ter ", 7))
-				read_log_si(buffer + 7, sysinfo.si2ter);
-			else if (!strncmp(buffer, "si3 ", 4))
-				read_log_si(buffer + 4, sysinfo.si3);
-			else if (!strncmp(buffer, "si4 ", 4))
-				read_log_si(buffer + 4, sysinfo.si4);
-			else if (!strncmp(buffer, "time ", 5))
-				sysinfo.gmt = strtoul(buffer + 5, NULL, 0);
-			else if (!strncmp(buffer, "position ", 9))
-				read_log_pos(buffer + 9, &sysinfo.longitude,
-					&sysinfo.latitude, &sysinfo.gps_valid);
-			else if (!strncmp(buffer, "rxlev ", 5))
-				sysinfo.rxlev =
-					strtoul(buffer + 5, NULL, 0);
-			else if (!strncmp(buffer, "bsic ", 5))
-				read_log_bsic(buffer + 5);
-			else if (!strncmp(buffer, "ta ", 3)) {
-				sysinfo.ta_valid = 1;
-				sysinfo.ta = atoi(buffer + 3);
-			}
-			break;
-		case LOG_TYPE_POWER:
-			if (!strncmp(buffer, "arfcn ", 6))
-				read_log_power(buffer + 6);
-			else if (!strncmp(buffer, "time ", 5))
-				power.gmt = strtoul(buffer + 5, NULL, 0);
-			else if (!strncmp(buffer, "position ", 9))
-				read_log_pos(buffer + 9, &power.longitude,
-					&power.latitude, &sysinfo.gps_valid);
-			break;
+/* store the record that was read so far */
+static int parser_flush(struct log_parser *lp)
+{
+	switch (lp->type) {
+	case LOG_TYPE_SYSINFO:
+		return lp->h->sysinfo(lp->priv, &lp->sysinfo);
+	case LOG_TYPE_POWER:
+		return lp->h->power(lp->priv, &lp->power);
+	}
+
+	return 0;
+}
+
+static int parse_line(struct log_parser *lp, char *buffer)
+{
+	struct sysinfo *sysinfo = &lp->sysinfo;
+	struct power *power = &lp->power;
+	int rc;
+
+	if (buffer[0] == '[') {
+		rc = parser_flush(lp);
+		if (rc < 0)
+			return rc;
+		if (!strcmp(buffer, "[sysinfo]"))
+			parser_reset(lp, LOG_TYPE_SYSINFO);
+		else if (!strcmp(buffer, "[power]"))
+			parser_reset(lp, LOG_TYPE_POWER);
+		else
+			lp->type = LOG_TYPE_NONE;
+		return 0;
+	}
+
+	switch (lp->type) {
+	case LOG_TYPE_SYSINFO:
+		if (!strncmp(buffer, "arfcn ", 6))
+			sysinfo->arfcn = atoi(buffer + 6);
+		else if (!strncmp(buffer, "si1 ", 4))
+			read_log_si(buffer + 4, sysinfo->si1);
+		else if (!strncmp(buffer, "si2 ", 4))
+			read_log_si(buffer + 4, sysinfo->si2);
+		else if (!strncmp(buffer, "si2bis ", 7))
+			read_log_si(buffer + 7, sysinfo->si2bis);
+		else if (!strncmp(buffer, "si2ter ", 7))
+			read_log_si(buffer + 7, sysinfo->si2ter);
+		else if (!strncmp(buffer, "si3 ", 4))
+			read_log_si(buffer + 4, sysinfo->si3);
+		else if (!strncmp(buffer, "si4 ", 4))
+			read_log_si(buffer + 4, sysinfo->si4);
+		else if (!strncmp(buffer, "time ", 5))
+			sysinfo->gmt = strtoul(buffer + 5, NULL, 0);
+		else if (!strncmp(buffer, "position ", 9))
+			read_log_pos(buffer + 9, &sysinfo->longitude,
+				&sysinfo->latitude, &sysinfo->gps_valid);
+		else if (!strncmp(buffer, "rxlev ", 5))
+			sysinfo->rxlev =
+				strtoul(buffer + 5, NULL, 0);
+		else if (!strncmp(buffer, "bsic ", 5))
+			read_log_bsic(buffer + 5, sysinfo);
+		else if (!strncmp(buffer, "ta ", 3)) {
+			sysinfo->ta_valid = 1;
+			sysinfo->ta = atoi(buffer + 3);
 		}
+		break;
+	case LOG_TYPE_POWER:
+		if (!strncmp(buffer, "arfcn ", 6))
+			read_log_power(buffer + 6, power);
+		else if (!strncmp(buffer, "time ", 5))
+			power->gmt = strtoul(buffer + 5, NULL, 0);
+		else if (!strncmp(buffer, "position ", 9))
+			read_log_pos(buffer + 9, &power->longitude,
+				&power->latitude, &power->gps_valid);
+		break;
 	}
 
-	return type;
+	return 0;
 }
 
+/* parse all records of a log in memory, the data need not be terminated.
+ * Binary logs are detected by their header. */
+int log_parse_buffer(const struct log_handler *h, void *priv, const char *data,
+	size_t len)
+{
+	struct log_parser lp = {
+		.h = h,
+		.priv = priv,
+		.type = LOG_TYPE_NONE,
+	};
+	const char *end = data + len, *eol;
+	char buffer[256];
+	size_t n;
+	int rc;
+
+	if (binlog_detect(data, len))
+		return binlog_parse(h, priv, (const uint8_t *)data, len);
+
+	while (data < end) {
+		eol = memchr(data, '\n', end - data);
+		if (!eol)
+			eol = end;
+		/* lines are short, longer ones are truncated */
+		n = OSMO_MIN((size_t)(eol - data), sizeof(buffer) - 1);
+		memcpy(buffer, data, n);
+		buffer[n] = '\0';
+		data = eol + 1;
+
+		rc = parse_line(&lp, buffer);
+		if (rc < 0)
+			return rc;
+	}
+
+	return parser_flush(&lp);
+}
+
+/* map the log file and parse it */
+int log_parse_file(const struct log_handler *h, void *priv,
+	const char *filename)
+{
+	struct stat st;
+	void *data;
+	int fd, rc;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	if (fstat(fd, &st) < 0) {
+		rc = -errno;
+		close(fd);
+		return rc;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return -errno;
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+	rc = log_parse_buffer(h, priv, data, st.st_size);
+
+	munmap(data, st.st_size);
+
+	return rc;
+}
+
+static int db_sysinfo(void *priv, const struct sysinfo *si)
+{
+	return log_db_add_sysinfo(priv, si);
+}
+
+static int db_power(void *priv, const struct power *power)
+{
+	return log_db_add_power(priv, power);
+}
+
+static const struct log_handler db_handler = {
+	.sysinfo = db_sysinfo,
+	.power = db_power,
+};
+
+int log_read_buffer(struct log_db *db, const char *data, size_t len)
+{
+	return log_parse_buffer(&db_handler, db, data, len);
+}
+
+int log_read_file(struct log_db *db, const char *filename)
+{
+	return log_parse_file(&db_handler, db, filename);
+}
+
+/*
+ * writing of text logs, in the format of cell_log
+ */
+
+static void write_si(FILE *fp, const char *tag, const uint8_t *data)
+{
+	int i;
+
+	/* the first octet is the L2 pseudo length, never 0 */
+	if (!data[0])
+		return;
+	fprintf(fp, "%s", tag);
+	for (i = 0; i < 23; i++)
+		fprintf(fp, " %02x", data[i]);
+	fprintf(fp, "\n");
+}
+
+void log_write_sysinfo(FILE *fp, const struct sysinfo *si)
+{
+	fprintf(fp, "[sysinfo]\n");
+	fprintf(fp, "arfcn %d\n", si->arfcn);
+	fprintf(fp, "time %lu\n", (unsigned long)si->gmt);
+	if (si->gps_valid)
+		fprintf(fp, "position %.8f %.8f\n", si->longitude,
+			si->latitude);
+	fprintf(fp, "bsic %d,%d\n", si->bsic >> 3, si->bsic & 7);
+	fprintf(fp, "rxlev %d\n", si->rxlev);
+	write_si(fp, "si1", si->si1);
+	write_si(fp, "si2", si->si2);
+	write_si(fp, "si2bis", si->si2bis);
+	write_si(fp, "si2ter", si->si2ter);
+	write_si(fp, "si3", si->si3);
+	write_si(fp, "si4", si->si4);
+	if (si->ta_valid)
+		fprintf(fp, "ta %d\n", si->ta);
+	fprintf(fp, "\n");
+}
+
+void log_write_power(FILE *fp, const struct power *power)
+{
+	int count = 0, i;
+
+	fprintf(fp, "[power]\n");
+	fprintf(fp, "time %lu\n", (unsigned long)power->gmt);
+	if (power->gps_valid)
+		fprintf(fp, "position %.8f %.8f\n", power->longitude,
+			power->latitude);
+	for (i = 0; i <= 1023; i++) {
+		if (power->rxlev[i] != -128) {
+			if (!count)
+				fprintf(fp, "arfcn %d", i);
+			fprintf(fp, " %d", power->rxlev[i]);
+			if (++count == 12) {
+				fprintf(fp, "\n");
+				count = 0;
+			}
+		} else if (count) {
+			fprintf(fp, "\n");
+			count = 0;
+		}
+	}
+	if (count)
+		fprintf(fp, "\n");
+	fprintf(fp, "\n");
+}
@@ -0,0 +1,267 @@
+/* Capture of paging requests to a file or unix socket */
+
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm48.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/misc/pagcap.h>
+
+#define RING_SIZE	8192 /* records, power of two */
+#define BATCH_SIZE	256 /* records per write */
+#define IDLE_US		10000 /* writer sleep when the ring is empty */
+#define STATS_INTERVAL	1 /* seconds */
+
+/* The producer is the main loop, the consumer is the writer thread. Each
+ * index is only written by one side, so the ring needs no lock. */
+static struct {
+	struct pagcap_rec rec[RING_SIZE];
+	atomic_uint head __attribute__((aligned(64))); /* next to write */
+	atomic_uint tail __attribute__((aligned(64))); /* next to read */
+} ring;
+
+static struct {
+	int fd;
+	int is_socket;
+	pthread_t thread;
+	atomic_int stop;
+	int active;
+
+	/* written by the main loop only */
+	struct osmo_timer_list stats_timer;
+	unsigned int requests, identities, tmsi, imsi, dropped;
+	unsigned long dropped_total;
+	uint32_t last_fn;
+} pc = {
+	.fd = -1,
+};
+
+static int write_all(const uint8_t *data, size_t len)
+{
+	ssize_t rc;
+
+	while (len) {
+		if (pc.is_socket)
+			rc = send(pc.fd, data, len, MSG_NOSIGNAL);
+		else
+			rc = write(pc.fd, data, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		data += rc;
+		len -= rc;
+	}
+
+	return 0;
+}
+
+static void *writer_thread(void *arg)
+{
+	static uint8_t buf[BATCH_SIZE * sizeof(struct pagcap_rec)];
+	const struct pagcap_rec *rec;
+	unsigned int head, tail, n;
+	uint8_t *p;
+
+	tail = atomic_load_explicit(&ring.tail, memory_order_relaxed);
+	while (1) {
+		head = atomic_load_explicit(&ring.head, memory_order_acquire);
+		if (head == tail) {
+			/* drain the ring before stopping */
+			if (atomic_load(&pc.stop))
+				break;
+			usleep(IDLE_US);
+			continue;
+		}
+
+		/* convert a batch to the byte order of the file */
+		p = buf;
+		for (n = 0; n < BATCH_SIZE && tail != head; n++, tail++) {
+			rec = &ring.rec[tail & (RING_SIZE - 1)];
+			memcpy(p, rec, sizeof(*rec));
+			osmo_store32le(rec->fn, p);
+			osmo_store16le(rec->arfcn, p + 4);
+			p += sizeof(*rec);
+		}
+		atomic_store_explicit(&ring.tail, tail, memory_order_release);
+
+		/* on error, records are lost, the main loop keeps running */
+		if (pc.fd >= 0 && write_all(buf, p - buf) < 0) {
+			close(pc.fd);
+			pc.fd = -1;
+		}
+	}
+
+	return NULL;
+}
+
+static void stats_cb(void *data)
+{
+	if (pc.requests || pc.dropped) {
+		LOGP(DRR, LOGL_INFO, "Paging load: %u requests/s, %u "
+			"identities/s (%u TMSI, %u IMSI), %u dropped "
+			"(%lu total)\n", pc.requests, pc.identities, pc.tmsi,
+			pc.imsi, pc.dropped, pc.dropped_total);
+	}
+	pc.requests = pc.identities = pc.tmsi = pc.imsi = pc.dropped = 0;
+	osmo_timer_schedule(&pc.stats_timer, STATS_INTERVAL, 0);
+}
+
+static int open_socket(const char *path)
+{
+	struct sockaddr_un addr = {
+		.sun_family = AF_UNIX,
+	};
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+		return -EINVAL;
+	OSMO_STRLCPY_ARRAY(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -errno;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return -errno;
+	}
+
+	return fd;
+}
+
+/* open the capture, "unix:<path>" connects to a unix socket */
+int pagcap_open(const char *path)
+{
+	uint8_t hdr[PAGCAP_HDR_LEN];
+	int rc;
+
+	if (!strncmp(path, "unix:", 5)) {
+		pc.fd = open_socket(path + 5);
+		pc.is_socket = 1;
+	} else {
+		pc.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (pc.fd < 0)
+			pc.fd = -errno;
+	}
+	if (pc.fd < 0) {
+		rc = pc.fd;
+		LOGP(DRR, LOGL_ERROR, "Failed to open paging capture '%s': "
+			"%s\n", path, strerror(-rc));
+		pc.fd = -1;
+		return rc;
+	}
+
+	memcpy(hdr, PAGCAP_MAGIC, 8);
+	osmo_store16le(PAGCAP_VERSION, hdr + 8);
+	osmo_store16le(sizeof(struct pagcap_rec), hdr + 10);
+	osmo_store32le(0, hdr + 12);
+	rc = write_all(hdr, sizeof(hdr));
+	if (rc < 0)
+		goto error;
+
+	atomic_store(&ring.head, 0);
+	atomic_store(&ring.tail, 0);
+	atomic_store(&pc.stop, 0);
+	rc = -pthread_create(&pc.thread, NULL, writer_thread, NULL);
+	if (rc < 0)
+		goto error;
+	pc.active = 1;
+
+	osmo_timer_setup(&pc.stats_timer, stats_cb, NULL);
+	osmo_timer_schedule(&pc.stats_timer, STATS_INTERVAL, 0);
+
+	return 0;
+
+error:
+	LOGP(DRR, LOGL_ERROR, "Failed to start paging capture: %s\n",
+		strerror(-rc));
+	close(pc.fd);
+	pc.fd = -1;
+	return rc;
+}
+
+/* write the remaining records and stop the writer */
+void pagcap_close(void)
+{
+	if (!pc.active)
+		return;
+
+	osmo_timer_del(&pc.stats_timer);
+	atomic_store(&pc.stop, 1);
+	pthread_join(pc.thread, NULL);
+	if (pc.fd >= 0)
+		close(pc.fd);
+	pc.fd = -1;
+	pc.active = 0;
+
+	if (pc.dropped_total)
+		LOGP(DRR, LOGL_NOTICE, "Paging capture dropped %lu records\n",
+			pc.dropped_total);
+}
+
+int pagcap_active(void)
+{
+	return pc.active;
+}
+
+/* queue a record, called from the main loop only */
+int pagcap_push(const struct pagcap_rec *rec)
+{
+	unsigned int head, tail;
+
+	head = atomic_load_explicit(&ring.head, memory_order_relaxed);
+	tail = atomic_load_explicit(&ring.tail, memory_order_acquire);
+
+	/* there is one message per block, so identities of a request
+	 * share the frame number */
+	if (!pc.identities || rec->fn != pc.last_fn)
+		pc.requests++;
+	pc.last_fn = rec->fn;
+	if (rec->mi_type == GSM_MI_TYPE_TMSI)
+		pc.tmsi++;
+	else if (rec->mi_type == GSM_MI_TYPE_IMSI)
+		pc.imsi++;
+	pc.identities++;
+
+	if (head - tail >= RING_SIZE) {
+		pc.dropped++;
+		pc.dropped_total++;
+		return -ENOBUFS;
+	}
+
+	ring.rec[head & (RING_SIZE - 1)] = *rec;
+	atomic_store_explicit(&ring.head, head + 1, memory_order_release);
+
+	return 0;
+}
@@ -0,0 +1,839 @@
+/* Decoder of system information before the rest octets were table driven
+ * and frequency lists were decoded into sets. bench compares the decoder of
+ * sysinfo.c against it. The code is that of sysinfo.c at the time, with
+ * the functions renamed. The only change is that SI 1 rest octets of a
+ * message shorter than its fixed part are skipped, as the old decoder read
+ * them with a negative length. */
+
+/*
+ * (C) 2010 by Andreas Eversberg <jolly@eversberg.eu>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bitvec.h>
+#include <osmocom/gsm/gsm48.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/common/sysinfo.h>
+#include <osmocom/bb/misc/sysinfo_ref.h>
+
+static int ref_decode_chan_h0(const struct gsm48_chan_desc *cd,
+			 uint8_t *tsc, uint16_t *arfcn)
+{
+	*tsc = cd->h0.tsc;
+	*arfcn = cd->h0.arfcn_low | (cd->h0.arfcn_high << 8);
+
+	return 0;
+}
+
+static int ref_decode_chan_h1(const struct gsm48_chan_desc *cd,
+			 uint8_t *tsc, uint8_t *maio, uint8_t *hsn)
+{
+	*tsc = cd->h1.tsc;
+	*maio = cd->h1.maio_low | (cd->h1.maio_high << 2);
+	*hsn = cd->h1.hsn;
+
+	return 0;
+}
+
+/* decode "Cell Channel Description" (10.5.2.1b) and other frequency lists */
+static int decode_freq_list(struct gsm_sysinfo_freq *f,
+			    const uint8_t *cd, uint8_t len,
+			    uint8_t mask, uint8_t frqt)
+{
+#if 0
+	/* only Bit map 0 format for P-GSM */
+	if ((cd[0] & 0xc0 & mask) != 0x00 &&
+	    (set->p_gsm && !set->e_gsm && !set->r_gsm && !set->dcs))
+		return 0;
+#endif
+
+	return gsm48_decode_freq_list(f, cd, len, mask, frqt);
+}
+
+/* decode "Cell Selection Parameters" (10.5.2.4) */
+static int ref_decode_cell_sel_param(struct gsm48_sysinfo *s,
+				       const struct gsm48_cell_sel_par *cs)
+{
+	s->ms_txpwr_max_cch = cs->ms_txpwr_max_ccch;
+	s->cell_resel_hyst_db = cs->cell_resel_hyst * 2;
+	s->rxlev_acc_min_db = cs->rxlev_acc_min - 110;
+	s->neci = cs->neci;
+	s->acs = cs->acs;
+
+	return 0;
+}
+
+/* decode "Cell Options (BCCH)" (10.5.2.3) */
+static int ref_decode_cellopt_bcch(struct gsm48_sysinfo *s,
+				     const struct gsm48_cell_options *co)
+{
+	s->bcch_radio_link_timeout = (co->radio_link_timeout + 1) * 4;
+	s->bcch_dtx = co->dtx;
+	s->bcch_pwrc = co->pwrc;
+
+	return 0;
+}
+
+/* decode "Cell Options (SACCH)" (10.5.2.3a) */
+static int ref_decode_cellopt_sacch(struct gsm48_sysinfo *s,
+				      const struct gsm48_cell_options *co)
+{
+	s->sacch_radio_link_timeout = (co->radio_link_timeout + 1) * 4;
+	s->sacch_dtx = co->dtx;
+	s->sacch_pwrc = co->pwrc;
+
+	return 0;
+}
+
+/* decode "Control Channel Description" (10.5.2.11) */
+static int ref_decode_ccd(struct gsm48_sysinfo *s,
+			    const struct gsm48_control_channel_descr *cc)
+{
+	s->ccch_conf = cc->ccch_conf;
+	s->bs_ag_blks_res = cc->bs_ag_blks_res;
+	s->att_allowed = cc->att;
+	s->pag_mf_periods = cc->bs_pa_mfrms + 2;
+	s->t3212 = cc->t3212 * 360; /* convert deci-hours to seconds */
+
+	return 0;
+}
+
+/* decode "Mobile Allocation" (10.5.2.21) */
+static int ref_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
+			      const uint8_t *ma, uint8_t len,
+			      uint16_t *hopping, uint8_t *hopp_len, int si4)
+{
+	int i, j = 0;
+	uint16_t f[len << 3];
+
+	/* not more than 64 hopping indexes allowed in IE */
+	if (len > 8)
+		return -EINVAL;
+
+	/* tabula rasa */
+	*hopp_len = 0;
+	if (si4) {
+		for (i = 0; i < 1024; i++)
+			freq[i].mask &= ~FREQ_TYPE_HOPP;
+	}
+
+	/* generating list of all frequencies (1..1023,0) */
+	for (i = 1; i <= 1024; i++) {
+		if ((freq[i & 1023].mask & FREQ_TYPE_SERV)) {
+			LOGP(DRR, LOGL_INFO, "Serving cell ARFCN #%d: %d\n",
+				j, i & 1023);
+			f[j++] = i & 1023;
+			if (j == (len << 3))
+				break;
+		}
+	}
+
+	/* fill hopping table with frequency index given by IE
+	 * and set hopping type bits
+	 */
+	for (i = 0; i < (len << 3); i++) {
+		/* if bit is set, this frequency index is used for hopping */
+		if ((ma[len - 1 - (i >> 3)] & (1 << (i & 7)))) {
+			LOGP(DRR, LOGL_INFO, "Hopping ARFCN: %d (bit %d)\n",
+				i, f[i]);
+			/* index higher than entries in list ? */
+			if (i >= j) {
+				LOGP(DRR, LOGL_NOTICE, "Mobile Allocation "
+					"hopping index %d exceeds maximum "
+					"number of cell frequencies. (%d)\n",
+					i + 1, j);
+				break;
+			}
+			hopping[(*hopp_len)++] = f[i];
+			if (si4)
+				freq[f[i]].mask |= FREQ_TYPE_HOPP;
+		}
+	}
+
+	return 0;
+}
+
+/* Rach Control decode tables */
+static const uint8_t gsm48_max_retrans[4] = {
+	1, 2, 4, 7
+};
+static const uint8_t gsm48_tx_integer[16] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 14, 16, 20, 25, 32, 50
+};
+
+/* decode "RACH Control Parameter" (10.5.2.29) */
+static int ref_decode_rach_ctl_param(struct gsm48_sysinfo *s,
+				       const struct gsm48_rach_control *rc)
+{
+	s->reest_denied = rc->re;
+	s->cell_barr = rc->cell_bar;
+	s->tx_integer = gsm48_tx_integer[rc->tx_integer];
+	s->max_retrans = gsm48_max_retrans[rc->max_trans];
+	s->class_barr = (rc->t2 << 8) | rc->t3;
+
+	return 0;
+}
+static int ref_decode_rach_ctl_neigh(struct gsm48_sysinfo *s,
+				       const struct gsm48_rach_control *rc)
+{
+	s->nb_reest_denied = rc->re;
+	s->nb_cell_barr = rc->cell_bar;
+	s->nb_tx_integer = gsm48_tx_integer[rc->tx_integer];
+	s->nb_max_retrans = gsm48_max_retrans[rc->max_trans];
+	s->nb_class_barr = (rc->t2 << 8) | rc->t3;
+
+	return 0;
+}
+
+/* decode "SI 1 Rest Octets" (10.5.2.32) */
+static int ref_decode_si1_rest(struct gsm48_sysinfo *s,
+				 const uint8_t *si, uint8_t len)
+{
+	struct bitvec bv = {
+		.data_len = len,
+		.data = (uint8_t *)si,
+	};
+
+	/* Optional Selection Parameters */
+	if (bitvec_get_bit_high(&bv) == H) {
+		s->nch = 1;
+		s->nch_position = bitvec_get_uint(&bv, 5);
+	} else
+		s->nch = 0;
+	s->band_ind = (bitvec_get_bit_high(&bv) == H);
+
+	return 0;
+}
+
+/* decode "SI 3 Rest Octets" (10.5.2.34) */
+static int ref_decode_si3_rest(struct gsm48_sysinfo *s,
+				 const uint8_t *si, uint8_t len)
+{
+	struct bitvec bv = {
+		.data_len = len,
+		.data = (uint8_t *)si,
+	};
+
+	/* Optional Selection Parameters */
+	if (bitvec_get_bit_high(&bv) == H) {
+		s->sp = 1;
+		s->sp_cbq = bitvec_get_uint(&bv, 1);
+		s->sp_cro = bitvec_get_uint(&bv, 6);
+		s->sp_to = bitvec_get_uint(&bv, 3);
+		s->sp_pt = bitvec_get_uint(&bv, 5);
+	} else
+		s->sp = 0;
+	/* Optional Power Offset */
+	if (bitvec_get_bit_high(&bv) == H) {
+		s->po = 1;
+		s->po_value = bitvec_get_uint(&bv, 2);
+	} else
+		s->po = 0;
+	/* System Onformation 2ter Indicator */
+	if (bitvec_get_bit_high(&bv) == H)
+		s->si2ter_ind = 1;
+	else
+		s->si2ter_ind = 0;
+	/* Early Classark Sending Control */
+	if (bitvec_get_bit_high(&bv) == H)
+		s->ecsm = 1;
+	else
+		s->ecsm = 0;
+	/* Scheduling if and where */
+	if (bitvec_get_bit_high(&bv) == H) {
+		s->sched = 1;
+		s->sched_where = bitvec_get_uint(&bv, 3);
+	} else
+		s->sched = 0;
+	/* GPRS Indicator */
+	if (bitvec_get_bit_high(&bv) == H) {
+		s->gprs.supported = 1;
+		s->gprs.ra_colour = bitvec_get_uint(&bv, 3);
+		s->gprs.si13_pos = bitvec_get_uint(&bv, 1);
+	} else
+		s->gprs.supported = 0;
+
+	return 0;
+}
+
+/* decode "SI 4 Rest Octets" (10.5.2.35) */
+static int ref_decode_si4_rest(struct gsm48_sysinfo *s,
+				 const uint8_t *si, uint8_t len)
+{
+	struct bitvec bv = {
+		.data_len = len,
+		.data = (uint8_t *)si,
+	};
+
+	/* Optional Selection Parameters */
+	if (bitvec_get_bit_high(&bv) == H) {
+		s->sp = 1;
+		s->sp_cbq = bitvec_get_uint(&bv, 1);
+		s->sp_cro = bitvec_get_uint(&bv, 6);
+		s->sp_to = bitvec_get_uint(&bv, 3);
+		s->sp_pt = bitvec_get_uint(&bv, 5);
+	} else
+		s->sp = 0;
+	/* Optional Power Offset */
+	if (bitvec_get_bit_high(&bv) == H) {
+		s->po = 1;
+		s->po_value = bitvec_get_uint(&bv, 3);
+	} else
+		s->po = 0;
+	/* GPRS Indicator */
+	if (bitvec_get_bit_high(&bv) == H) {
+		s->gprs.supported = 1;
+		s->gprs.ra_colour = bitvec_get_uint(&bv, 3);
+		s->gprs.si13_pos = bitvec_get_uint(&bv, 1);
+	} else
+		s->gprs.supported = 0;
+	// todo: more rest octet bits
+
+	return 0;
+}
+
+/* TODO: decode "SI 6 Rest Octets" (10.5.2.35a) */
+static int ref_decode_si6_rest(struct gsm48_sysinfo *s,
+				 const uint8_t *si, uint8_t len)
+{
+	return 0;
+}
+
+/* Decode "SI 10 Rest Octets" (10.5.2.44) */
+static int ref_decode_si10_rest_first(struct gsm48_sysinfo *s, struct bitvec *bv,
+					struct si10_cell_info *c)
+{
+	uint8_t ba_ind;
+
+	/* <BA ind : bit(1)> */
+	ba_ind = bitvec_get_uint(bv, 1);
+	if (ba_ind != s->nb_ba_ind_si5) {
+		LOGP(DRR, LOGL_NOTICE, "SI10: BA_IND %u != BA_IND %u of SI5!\n", ba_ind, s->nb_ba_ind_si5);
+		return EOF;
+	}
+
+	/* { L <spare padding> | H <neighbour information> } */
+	if (bitvec_get_bit_high(bv) != H) {
+		LOGP(DRR, LOGL_INFO, "SI10: No neighbor cell defined.\n");
+		return EOF;
+	}
+
+	/* <first frequency: bit(5)> */
+	c->index = bitvec_get_uint(bv, 5);
+
+	/* <bsic : bit(6)> */
+	c->bsic = bitvec_get_uint(bv, 6);
+
+	/* { H <cell parameters> | L } */
+	if (bitvec_get_bit_high(bv) != H) {
+		LOGP(DRR, LOGL_NOTICE, "SI10: No cell parameters for first cell, cannot continue to decode!\n");
+		return EOF;
+	}
+
+	/* <cell barred (H)> | L <further cell info> */
+	if (bitvec_get_bit_high(bv) == H) {
+		c->barred = true;
+		return 0;
+	}
+
+	/* { H <cell reselect hysteresis : bit(3)> | L } */
+	if (bitvec_get_bit_high(bv) == H) {
+		c->la_different = true;
+		c->cell_resel_hyst_db = bitvec_get_uint(bv, 3) * 2;
+	}
+
+	/* <ms txpwr max cch : bit(5)> */
+	c->ms_txpwr_max_cch = bitvec_get_uint(bv, 5);
+	/* <rxlev access min : bit(6)> */
+	c->rxlev_acc_min_db = rxlev2dbm(bitvec_get_uint(bv, 6));
+	/* <cell reselect offset : bit(6)> */
+	c->cell_resel_offset = bitvec_get_uint(bv, 6);
+	/* <temporary offset : bit(3)> */
+	c->temp_offset = bitvec_get_uint(bv, 3);
+	/* <penalty time : bit(5)> */
+	c->penalty_time = bitvec_get_uint(bv, 5);
+
+	return 0;
+}
+
+static int ref_decode_si10_rest_other(struct gsm48_sysinfo *s, struct bitvec *bv,
+					struct si10_cell_info *c)
+{
+	int rc;
+
+	/* { H <info field> }** L <spare padding> */
+	if (bitvec_get_bit_high(bv) != H)
+		return EOF;
+
+	c->index = (c->index + 1) & 0x1f;
+	/* <next frequency (H)>** L <differential cell info> */
+	/* Increment frequency number for every <info field> and every <next frequency> occurrence. */
+	while ((rc = bitvec_get_bit_high(bv)) == H)
+		c->index = (c->index + 1) & 0x1f;
+	if (rc < 0)
+		goto short_read;
+
+	/* { H <BCC : bit(3)> | L <bsic : bit(6)> } */
+	rc = bitvec_get_bit_high(bv);
+	if (rc < 0)
+		goto short_read;
+	if (rc == H) {
+		rc = bitvec_get_uint(bv, 3);
+		if (rc < 0)
+			goto short_read;
+		c->bsic = (c->bsic & 0x07) | rc;
+	} else {
+		rc = bitvec_get_uint(bv, 6);
+		if (rc < 0)
+			goto short_read;
+		c->bsic = rc;
+	}
+
+	/* { H <diff cell pars> | L } */
+	rc = bitvec_get_bit_high(bv);
+	if (rc < 0)
+		goto short_read;
+	if (rc != H)
+		return 0;
+
+	/* <cell barred (H)> | L <further cell info> */
+	rc = bitvec_get_bit_high(bv);
+	if (rc < 0)
+		goto short_read;
+	if (rc == H) {
+		c->barred = true;
+		return 0;
+	}
+
+	/* { H <cell reselect hysteresis : bit(3)> | L } */
+	rc = bitvec_get_bit_high(bv);
+	if (rc < 0)
+		goto short_read;
+	if (rc == H) {
+		c->la_different = true;
+		rc = bitvec_get_uint(bv, 3);
+		if (rc < 0)
+			goto short_read;
+		c->cell_resel_hyst_db = bitvec_get_uint(bv, 3) * 2;
+	}
+
+	/* { H <ms txpwr max cch : bit(5)> | L } */
+	rc = bitvec_get_bit_high(bv);
+	if (rc < 0)
+		goto short_read;
+	if (rc == H) {
+		rc = bitvec_get_uint(bv, 5);
+		if (rc < 0)
+			goto short_read;
+		c->ms_txpwr_max_cch = rc;
+	}
+
+	/* { H <rxlev access min : bit(6)> | L } */
+	rc = bitvec_get_bit_high(bv);
+	if (rc < 0)
+		goto short_read;
+	if (rc == H) {
+		rc = bitvec_get_uint(bv, 6);
+		if (rc < 0)
+			goto short_read;
+		c->rxlev_acc_min_db = rxlev2dbm(rc);
+	} else
+		c->rxlev_acc_min_db = -110;
+
+	/* { H <cell reselect offset : bit(6)> | L } */
+	rc = bitvec_get_bit_high(bv);
+	if (rc < 0)
+		goto short_read;
+	if (rc == H) {
+		rc = bitvec_get_uint(bv, 6);
+		if (rc < 0)
+			goto short_read;
+		c->cell_resel_offset = rc;
+	}
+
+	/* { H <temporary offset : bit(3)> | L } */
+	rc = bitvec_get_bit_high(bv);
+	if (rc < 0)
+		goto short_read;
+	if (rc == H) {
+		rc = bitvec_get_uint(bv, 3);
+		if (rc < 0)
+			goto short_read;
+		c->temp_offset = rc;
+	}
+
+	/* { H <penalty time : bit(5)> | L } */
+	rc = bitvec_get_bit_high(bv);
+	if (rc < 0)
+		goto short_read;
+	if (rc == H) {
+		rc = bitvec_get_uint(bv, 5);
+		if (rc < 0)
+			goto short_read;
+		c->penalty_time = rc;
+	}
+
+	return 0;
+
+short_read:
+	LOGP(DRR, LOGL_NOTICE, "SI10: Short read of differential cell info.\n");
+	return -EINVAL;
+}
+
+int ref_decode_sysinfo1(struct gsm48_sysinfo *s,
+			  const struct gsm48_system_information_type_1 *si, int len)
+{
+	int payload_len = len - sizeof(*si);
+
+	memcpy(s->si1_msg, si, OSMO_MIN(len, sizeof(s->si1_msg)));
+
+	/* Cell Channel Description */
+	decode_freq_list(s->freq, si->cell_channel_description,
+			 sizeof(si->cell_channel_description),
+			 0xce, FREQ_TYPE_SERV);
+	/* RACH Control Parameter */
+	ref_decode_rach_ctl_param(s, &si->rach_control);
+	/* SI 1 Rest Octets */
+	if (payload_len > 0)
+		ref_decode_si1_rest(s, si->rest_octets, payload_len);
+
+	s->si1 = 1;
+
+	if (s->si4) {
+		const struct gsm48_system_information_type_4 *si4 = (void *)s->si4_msg;
+		LOGP(DRR, LOGL_NOTICE,
+		     "Now updating previously received SYSTEM INFORMATION 4\n");
+		ref_decode_sysinfo4(s, si4, sizeof(s->si4_msg));
+	}
+
+	return 0;
+}
+
+int ref_decode_sysinfo2(struct gsm48_sysinfo *s,
+			  const struct gsm48_system_information_type_2 *si, int len)
+{
+	memcpy(s->si2_msg, si, OSMO_MIN(len, sizeof(s->si2_msg)));
+
+	/* Neighbor Cell Description */
+	s->nb_ext_ind_si2 = (si->bcch_frequency_list[0] >> 5) & 1;
+	s->nb_ba_ind_si2 = (si->bcch_frequency_list[0] >> 4) & 1;
+	decode_freq_list(s->freq, si->bcch_frequency_list,
+			 sizeof(si->bcch_frequency_list),
+			 0xce, FREQ_TYPE_NCELL_2);
+	/* NCC Permitted */
+	s->nb_ncc_permitted_si2 = si->ncc_permitted;
+	/* RACH Control Parameter */
+	ref_decode_rach_ctl_neigh(s, &si->rach_control);
+
+	s->si2 = 1;
+
+	return 0;
+}
+
+int ref_decode_sysinfo2bis(struct gsm48_sysinfo *s,
+			     const struct gsm48_system_information_type_2bis *si, int len)
+{
+	memcpy(s->si2b_msg, si, OSMO_MIN(len, sizeof(s->si2b_msg)));
+
+	/* Neighbor Cell Description */
+	s->nb_ext_ind_si2bis = (si->bcch_frequency_list[0] >> 5) & 1;
+	s->nb_ba_ind_si2bis = (si->bcch_frequency_list[0] >> 4) & 1;
+	decode_freq_list(s->freq, si->bcch_frequency_list,
+		sizeof(si->bcch_frequency_list), 0xce, FREQ_TYPE_NCELL_2bis);
+	/* RACH Control Parameter */
+	ref_decode_rach_ctl_neigh(s, &si->rach_control);
+
+	s->si2bis = 1;
+
+	return 0;
+}
+
+int ref_decode_sysinfo2ter(struct gsm48_sysinfo *s,
+			     const struct gsm48_system_information_type_2ter *si, int len)
+{
+	memcpy(s->si2t_msg, si, OSMO_MIN(len, sizeof(s->si2t_msg)));
+
+	/* Neighbor Cell Description 2 */
+	s->nb_multi_rep_si2ter = (si->ext_bcch_frequency_list[0] >> 5) & 3;
+	s->nb_ba_ind_si2ter = (si->ext_bcch_frequency_list[0] >> 4) & 1;
+	decode_freq_list(s->freq, si->ext_bcch_frequency_list,
+		sizeof(si->ext_bcch_frequency_list), 0x8e,
+			FREQ_TYPE_NCELL_2ter);
+
+	s->si2ter = 1;
+
+	return 0;
+}
+
+int ref_decode_sysinfo3(struct gsm48_sysinfo *s,
+			  const struct gsm48_system_information_type_3 *si, int len)
+{
+	int payload_len = len - sizeof(*si);
+
+	memcpy(s->si3_msg, si, OSMO_MIN(len, sizeof(s->si3_msg)));
+
+	/* Cell Identity */
+	s->cell_id = ntohs(si->cell_identity);
+	/* LAI */
+	gsm48_decode_lai2(&si->lai, &s->lai);
+	/* Control Channel Description */
+	ref_decode_ccd(s, &si->control_channel_desc);
+	/* Cell Options (BCCH) */
+	ref_decode_cellopt_bcch(s, &si->cell_options);
+	/* Cell Selection Parameters */
+	ref_decode_cell_sel_param(s, &si->cell_sel_par);
+	/* RACH Control Parameter */
+	ref_decode_rach_ctl_param(s, &si->rach_control);
+	/* SI 3 Rest Octets */
+	if (payload_len >= 4)
+		ref_decode_si3_rest(s, si->rest_octets, payload_len);
+
+	LOGP(DRR, LOGL_INFO,
+	     "New SYSTEM INFORMATION 3 (lai=%s)\n", osmo_lai_name(&s->lai));
+
+	s->si3 = 1;
+
+	return 0;
+}
+
+int ref_decode_sysinfo4(struct gsm48_sysinfo *s,
+			  const struct gsm48_system_information_type_4 *si, int len)
+{
+	int payload_len = len - sizeof(*si);
+
+	const uint8_t *data = si->data;
+	const struct gsm48_chan_desc *cd;
+
+	memcpy(s->si4_msg, si, OSMO_MIN(len, sizeof(s->si4_msg)));
+
+	/* LAI */
+	gsm48_decode_lai2(&si->lai, &s->lai);
+	/* Cell Selection Parameters */
+	ref_decode_cell_sel_param(s, &si->cell_sel_par);
+	/* RACH Control Parameter */
+	ref_decode_rach_ctl_param(s, &si->rach_control);
+
+	/* CBCH Channel Description */
+	if (payload_len >= 1 && data[0] == GSM48_IE_CBCH_CHAN_DESC) {
+		if (payload_len < 4) {
+short_read:
+			LOGP(DRR, LOGL_NOTICE, "Short read!\n");
+			return -EIO;
+		}
+		cd = (const struct gsm48_chan_desc *)(data + 1);
+		s->chan_nr = cd->chan_nr;
+		s->h = cd->h0.h;
+		if (s->h)
+			ref_decode_chan_h1(cd, &s->tsc, &s->maio, &s->hsn);
+		else
+			ref_decode_chan_h0(cd, &s->tsc, &s->arfcn);
+		payload_len -= 4;
+		data += 4;
+	}
+	/* CBCH Mobile Allocation */
+	if (payload_len >= 1 && data[0] == GSM48_IE_CBCH_MOB_AL) {
+		if (payload_len < 1 || payload_len < 2 + data[1])
+			goto short_read;
+		if (!s->si1) {
+			LOGP(DRR, LOGL_NOTICE, "Ignoring CBCH allocation of "
+			     "SYSTEM INFORMATION 4 until SI 1 is received.\n");
+		} else {
+			ref_decode_mobile_alloc(s->freq, data + 2, data[1],
+						  s->hopping, &s->hopp_len, 1);
+		}
+		payload_len -= 2 + data[1];
+		data += 2 + data[1];
+	}
+	/* SI 4 Rest Octets */
+	if (payload_len > 0)
+		ref_decode_si4_rest(s, data, payload_len);
+
+	s->si4 = 1;
+
+	return 0;
+}
+
+int ref_decode_sysinfo5(struct gsm48_sysinfo *s,
+			  const struct gsm48_system_information_type_5 *si, int len)
+{
+	memcpy(s->si5_msg, si, OSMO_MIN(len, sizeof(s->si5_msg)));
+
+	/* Neighbor Cell Description */
+	s->nb_ext_ind_si5 = (si->bcch_frequency_list[0] >> 5) & 1;
+	s->nb_ba_ind_si5 = (si->bcch_frequency_list[0] >> 4) & 1;
+	decode_freq_list(s->freq, si->bcch_frequency_list,
+			 sizeof(si->bcch_frequency_list),
+			 0xce, FREQ_TYPE_REP_5);
+
+	s->si5 = 1;
+	s->si10 = false;
+
+	return 0;
+}
+
+int ref_decode_sysinfo5bis(struct gsm48_sysinfo *s,
+			     const struct gsm48_system_information_type_5bis *si, int len)
+{
+	memcpy(s->si5b_msg, si, OSMO_MIN(len, sizeof(s->si5b_msg)));
+
+	/* Neighbor Cell Description */
+	s->nb_ext_ind_si5bis = (si->bcch_frequency_list[0] >> 5) & 1;
+	s->nb_ba_ind_si5bis = (si->bcch_frequency_list[0] >> 4) & 1;
+	decode_freq_list(s->freq, si->bcch_frequency_list,
+			 sizeof(si->bcch_frequency_list),
+			 0xce, FREQ_TYPE_REP_5bis);
+
+	s->si5bis = 1;
+	s->si10 = false;
+
+	return 0;
+}
+
+int ref_decode_sysinfo5ter(struct gsm48_sysinfo *s,
+			     const struct gsm48_system_information_type_5ter *si, int len)
+{
+	memcpy(s->si5t_msg, si, OSMO_MIN(len, sizeof(s->si5t_msg)));
+
+	/* Neighbor Cell Description */
+	s->nb_multi_rep_si5ter = (si->bcch_frequency_list[0] >> 5) & 3;
+	s->nb_ba_ind_si5ter = (si->bcch_frequency_list[0] >> 4) & 1;
+	decode_freq_list(s->freq, si->bcch_frequency_list,
+			 sizeof(si->bcch_frequency_list),
+			 0x8e, FREQ_TYPE_REP_5ter);
+
+	s->si5ter = 1;
+	s->si10 = false;
+
+	return 0;
+}
+
+int ref_decode_sysinfo6(struct gsm48_sysinfo *s,
+			  const struct gsm48_system_information_type_6 *si, int len)
+{
+	int payload_len = len - sizeof(*si);
+
+	memcpy(s->si6_msg, si, OSMO_MIN(len, sizeof(s->si6_msg)));
+
+	/* Cell Identity */
+	if (s->si6 && s->cell_id != ntohs(si->cell_identity))
+		LOGP(DRR, LOGL_INFO, "Cell ID on SI 6 differs from previous "
+			"read.\n");
+	s->cell_id = ntohs(si->cell_identity);
+	/* LAI */
+	gsm48_decode_lai2(&si->lai, &s->lai);
+	/* Cell Options (SACCH) */
+	ref_decode_cellopt_sacch(s, &si->cell_options);
+	/* NCC Permitted */
+	s->nb_ncc_permitted_si6 = si->ncc_permitted;
+	/* SI 6 Rest Octets */
+	if (payload_len >= 4)
+		ref_decode_si6_rest(s, si->rest_octets, payload_len);
+
+	s->si6 = 1;
+
+	return 0;
+}
+
+/* Get ARFCN from BCCH allocation found in SI5/SI5bis an SI5ter. See TS 44.018 §10.5.2.20. */
+static int16_t ref_arfcn_from_freq_index(const struct gsm48_sysinfo *s, uint16_t index)
+{
+	uint16_t arfcn, i = 0;
+
+	/* Search for ARFCN found in SI5 or SI5bis. (first sub list) */
+	for (arfcn = 1; arfcn <= 1024; arfcn++) {
+		if (!(s->freq[arfcn & 1023].mask & (FREQ_TYPE_REP_5 | FREQ_TYPE_REP_5bis)))
+			continue;
+		if (index == i++)
+			return arfcn & 1023;
+	}
+
+	/* Search for ARFCN found in SI5ter. (second sub list) */
+	for (arfcn = 1; arfcn <= 1024; arfcn++) {
+		if (!(s->freq[arfcn & 1023].mask & FREQ_TYPE_REP_5ter))
+			continue;
+		if (index == i++)
+			return arfcn & 1023;
+	}
+
+	/* If not found, return EOF (-1) as idicator. */
+	return EOF;
+}
+
+int ref_decode_sysinfo10(struct gsm48_sysinfo *s,
+			   const struct gsm48_system_information_type_10 *si, int len)
+{
+	int payload_len = len - sizeof(*si);
+	struct bitvec bv;
+	int i;
+	int rc;
+
+	bv = (struct bitvec) {
+		.data_len = payload_len,
+		.data = (uint8_t *)si->rest_octets,
+	};
+
+	memcpy(s->si10_msg, si, OSMO_MIN(len, sizeof(s->si10_msg)));
+
+	/* Clear cell list. */
+	s->si10_cell_num = 0;
+	memset(s->si10_cell, 0, sizeof(s->si10_cell));
+
+	/* SI 10 Rest Octets of first neighbor cell, if included. */
+	rc = ref_decode_si10_rest_first(s, &bv, &s->si10_cell[0]);
+	if (rc == EOF) {
+		s->si10 = true;
+		return 0;
+	}
+	if (rc < 0)
+		return rc;
+	s->si10_cell[0].arfcn = ref_arfcn_from_freq_index(s, s->si10_cell[0].index);
+	s->si10_cell_num++;
+
+	for (i = 1; i < ARRAY_SIZE(s->si10_cell); i++) {
+		/* Clone last cell info and then store differential elements. */
+		memcpy(&s->si10_cell[i], &s->si10_cell[i - 1], sizeof(s->si10_cell[i]));
+		/* SI 10 Rest Octets of other neighbor cell, if included. */
+		rc = ref_decode_si10_rest_other(s, &bv, &s->si10_cell[i]);
+		if (rc == EOF)
+			break;
+		if (rc < 0)
+			return rc;
+		s->si10_cell[i].arfcn = ref_arfcn_from_freq_index(s, s->si10_cell[i].index);
+		s->si10_cell_num++;
+	}
+
+	s->si10 = true;
+	return 0;
+}
+
+int ref_decode_sysinfo13(struct gsm48_sysinfo *s,
+		   const struct gsm48_system_information_type_13 *si, int len)
+{
+#ifdef ENABLE_GPRS
+	/* Full GPRS decoding removed when GPRS disabled */
+	return 0;
+#else
+	/* GPRS disabled: mark SI13 absent */
+	s->si13 = 0;
+	return 0;
+#endif
+}
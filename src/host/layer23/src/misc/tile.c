@@ -0,0 +1,125 @@
+/* Aggregation of measurements into map tiles */
+
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+
+#include <osmocom/bb/misc/geo.h>
+#include <osmocom/bb/misc/log.h>
+#include <osmocom/bb/misc/tile.h>
+
+/* latitude of the northern and southern edge of the map */
+#define MERCATOR_LAT_MAX	85.05112878
+
+struct tile_meas {
+	uint64_t key; /* tile x in the upper, tile y in the lower half */
+	int8_t rxlev;
+};
+
+void tile_of(double longitude, double latitude, int zoom, uint32_t *x,
+	uint32_t *y)
+{
+	double n = (double)(1 << zoom), lat, tx, ty;
+
+	if (longitude >= 180)
+		longitude -= 360;
+	lat = fmax(-MERCATOR_LAT_MAX, fmin(MERCATOR_LAT_MAX, latitude))
+		/ 180.0 * PI;
+	tx = (longitude + 180.0) / 360.0 * n;
+	ty = (1.0 - asinh(tan(lat)) / PI) / 2.0 * n;
+
+	*x = fmax(0, fmin(n - 1, floor(tx)));
+	*y = fmax(0, fmin(n - 1, floor(ty)));
+}
+
+void tile_center(uint32_t x, uint32_t y, int zoom, double *longitude,
+	double *latitude)
+{
+	double n = (double)(1 << zoom);
+
+	*longitude = (x + 0.5) / n * 360.0 - 180.0;
+	*latitude = atan(sinh(PI * (1.0 - 2.0 * (y + 0.5) / n))) / PI * 180.0;
+}
+
+static int tile_meas_cmp(const void *a, const void *b)
+{
+	const struct tile_meas *ta = a, *tb = b;
+
+	if (ta->key != tb->key)
+		return (ta->key < tb->key) ? -1 : 1;
+	return ta->rxlev - tb->rxlev;
+}
+
+/* Group the measurements with position of a cell by tile on the given zoom
+ * level. The tiles are sorted by x and y. Return the number of tiles in the
+ * allocated array, or -ENOMEM. */
+int tile_aggregate(const struct node_cell *cell, int zoom,
+	struct tile **tiles)
+{
+	struct tile_meas *meas;
+	struct tile *tile;
+	unsigned int i, j, n = 0, num = 0;
+	uint32_t x, y;
+
+	*tiles = NULL;
+	meas = malloc(cell->meas_num * sizeof(*meas) + 1);
+	if (!meas)
+		return -ENOMEM;
+	for (i = 0; i < cell->meas_num; i++) {
+		if (!(cell->flags[i] & MEAS_F_GPS))
+			continue;
+		tile_of(cell->longitude[i], cell->latitude[i], zoom, &x, &y);
+		meas[n].key = ((uint64_t)x << 32) | y;
+		meas[n].rxlev = cell->rxlev[i];
+		n++;
+	}
+	if (!n) {
+		free(meas);
+		return 0;
+	}
+
+	/* measurements of a tile are adjacent and sorted by rxlev */
+	qsort(meas, n, sizeof(*meas), tile_meas_cmp);
+	for (i = 0; i < n; i++) {
+		if (i == 0 || meas[i].key != meas[i - 1].key)
+			num++;
+	}
+	*tiles = calloc(num, sizeof(**tiles));
+	if (!*tiles) {
+		free(meas);
+		return -ENOMEM;
+	}
+
+	tile = *tiles;
+	for (i = 0; i < n; i = j) {
+		for (j = i; j < n && meas[j].key == meas[i].key; j++)
+			;
+		tile->x = meas[i].key >> 32;
+		tile->y = meas[i].key & 0xffffffff;
+		tile->count = j - i;
+		tile->rxlev_min = meas[i].rxlev;
+		tile->rxlev_max = meas[j - 1].rxlev;
+		tile->rxlev_median = meas[i + (j - i) / 2].rxlev;
+		tile++;
+	}
+	free(meas);
+
+	return num;
+}
@@ -101,6 +101,8 @@ static int mobile_l23_subscr_signal_cb(unsigned int subsys, unsigned int signal,
 	switch (signal) {
 	case S_L23_SUBSCR_SIM_ATTACHED:
 		ms = signal_data;
+		/* the paging group depends on the IMSI */
+		gsm48_rr_drx_update(ms);
 		nmsg = gsm48_mmr_msgb_alloc(GSM48_MMR_REG_REQ);
 		if (!nmsg)
 			return -ENOMEM;
@@ -108,6 +110,7 @@ static int mobile_l23_subscr_signal_cb(unsigned int subsys, unsigned int signal,
 		break;
 	case S_L23_SUBSCR_SIM_DETACHED:
 		ms = signal_data;
+		gsm48_rr_drx_update(ms);
 		nmsg = gsm48_mmr_msgb_alloc(GSM48_MMR_NREG_REQ);
 		if (!nmsg)
 			return 0;
@@ -0,0 +1,540 @@
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if !defined(TARGET_FREERTOS)
+#include <sys/mman.h>
+#include <sys/file.h>
+#endif
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/common/sysinfo.h>
+#include <osmocom/bb/common/l23_app.h>
+#include <osmocom/bb/mobile/celldb.h>
+
+/* minimum number of stale records before the file is compacted */
+#define CELLDB_COMPACT_MIN	256
+
+/* do not append a record for an unchanged cell more often than this */
+#define CELLDB_REFRESH		600
+
+/* records older than this are dropped during compaction */
+#define CELLDB_MAX_AGE		(30 * 86400)
+
+#if !defined(TARGET_FREERTOS)
+
+static struct celldb {
+	int			refcount;
+	char			*path;
+	int			fd;
+	ino_t			ino; /* inode of the opened file */
+	uint8_t			*map; /* mapping of the file */
+	size_t			map_len;
+	unsigned int		num_recs; /* valid records in mapping */
+	uint32_t		*idx; /* latest record per cell, sorted */
+	unsigned int		idx_num;
+} db = {
+	.fd = -1,
+};
+
+static const struct celldb_rec *celldb_rec(unsigned int n)
+{
+	return (const struct celldb_rec *)(db.map
+		+ sizeof(struct celldb_file_hdr)
+		+ n * sizeof(struct celldb_rec));
+}
+
+/* Fletcher-16 over all octets in front of the checksum */
+static uint16_t celldb_csum(const struct celldb_rec *rec)
+{
+	const uint8_t *data = (const uint8_t *)rec;
+	uint16_t sum1 = 0, sum2 = 0;
+	int i;
+
+	for (i = 0; i < offsetof(struct celldb_rec, csum); i++) {
+		sum1 = (sum1 + data[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+
+	return (sum2 << 8) | sum1;
+}
+
+static int celldb_key_cmp(const struct celldb_rec *a,
+	const struct celldb_rec *b)
+{
+	if (a->mcc != b->mcc)
+		return (a->mcc < b->mcc) ? -1 : 1;
+	if (a->mnc != b->mnc)
+		return (a->mnc < b->mnc) ? -1 : 1;
+	if (a->mnc_3_digits != b->mnc_3_digits)
+		return (a->mnc_3_digits < b->mnc_3_digits) ? -1 : 1;
+	if (a->arfcn != b->arfcn)
+		return (a->arfcn < b->arfcn) ? -1 : 1;
+	return 0;
+}
+
+/* sort by key, latest record of the same key first */
+static int celldb_idx_cmp(const void *_a, const void *_b)
+{
+	uint32_t a = *(const uint32_t *)_a, b = *(const uint32_t *)_b;
+	int rc;
+
+	rc = celldb_key_cmp(celldb_rec(a), celldb_rec(b));
+	if (rc)
+		return rc;
+	return (a > b) ? -1 : (a < b);
+}
+
+/* build index of the latest record of each cell */
+static int celldb_build_idx(void)
+{
+	unsigned int i, j;
+
+	talloc_free(db.idx);
+	db.idx = NULL;
+	db.idx_num = 0;
+	if (!db.num_recs)
+		return 0;
+
+	db.idx = talloc_zero_array(l23_ctx, uint32_t, db.num_recs);
+	if (!db.idx)
+		return -ENOMEM;
+	for (i = 0; i < db.num_recs; i++)
+		db.idx[i] = i;
+	qsort(db.idx, db.num_recs, sizeof(*db.idx), celldb_idx_cmp);
+
+	/* remove older records of the same cell */
+	for (i = 0, j = 0; i < db.num_recs; i++) {
+		if (j && !celldb_key_cmp(celldb_rec(db.idx[j - 1]),
+					 celldb_rec(db.idx[i])))
+			continue;
+		db.idx[j++] = db.idx[i];
+	}
+	db.idx_num = j;
+
+	return 0;
+}
+
+/* (re-)map the file, if it has grown or was replaced */
+static int celldb_remap(void)
+{
+	const struct celldb_file_hdr *hdr;
+	struct stat st;
+	unsigned int n;
+
+	if (fstat(db.fd, &st) < 0)
+		return -errno;
+	if (db.map && st.st_size == db.map_len)
+		return 0;
+
+	if (db.map)
+		munmap(db.map, db.map_len);
+	db.map = NULL;
+	db.map_len = 0;
+	db.num_recs = 0;
+
+	if (st.st_size < sizeof(struct celldb_file_hdr))
+		return -EINVAL;
+	db.map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, db.fd, 0);
+	if (db.map == MAP_FAILED) {
+		db.map = NULL;
+		return -errno;
+	}
+	db.map_len = st.st_size;
+
+	hdr = (const struct celldb_file_hdr *)db.map;
+	if (memcmp(hdr->magic, CELLDB_MAGIC, sizeof(CELLDB_MAGIC))
+	 || hdr->version != CELLDB_VERSION
+	 || hdr->rec_size != sizeof(struct celldb_rec)) {
+		LOGP(DCS, LOGL_NOTICE, "Cell database '%s' has unknown "
+			"version, ignoring.\n", db.path);
+		return -EINVAL;
+	}
+
+	/* use all records up to the first torn one */
+	n = (db.map_len - sizeof(*hdr)) / sizeof(struct celldb_rec);
+	for (db.num_recs = 0; db.num_recs < n; db.num_recs++) {
+		const struct celldb_rec *rec = celldb_rec(db.num_recs);
+
+		if (rec->csum != celldb_csum(rec))
+			break;
+	}
+
+	return celldb_build_idx();
+}
+
+/* open the file, create it if it does not exist or is unusable, discard
+ * torn records at the end */
+static int celldb_open_file(void)
+{
+	struct celldb_file_hdr hdr;
+	struct stat st;
+	size_t valid;
+	int rc;
+
+	db.fd = open(db.path, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (db.fd < 0)
+		return -errno;
+	if (fstat(db.fd, &st) < 0)
+		return -errno;
+	db.ino = st.st_ino;
+
+	flock(db.fd, LOCK_EX);
+	rc = celldb_remap();
+	if (rc == -EINVAL) {
+		/* empty, foreign or old version: start a new database */
+		if (db.map)
+			munmap(db.map, db.map_len);
+		db.map = NULL;
+		db.map_len = 0;
+		memset(&hdr, 0, sizeof(hdr));
+		memcpy(hdr.magic, CELLDB_MAGIC, sizeof(CELLDB_MAGIC));
+		hdr.version = CELLDB_VERSION;
+		hdr.rec_size = sizeof(struct celldb_rec);
+		if (ftruncate(db.fd, 0) < 0
+		 || write(db.fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+			rc = -errno;
+			goto out;
+		}
+		rc = celldb_remap();
+	} else if (rc == 0) {
+		valid = sizeof(hdr) + db.num_recs * sizeof(struct celldb_rec);
+		if (valid < db.map_len) {
+			LOGP(DCS, LOGL_NOTICE, "Cell database '%s' has %zu "
+				"torn octets at the end, discarding.\n",
+				db.path, db.map_len - valid);
+			if (ftruncate(db.fd, valid) == 0)
+				rc = celldb_remap();
+		}
+	}
+out:
+	flock(db.fd, LOCK_UN);
+
+	return rc;
+}
+
+static void celldb_close_file(void)
+{
+	if (db.map)
+		munmap(db.map, db.map_len);
+	db.map = NULL;
+	db.map_len = 0;
+	db.num_recs = 0;
+	if (db.fd >= 0)
+		close(db.fd);
+	db.fd = -1;
+}
+
+/* lock the file for writing. if another process has replaced it by
+ * compaction before we got the lock, re-open it and lock the new file. */
+static int celldb_lock(void)
+{
+	struct stat st;
+	int rc;
+
+	while (1) {
+		flock(db.fd, LOCK_EX);
+		if (stat(db.path, &st) == 0 && st.st_ino == db.ino)
+			return 0;
+		flock(db.fd, LOCK_UN);
+		celldb_close_file();
+		rc = celldb_open_file();
+		if (rc < 0)
+			return rc;
+	}
+}
+
+/* find the latest record of a cell */
+static const struct celldb_rec *celldb_find(const struct celldb_rec *key)
+{
+	int lo = 0, hi = (int)db.idx_num - 1, mid, rc;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		rc = celldb_key_cmp(celldb_rec(db.idx[mid]), key);
+		if (!rc)
+			return celldb_rec(db.idx[mid]);
+		if (rc < 0)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	return NULL;
+}
+
+/* open the database, it is shared by all callers */
+int celldb_open(const char *path)
+{
+	int rc;
+
+	if (db.refcount++)
+		return 0;
+
+	db.path = talloc_strdup(l23_ctx, path);
+	rc = celldb_open_file();
+	if (rc < 0) {
+		LOGP(DCS, LOGL_ERROR, "Failed to open cell database '%s': "
+			"%s\n", path, strerror(-rc));
+		celldb_close_file();
+		return rc;
+	}
+	LOGP(DCS, LOGL_INFO, "Opened cell database '%s' (%u cells, %u "
+		"records)\n", path, db.idx_num, db.num_recs);
+
+	return 0;
+}
+
+void celldb_close(void)
+{
+	if (!db.refcount || --db.refcount)
+		return;
+
+	if (db.fd >= 0 && db.num_recs >= db.idx_num + CELLDB_COMPACT_MIN)
+		celldb_compact();
+
+	celldb_close_file();
+	talloc_free(db.idx);
+	db.idx = NULL;
+	db.idx_num = 0;
+	talloc_free(db.path);
+	db.path = NULL;
+}
+
+/* store the cell we have read, if it is new or has changed */
+int celldb_update(uint16_t arfcn, const struct gsm48_sysinfo *s,
+	uint8_t rxlev)
+{
+	const struct celldb_rec *old;
+	struct celldb_rec rec;
+	time_t now;
+	int rc;
+
+	if (db.fd < 0 || !s->lai.plmn.mcc)
+		return -EINVAL;
+
+	time(&now);
+	memset(&rec, 0, sizeof(rec));
+	rec.mcc = s->lai.plmn.mcc;
+	rec.mnc = s->lai.plmn.mnc;
+	rec.mnc_3_digits = s->lai.plmn.mnc_3_digits;
+	rec.bsic = s->bsic;
+	rec.arfcn = arfcn;
+	rec.lac = s->lai.lac;
+	rec.cell_id = s->cell_id;
+	rec.rxlev_acc_min_db = s->rxlev_acc_min_db;
+	rec.ms_txpwr_max_cch = s->ms_txpwr_max_cch;
+	rec.rxlev = rxlev;
+	if (s->cell_barr)
+		rec.flags |= CELLDB_F_BARRED;
+	rec.last_seen = now;
+	rec.csum = celldb_csum(&rec);
+
+	celldb_remap();
+	old = celldb_find(&rec);
+	if (old && old->bsic == rec.bsic && old->lac == rec.lac
+	 && old->cell_id == rec.cell_id
+	 && old->rxlev_acc_min_db == rec.rxlev_acc_min_db
+	 && old->ms_txpwr_max_cch == rec.ms_txpwr_max_cch
+	 && old->flags == rec.flags
+	 && old->last_seen + CELLDB_REFRESH > rec.last_seen)
+		return 0;
+
+	rc = celldb_lock();
+	if (rc < 0)
+		return rc;
+	if (write(db.fd, &rec, sizeof(rec)) != sizeof(rec))
+		rc = -errno;
+	flock(db.fd, LOCK_UN);
+	if (rc < 0) {
+		LOGP(DCS, LOGL_ERROR, "Failed to write cell database: %s\n",
+			strerror(-rc));
+		return rc;
+	}
+
+	rc = celldb_remap();
+	if (rc < 0)
+		return rc;
+
+	if (db.num_recs >= 2 * db.idx_num + CELLDB_COMPACT_MIN)
+		return celldb_compact();
+
+	return 0;
+}
+
+/* get up to 'max' cells of the given PLMN, strongest cell first. The records
+ * are valid until the next call of any celldb_*() function. */
+int celldb_cells(const struct osmo_plmn_id *plmn,
+	const struct celldb_rec **recs, int max)
+{
+	struct celldb_rec key;
+	const struct celldb_rec *rec;
+	int lo = 0, hi, mid, num = 0, i;
+
+	if (db.fd < 0)
+		return 0;
+	celldb_remap();
+
+	/* find the first record of the PLMN */
+	memset(&key, 0, sizeof(key));
+	key.mcc = plmn->mcc;
+	key.mnc = plmn->mnc;
+	key.mnc_3_digits = plmn->mnc_3_digits;
+	hi = db.idx_num;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (celldb_key_cmp(celldb_rec(db.idx[mid]), &key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* keep the 'max' strongest cells of the PLMN, sorted by rxlev */
+	for (; lo < db.idx_num && max > 0; lo++) {
+		rec = celldb_rec(db.idx[lo]);
+		if (rec->mcc != key.mcc || rec->mnc != key.mnc
+		 || rec->mnc_3_digits != key.mnc_3_digits)
+			break;
+		if (num == max) {
+			if (rec->rxlev <= recs[num - 1]->rxlev)
+				continue;
+			num--;
+		}
+		for (i = num; i > 0 && recs[i - 1]->rxlev < rec->rxlev; i--)
+			recs[i] = recs[i - 1];
+		recs[i] = rec;
+		num++;
+	}
+
+	return num;
+}
+
+/* write the latest record of each cell into a new file and replace the
+ * database with it */
+int celldb_compact(void)
+{
+	struct celldb_file_hdr hdr;
+	const struct celldb_rec *rec;
+	char *tmp_path;
+	time_t now;
+	unsigned int i, kept = 0;
+	int fd, rc;
+
+	if (db.fd < 0)
+		return -EINVAL;
+
+	rc = celldb_lock();
+	if (rc < 0)
+		return rc;
+	rc = celldb_remap();
+	if (rc < 0)
+		goto unlock;
+
+	/* unique name, so a stale file of a crashed process is not reused */
+	tmp_path = talloc_asprintf(l23_ctx, "%s.XXXXXX", db.path);
+	fd = mkstemp(tmp_path);
+	if (fd < 0) {
+		rc = -errno;
+		goto out_free;
+	}
+	if (fchmod(fd, 0644) < 0)
+		goto error;
+
+	time(&now);
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, CELLDB_MAGIC, sizeof(CELLDB_MAGIC));
+	hdr.version = CELLDB_VERSION;
+	hdr.rec_size = sizeof(struct celldb_rec);
+	if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+		goto error;
+	for (i = 0; i < db.idx_num; i++) {
+		rec = celldb_rec(db.idx[i]);
+		if (rec->last_seen + CELLDB_MAX_AGE < now)
+			continue;
+		if (write(fd, rec, sizeof(*rec)) != sizeof(*rec))
+			goto error;
+		kept++;
+	}
+	if (fsync(fd) < 0 || rename(tmp_path, db.path) < 0)
+		goto error;
+	close(fd);
+
+	LOGP(DCS, LOGL_INFO, "Compacted cell database '%s' (%u of %u "
+		"records kept)\n", db.path, kept, db.num_recs);
+
+	/* the old file is still locked by us, release it and use the new */
+	flock(db.fd, LOCK_UN);
+	talloc_free(tmp_path);
+	celldb_close_file();
+	return celldb_open_file();
+
+error:
+	rc = -errno;
+	close(fd);
+	unlink(tmp_path);
+	LOGP(DCS, LOGL_ERROR, "Failed to compact cell database '%s': %s\n",
+		db.path, strerror(-rc));
+out_free:
+	talloc_free(tmp_path);
+unlock:
+	flock(db.fd, LOCK_UN);
+	return rc;
+}
+
+#else /* TARGET_FREERTOS */
+
+/* no file system with mmap() on embedded targets, just use the BA list */
+
+int celldb_open(const char *path)
+{
+	return -ENOTSUP;
+}
+
+void celldb_close(void)
+{
+}
+
+int celldb_update(uint16_t arfcn, const struct gsm48_sysinfo *s,
+	uint8_t rxlev)
+{
+	return -ENOTSUP;
+}
+
+int celldb_cells(const struct osmo_plmn_id *plmn,
+	const struct celldb_rec **recs, int max)
+{
+	return 0;
+}
+
+int celldb_compact(void)
+{
+	return -ENOTSUP;
+}
+
+#endif /* TARGET_FREERTOS */
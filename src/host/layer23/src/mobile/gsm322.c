@@ -40,6 +40,7 @@
 #include <osmocom/bb/mobile/app_mobile.h>
 #include <osmocom/bb/mobile/gsm322.h>
 #include <osmocom/bb/mobile/gsm48_mm.h>
+#include <osmocom/bb/mobile/celldb.h>
 
 #include <l1ctl_proto.h>
 
@@ -68,14 +69,11 @@ static int gsm322_nb_meas_ind(struct osmocom_ms *ms, uint16_t arfcn,
 /* time for reading BCCH of neighbour cell again */
 #define GSM58_READ_AGAIN	300
 
-/* number of neighbour cells to monitor */
-#define GSM58_NB_NUMBER		6
-
 /* Timeout for reading BCCH of neighbour cells */
 #define GSM322_NB_TIMEOUT	2
 
 /* number of neighbour cells to measure for average */
-#define RLA_C_NUM		4
+#define RLA_C_NUM		GSM322_RLA_C_WIN
 
 /* wait before doing neighbour cell reselecton due to a better cell again */
 #define GSM58_RESEL_THRESHOLD	15
@@ -200,9 +198,18 @@ static int gsm322_nb_meas_ind(struct osmocom_ms *ms, uint16_t arfcn,
  * the BCCH data after 5 minutes. This timer is also used if sync or read
  * fails.
  *
- * The C1 and C2 criterion is calculated for the currently monitored neighbour
- * cells. During this process, a better neighbour cell will trigger cell
- * re-selection.
+ * Neighbour cells are indexed by frequency (cs->nb_index), so a measurement
+ * result is stored without searching the list. Each neighbour keeps a sliding
+ * window of the last RLA_C_NUM levels. cs->nb_pending counts the neighbours
+ * that still lack enough new samples, so a complete set of measurements is
+ * detected without walking the list. When complete, the up to 6 strongest
+ * cells are put into the ranked view (cs->nb_ranked).
+ *
+ * The C1 and C2 criterion is calculated for the cells in the ranked view.
+ * The part of C1 that only depends on the system information is cached until
+ * the BCCH of the neighbour is read again. During this process, a better
+ * neighbour cell will trigger cell re-selection and the best candidate is
+ * stored in cs->nb_best.
  *
  * The cell re-selection is similar to the cell selection process, except that
  * only neighbour cells are searched in order of their quality criterion C2.
@@ -483,6 +490,7 @@ static int gsm322_sync_to_cell(struct gsm322_cellsel *cs,
 	cs->rxlev_sum_dbm = cs->rxlev_count = 0;
 
 	cs->neighbour = neighbour;
+	gsm48_rr_drx_update(ms);
 
 	if (camping) {
 		cs->rla_c_dbm = -128;
@@ -513,6 +521,7 @@ static void gsm322_unselect_cell(struct gsm322_cellsel *cs)
 	cs->si = NULL;
 	memset(&cs->sel_si, 0, sizeof(cs->sel_si));
 	memset(&cs->sel_cgi, 0, sizeof(cs->sel_cgi));
+	gsm48_rr_drx_update(cs->ms);
 }
 
 /* print to DCS logging */
@@ -834,6 +843,7 @@ static void new_c_state(struct gsm322_cellsel *cs, int state)
 	}
 
 	cs->state = state;
+	gsm48_rr_drx_update(cs->ms);
 }
 
 /*
@@ -2183,6 +2193,11 @@ static int gsm322_cs_scan(struct osmocom_ms *ms)
 			 * if it is the same, it depends on arfcn
 			 */
 			test = cs->list[i].rxlev + 1;
+			/* during stored cell selection, cells from the cell
+			 * database are tried first */
+			if (cs->state == GSM322_C2_STORED_CELL_SEL
+			 && cs->list[i].stored)
+				test |= 0x80;
 			test = (test << 16) | i;
 			if (test >= cs->scan_state)
 				continue;
@@ -2285,6 +2300,9 @@ static int gsm322_cs_store(struct osmocom_ms *ms)
 		gsm_print_rxlev(cs->list[cs->arfci].rxlev),
 		osmo_lai_name(&s->lai));
 
+	/* remember cell for stored cell selection */
+	celldb_update(cs->arfcn, s, cs->list[cs->arfci].rxlev);
+
 	/* selected PLMN (auto) becomes available during "any search" */
 	if (ms->settings.plmn_mode == PLMN_MODE_AUTO
 	 && (cs->state == GSM322_ANY_SEARCH
@@ -2926,6 +2944,7 @@ int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
 
 			/* set downlink signalling failure criterion */
 			ms->meas.ds_fail = ms->meas.dsc = ms->settings.dsc_max;
+			gsm48_rr_drx_update(ms);
 			LOGP(DRR, LOGL_INFO, "using DSC of %d\n", ms->meas.dsc);
 
 			/* start in case we are camping on serving/neighbour
@@ -3015,12 +3034,10 @@ int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
 	case S_L1CTL_NEIGH_PM_IND:
 		ni = signal_data;
 		ms = ni->ms;
-#ifdef COMMING_LATE_R
 		/* in dedicated mode */
 		if (ms->rrlayer.dm_est)
 			gsm48_rr_meas_ind(ms, ni->band_arfcn, ni->rx_lev);
 		else
-#endif
 		/* in camping mode */
 		if ((ms->cellsel.state == GSM322_C3_CAMPED_NORMALLY
 		  || ms->cellsel.state == GSM322_C7_CAMPED_ANY_CELL)
@@ -3150,13 +3167,15 @@ static int gsm322_c_stored_cell_sel(struct osmocom_ms *ms,
 	struct gsm322_ba_list *ba)
 {
 	struct gsm322_cellsel *cs = &ms->cellsel;
-	int i;
+	const struct celldb_rec *cells[64];
+	int i, num;
 
 	/* we weed to rescan */
 	for (i = 0; i <= 1023+299; i++) {
 		cs->list[i].flags &= ~(GSM322_CS_FLAG_POWER
 					| GSM322_CS_FLAG_SIGNAL
 					| GSM322_CS_FLAG_SYSINFO);
+		cs->list[i].stored = 0;
 	}
 
 	new_c_state(cs, GSM322_C2_STORED_CELL_SEL);
@@ -3169,6 +3188,20 @@ static int gsm322_c_stored_cell_sel(struct osmocom_ms *ms,
 			cs->list[i].flags &= ~GSM322_CS_FLAG_BA;
 	}
 
+	/* add the known cells of the cell database, strongest first */
+	num = celldb_cells(&ba->plmn, cells, ARRAY_SIZE(cells));
+	for (i = 0; i < num; i++) {
+		int index = arfcn2index(cells[i]->arfcn);
+
+		LOGP(DCS, LOGL_DEBUG, "Stored cell ARFCN=%s (BSIC %d, LAC "
+			"0x%04x, cell ID 0x%04x, rxlev %s)\n",
+			gsm_print_arfcn(cells[i]->arfcn), cells[i]->bsic,
+			cells[i]->lac, cells[i]->cell_id,
+			gsm_print_rxlev(cells[i]->rxlev));
+		cs->list[index].flags |= GSM322_CS_FLAG_BA;
+		cs->list[index].stored = 1;
+	}
+
 	/* unset selected cell */
 	gsm322_unselect_cell(cs);
 
@@ -4059,18 +4092,65 @@ static struct gsm322_neighbour *gsm322_nb_alloc(struct gsm322_cellsel *cs,
 	nb->cs = cs;
 	nb->arfcn = arfcn;
 	nb->rla_c_dbm = -128;
+	nb->rank = -1;
 	nb->created = now;
 	llist_add_tail(&nb->entry, &cs->nb_list);
+	cs->nb_index[arfcn2index(arfcn)] = nb;
 
 	return nb;
 }
 
 static void gsm322_nb_free(struct gsm322_neighbour *nb)
 {
+	struct gsm322_cellsel *cs = nb->cs;
+	int i;
+
+	if (cs->nb_index[arfcn2index(nb->arfcn)] == nb)
+		cs->nb_index[arfcn2index(nb->arfcn)] = NULL;
+
+	/* remove from ranked view, keep order of the remaining cells */
+	if (nb->rank >= 0) {
+		for (i = nb->rank; i < cs->nb_ranked_num - 1; i++) {
+			cs->nb_ranked[i] = cs->nb_ranked[i + 1];
+			cs->nb_ranked[i]->rank = i;
+		}
+		cs->nb_ranked_num--;
+	}
+	if (cs->nb_best == nb)
+		cs->nb_best = NULL;
+
+	if (nb->state != GSM322_NB_NOT_SUP && nb->rxlev_count < RLA_C_NUM
+	 && cs->nb_pending)
+		cs->nb_pending--;
+
 	llist_del(&nb->entry);
 	talloc_free(nb);
 }
 
+/* insert neighbour cell into the ranked view, if it is one of the
+ * GSM58_NB_NUMBER strongest cells */
+static void gsm322_nb_rank(struct gsm322_cellsel *cs,
+	struct gsm322_neighbour *nb)
+{
+	int i = cs->nb_ranked_num;
+
+	if (i == GSM58_NB_NUMBER) {
+		if (nb->rla_c_dbm <= cs->nb_ranked[i - 1]->rla_c_dbm)
+			return;
+		/* the weakest cell drops out */
+		cs->nb_ranked[--i]->rank = -1;
+	} else
+		cs->nb_ranked_num++;
+
+	while (i > 0 && cs->nb_ranked[i - 1]->rla_c_dbm < nb->rla_c_dbm) {
+		cs->nb_ranked[i] = cs->nb_ranked[i - 1];
+		cs->nb_ranked[i]->rank = i;
+		i--;
+	}
+	cs->nb_ranked[i] = nb;
+	nb->rank = i;
+}
+
 /* check and calculate reselection criterion for all 6 neighbour cells and
  * return, if cell reselection has to be triggered */
 static int gsm322_nb_check(struct osmocom_ms *ms, int any)
@@ -4079,15 +4159,17 @@ static int gsm322_nb_check(struct osmocom_ms *ms, int any)
 	struct gsm_subscriber *subscr = &ms->subscr;
 	struct gsm_settings *set = &ms->settings;
 	struct gsm48_sysinfo *s;
-	int i = 0, reselect = 0;
+	int i, reselect = 0;
 	uint16_t acc_class;
 	int class;
 	enum gsm_band band;
-	struct gsm322_neighbour *nb;
+	struct gsm322_neighbour *nb, *best_nb_low = NULL, *best_nb_normal = NULL;
+	int16_t best_low = -32768, best_normal = -32768;
 	time_t now;
 	char arfcn_text[10];
 
 	time(&now);
+	cs->nb_best = NULL;
 
 	/* set out access class depending on the cell selection type */
 	if (any) {
@@ -4110,8 +4192,9 @@ static int gsm322_nb_check(struct osmocom_ms *ms, int any)
 			cs->rla_c_dbm, bargraph(cs->rla_c_dbm / 2, -55, -24));
 	}
 
-	/* loop through all neighbour cells and select best cell */
-	llist_for_each_entry(nb, &cs->nb_list, entry) {
+	/* loop through the strongest neighbour cells and select best cell */
+	for (i = 0; i < cs->nb_ranked_num; i++) {
+		nb = cs->nb_ranked[i];
 		LOGP(DNB, LOGL_INFO, "Checking cell of ARFCN %s for cell "
 			"re-selection.\n", gsm_print_arfcn(nb->arfcn));
 		s = cs->list[arfcn2index(nb->arfcn)].sysinfo;
@@ -4152,15 +4235,24 @@ static int gsm322_nb_check(struct osmocom_ms *ms, int any)
 		if (s->sp && s->sp_cbq)
 			nb->prio_low = 1;
 
-		/* get C1 & C2 */
-		if (gsm_arfcn2band_rc(nb->arfcn, &band) != 0) {
-			LOGP(DNB, LOGL_ERROR, "gsm_arfcn2band_rc() failed\n");
-			goto cont;
+		/* get C1 & C2, the part of C1 that depends on the system
+		 * information is only calculated after reading the BCCH */
+		if (!nb->c1_offset_valid) {
+			if (gsm_arfcn2band_rc(nb->arfcn, &band) != 0) {
+				LOGP(DNB, LOGL_ERROR, "gsm_arfcn2band_rc() "
+					"failed\n");
+				goto cont;
+			}
+			class = class_of_band(ms, band);
+			nb->c1_offset = nb->rla_c_dbm - calculate_c1(DNB,
+				nb->rla_c_dbm, s->rxlev_acc_min_db,
+				ms_pwr_dbm(band, s->ms_txpwr_max_cch),
+				ms_class_gmsk_dbm(band, class));
+			nb->c1_offset_valid = 1;
 		}
-		class = class_of_band(ms, band);
-		nb->c1 = calculate_c1(DNB, nb->rla_c_dbm, s->rxlev_acc_min_db,
-			ms_pwr_dbm(band, s->ms_txpwr_max_cch),
-			ms_class_gmsk_dbm(band, class));
+		nb->c1 = nb->rla_c_dbm - nb->c1_offset;
+		LOGP(DNB, LOGL_INFO, "C1 (RLA_C (%d) - offset (%d)) = %d\n",
+			nb->rla_c_dbm, nb->c1_offset, nb->c1);
 		nb->c2 = calculate_c2(nb->c1, 0,
 			(cs->last_serving_valid
 				&& cs->last_serving_arfcn == nb->arfcn),
@@ -4234,6 +4326,19 @@ static int gsm322_nb_check(struct osmocom_ms *ms, int any)
 		/* we can use this cell, if it is better */
 		nb->suitable_allowable = 1;
 
+		/* remember the best candidate for re-selection */
+		if (nb->prio_low) {
+			if (nb->c2 - nb->crh > best_low) {
+				best_low = nb->c2 - nb->crh;
+				best_nb_low = nb;
+			}
+		} else {
+			if (nb->c2 - nb->crh > best_normal) {
+				best_normal = nb->c2 - nb->crh;
+				best_nb_normal = nb;
+			}
+		}
+
 		/* check priority */
 		if (!cs->prio_low && nb->prio_low) {
 			LOGP(DNB, LOGL_INFO, "Skip cell: cell has low "
@@ -4257,11 +4362,13 @@ static int gsm322_nb_check(struct osmocom_ms *ms, int any)
 		}
 
 cont:
-		if (++i == GSM58_NB_NUMBER)
-			break;
+		continue;
 	}
 
-	if (!i) {
+	/* same preference as gsm322_nb_scan() */
+	cs->nb_best = (best_nb_low) ? best_nb_low : best_nb_normal;
+
+	if (!cs->nb_ranked_num) {
 		if (ms->rrlayer.monitor)
 			l23_vty_ms_notify(ms, "MON: no neighbour cells\n");
 	}
@@ -4286,7 +4393,7 @@ static int gsm322_nb_scan(struct osmocom_ms *ms)
 {
 	struct gsm322_cellsel *cs = &ms->cellsel;
 	struct gsm_settings *set = &ms->settings;
-	int i = 0;
+	int i;
 	struct gsm322_neighbour *nb, *best_nb_low = NULL, *best_nb_normal = 0;
 	int16_t best_low = -32768, best_normal = -32768;
 
@@ -4302,8 +4409,18 @@ static int gsm322_nb_scan(struct osmocom_ms *ms)
 		goto no_cell_found;
 	}
 
-	/* loop through all neighbour cells and select best cell */
-	llist_for_each_entry(nb, &cs->nb_list, entry) {
+	/* the best cell is known from the last check, if not tried yet */
+	nb = cs->nb_best;
+	if (nb && !nb->checked_for_resel) {
+		LOGP(DCS, LOGL_INFO, "Best neighbour cell with ARFCN %s "
+			"selected. (%s priority)\n", gsm_print_arfcn(nb->arfcn),
+			(nb->prio_low) ? "low" : "normal");
+		goto found;
+	}
+
+	/* loop through the strongest neighbour cells and select best cell */
+	for (i = 0; i < cs->nb_ranked_num; i++) {
+		nb = cs->nb_ranked[i];
 		LOGP(DCS, LOGL_INFO, "Checking cell with ARFCN %s for cell "
 			"re-selection. (C2 = %d)\n", gsm_print_arfcn(nb->arfcn),
 			nb->c2);
@@ -4335,8 +4452,7 @@ static int gsm322_nb_scan(struct osmocom_ms *ms)
 		}
 
 cont:
-		if (++i == GSM58_NB_NUMBER)
-			break;
+		continue;
 	}
 
 	nb = NULL;
@@ -4367,6 +4483,7 @@ no_cell_found:
 
 		return 0;
 	}
+found:
 	nb->checked_for_resel = 1;
 
 	/* NOTE: We might already have system information from previous
@@ -4400,7 +4517,7 @@ static int gsm322_nb_start(struct osmocom_ms *ms, int synced)
 	struct gsm322_cellsel *cs = &ms->cellsel;
 	struct gsm48_sysinfo *s = &cs->sel_si;
 	struct gsm322_neighbour *nb, *nb2;
-	int i, num;
+	int i, num, others, slots, first;
 	uint8_t map[128];
 	uint16_t nc[32];
 	uint8_t changed = 0;
@@ -4477,16 +4594,36 @@ static int gsm322_nb_start(struct osmocom_ms *ms, int synced)
 	if (!changed && cs->nb_meas_set)
 		return 0;
 
-	/* start neighbour cell measurement task */
+	/* start neighbour cell measurement task, count the cells that need
+	 * samples for a complete set of measurements. layer1 measures up to
+	 * 32 cells, so the ranked cells are always measured and a window that
+	 * moves after each complete set is taken from the other cells. */
 	num = 0;
+	cs->nb_pending = 0;
+	for (i = 0; i < cs->nb_ranked_num; i++) {
+		nb = cs->nb_ranked[i];
+		nc[num] = nb->arfcn;
+		num++;
+		if (nb->rxlev_count < RLA_C_NUM)
+			cs->nb_pending++;
+	}
+	others = 0;
 	llist_for_each_entry(nb, &cs->nb_list, entry) {
-		if (nb->state == GSM322_NB_NOT_SUP)
+		if (nb->state != GSM322_NB_NOT_SUP && nb->rank < 0)
+			others++;
+	}
+	slots = 32 - num;
+	first = (others > slots) ? cs->nb_rotate % others : 0;
+	i = 0;
+	llist_for_each_entry(nb, &cs->nb_list, entry) {
+		if (nb->state == GSM322_NB_NOT_SUP || nb->rank >= 0)
+			continue;
+		if ((i++ - first + others) % others >= slots)
 			continue;
-		/* it should not happen that there are more than 32 nb-cells */
-		if (num == 32)
-			break;
 		nc[num] = nb->arfcn;
 		num++;
+		if (nb->rxlev_count < RLA_C_NUM)
+			cs->nb_pending++;
 	}
 	LOGP(DNB, LOGL_INFO, "Sending list of neighbour cells to layer1.\n");
 	l1ctl_tx_neigh_pm_req(ms, num, nc);
@@ -4501,13 +4638,14 @@ static int gsm322_nb_trigger_event(struct gsm322_cellsel *cs)
 {
 	struct osmocom_ms *ms = cs->ms;
 	struct gsm322_neighbour *nb, *nb_sync = NULL, *nb_again = NULL;
-	int i = 0;
+	int i;
 	time_t now;
 
 	time(&now);
 
-	/* check the list for reading neighbour cell's BCCH */
-	llist_for_each_entry(nb, &cs->nb_list, entry) {
+	/* check the strongest cells for reading neighbour cell's BCCH */
+	for (i = 0; i < cs->nb_ranked_num; i++) {
+		nb = cs->nb_ranked[i];
 		if (nb->rla_c_dbm >= cs->ms->settings.min_rxlev_dbm) {
 			/* select the strongest unsynced cell */
 			if (nb->state == GSM322_NB_RLA_C) {
@@ -4531,8 +4669,6 @@ printf("%d time to sync again: %u\n", nb->arfcn, now + GSM58_READ_AGAIN - nb->wh
 					nb_again = nb;
 			}
 		}
-		if (++i == GSM58_NB_NUMBER)
-			break;
 	}
 
 	/* trigger sync to neighbour cell, priorize the untested cell */
@@ -4637,6 +4773,7 @@ static int gsm322_nb_read(struct gsm322_cellsel *cs, int yes)
 		cs->arfcn, gsm_print_rxlev(cs->list[cs->arfci].rxlev));
 
 	cs->neighbour->state = (yes) ? GSM322_NB_SYSINFO : GSM322_NB_NO_BCCH;
+	cs->neighbour->c1_offset_valid = 0;
 	time(&now);
 	cs->neighbour->when = now;
 
@@ -4646,11 +4783,8 @@ static int gsm322_nb_read(struct gsm322_cellsel *cs, int yes)
 /* a complete set of measurements are received, calculate the RLA_C, sort */
 static int gsm322_nb_new_rxlev(struct gsm322_cellsel *cs)
 {
-	struct gsm322_neighbour *nb, *strongest_nb;
-	int i = 0;
-	int8_t strongest;
-	struct llist_head sorted;
-	struct llist_head *lh, *lh2;
+	struct gsm322_neighbour *nb;
+	int i, supported = 0;
 	struct gsm48_sysinfo *s = &cs->sel_si;
 	enum gsm_band band;
 	int class;
@@ -4685,8 +4819,11 @@ static int gsm322_nb_new_rxlev(struct gsm322_cellsel *cs)
 			cs->prio_low = 1;
 	}
 
-	/* calculate the RAL_C of neighbours */
+	/* calculate the RAL_C of neighbours and rank the 6 strongest */
+	cs->nb_ranked_num = 0;
+	cs->nb_pending = 0;
 	llist_for_each_entry(nb, &cs->nb_list, entry) {
+		nb->rank = -1;
 		if (nb->state == GSM322_NB_NOT_SUP)
 			continue;
 		/* if sysinfo is gone due to scanning, mark neighbour as
@@ -4697,46 +4834,29 @@ static int gsm322_nb_new_rxlev(struct gsm322_cellsel *cs)
 				nb->when = 0;
 			}
 		}
-		nb->rla_c_dbm =
-			(nb->rxlev_sum_dbm + (nb->rxlev_count / 2))
-				/ nb->rxlev_count;
+		if (nb->rxlev_win_num)
+			nb->rla_c_dbm =
+				(nb->rxlev_sum_dbm + (nb->rxlev_win_num / 2))
+					/ nb->rxlev_win_num;
 		nb->rxlev_count = 0;
-		nb->rxlev_sum_dbm = 0;
+		/* only 32 cells are measured, see gsm322_nb_start() */
+		if (cs->nb_pending < 32)
+			cs->nb_pending++;
+		supported++;
 		if (nb->state == GSM322_NB_NEW)
 			nb->state = GSM322_NB_RLA_C;
+		gsm322_nb_rank(cs, nb);
 	}
 
-	/* sort the 6 strongest */
-	INIT_LLIST_HEAD(&sorted);
+	for (i = 0; i < cs->nb_ranked_num; i++)
+		LOGP(DNB, LOGL_INFO, "#%d ARFCN=%d RLA_C=%d\n", i + 1,
+			cs->nb_ranked[i]->arfcn, cs->nb_ranked[i]->rla_c_dbm);
 
-	/* detach up to 6 of the strongest neighbour cells from list and put
-	 * them in the "sorted" list */
-	while (!llist_empty(&cs->nb_list)) {
-		strongest = -128;
-		strongest_nb = NULL;
-		llist_for_each_entry(nb, &cs->nb_list, entry) {
-			if (nb->state == GSM322_NB_NOT_SUP)
-				continue;
-			if (nb->rla_c_dbm > strongest) {
-				strongest = nb->rla_c_dbm;
-				strongest_nb = nb;
-			}
-		}
-		if (strongest_nb == NULL) /* this should not happen */
-			break;
-		LOGP(DNB, LOGL_INFO, "#%d ARFCN=%d RLA_C=%d\n",
-			i+1, strongest_nb->arfcn, strongest_nb->rla_c_dbm);
-		llist_del(&strongest_nb->entry);
-		llist_add(&strongest_nb->entry, &sorted);
-		if (++i == GSM58_NB_NUMBER)
-			break;
-	}
-
-	/* take the sorted list and attat it to the head of the neighbour cell
-	 * list */
-	llist_for_each_safe(lh, lh2, &sorted) {
-		llist_del(lh);
-		llist_add(lh, &cs->nb_list);
+	/* not all cells were measured, move on to the next ones */
+	if (supported > 32) {
+		cs->nb_rotate += 32 - cs->nb_ranked_num;
+		cs->nb_meas_set = 0;
+		gsm322_nb_start(cs->ms, 0);
 	}
 
 	return gsm322_nb_trigger_event(cs);
@@ -4749,32 +4869,31 @@ static int gsm322_nb_meas_ind(struct osmocom_ms *ms, uint16_t arfcn,
 {
 	struct gsm322_cellsel *cs = &ms->cellsel;
 	struct gsm322_neighbour *nb;
-	int enough_results = 1, result = 0;
 
-	llist_for_each_entry(nb, &cs->nb_list, entry) {
-		if (nb->state == GSM322_NB_NOT_SUP)
-			continue;
-		if (arfcn != nb->arfcn) {
-			if (nb->rxlev_count < RLA_C_NUM)
-				enough_results = 0;
-			continue;
-		}
-		nb->rxlev_sum_dbm += rx_lev - 110;
-		nb->rxlev_count++;
-		LOGP(DNB, LOGL_INFO, "Measurement result for ARFCN %s: %d\n",
-			gsm_print_arfcn(arfcn), rx_lev - 110);
-
-		if (nb->rxlev_count < RLA_C_NUM)
-			enough_results = 0;
-
-		result = 1;
-	}
-
-	if (!result)
+	nb = cs->nb_index[arfcn2index(arfcn)];
+	if (!nb || nb->state == GSM322_NB_NOT_SUP) {
 		LOGP(DNB, LOGL_INFO, "Measurement result for ARFCN %s not "
 			"requested. (not a bug)\n", gsm_print_arfcn(arfcn));
+		goto check;
+	}
 
-	if (enough_results)
+	/* the new level replaces the oldest level in the window */
+	if (nb->rxlev_win_num == RLA_C_NUM)
+		nb->rxlev_sum_dbm -= nb->rxlev_win_dbm[nb->rxlev_win_pos];
+	else
+		nb->rxlev_win_num++;
+	nb->rxlev_win_dbm[nb->rxlev_win_pos] = rx_lev - 110;
+	nb->rxlev_sum_dbm += rx_lev - 110;
+	nb->rxlev_win_pos = (nb->rxlev_win_pos + 1) % RLA_C_NUM;
+	LOGP(DNB, LOGL_INFO, "Measurement result for ARFCN %s: %d\n",
+		gsm_print_arfcn(arfcn), rx_lev - 110);
+
+	if (nb->rxlev_count < RLA_C_NUM && ++nb->rxlev_count == RLA_C_NUM
+	 && cs->nb_pending)
+		cs->nb_pending--;
+
+check:
+	if (!cs->nb_pending)
 		return gsm322_nb_new_rxlev(cs);
 
 	return 0;
@@ -4910,10 +5029,63 @@ int gsm322_dump_ba_list(struct gsm322_cellsel *cs, const struct osmo_plmn_id *pl
 	return 0;
 }
 
+static void gsm322_dump_nb(struct gsm322_cellsel *cs,
+	struct gsm322_neighbour *nb, int i,
+	void (*print)(void *, const char *, ...), void *priv)
+{
+	struct gsm48_sysinfo *s;
+
+	if (i == 1) {
+		print(priv, "#      |ARFCN  |RLA_C  |C1     |C2     |"
+			"CRH    |prio   |LAC    |cell ID|usable |"
+			"state\n");
+		print(priv, "----------------------------------------"
+			"----------------------------------------"
+			"-------\n");
+	} else
+	if (i == cs->nb_ranked_num + 1)
+		print(priv, "--- unmonitored cells: ---\n");
+	if (cs->last_serving_valid
+	 && cs->last_serving_arfcn == nb->arfcn)
+		print(priv, "%2d last|", i);
+	else
+		print(priv, "%2d     |", i);
+	if ((nb->arfcn & ARFCN_PCS))
+		print(priv, "%4dPCS|", nb->arfcn & 1023);
+	else if (i >= 512 && i <= 885)
+		print(priv, "%4dDCS|", nb->arfcn & 1023);
+	else
+		print(priv, "%4d   |", nb->arfcn);
+	if (nb->state == GSM322_NB_NOT_SUP) {
+		print(priv, "  ARFCN not supported\n");
+		return;
+	}
+	if (nb->rla_c_dbm > -128)
+		print(priv, "%6s |",
+			gsm_print_rxlev(nb->rla_c_dbm + 110));
+	else
+		print(priv, "-      |");
+	if (nb->state == GSM322_NB_SYSINFO && nb->c12_valid)
+		print(priv, "%4d   |%4d   |%4d   |", nb->c1, nb->c1,
+			nb->crh);
+	else
+		print(priv, "-      |-      |-      |");
+	s = cs->list[arfcn2index(nb->arfcn)].sysinfo;
+	if (nb->state == GSM322_NB_SYSINFO && s) {
+		print(priv, "%s |0x%04x |0x%04x |",
+			(nb->prio_low) ? "low   ":"normal", s->lai.lac,
+			s->cell_id);
+	} else
+		print(priv, "-      |-      |-      |");
+
+	print(priv, "%s    |",
+		(nb->suitable_allowable) ? "yes" : "no ");
+	print(priv, "%s\n", get_nb_state_name(nb->state));
+}
+
 int gsm322_dump_nb_list(struct gsm322_cellsel *cs,
 			void (*print)(void *, const char *, ...), void *priv)
 {
-	struct gsm48_sysinfo *s;
 	struct gsm322_neighbour *nb;
 	int i = 0;
 
@@ -4931,54 +5103,14 @@ int gsm322_dump_nb_list(struct gsm322_cellsel *cs,
 	print(priv, "LAC=0x%04x\n\n", (cs->selected) ? cs->sel_si.lai.lac : 0);
 
 	print(priv, "Neighbour cells:\n\n");
+	/* ranked (monitored) cells first, then all others */
+	for (i = 0; i < cs->nb_ranked_num; i++)
+		gsm322_dump_nb(cs, cs->nb_ranked[i], i + 1, print, priv);
 	llist_for_each_entry(nb, &cs->nb_list, entry) {
-		if (i == 0) {
-			print(priv, "#      |ARFCN  |RLA_C  |C1     |C2     |"
-				"CRH    |prio   |LAC    |cell ID|usable |"
-				"state\n");
-			print(priv, "----------------------------------------"
-				"----------------------------------------"
-				"-------\n");
-		} else
-		if (i == GSM58_NB_NUMBER)
-			print(priv, "--- unmonitored cells: ---\n");
-		i++;
-		if (cs->last_serving_valid
-		 && cs->last_serving_arfcn == nb->arfcn)
-			print(priv, "%2d last|", i);
-		else
-			print(priv, "%2d     |", i);
-		if ((nb->arfcn & ARFCN_PCS))
-			print(priv, "%4dPCS|", nb->arfcn & 1023);
-		else if (i >= 512 && i <= 885)
-			print(priv, "%4dDCS|", nb->arfcn & 1023);
-		else
-			print(priv, "%4d   |", nb->arfcn);
-		if (nb->state == GSM322_NB_NOT_SUP) {
-			print(priv, "  ARFCN not supported\n");
+		if (nb->rank >= 0)
 			continue;
-		}
-		if (nb->rla_c_dbm > -128)
-			print(priv, "%6s |",
-				gsm_print_rxlev(nb->rla_c_dbm + 110));
-		else
-			print(priv, "-      |");
-		if (nb->state == GSM322_NB_SYSINFO && nb->c12_valid)
-			print(priv, "%4d   |%4d   |%4d   |", nb->c1, nb->c1,
-				nb->crh);
-		else
-			print(priv, "-      |-      |-      |");
-		s = cs->list[arfcn2index(nb->arfcn)].sysinfo;
-		if (nb->state == GSM322_NB_SYSINFO && s) {
-			print(priv, "%s |0x%04x |0x%04x |",
-				(nb->prio_low) ? "low   ":"normal", s->lai.lac,
-				s->cell_id);
-		} else
-			print(priv, "-      |-      |-      |");
-
-		print(priv, "%s    |",
-			(nb->suitable_allowable) ? "yes" : "no ");
-		print(priv, "%s\n", get_nb_state_name(nb->state));
+		i++;
+		gsm322_dump_nb(cs, nb, i, print, priv);
 	}
 
 	if (i == 0)
@@ -4996,7 +5128,7 @@ int gsm322_init(struct osmocom_ms *ms)
 	struct gsm322_plmn *plmn = &ms->plmn;
 	struct gsm322_cellsel *cs = &ms->cellsel;
 	FILE *fp;
-	char *ba_filename;
+	char *ba_filename, *db_filename;
 	int i;
 	struct gsm322_ba_list *ba;
 	uint8_t buf[4];
@@ -5022,6 +5154,11 @@ int gsm322_init(struct osmocom_ms *ms)
 	INIT_LLIST_HEAD(&cs->ba_list);
 	INIT_LLIST_HEAD(&cs->nb_list);
 
+	/* open cell database that is shared by all MS */
+	db_filename = talloc_asprintf(ms, "%s/cells.db", config_dir);
+	celldb_open(db_filename);
+	talloc_free(db_filename);
+
 	/* set supported frequencies in cell selection list */
 	for (i = 0; i <= 1023+299; i++)
 		if ((ms->settings.freq_map[i >> 3] & (1 << (i & 7))))
@@ -5170,6 +5307,7 @@ int gsm322_exit(struct osmocom_ms *ms)
 
 	/* store BA list */
 	gsm322_write_ba(ms);
+	celldb_close();
 
 	/* free lists */
 	while ((msg = msgb_dequeue(&plmn->event_queue)))
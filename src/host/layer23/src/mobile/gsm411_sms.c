@@ -26,14 +26,18 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <osmocom/core/msgb.h>
+#include <osmocom/core/timer.h>
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/common/osmocom_data.h>
 #include <osmocom/bb/common/ms.h>
 #include <osmocom/bb/mobile/mncc.h>
 #include <osmocom/bb/mobile/transaction.h>
 #include <osmocom/bb/mobile/gsm411_sms.h>
+#include <osmocom/bb/mobile/sms_store.h>
+#include <osmocom/bb/mobile/app_mobile.h>
 #include <osmocom/bb/mobile/gsm44068_gcc_bcc.h>
 #include <osmocom/gsm/gsm0411_utils.h>
 #include <osmocom/core/talloc.h>
@@ -53,6 +57,8 @@ static int gsm411_mm_send(struct gsm411_smc_inst *inst, int msg_type,
 			struct msgb *msg, int cp_msg_type);
 static int gsm411_mn_send(struct gsm411_smr_inst *inst, int msg_type,
 			struct msgb *msg);
+static void sms_bulk_done(struct osmocom_ms *ms, struct gsm_sms *sms,
+	uint8_t cause);
 /*
  * init / exit
  */
@@ -70,6 +76,10 @@ int gsm411_sms_exit(struct osmocom_ms *ms)
 
 	LOGP(DLSMS, LOGL_INFO, "exit SMS processes for %s\n", ms->name);
 
+	sms_bulk_flush(ms);
+	sms_store_close(ms->sms_store);
+	ms->sms_store = NULL;
+
 	llist_for_each_entry_safe(trans, trans2, &ms->trans_list, entry) {
 		if (trans->protocol == GSM48_PDISC_SMS) {
 			LOGP(DLSMS, LOGL_NOTICE, "Free pendig "
@@ -121,6 +131,13 @@ struct gsm_sms *sms_from_text(const char *receiver, int dcs, const char *text)
 static int gsm411_sms_report(struct osmocom_ms *ms, struct gsm_sms *sms,
 	uint8_t cause)
 {
+	/* bulk submissions are summarized when the queue is done */
+	if (sms->bulk) {
+		mobile_prim_ntfy_sms_status(ms, sms, cause);
+		sms_bulk_done(ms, sms, cause);
+		return 0;
+	}
+
 	l23_vty_ms_notify(ms, NULL);
 	if (!cause)
 		l23_vty_ms_notify(ms, "SMS to %s successful\n", sms->address);
@@ -165,7 +182,7 @@ static int gsm411_trans_free(struct gsm_trans *trans)
 	LOGP(DLSMS, LOGL_INFO, "Sending MMSMS_REL_REQ\n");
 	gsm48_mmxx_downmsg(trans->ms, nmsg);
 
-	trans->callref = 0;
+	trans_set_callref(trans, 0);
 	trans_free(trans);
 
 	return 0;
@@ -175,15 +192,29 @@ static int gsm411_trans_free(struct gsm_trans *trans)
  * receive SMS
  */
 
+/* get the store of received SMS, open it on first use */
+struct sms_store *gsm411_sms_store(struct osmocom_ms *ms)
+{
+	char *path;
+
+	if (ms->sms_store)
+		return ms->sms_store;
+
+	path = talloc_asprintf(ms, "%s/%s.sms", config_dir, ms->name);
+	if (!path)
+		return NULL;
+	ms->sms_store = sms_store_open(ms, path);
+	talloc_free(path);
+
+	return ms->sms_store;
+}
+
 /* store the SMS to disk */
 static int sms_store(struct osmocom_ms *ms, struct msgb *msg,
 	struct gsm_sms *gsms)
 {
-	const char osmocomsms[] = ".osmocom/bb/sms.txt";
-	const char *home;
-	char *sms_file;
+	struct sms_store *st;
 	char vty_text[sizeof(gsms->text)], *p;
-	FILE *fp;
 
 	/* remove linefeeds and show at VTY */
 	strcpy(vty_text, gsms->text);
@@ -194,26 +225,13 @@ static int sms_store(struct osmocom_ms *ms, struct msgb *msg,
 	l23_vty_ms_notify(ms, NULL);
 	l23_vty_ms_notify(ms, "SMS from %s: '%s'\n", gsms->address, vty_text);
 
-	home = getenv("HOME");
-        if (!home) {
-fail:
-		fprintf(stderr, "Can't deliver SMS, be sure to create '%s' in "
-			"your home directory.\n", osmocomsms);
+	/* the network keeps the SMS, if we cannot store it */
+	st = gsm411_sms_store(ms);
+	if (!st || sms_store_add(st, gsms) < 0) {
+		LOGP(DLSMS, LOGL_ERROR, "Can't deliver SMS, failed to write "
+			"the SMS store\n");
 		return GSM411_RP_CAUSE_MT_MEM_EXCEEDED;
 	}
-	sms_file = talloc_asprintf(l23_ctx, "%s/%s", home, osmocomsms);
-	if (!sms_file)
-		goto fail;
-
-	fp = fopen(sms_file, "a");
-	if (!fp) {
-		talloc_free(sms_file);
-		goto fail;
-	}
-	fprintf(fp, "[SMS from %s]\n%s\n", gsms->address, gsms->text);
-	fclose(fp);
-
-	talloc_free(sms_file);
 
 	return 0;
 }
@@ -698,6 +716,9 @@ int gsm411_tx_sms_submit(struct osmocom_ms *ms, const char *sms_sca,
 	if (rc < 0) {
 error:
 		gsm411_sms_report(ms, sms, GSM411_RP_CAUSE_SEMANT_INC_MSG);
+		/* reported, so don't let the transaction report it again */
+		trans->sms.sms = NULL;
+		sms_free(sms);
 		gsm411_trans_free(trans);
 		msgb_free(msg);
 		return rc;
@@ -734,6 +755,294 @@ int sms_send(struct osmocom_ms *ms, const char *sms_sca, const char *number,
 	return gsm411_tx_sms_submit(ms, sms_sca, sms);
 }
 
+/*
+ * bulk submission
+ */
+
+/* Messages queued per MS are submitted as fast as the limits allow. A
+ * transaction that completes starts the next one before it releases its
+ * own MM connection, so MM only adds a connection with a CM SERVICE
+ * REQUEST on the RR connection that is already up. */
+
+#define SMS_BULK_POLL_MS	100
+
+struct sms_bulk_msg {
+	struct llist_head entry;
+	struct gsm_sms *sms;
+	char sca[22];
+};
+
+struct sms_bulk {
+	struct osmocom_ms *ms;
+	struct llist_head queue; /* struct sms_bulk_msg */
+	unsigned int pending, inflight;
+	bool kicking;
+	uint8_t msg_ref;
+
+	/* limits */
+	unsigned int concurrency; /* transactions at a time */
+	unsigned int rate; /* submissions per minute, 0 = unlimited */
+	struct timespec next_start;
+	struct osmo_timer_list timer;
+
+	/* statistics of the current run */
+	unsigned int submitted, acked, failed;
+	struct timespec first, last; /* first submission, last result */
+	uint64_t lat_sum; /* submission to RP-ACK in ms */
+	uint32_t lat_min, lat_max;
+};
+
+static int64_t ts_diff_us(const struct timespec *a, const struct timespec *b)
+{
+	return (int64_t)(a->tv_sec - b->tv_sec) * 1000000
+		+ (a->tv_nsec - b->tv_nsec) / 1000;
+}
+
+static void ts_add_us(struct timespec *ts, uint32_t us)
+{
+	ts->tv_sec += us / 1000000;
+	ts->tv_nsec += (us % 1000000) * 1000;
+	if (ts->tv_nsec >= 1000000000) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000;
+	}
+}
+
+static void bulk_timeout(void *arg);
+
+static struct sms_bulk *bulk_get(struct osmocom_ms *ms)
+{
+	struct sms_bulk *b;
+
+	if (ms->sms_bulk)
+		return ms->sms_bulk;
+
+	b = talloc_zero(ms, struct sms_bulk);
+	if (!b)
+		return NULL;
+	b->ms = ms;
+	INIT_LLIST_HEAD(&b->queue);
+	b->concurrency = 1;
+	b->timer.cb = bulk_timeout;
+	b->timer.data = b;
+	ms->sms_bulk = b;
+
+	return b;
+}
+
+/* MM accepts an establishment only in these states */
+static bool bulk_may_start(struct osmocom_ms *ms, struct sms_bulk *b)
+{
+	struct gsm48_mmlayer *mm = &ms->mmlayer;
+
+	if (b->inflight >= b->concurrency)
+		return false;
+
+	switch (mm->state) {
+	case GSM48_MM_ST_MM_CONN_ACTIVE:
+		/* reuse the RR connection */
+		return true;
+	case GSM48_MM_ST_MM_IDLE:
+		/* the first transaction establishes the RR connection */
+		return !b->inflight
+			&& mm->substate == GSM48_MM_SST_NORMAL_SERVICE;
+	default:
+		return false;
+	}
+}
+
+static void bulk_kick(struct osmocom_ms *ms, struct sms_bulk *b)
+{
+	struct sms_bulk_msg *bm;
+	struct timespec now;
+	int64_t wait;
+
+	/* a submission that fails at once reports while we are here */
+	if (b->kicking)
+		return;
+	b->kicking = true;
+
+	while (!llist_empty(&b->queue) && bulk_may_start(ms, b)) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (b->rate) {
+			wait = ts_diff_us(&b->next_start, &now);
+			if (wait > 0) {
+				osmo_timer_schedule(&b->timer, wait / 1000000,
+					wait % 1000000);
+				b->kicking = false;
+				return;
+			}
+			/* no credit is saved up while idle */
+			b->next_start = now;
+			ts_add_us(&b->next_start, 60000000 / b->rate);
+		}
+
+		bm = llist_first_entry(&b->queue, struct sms_bulk_msg, entry);
+		llist_del(&bm->entry);
+		b->pending--;
+		b->inflight++;
+		if (!b->submitted++)
+			b->first = now;
+		bm->sms->submitted = now;
+		gsm411_tx_sms_submit(ms, bm->sca, bm->sms);
+		talloc_free(bm);
+	}
+
+	/* MM is busy with a connection, look again later */
+	if (!llist_empty(&b->queue) && b->inflight < b->concurrency
+	 && !osmo_timer_pending(&b->timer))
+		osmo_timer_schedule(&b->timer, 0, SMS_BULK_POLL_MS * 1000);
+
+	b->kicking = false;
+}
+
+static void bulk_timeout(void *arg)
+{
+	struct sms_bulk *b = arg;
+
+	bulk_kick(b->ms, b);
+}
+
+/* result of a bulk submission, the SMS is freed by the caller */
+static void sms_bulk_done(struct osmocom_ms *ms, struct gsm_sms *sms,
+	uint8_t cause)
+{
+	struct sms_bulk *b = ms->sms_bulk;
+	uint32_t lat;
+
+	if (!b || !b->inflight)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &b->last);
+	lat = ts_diff_us(&b->last, &sms->submitted) / 1000;
+	b->inflight--;
+	if (!cause) {
+		if (!b->acked++ || lat < b->lat_min)
+			b->lat_min = lat;
+		if (lat > b->lat_max)
+			b->lat_max = lat;
+		b->lat_sum += lat;
+		LOGP(DLSMS, LOGL_INFO, "Bulk SMS %u to %s acked after %u ms\n",
+			sms->msg_ref, sms->address, lat);
+	} else {
+		b->failed++;
+		LOGP(DLSMS, LOGL_NOTICE, "Bulk SMS %u to %s failed after %u ms: "
+			"%s\n", sms->msg_ref, sms->address, lat,
+			get_value_string(gsm411_rp_cause_strs, cause));
+	}
+
+	if (llist_empty(&b->queue) && !b->inflight) {
+		l23_vty_ms_notify(ms, NULL);
+		l23_vty_ms_notify(ms, "Bulk SMS done: %u acked, %u failed\n",
+			b->acked, b->failed);
+		return;
+	}
+
+	/* start the next one while the MM connection is still up */
+	bulk_kick(ms, b);
+}
+
+/* queue an SMS for bulk submission */
+int sms_bulk_queue(struct osmocom_ms *ms, const char *sms_sca,
+	const char *number, const char *text)
+{
+	struct sms_bulk *b = bulk_get(ms);
+	struct sms_bulk_msg *bm;
+
+	if (!b)
+		return -ENOMEM;
+	bm = talloc_zero(b, struct sms_bulk_msg);
+	if (!bm)
+		return -ENOMEM;
+	bm->sms = sms_from_text(number, 0, text);
+	if (!bm->sms) {
+		talloc_free(bm);
+		return -ENOMEM;
+	}
+	bm->sms->bulk = true;
+	bm->sms->msg_ref = b->msg_ref++;
+	OSMO_STRLCPY_ARRAY(bm->sca, sms_sca);
+
+	/* a new run starts with new statistics */
+	if (llist_empty(&b->queue) && !b->inflight) {
+		b->submitted = b->acked = b->failed = 0;
+		b->lat_sum = b->lat_min = b->lat_max = 0;
+	}
+
+	llist_add_tail(&bm->entry, &b->queue);
+	b->pending++;
+	bulk_kick(ms, b);
+
+	return 0;
+}
+
+/* set the number of transactions at a time and the submissions per
+ * minute (0 = no limit) */
+int sms_bulk_limit(struct osmocom_ms *ms, unsigned int concurrency,
+	unsigned int rate)
+{
+	struct sms_bulk *b;
+
+	if (!concurrency)
+		return -EINVAL;
+	b = bulk_get(ms);
+	if (!b)
+		return -ENOMEM;
+	b->concurrency = concurrency;
+	b->rate = rate;
+	bulk_kick(ms, b);
+
+	return 0;
+}
+
+/* drop pending messages, transactions in progress are completed */
+void sms_bulk_flush(struct osmocom_ms *ms)
+{
+	struct sms_bulk *b = ms->sms_bulk;
+	struct sms_bulk_msg *bm, *bm2;
+
+	if (!b)
+		return;
+
+	osmo_timer_del(&b->timer);
+	llist_for_each_entry_safe(bm, bm2, &b->queue, entry) {
+		llist_del(&bm->entry);
+		sms_free(bm->sms);
+		talloc_free(bm);
+	}
+	b->pending = 0;
+}
+
+void sms_bulk_dump(struct osmocom_ms *ms,
+	void (*print)(void *, const char *, ...), void *priv)
+{
+	struct sms_bulk *b = ms->sms_bulk;
+	int64_t elapsed;
+
+	if (!b) {
+		print(priv, "No bulk submission\n");
+		return;
+	}
+
+	print(priv, "Pending %u, in progress %u\n", b->pending, b->inflight);
+	if (b->rate)
+		print(priv, "Limits: %u at a time, %u per minute\n",
+			b->concurrency, b->rate);
+	else
+		print(priv, "Limits: %u at a time, no rate limit\n",
+			b->concurrency);
+	print(priv, "Submitted %u, acked %u, failed %u\n", b->submitted,
+		b->acked, b->failed);
+	if (!b->acked)
+		return;
+	print(priv, "Latency min %u ms, avg %lu ms, max %u ms\n", b->lat_min,
+		(unsigned long)(b->lat_sum / b->acked), b->lat_max);
+	elapsed = ts_diff_us(&b->last, &b->first) / 1000;
+	if (elapsed > 0)
+		print(priv, "Throughput %lu SMS per minute\n",
+			(unsigned long)((uint64_t)b->acked * 60000 / elapsed));
+}
+
 /*
  * message flow between layers
  */
@@ -651,7 +651,7 @@ static void vgcs_gcc_fsm_u0p_action(struct osmo_fsm_inst *fi, uint32_t event, vo
 			trans_free(trans);
 			return;
 		}
-		trans->transaction_id = rc;
+		trans_set_id(trans, rc);
 		/* Send SETUP towards network. */
 		gsm44068_tx_setup(trans, trans->callref, false, 0, false, NULL, 0, false, 0);
 		break;
@@ -1574,7 +1574,7 @@ static int gsm44068_gcc_data_ind(struct gsm_trans *trans, struct msgb *msg, uint
 	msgb_pull(msg, sizeof(struct gsm48_mmxx_hdr));
 
 	/* Use transaction ID from message. If we join a group call, we don't have it until now. */
-	trans->transaction_id = transaction_id;
+	trans_set_id(trans, transaction_id);
 
 	LOG_GCC(trans, LOGL_INFO, "(ms %s) Received '%s' in state %s\n", ms->name, gsm44068_gcc_msg_name(msg_type),
 		gsm44068_gcc_state_name(trans->gcc.fi));
@@ -281,7 +281,7 @@ static int gsm480_trans_free(struct gsm_trans *trans)
 	LOGP(DSS, LOGL_INFO, "Sending MMSS_REL_REQ\n");
 	gsm48_mmxx_downmsg(trans->ms, nmsg);
 
-	trans->callref = 0;
+	trans_set_callref(trans, 0);
 	trans_free(trans);
 
 	return 0;
@@ -417,7 +417,7 @@ static int gsm48_rel_null_free(struct gsm_trans *trans)
 
 	new_cc_state(trans, GSM_CSTATE_NULL);
 
-	trans->callref = 0;
+	trans_set_callref(trans, 0);
 	trans_free(trans);
 
 	return 0;
@@ -539,7 +539,7 @@ static int gsm48_cc_abort_mm(struct gsm_trans *trans, void *arg)
 
 	new_cc_state(trans, GSM_CSTATE_NULL);
 
-	trans->callref = 0;
+	trans_set_callref(trans, 0);
 	trans_free(trans);
 
 	return 0;
@@ -569,7 +569,7 @@ static int gsm48_cc_tx_setup(struct gsm_trans *trans)
 		rc = mncc_release_ind(trans->ms, trans, trans->callref,
 				      GSM48_CAUSE_LOC_PRN_S_LU,
 				      GSM48_CC_CAUSE_NORMAL_UNSPEC);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		trans_free(trans);
 		return rc;
 	}
@@ -581,11 +581,11 @@ static int gsm48_cc_tx_setup(struct gsm_trans *trans)
 		rc = mncc_release_ind(trans->ms, trans, trans->callref,
 				      GSM48_CAUSE_LOC_PRN_S_LU,
 				      GSM48_CC_CAUSE_RESOURCE_UNAVAIL);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		trans_free(trans);
 		return rc;
 	}
-	trans->transaction_id = transaction_id;
+	trans_set_id(trans, transaction_id);
 
 	gh->msg_type = (setup->emergency) ? GSM48_MT_CC_EMERG_SETUP :
 						GSM48_MT_CC_SETUP;
@@ -1672,7 +1672,7 @@ static int gsm48_cc_tx_release(struct gsm_trans *trans, void *arg)
 #if 0
 	/* release without sending MMCC_REL_REQ */
 	new_cc_state(trans, GSM_CSTATE_NULL);
-	trans->callref = 0;
+	trans_set_callref(trans, 0);
 	trans_free(trans);
 #endif
 
@@ -1712,7 +1712,7 @@ static int gsm48_cc_tx_release_compl(struct gsm_trans *trans, void *arg)
 
 	/* release without sending MMCC_REL_REQ */
 	new_cc_state(trans, GSM_CSTATE_NULL);
-	trans->callref = 0;
+	trans_set_callref(trans, 0);
 	trans_free(trans);
 
 	return 0;
@@ -2184,7 +2184,7 @@ static int gsm48_cc_data_ind(struct gsm_trans *trans, struct msgb *msg)
 	msg_type = gh->msg_type & 0xbf;
 
 	/* set transaction ID (flip), if not already */
-	trans->transaction_id = ((gh->proto_discr & 0xf0) ^ 0x80) >> 4;
+	trans_set_id(trans, ((gh->proto_discr & 0xf0) ^ 0x80) >> 4);
 
 	/* pull the MMCC header */
 	msgb_pull(msg, sizeof(struct gsm48_mmxx_hdr));
@@ -2259,7 +2259,7 @@ int gsm48_rcv_cc(struct osmocom_ms *ms, struct msgb *msg)
 			 GSM48_CAUSE_LOC_PRN_S_LU, mmh->cause);
 		/* release without sending MMCC_REL_REQ */
 		new_cc_state(trans, GSM_CSTATE_NULL);
-		trans->callref = 0;
+		trans_set_callref(trans, 0);
 		trans_free(trans);
 		break;
 	case GSM48_MMCC_DATA_IND:
@@ -1884,6 +1884,7 @@ static int gsm48_mm_rx_auth_rej(struct osmocom_ms *ms, struct msgb *msg)
 
 	/* SIM invalid */
 	subscr->sim_valid = 0;
+	gsm48_rr_drx_update(ms);
 
 	/* TMSI and LAI invalid */
 	subscr->tmsi = GSM_RESERVED_TMSI;
@@ -2037,6 +2038,7 @@ static int gsm48_mm_imsi_detach_end(struct osmocom_ms *ms, struct msgb *msg)
 
 	/* SIM invalid */
 	subscr->sim_valid = 0;
+	gsm48_rr_drx_update(ms);
 
 	/* wait for RR idle and then power off when IMSI is detached */
 	if (ms->shutdown != MS_SHUTDOWN_NONE) {
@@ -2229,6 +2231,7 @@ static int gsm48_mm_rx_abort(struct osmocom_ms *ms, struct msgb *msg)
 	if (reject_cause == GSM48_REJECT_ILLEGAL_ME) {
 		/* SIM invalid */
 		subscr->sim_valid = 0;
+		gsm48_rr_drx_update(ms);
 
 		/* TMSI and LAI invalid */
 		subscr->tmsi = GSM_RESERVED_TMSI;
@@ -2782,6 +2785,7 @@ static int gsm48_mm_rel_loc_upd_rej(struct osmocom_ms *ms, struct msgb *msg)
 
 		/* SIM invalid */
 		subscr->sim_valid = 0;
+		gsm48_rr_drx_update(ms);
 
 		// fall through
 	case GSM48_REJECT_PLMN_NOT_ALLOWED:
@@ -3127,8 +3131,10 @@ static int gsm48_mm_rx_cm_service_rej(struct osmocom_ms *ms, struct msgb *msg)
 
 		/* change to WAIT_NETWORK_CMD state impied by abort_any == 1 */
 
-		if (reject_cause == GSM48_REJECT_ILLEGAL_ME)
+		if (reject_cause == GSM48_REJECT_ILLEGAL_ME) {
 			subscr->sim_valid = 0;
+			gsm48_rr_drx_update(ms);
+		}
 
 		break;
 	default:
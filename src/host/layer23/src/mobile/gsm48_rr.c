@@ -107,6 +107,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #include <arpa/inet.h>
 
 #include <osmocom/core/msgb.h>
@@ -121,6 +122,8 @@
 #include <osmocom/bb/common/l23_app.h>
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/common/networks.h>
+#include <osmocom/bb/common/paging_match.h>
+#include <osmocom/bb/common/paging_watch.h>
 #include <osmocom/bb/common/l1ctl.h>
 #include <osmocom/bb/common/utils.h>
 #include <osmocom/bb/common/settings.h>
@@ -154,6 +157,7 @@ static int gsm48_match_ra(struct osmocom_ms *ms, struct gsm48_req_ref *ref, uint
 static int gsm48_rr_tx_talker_indication(struct osmocom_ms *ms);
 static int gsm48_rr_tx_rand_acc_dedicated(struct osmocom_ms *ms, uint8_t ref, uint16_t offset, int8_t uic);
 static int gsm48_rr_uplink_rel_req(struct osmocom_ms *ms, struct msgb *msg);
+static void gsm48_rr_dq_flush(struct gsm48_rrlayer *rr);
 
 /*
  * support
@@ -486,13 +490,14 @@ static void new_rr_state(struct gsm48_rrlayer *rr, int state)
 	}
 
 	rr->state = state;
+	gsm48_rr_drx_update(ms);
 
 	if (state != GSM48_RR_ST_IDLE)
 		return;
 
 	/* Return from dedicated/group receive/transmit mode to idle mode. (Trigger cell reselection.) */
 	if (rr->vgcs.group_state == GSM48_RR_GST_OFF) {
-		struct msgb *msg, *nmsg;
+		struct msgb *nmsg;
 		struct gsm322_msg *em;
 
 		LOGP(DRR, LOGL_INFO, "Returning to IDLE mode.\n");
@@ -508,8 +513,7 @@ static void new_rr_state(struct gsm48_rrlayer *rr, int state)
 			rr->rr_est_msg = NULL;
 		}
 		/* free all pending messages */
-		while((msg = msgb_dequeue(&rr->downqueue)))
-			msgb_free(msg);
+		gsm48_rr_dq_flush(rr);
 		/* clear all descriptions of last channel */
 		memset(&rr->cd_now, 0, sizeof(rr->cd_now));
 		/* reset ciphering */
@@ -543,7 +547,6 @@ static void new_rr_state(struct gsm48_rrlayer *rr, int state)
 	if (rr->vgcs.group_state == GSM48_RR_GST_RECEIVE) {
 		uint16_t ma[64];
 		uint8_t ma_len;
-		struct msgb *msg;
 
 		LOGP(DRR, LOGL_INFO, "Returning to GROUP RECEIVE mode.\n");
 		/* release dedicated mode, if any */
@@ -558,8 +561,7 @@ static void new_rr_state(struct gsm48_rrlayer *rr, int state)
 			rr->rr_est_msg = NULL;
 		}
 		/* free all pending messages */
-		while ((msg = msgb_dequeue(&rr->downqueue)))
-			msgb_free(msg);
+		gsm48_rr_dq_flush(rr);
 		/* reset ciphering */
 		rr->cipher_on = 0;
 		/* copy channel description "group mode" */
@@ -712,6 +714,21 @@ static int rcv_rsl(struct msgb *msg, struct lapdm_entity *le, void *l3ctx)
 {
 	struct osmocom_ms *ms = l3ctx;
 	struct gsm48_rrlayer *rr = &ms->rrlayer;
+	struct abis_rsl_rll_hdr *rllh = msgb_l2(msg);
+
+	/* While waiting for IMMEDIATE ASSIGNMENT, handle CCCH messages at
+	 * once, so the channel is established before its starting time.
+	 * Messages are only handled out of the queue if it is empty. */
+	if (rr->state == GSM48_RR_ST_CONN_PEND && rr->wait_assign == 1
+	 && rllh->c.msg_type == RSL_MT_UNIT_DATA_IND
+	 && rllh->chan_nr == RSL_CHAN_PCH_AGCH
+	 && llist_empty(&rr->rsl_upqueue)) {
+		clock_gettime(CLOCK_MONOTONIC, &rr->ia_rx);
+		/* msg is freed there */
+		gsm48_rcv_rsl(ms, msg);
+		memset(&rr->ia_rx, 0, sizeof(rr->ia_rx));
+		return 0;
+	}
 
 	msgb_enqueue(&rr->rsl_upqueue, msg);
 
@@ -2026,21 +2043,7 @@ static int gsm48_rr_uplink_access(struct osmocom_ms *ms, struct msgb *msg)
 		}
 
 		/* Store to history buffer. */
-		/* shift history and store */
-		memcpy(&(rr->cr_hist[4]), &(rr->cr_hist[3]),
-			sizeof(struct gsm48_cr_hist));
-		memcpy(&(rr->cr_hist[3]), &(rr->cr_hist[2]),
-			sizeof(struct gsm48_cr_hist));
-		memcpy(&(rr->cr_hist[2]), &(rr->cr_hist[1]),
-			sizeof(struct gsm48_cr_hist));
-		memcpy(&(rr->cr_hist[1]), &(rr->cr_hist[0]),
-			sizeof(struct gsm48_cr_hist));
-		rr->cr_hist[0].valid = 1;
-		rr->cr_hist[0].ref.ra = rr->cr_ra;
-		rr->cr_hist[0].ref.t1 = ref->t1;
-		rr->cr_hist[0].ref.t2 = ref->t2;
-		rr->cr_hist[0].ref.t3_low = ref->t3_low;
-		rr->cr_hist[0].ref.t3_high = ref->t3_high;
+		gsm48_cr_hist_add(rr, ref);
 	}
 
 	if (!osmo_timer_pending(&rr->vgcs.t3130)) {
@@ -2063,11 +2066,7 @@ static int gsm48_rr_uplink_access(struct osmocom_ms *ms, struct msgb *msg)
 
 		/* store value, mask and history */
 		rr->cr_ra = uplink_ref;
-		rr->cr_hist[4].valid = 0;
-		rr->cr_hist[3].valid = 0;
-		rr->cr_hist[2].valid = 0;
-		rr->cr_hist[1].valid = 0;
-		rr->cr_hist[0].valid = 0;
+		gsm48_cr_hist_clear(rr);
 
 		/* Reset counter. */
 		rr->vgcs.uplink_counter = 0;
@@ -2372,7 +2371,7 @@ rel_ind:
 	/* store value, mask and clear history */
 	rr->chan_req_val = chan_req_val;
 	rr->chan_req_mask = chan_req_mask;
-	memset(rr->cr_hist, 0, sizeof(rr->cr_hist));
+	gsm48_cr_hist_clear(rr);
 
 	/* store establishment cause, so 'choose cell' selects the last cell
 	 * after location updating */
@@ -2388,6 +2387,23 @@ rel_ind:
 	return 0;
 }
 
+/* S of table 3.3.1.1.2.1, by Tx-integer, for not combined/combined CCCH */
+static uint8_t gsm48_rach_s(uint8_t tx_integer, bool combined)
+{
+	switch (tx_integer) {
+	case 3: case 8: case 14: case 50:
+		return combined ? 41 : 55;
+	case 4: case 9: case 16:
+		return combined ? 52 : 76;
+	case 5: case 10: case 20:
+		return combined ? 58 : 109;
+	case 6: case 11: case 25:
+		return combined ? 86 : 163;
+	default:
+		return combined ? 115 : 217;
+	}
+}
+
 /* send first/next channel request in conn pend state */
 int gsm48_rr_tx_rand_acc(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -2422,14 +2438,8 @@ int gsm48_rr_tx_rand_acc(struct osmocom_ms *ms, struct msgb *msg)
 			return -EINVAL;
 		}
 
-		/* shift history and store */
-		memmove(rr->cr_hist + 1, rr->cr_hist, sizeof(rr->cr_hist) - sizeof(rr->cr_hist[0]));
-		rr->cr_hist[0].valid = 1;
-		rr->cr_hist[0].ref.ra = rr->cr_ra;
-		rr->cr_hist[0].ref.t1 = ref->t1;
-		rr->cr_hist[0].ref.t2 = ref->t2;
-		rr->cr_hist[0].ref.t3_low = ref->t3_low;
-		rr->cr_hist[0].ref.t3_high = ref->t3_high;
+		/* store in history */
+		gsm48_cr_hist_add(rr, ref);
 	}
 
 	if (cs->ccch_state != GSM322_CCCH_ST_DATA) {
@@ -2480,40 +2490,10 @@ fail:
 		/* first random access, without delay of slots */
 		slots = 0;
 		rr->wait_assign = 1;
+		rr->rach_s = gsm48_rach_s(s->tx_integer, s->ccch_conf == 1);
 	} else {
 		/* subsequent random access, with slots from table 3.1 */
-		switch(s->tx_integer) {
-		case 3: case 8: case 14: case 50:
-			if (s->ccch_conf != 1) /* not combined CCCH */
-				slots = 55;
-			else
-				slots = 41;
-			break;
-		case 4: case 9: case 16:
-			if (s->ccch_conf != 1)
-				slots = 76;
-			else
-				slots = 52;
-			break;
-		case 5: case 10: case 20:
-			if (s->ccch_conf != 1)
-				slots = 109;
-			else
-				slots = 58;
-			break;
-		case 6: case 11: case 25:
-			if (s->ccch_conf != 1)
-				slots = 163;
-			else
-				slots = 86;
-			break;
-		default:
-			if (s->ccch_conf != 1)
-				slots = 217;
-			else
-				slots = 115;
-			break;
-		}
+		slots = rr->rach_s;
 	}
 
 	chan_req = layer23_random();
@@ -2614,6 +2594,7 @@ static int gsm48_new_sysinfo(struct osmocom_ms *ms, uint8_t type)
 			     gsm_print_arfcn(rrmeas->nc_arfcn[i]), i);
 		}
 		rrmeas->nc_num = i;
+		rrmeas->nc_top_valid = false;
 		if (i == 32 && arfcn_from_freq_index(s, i) >= 0)
 			LOGP(DRR, LOGL_NOTICE, "SI5/SI5bis/SI5ter define more than 32 channels.\n");
 	}
@@ -2789,6 +2770,7 @@ static int gsm48_rr_rx_sysinfo3(struct osmocom_ms *ms, struct msgb *msg)
 			cs->ccch_mode);
 		l1ctl_tx_ccch_mode_req(ms, cs->ccch_mode);
 	}
+	gsm48_rr_drx_update(ms);
 
 	return gsm48_new_sysinfo(ms, si->header.system_information);
 }
@@ -3027,41 +3009,135 @@ static int gsm48_rr_chan2cause[4] = {
 	RR_EST_CAUSE_ANS_PAG_TCH_ANY
 };
 
-/* given LV of mobile identity is checked against ms */
-static uint8_t gsm_match_mi(struct osmocom_ms *ms, const uint8_t *mi_lv)
+/* DRX, TS 45.002 §6.5: while camping in idle mode, only the paging block of
+ * our paging group is read. While waiting for an IMMEDIATE ASSIGNMENT,
+ * without IMSI or while the paging watch list has entries, all CCCH blocks
+ * are read. Call after any change of RR state, cell selection state, SI3,
+ * SIM validity, IMSI or watch list. */
+void gsm48_rr_drx_update(struct osmocom_ms *ms)
 {
+	struct gsm48_rrlayer *rr = &ms->rrlayer;
 	struct gsm322_cellsel *cs = &ms->cellsel;
+	struct gsm48_sysinfo *s = cs->si;
+	struct rx_drx *drx = &ms->drx;
+	struct rx_meas_stat *meas = &ms->meas;
+	uint8_t mf_index, fn51;
+	int16_t dsc;
+	bool active;
+
+	active = rr->state == GSM48_RR_ST_IDLE
+		&& rr->vgcs.group_state == GSM48_RR_GST_OFF
+		&& cs->selected && s && !cs->neighbour
+		&& (cs->state == GSM322_C3_CAMPED_NORMALLY
+		 || cs->state == GSM322_C7_CAMPED_ANY_CELL)
+		&& ms->subscr.sim_valid
+		/* the watched identities are paged in other groups */
+		&& !paging_watch_count()
+		&& gsm48_sysinfo_paging_block(s, ms->subscr.imsi, &mf_index,
+					      &fn51) == 0;
+
+	if (!active) {
+		if (!drx->active)
+			return;
+		LOGP(DRR, LOGL_INFO, "DRX off (%u blocks passed, %u dropped)\n",
+			drx->passed, drx->dropped);
+		drx->active = false;
+		/* the loss counter samples each multiframe again */
+		if (meas->ds_fail)
+			meas->ds_fail = meas->dsc = ms->settings.dsc_max;
+		return;
+	}
+
+	if (!drx->active || drx->bs_pa_mfrms != s->pag_mf_periods
+	 || drx->mf_index != mf_index || drx->fn51 != fn51) {
+		LOGP(DRR, LOGL_INFO, "DRX on, paging block at frame %u of "
+			"multiframe %u of %u\n", fn51, mf_index,
+			s->pag_mf_periods);
+		if (!drx->active) {
+			drx->all = false;
+			drx->passed = drx->dropped = 0;
+		}
+		drx->bs_pa_mfrms = s->pag_mf_periods;
+		drx->mf_index = mf_index;
+		drx->fn51 = fn51;
+		drx->active = true;
+	}
+
+	/* DSC is initialized to 90 / BS_PA_MFRMS, TS 45.008 §6.5 */
+	dsc = (ms->settings.dsc_max + drx->bs_pa_mfrms / 2)
+		/ drx->bs_pa_mfrms;
+	if (meas->ds_fail > dsc)
+		meas->ds_fail = meas->dsc = dsc;
+}
+
+/* Update our identities as they are coded in paging. This is done once for
+ * each PAGING REQUEST, so that each identity on the air is only compared
+ * octet by octet. */
+static void gsm48_rr_paging_ids(struct osmocom_ms *ms)
+{
+	struct gsm_subscriber *subscr = &ms->subscr;
+
+	/* the TMSI is only valid in the LA where it was assigned */
+	paging_ids_update(&ms->rrlayer.pag_id, subscr->tmsi,
+		subscr->tmsi != GSM_RESERVED_TMSI
+		&& osmo_lai_cmp(&subscr->lai, &ms->cellsel.sel_cgi.lai) == 0,
+		subscr->imsi);
+}
+
+/* given LV of mobile identity is checked against ms and the watch list */
+static uint8_t gsm_match_mi(struct osmocom_ms *ms, const uint8_t *mi_lv,
+	int chan)
+{
 	struct osmo_mobile_identity mi;
+	uint8_t mi_type;
 	char buf[32];
-	int rc;
-
-	rc = osmo_mobile_identity_decode(&mi, mi_lv+1, mi_lv[0], false);
-	if (rc < 0)
-		return rc;
-	osmo_mobile_identity_to_str_buf(buf, sizeof(buf), &mi);
 
-	switch (mi.type) {
+	if (mi_lv[0] < 1)
+		return 0;
+	switch (mi_lv[1] & GSM_MI_TYPE_MASK) {
 	case GSM_MI_TYPE_TMSI:
-		if ((ms->subscr.tmsi == mi.tmsi)
-		 && (osmo_lai_cmp(&ms->subscr.lai, &cs->sel_cgi.lai) == 0)) {
-			LOGP(DPAG, LOGL_INFO, " %s matches\n", buf);
-			return mi.type;
-		} else
-			LOGP(DPAG, LOGL_INFO, " %s (not for us)\n", buf);
-		break;
 	case GSM_MI_TYPE_IMSI:
-		if (!strcmp(mi.imsi, ms->subscr.imsi)) {
-			LOGP(DPAG, LOGL_INFO, " %s matches\n", buf);
-			return mi.type;
-		} else
-			LOGP(DPAG, LOGL_INFO, "  %s (not for us)\n", buf);
 		break;
 	default:
 		LOGP(DPAG, LOGL_NOTICE, "Paging with unsupported MI type %d.\n",
-			mi.type);
+			mi_lv[1] & GSM_MI_TYPE_MASK);
+		return 0;
 	}
+	mi_type = paging_match_mi(&ms->rrlayer.pag_id, mi_lv);
+	paging_watch(ms->meas.last_fn, ms->cellsel.sel_arfcn, chan, mi_lv + 1,
+		mi_lv[0]);
 
-	return 0;
+	/* only decode for the log */
+	if (log_check_level(DPAG, LOGL_INFO)) {
+		if (osmo_mobile_identity_decode(&mi, mi_lv + 1, mi_lv[0],
+						false) < 0)
+			return 0;
+		osmo_mobile_identity_to_str_buf(buf, sizeof(buf), &mi);
+		LOGP(DPAG, LOGL_INFO, " %s %s\n", buf,
+			mi_type ? "matches" : "(not for us)");
+	}
+
+	return mi_type;
+}
+
+/* TMSI of PAGING REQUEST 2 and 3 is checked against ms and the watch list */
+static bool gsm_match_tmsi(struct osmocom_ms *ms, const void *tmsi, int chan)
+{
+	uint8_t mi[5];
+	bool match;
+
+	if (paging_watch_count()) {
+		mi[0] = 0xf0 | GSM_MI_TYPE_TMSI;
+		memcpy(mi + 1, tmsi, 4);
+		paging_watch(ms->meas.last_fn, ms->cellsel.sel_arfcn, chan, mi,
+			sizeof(mi));
+	}
+
+	match = paging_match_tmsi(&ms->rrlayer.pag_id, tmsi);
+	LOGP(DPAG, LOGL_INFO, " TMSI %08x %s\n", osmo_load32be(tmsi),
+		match ? "matches" : "(not for us)");
+
+	return match;
 }
 
 /* 9.1.22 PAGING REQUEST 1 message received */
@@ -3088,6 +3164,7 @@ static int gsm48_rr_rx_pag_req_1(struct osmocom_ms *ms, struct msgb *msg)
 		return 0;
 	}
 	LOGP(DPAG, LOGL_INFO, "PAGING REQUEST 1\n");
+	gsm48_rr_paging_ids(ms);
 
 	if (payload_len < 2) {
 		short_read:
@@ -3104,7 +3181,7 @@ static int gsm48_rr_rx_pag_req_1(struct osmocom_ms *ms, struct msgb *msg)
 	mi = pa->data;
 	if (payload_len < mi[0] + 1)
 		goto short_read;
-	if ((mi_type = gsm_match_mi(ms, mi)) > 0)
+	if ((mi_type = gsm_match_mi(ms, mi, chan_1)) > 0)
 		return gsm48_rr_chan_req(ms, gsm48_rr_chan2cause[chan_1], 1,
 			mi_type);
 	/* second MI */
@@ -3116,7 +3193,7 @@ static int gsm48_rr_rx_pag_req_1(struct osmocom_ms *ms, struct msgb *msg)
 		return 0;
 	if (payload_len < mi[1] + 2)
 		goto short_read;
-	if ((mi_type = gsm_match_mi(ms, mi + 1)) > 0)
+	if ((mi_type = gsm_match_mi(ms, mi + 1, chan_2)) > 0)
 		return gsm48_rr_chan_req(ms, gsm48_rr_chan2cause[chan_2], 1,
 			mi_type);
 
@@ -3143,6 +3220,7 @@ static int gsm48_rr_rx_pag_req_2(struct osmocom_ms *ms, struct msgb *msg)
 		return 0;
 	}
 	LOGP(DPAG, LOGL_INFO, "PAGING REQUEST 2\n");
+	gsm48_rr_paging_ids(ms);
 
 	if (payload_len < 0) {
 		short_read:
@@ -3156,23 +3234,13 @@ static int gsm48_rr_rx_pag_req_2(struct osmocom_ms *ms, struct msgb *msg)
 	chan_1 = pa->cneed1;
 	chan_2 = pa->cneed2;
 	/* first MI */
-	if (ms->subscr.tmsi == ntohl(pa->tmsi1)
-	 && (osmo_lai_cmp(&ms->subscr.lai, &cs->sel_cgi.lai) == 0)) {
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x matches\n", ntohl(pa->tmsi1));
+	if (gsm_match_tmsi(ms, &pa->tmsi1, chan_1))
 		return gsm48_rr_chan_req(ms, gsm48_rr_chan2cause[chan_1], 1,
 			GSM_MI_TYPE_TMSI);
-	} else
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x (not for us)\n",
-			ntohl(pa->tmsi1));
 	/* second MI */
-	if (ms->subscr.tmsi == ntohl(pa->tmsi2)
-	 && (osmo_lai_cmp(&ms->subscr.lai, &cs->sel_cgi.lai) == 0)) {
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x matches\n", ntohl(pa->tmsi2));
+	if (gsm_match_tmsi(ms, &pa->tmsi2, chan_2))
 		return gsm48_rr_chan_req(ms, gsm48_rr_chan2cause[chan_2], 1,
 			GSM_MI_TYPE_TMSI);
-	} else
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x (not for us)\n",
-			ntohl(pa->tmsi2));
 	/* third MI */
 	mi = pa->data;
 	if (payload_len < 2)
@@ -3182,7 +3250,7 @@ static int gsm48_rr_rx_pag_req_2(struct osmocom_ms *ms, struct msgb *msg)
 	if (payload_len < mi[1] + 2 + 1) /* must include "channel needed" */
 		goto short_read;
 	chan_3 = mi[mi[1] + 2] & 0x03; /* channel needed */
-	if ((mi_type = gsm_match_mi(ms, mi + 1)) > 0)
+	if ((mi_type = gsm_match_mi(ms, mi + 1, chan_3)) > 0)
 		return gsm48_rr_chan_req(ms, gsm48_rr_chan2cause[chan_3], 1,
 			mi_type);
 
@@ -3208,6 +3276,7 @@ static int gsm48_rr_rx_pag_req_3(struct osmocom_ms *ms, struct msgb *msg)
 		return 0;
 	}
 	LOGP(DPAG, LOGL_INFO, "PAGING REQUEST 3\n");
+	gsm48_rr_paging_ids(ms);
 
 	if (payload_len < 0) { /* must include "channel needed", part of *pa */
 		LOGP(DRR, LOGL_NOTICE, "Short read of PAGING REQUEST 3 "
@@ -3222,41 +3291,21 @@ static int gsm48_rr_rx_pag_req_3(struct osmocom_ms *ms, struct msgb *msg)
 	chan_3 = pa->cneed3;
 	chan_4 = pa->cneed4;
 	/* first MI */
-	if (ms->subscr.tmsi == ntohl(pa->tmsi1)
-	 && (osmo_lai_cmp(&ms->subscr.lai, &cs->sel_cgi.lai) == 0)) {
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x matches\n", ntohl(pa->tmsi1));
+	if (gsm_match_tmsi(ms, &pa->tmsi1, chan_1))
 		return gsm48_rr_chan_req(ms, gsm48_rr_chan2cause[chan_1], 1,
 			GSM_MI_TYPE_TMSI);
-	} else
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x (not for us)\n",
-			ntohl(pa->tmsi1));
 	/* second MI */
-	if (ms->subscr.tmsi == ntohl(pa->tmsi2)
-	 && (osmo_lai_cmp(&ms->subscr.lai, &cs->sel_cgi.lai) == 0)) {
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x matches\n", ntohl(pa->tmsi2));
+	if (gsm_match_tmsi(ms, &pa->tmsi2, chan_2))
 		return gsm48_rr_chan_req(ms, gsm48_rr_chan2cause[chan_2], 1,
 			GSM_MI_TYPE_TMSI);
-	} else
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x (not for us)\n",
-			ntohl(pa->tmsi2));
 	/* third MI */
-	if (ms->subscr.tmsi == ntohl(pa->tmsi3)
-	 && (osmo_lai_cmp(&ms->subscr.lai, &cs->sel_cgi.lai) == 0)) {
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x matches\n", ntohl(pa->tmsi3));
+	if (gsm_match_tmsi(ms, &pa->tmsi3, chan_3))
 		return gsm48_rr_chan_req(ms, gsm48_rr_chan2cause[chan_3], 1,
 			GSM_MI_TYPE_TMSI);
-	} else
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x (not for us)\n",
-			ntohl(pa->tmsi3));
 	/* fourth MI */
-	if (ms->subscr.tmsi == ntohl(pa->tmsi4)
-	 && (osmo_lai_cmp(&ms->subscr.lai, &cs->sel_cgi.lai) == 0)) {
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x matches\n", ntohl(pa->tmsi4));
+	if (gsm_match_tmsi(ms, &pa->tmsi4, chan_4))
 		return gsm48_rr_chan_req(ms, gsm48_rr_chan2cause[chan_4], 1,
 			GSM_MI_TYPE_TMSI);
-	} else
-		LOGP(DPAG, LOGL_INFO, " TMSI %08x (not for us)\n",
-			ntohl(pa->tmsi4));
 
 	return 0;
 }
@@ -3269,35 +3318,47 @@ static int gsm48_rr_rx_pag_req_3(struct osmocom_ms *ms, struct msgb *msg)
 static int gsm48_match_ra(struct osmocom_ms *ms, struct gsm48_req_ref *ref, uint8_t hist_num)
 {
 	struct gsm48_rrlayer *rr = &ms->rrlayer;
+
+	if (!gsm48_cr_hist_match(rr, ref, hist_num))
+		return 0;
+
+	LOGP(DRR, LOGL_INFO, "request %02x matches (fn=%d,%d,%d)\n", ref->ra,
+		ref->t1, ref->t2, (ref->t3_high << 3) | ref->t3_low);
+	return 1;
+}
+
+/* account the time from reception of our IMMEDIATE ASSIGNMENT until the
+ * channel is activated or its activation is scheduled */
+static void gsm48_rr_ia_lat_add(struct gsm48_rrlayer *rr)
+{
+	struct timespec now;
+	unsigned long us;
 	int i;
-	uint8_t ia_t1, ia_t2, ia_t3;
-	uint8_t cr_t1, cr_t2, cr_t3;
-
-	for (i = 0; i < hist_num; i++) {
-		/* filter confirmed RACH requests only */
-		if (rr->cr_hist[i].valid && ref->ra == rr->cr_hist[i].ref.ra) {
-			ia_t1 = ref->t1;
-			ia_t2 = ref->t2;
-			ia_t3 = (ref->t3_high << 3) | ref->t3_low;
-			cr_t1 = rr->cr_hist[i].ref.t1;
-			cr_t2 = rr->cr_hist[i].ref.t2;
-			cr_t3 = (rr->cr_hist[i].ref.t3_high << 3) | rr->cr_hist[i].ref.t3_low;
-			if (ia_t1 == cr_t1 && ia_t2 == cr_t2
-			 && ia_t3 == cr_t3) {
-		 		LOGP(DRR, LOGL_INFO, "request %02x matches "
-					"(fn=%d,%d,%d)\n", ref->ra, ia_t1,
-					ia_t2, ia_t3);
-				return 1;
-			} else
-		 		LOGP(DRR, LOGL_INFO, "request %02x matches "
-					"but not frame number (IMM.ASS "
-					"fn=%d,%d,%d != RACH fn=%d,%d,%d)\n",
-					ref->ra, ia_t1, ia_t2, ia_t3,
-					cr_t1, cr_t2, cr_t3);
-		}
+
+	if (!rr->ia_rx.tv_sec && !rr->ia_rx.tv_nsec)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	us = (now.tv_sec - rr->ia_rx.tv_sec) * 1000000
+		+ (now.tv_nsec - rr->ia_rx.tv_nsec) / 1000;
+	for (i = 0; i < GSM48_IA_LAT_NUM - 1; i++) {
+		if (us < (16UL << i))
+			break;
 	}
+	rr->ia_lat[i]++;
+	memset(&rr->ia_rx, 0, sizeof(rr->ia_rx));
+}
 
-	return 0;
+void gsm48_rr_dump_ia_lat(struct osmocom_ms *ms,
+	void (*print)(void *, const char *, ...), void *priv)
+{
+	struct gsm48_rrlayer *rr = &ms->rrlayer;
+	int i;
+
+	print(priv, "IMMEDIATE ASSIGNMENT to channel activation:\n");
+	for (i = 0; i < GSM48_IA_LAT_NUM - 1; i++)
+		print(priv, "  < %6lu us: %u\n", 16UL << i, rr->ia_lat[i]);
+	print(priv, "  >= %5lu us: %u\n", 16UL << i, rr->ia_lat[i]);
 }
 
 /* 9.1.18 IMMEDIATE ASSIGNMENT is received */
@@ -3337,6 +3398,19 @@ static int gsm48_rr_rx_imm_ass(struct osmocom_ms *ms, struct msgb *msg)
 		return -EINVAL;
 	}
 
+	/* 3.3.1.1.2: ignore assignment while idle */
+	if (rr->state != GSM48_RR_ST_CONN_PEND || rr->wait_assign == 0)
+		return 0;
+
+	if (rr->wait_assign == 2) {
+		LOGP(DRR, LOGL_INFO, "Ignoring, channel already assigned.\n");
+		return 0;
+	}
+
+	/* request ref, before anything is decoded */
+	if (!gsm48_match_ra(ms, &ia->req_ref, IMM_ASS_HISTORY))
+		return 0;
+
 	/* starting time */
 #ifdef TEST_STARTING_TIMER
 	cd.start = 1;
@@ -3380,36 +3454,19 @@ static int gsm48_rr_rx_imm_ass(struct osmocom_ms *ms, struct msgb *msg)
 			gsm_print_arfcn(cd.arfcn), ch_ts, ch_subch, cd.tsc);
 	}
 
-	/* 3.3.1.1.2: ignore assignment while idle */
-	if (rr->state != GSM48_RR_ST_CONN_PEND || rr->wait_assign == 0) {
-		LOGP(DRR, LOGL_INFO, "Not for us, no request.\n");
-		return 0;
-	}
-
-	if (rr->wait_assign == 2) {
-		LOGP(DRR, LOGL_INFO, "Ignoring, channel already assigned.\n");
-		return 0;
-	}
-
-	/* request ref */
-	if (gsm48_match_ra(ms, &ia->req_ref, IMM_ASS_HISTORY)) {
-		/* channel description */
-		memcpy(&rr->cd_now, &cd, sizeof(rr->cd_now));
-		/* timing advance */
-		rr->cd_now.ind_ta = ia->timing_advance;
-		/* mobile allocation */
-		memcpy(&rr->cd_now.mob_alloc_lv, &ia->mob_alloc_len,
-			ia->mob_alloc_len + 1);
-		rr->wait_assign = 2;
-		/* reset scheduler */
-		LOGP(DRR, LOGL_INFO, "resetting scheduler\n");
-		l1ctl_tx_reset_req(ms, L1CTL_RES_T_SCHED);
-
-		return gsm48_rr_dl_est(ms);
-	}
-	LOGP(DRR, LOGL_INFO, "Request, but not for us.\n");
+	/* channel description */
+	memcpy(&rr->cd_now, &cd, sizeof(rr->cd_now));
+	/* timing advance */
+	rr->cd_now.ind_ta = ia->timing_advance;
+	/* mobile allocation */
+	memcpy(&rr->cd_now.mob_alloc_lv, &ia->mob_alloc_len,
+		ia->mob_alloc_len + 1);
+	rr->wait_assign = 2;
+	/* reset scheduler */
+	LOGP(DRR, LOGL_INFO, "resetting scheduler\n");
+	l1ctl_tx_reset_req(ms, L1CTL_RES_T_SCHED);
 
-	return 0;
+	return gsm48_rr_dl_est(ms);
 }
 
 /* 9.1.19 IMMEDIATE ASSIGNMENT EXTENDED is received */
@@ -3422,6 +3479,7 @@ static int gsm48_rr_rx_imm_ass_ext(struct osmocom_ms *ms, struct msgb *msg)
 	int ma_len = msgb_l3len(msg) - sizeof(*ia);
 	uint8_t ch_type, ch_subch, ch_ts;
 	struct gsm48_rr_cd cd1, cd2;
+	int ref;
 #ifndef TEST_STARTING_TIMER
 	uint8_t *st, st_len;
 #endif
@@ -3451,6 +3509,23 @@ static int gsm48_rr_rx_imm_ass_ext(struct osmocom_ms *ms, struct msgb *msg)
 		return -EINVAL;
 	}
 
+	/* 3.3.1.1.2: ignore assignment while idle */
+	if (rr->state != GSM48_RR_ST_CONN_PEND || rr->wait_assign == 0)
+		return 0;
+
+	if (rr->wait_assign == 2) {
+		LOGP(DRR, LOGL_INFO, "Ignoring, channel already assigned.\n");
+		return 0;
+	}
+
+	/* request refs, before anything is decoded */
+	if (gsm48_match_ra(ms, &ia->req_ref1, IMM_ASS_HISTORY))
+		ref = 1;
+	else if (gsm48_match_ra(ms, &ia->req_ref2, IMM_ASS_HISTORY))
+		ref = 2;
+	else
+		return 0;
+
 #ifdef TEST_STARTING_TIMER
 	cd1.start = 1;
 	cd2.start_tm.fn = (ms->meas.last_fn + TEST_STARTING_TIMER) % 42432;
@@ -3526,52 +3601,23 @@ static int gsm48_rr_rx_imm_ass_ext(struct osmocom_ms *ms, struct msgb *msg)
 			gsm_print_arfcn(cd2.arfcn), ch_ts, ch_subch, cd2.tsc);
 	}
 
-	/* 3.3.1.1.2: ignore assignment while idle */
-	if (rr->state != GSM48_RR_ST_CONN_PEND || rr->wait_assign == 0) {
-		LOGP(DRR, LOGL_INFO, "Not for us, no request.\n");
-		return 0;
-	}
-
-	if (rr->wait_assign == 2) {
-		LOGP(DRR, LOGL_INFO, "Ignoring, channel already assigned.\n");
-		return 0;
-	}
-
-	/* request ref 1 */
-	if (gsm48_match_ra(ms, &ia->req_ref1, IMM_ASS_HISTORY)) {
-		/* channel description */
+	/* channel description and timing advance */
+	if (ref == 1) {
 		memcpy(&rr->cd_now, &cd1, sizeof(rr->cd_now));
-		/* timing advance */
 		rr->cd_now.ind_ta = ia->timing_advance1;
-		/* mobile allocation */
-		memcpy(&rr->cd_now.mob_alloc_lv, &ia->mob_alloc_len,
-			ia->mob_alloc_len + 1);
-		rr->wait_assign = 2;
-		/* reset scheduler */
-		LOGP(DRR, LOGL_INFO, "resetting scheduler\n");
-		l1ctl_tx_reset_req(ms, L1CTL_RES_T_SCHED);
-
-		return gsm48_rr_dl_est(ms);
-	}
-	/* request ref 2 */
-	if (gsm48_match_ra(ms, &ia->req_ref2, IMM_ASS_HISTORY)) {
-		/* channel description */
+	} else {
 		memcpy(&rr->cd_now, &cd2, sizeof(rr->cd_now));
-		/* timing advance */
 		rr->cd_now.ind_ta = ia->timing_advance2;
-		/* mobile allocation */
-		memcpy(&rr->cd_now.mob_alloc_lv, &ia->mob_alloc_len,
-			ia->mob_alloc_len + 1);
-		rr->wait_assign = 2;
-		/* reset scheduler */
-		LOGP(DRR, LOGL_INFO, "resetting scheduler\n");
-		l1ctl_tx_reset_req(ms, L1CTL_RES_T_SCHED);
-
-		return gsm48_rr_dl_est(ms);
 	}
-	LOGP(DRR, LOGL_INFO, "Request, but not for us.\n");
+	/* mobile allocation */
+	memcpy(&rr->cd_now.mob_alloc_lv, &ia->mob_alloc_len,
+		ia->mob_alloc_len + 1);
+	rr->wait_assign = 2;
+	/* reset scheduler */
+	LOGP(DRR, LOGL_INFO, "resetting scheduler\n");
+	l1ctl_tx_reset_req(ms, L1CTL_RES_T_SCHED);
 
-	return 0;
+	return gsm48_rr_dl_est(ms);
 }
 
 /* 9.1.20 IMMEDIATE ASSIGNMENT REJECT is received */
@@ -3648,11 +3694,93 @@ static int gsm48_rr_rx_add_ass(struct osmocom_ms *ms, struct msgb *msg)
  * measturement reports
  */
 
+/* insert a cell into the list of the strongest cells, if its NCC is
+ * permitted, on equal RXLEV the lower index goes first */
+static void gsm48_rr_nc_top_insert(struct gsm48_rr_meas *rrmeas, uint8_t i)
+{
+	int8_t rxlev = rrmeas->nc_rxlev_dbm[i];
+	int n, num;
+	uint8_t j;
+
+	if (rxlev == -128
+	 || !(rrmeas->nc_top_ncc & (1 << (rrmeas->nc_bsic[i] >> 3))))
+		return;
+
+	for (n = rrmeas->nc_top_num; n > 0; n--) {
+		j = rrmeas->nc_top[n - 1];
+		if (rrmeas->nc_rxlev_dbm[j] > rxlev
+		 || (rrmeas->nc_rxlev_dbm[j] == rxlev && j < i))
+			break;
+	}
+	if (n >= ARRAY_SIZE(rrmeas->nc_top))
+		return;
+
+	num = rrmeas->nc_top_num;
+	if (num < ARRAY_SIZE(rrmeas->nc_top))
+		num++;
+	memmove(rrmeas->nc_top + n + 1, rrmeas->nc_top + n, num - 1 - n);
+	rrmeas->nc_top[n] = i;
+	rrmeas->nc_top_num = num;
+}
+
+static void gsm48_rr_nc_top_build(struct gsm48_rr_meas *rrmeas,
+	uint8_t ncc_permitted)
+{
+	int i;
+
+	rrmeas->nc_top_num = 0;
+	rrmeas->nc_top_ncc = ncc_permitted;
+	for (i = 0; i < rrmeas->nc_num; i++)
+		gsm48_rr_nc_top_insert(rrmeas, i);
+	rrmeas->nc_top_valid = true;
+}
+
+/* RXLEV of a neighbour cell in dedicated mode */
+void gsm48_rr_meas_ind(struct osmocom_ms *ms, uint16_t band_arfcn,
+	uint8_t rx_lev)
+{
+	struct gsm48_rr_meas *rrmeas = &ms->rrlayer.meas;
+	int i, n, full;
+
+	for (i = 0; i < rrmeas->nc_num; i++) {
+		if (rrmeas->nc_arfcn[i] == band_arfcn)
+			break;
+	}
+	if (i == rrmeas->nc_num)
+		return;
+	rrmeas->nc_rxlev_dbm[i] = rx_lev - 110;
+	if (!rrmeas->nc_top_valid)
+		return;
+
+	/* take the cell out and put it in again at its new place */
+	full = rrmeas->nc_top_num == ARRAY_SIZE(rrmeas->nc_top);
+	for (n = 0; n < rrmeas->nc_top_num; n++) {
+		if (rrmeas->nc_top[n] != i)
+			continue;
+		rrmeas->nc_top_num--;
+		memmove(rrmeas->nc_top + n, rrmeas->nc_top + n + 1,
+			rrmeas->nc_top_num - n);
+		break;
+	}
+	if (!full || n == ARRAY_SIZE(rrmeas->nc_top)) {
+		gsm48_rr_nc_top_insert(rrmeas, i);
+		return;
+	}
+
+	/* the cell was taken out of a full list, if it does not come back
+	 * before the last place, a cell outside may be stronger */
+	gsm48_rr_nc_top_insert(rrmeas, i);
+	if (rrmeas->nc_top_num < ARRAY_SIZE(rrmeas->nc_top)
+	 || rrmeas->nc_top[ARRAY_SIZE(rrmeas->nc_top) - 1] == i)
+		rrmeas->nc_top_valid = false;
+}
+
 static int gsm48_rr_tx_meas_rep(struct osmocom_ms *ms)
 {
 	struct gsm48_rrlayer *rr = &ms->rrlayer;
 	struct gsm48_sysinfo *s = ms->cellsel.si;
 	struct rx_meas_stat *meas = &rr->ms->meas;
+	struct rx_meas_rep *mrep = &rr->ms->meas_rep;
 	struct gsm48_rr_meas *rrmeas = &rr->meas;
 	struct msgb *nmsg;
 	struct gsm48_hdr *gh;
@@ -3679,21 +3807,20 @@ static int gsm48_rr_tx_meas_rep(struct osmocom_ms *ms)
 			rep_valid = 1;
 	}
 
-	/* check for valid measurements, any frame must exist */
-	if (meas->frames) {
+	/* results of the last complete reporting period */
+	if (mrep->valid) {
 		meas_valid = 1;
-		serv_rxlev_full = serv_rxlev_sub =
-			(meas->rxlev + (meas->frames / 2)) / meas->frames;
-		serv_rxqual_full = serv_rxqual_sub = 0; // FIXME
+		serv_rxlev_full = mrep->rxlev_full;
+		serv_rxlev_sub = mrep->rxlev_sub;
+		serv_rxqual_full = mrep->rxqual_full;
+		serv_rxqual_sub = mrep->rxqual_sub;
 	}
 
 	memset(&rxlev_nc, 0, sizeof(rxlev_nc));
 	memset(&bsic_nc, 0, sizeof(bsic_nc));
 	memset(&bcch_f_nc, 0, sizeof(bcch_f_nc));
 	if (rep_valid) {
-		int8_t strongest, current;
-		uint8_t ncc;
-		int i, index, strongest_i;
+		int index;
 
 #if 0
 		/* FIXME: multi-band reporting, if not: 0 = normal reporting */
@@ -3702,34 +3829,20 @@ static int gsm48_rr_tx_meas_rep(struct osmocom_ms *ms)
 #endif
 
 		/* get 6 strongest measurements */
-		strongest = 127; /* infinite */
-		strongest_i = -1; /* make gcc happy */
-		for (n = 0; n < 6; n++) {
-			current = -128; /* -infinite */
-			index = 0;
-			for (i = 0; i < rrmeas->nc_num; i++) {
-				/* Skip stronger cells that have been added to measurement report so far. */
-				if (rrmeas->nc_rxlev_dbm[i] > strongest)
-					continue;
-				/* Skip cells with equal strength that have been added so far. */
-				if (rrmeas->nc_rxlev_dbm[i] == strongest && i <= strongest_i)
-					continue;
-				/* only check if NCC is permitted */
-				ncc = rrmeas->nc_bsic[i] >> 3;
-				if ((s->nb_ncc_permitted_si6 & (1 << ncc))
-				 && rrmeas->nc_rxlev_dbm[i] > current) {
-					current = rrmeas->nc_rxlev_dbm[i];
-					strongest = current;
-					index = i;
-					strongest_i = i;
-				}
-			}
-			if (current == -128) /* no more found */
-				break;
+		if (!rrmeas->nc_top_valid
+		 || rrmeas->nc_top_ncc != s->nb_ncc_permitted_si6)
+			gsm48_rr_nc_top_build(rrmeas, s->nb_ncc_permitted_si6);
+		for (n = 0; n < rrmeas->nc_top_num; n++) {
+			index = rrmeas->nc_top[n];
 			rxlev_nc[n] = rrmeas->nc_rxlev_dbm[index] + 110;
 			bsic_nc[n] = rrmeas->nc_bsic[index];
 			bcch_f_nc[n] = index;
+			rr->ho_nb[n].arfcn = rrmeas->nc_arfcn[index];
+			rr->ho_nb[n].bsic = rrmeas->nc_bsic[index];
+			rr->ho_nb[n].rxlev_dbm = rrmeas->nc_rxlev_dbm[index];
+			rr->ho_nb[n].fn = meas->last_fn;
 		}
+		rr->ho_nb_num = n;
 	}
 
 	nmsg = gsm48_l3_msgb_alloc();
@@ -3927,7 +4040,10 @@ static int gsm48_rr_activate_channel(struct osmocom_ms *ms,
 		memset(s->si5t_msg, 0, sizeof(s->si5t_msg));
 	}
 	meas->frames = meas->snr = meas->berr = meas->rxlev = 0;
+	meas_rep_reset(&ms->meas_rep);
 	rr->meas.nc_num = 0;
+	rr->meas.nc_top_valid = false;
+	rr->ho_nb_num = 0;
 	stop_rr_t_meas(rr);
 	start_rr_t_meas(rr, 1, 0);
 	gsm48_rr_tx_meas_rep(ms);
@@ -3950,6 +4066,7 @@ static int gsm48_rr_activate_channel(struct osmocom_ms *ms,
 	else
 		l1ctl_tx_dm_est_req_h0(ms, cd->arfcn, cd->chan_nr, cd->tsc, cd->mode, rr->audio_mode, cd->tch_flags);
 	rr->dm_est = 1;
+	gsm48_rr_ia_lat_add(rr);
 
 	/* old SI 5/6 are not valid on a new dedicated channel */
 	s->si5 = s->si5bis = s->si5ter = s->si6 = 0;
@@ -4014,12 +4131,12 @@ static int gsm48_rr_render_ma(struct osmocom_ms *ms, struct gsm48_rr_cd *cd,
 					"has invalid length\n");
 				return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
 			}
-			gsm48_decode_freq_list(freq, cd->cell_desc_lv + 1, 16,
-				0xce, FREQ_TYPE_SERV);
+			gsm48_decode_freq_set(freq, &s->ca,
+				cd->cell_desc_lv + 1, 16, 0xce, FREQ_TYPE_SERV);
 		}
 
-		gsm48_decode_mobile_alloc(freq, cd->mob_alloc_lv + 1,
-			cd->mob_alloc_lv[0], ma, ma_len, 0);
+		gsm48_decode_mobile_alloc(&s->ca, cd->mob_alloc_lv + 1,
+			cd->mob_alloc_lv[0], ma, ma_len);
 		if (*ma_len < 1) {
 			LOGP(DRR, LOGL_NOTICE, "mobile allocation with no "
 				"frequency available\n");
@@ -4029,31 +4146,28 @@ static int gsm48_rr_render_ma(struct osmocom_ms *ms, struct gsm48_rr_cd *cd,
 	} else
 	/* decode frequency list */
 	if (cd->freq_list_lv[0]) {
-		struct gsm_sysinfo_freq f[1024];
-		int j = 0;
+		struct gsm_freq_set f;
+		int j;
 
 		LOGP(DRR, LOGL_INFO, "decoding frequency list\n");
 
-		/* get bitmap */
-		if (gsm48_decode_freq_list(f, cd->freq_list_lv + 1,
-			cd->freq_list_lv[0], 0xce, FREQ_TYPE_SERV)) {
+		/* get set */
+		if (gsm_freq_set_decode(&f, cd->freq_list_lv + 1,
+			cd->freq_list_lv[0], 0xce)) {
 			LOGP(DRR, LOGL_NOTICE, "frequency list invalid\n");
 			return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
 		}
 
-		/* collect channels from bitmap (1..1023,0) */
-		for (i = 1; i <= 1024; i++) {
-			if ((f[i & 1023].mask & FREQ_TYPE_SERV)) {
-				LOGP(DRR, LOGL_INFO, "Listed ARFCN #%d: %s\n",
-					j, gsm_print_arfcn((i & 1023) | pcs));
-				if (j == 64) {
-					LOGP(DRR, LOGL_NOTICE, "frequency list "
-						"exceeds 64 entries!\n");
-					return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
-				}
-				ma[j++] = i & 1023;
-			}
+		/* collect channels from set (1..1023,0) */
+		j = gsm_freq_set_list(&f, ma, 64);
+		if (j > 64) {
+			LOGP(DRR, LOGL_NOTICE, "frequency list "
+				"exceeds 64 entries!\n");
+			return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
 		}
+		for (i = 0; i < j; i++)
+			LOGP(DRR, LOGL_INFO, "Listed ARFCN #%d: %s\n",
+				i, gsm_print_arfcn(ma[i] | pcs));
 		*ma_len = j;
 	} else
 	/* decode frequency channel sequence */
@@ -4149,6 +4263,7 @@ static int gsm48_rr_dl_est(struct osmocom_ms *ms)
 
 #ifndef TEST_FREQUENCY_MOD
 		/* schedule start of IMM.ASS */
+		gsm48_rr_ia_lat_add(rr);
 		rr->modify_state = GSM48_RR_MOD_IMM_ASS;
 		start_rr_t_starting(rr, start_mili / 1000,
 			(start_mili % 1000) * 1000);
@@ -4688,8 +4803,6 @@ static int gsm48_rr_rx_ass_cmd(struct osmocom_ms *ms, struct msgb *msg)
 	struct gsm48_rr_cd *cdb = &rr->cd_before;
 	uint8_t ch_type, ch_subch, ch_ts;
 	uint8_t before_time = 0;
-	uint16_t ma[64];
-	uint8_t ma_len;
 	uint32_t start_mili = 0;
 	uint8_t cause;
 	struct msgb *nmsg;
@@ -4959,11 +5072,12 @@ static int gsm48_rr_rx_ass_cmd(struct osmocom_ms *ms, struct msgb *msg)
 	if (cause)
 		return gsm48_rr_tx_ass_fail(ms, cause, RSL_MT_DATA_REQ);
 	if (before_time) {
-		cause = gsm48_rr_render_ma(ms, cdb, ma, &ma_len);
+		cause = gsm48_rr_render_ma(ms, cdb, rr->ma_before,
+			&rr->ma_before_len);
 		if (cause)
 			return gsm48_rr_tx_ass_fail(ms, cause, RSL_MT_DATA_REQ);
 	}
-	cause = gsm48_rr_render_ma(ms, cda, ma, &ma_len);
+	cause = gsm48_rr_render_ma(ms, cda, rr->ma_after, &rr->ma_after_len);
 	if (cause)
 		return gsm48_rr_tx_ass_fail(ms, cause, RSL_MT_DATA_REQ);
 
@@ -4973,6 +5087,7 @@ static int gsm48_rr_rx_ass_cmd(struct osmocom_ms *ms, struct msgb *msg)
 	memcpy(cdb, cda, sizeof(*cdb));
 	cdb->h = 0;
 	cdb->arfcn = 0;
+	rr->ma_before_len = 0;
 #endif
 
 	/* schedule start of assignment */
@@ -4999,6 +5114,79 @@ static int gsm48_rr_rx_ass_cmd(struct osmocom_ms *ms, struct msgb *msg)
 	return 0;
 }
 
+/* look up the target of a HANDOVER COMMAND in the neighbours of the last
+ * MEASUREMENT REPORT */
+static struct gsm48_rr_ho_nb *gsm48_rr_ho_nb_find(struct osmocom_ms *ms,
+	uint16_t arfcn, uint8_t bsic)
+{
+	struct gsm48_rrlayer *rr = &ms->rrlayer;
+	struct gsm48_rr_ho_nb *nb;
+	int i;
+
+	for (i = 0; i < rr->ho_nb_num; i++) {
+		nb = &rr->ho_nb[i];
+		if (nb->arfcn != arfcn || nb->bsic != bsic)
+			continue;
+		rr->ho_nb_hit++;
+		LOGP(DRR, LOGL_INFO, " target ARFCN %s BSIC %u is reported "
+			"neighbour #%d (rxlev %d dBm, %u frames ago)\n",
+			gsm_print_arfcn(arfcn), bsic, i, nb->rxlev_dbm,
+			(ms->meas.last_fn + GSM_MAX_FN - nb->fn) % GSM_MAX_FN);
+		return nb;
+	}
+
+	rr->ho_nb_miss++;
+	LOGP(DRR, LOGL_NOTICE, " target ARFCN %s BSIC %u is not a reported "
+		"neighbour\n", gsm_print_arfcn(arfcn), bsic);
+	return NULL;
+}
+
+/* account the time from release of the old channel until the link is
+ * resumed on the new one */
+static void gsm48_rr_ho_int_add(struct gsm48_rrlayer *rr)
+{
+	struct timespec now;
+	unsigned long ms;
+	int i;
+
+	if (!rr->ho_rel.tv_sec && !rr->ho_rel.tv_nsec)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (now.tv_sec - rr->ho_rel.tv_sec) * 1000
+		+ (now.tv_nsec - rr->ho_rel.tv_nsec) / 1000000;
+	for (i = 0; i < GSM48_HO_INT_NUM - 1; i++) {
+		if (ms < (16UL << i))
+			break;
+	}
+	rr->ho_int[i]++;
+	rr->ho_int_last = ms;
+	memset(&rr->ho_rel, 0, sizeof(rr->ho_rel));
+
+	LOGP(DRR, LOGL_INFO, "handover interruption %lu ms\n", ms);
+}
+
+void gsm48_rr_dump_hando(struct osmocom_ms *ms,
+	void (*print)(void *, const char *, ...), void *priv)
+{
+	struct gsm48_rrlayer *rr = &ms->rrlayer;
+	struct gsm48_rr_ho_nb *nb;
+	int i;
+
+	print(priv, "Neighbours of last measurement report:\n");
+	for (i = 0; i < rr->ho_nb_num; i++) {
+		nb = &rr->ho_nb[i];
+		print(priv, "  ARFCN %s BSIC %u rxlev %d dBm\n",
+			gsm_print_arfcn(nb->arfcn), nb->bsic, nb->rxlev_dbm);
+	}
+	print(priv, "Handover target was reported: %u, was not: %u\n",
+		rr->ho_nb_hit, rr->ho_nb_miss);
+	print(priv, "Handover interruption (last %u ms):\n", rr->ho_int_last);
+	for (i = 0; i < GSM48_HO_INT_NUM - 1; i++)
+		print(priv, "  < %5lu ms: %u\n", 16UL << i, rr->ho_int[i]);
+	print(priv, "  >= %4lu ms: %u\n", 16UL << i, rr->ho_int[i]);
+}
+
 /* 9.1.16 sending HANDOVER COMPLETE */
 static int gsm48_rr_tx_hando_cpl(struct osmocom_ms *ms, uint8_t cause)
 {
@@ -5071,8 +5259,6 @@ static int gsm48_rr_rx_hando_cmd(struct osmocom_ms *ms, struct msgb *msg)
 	uint8_t bcc, ncc;
 	uint8_t ch_type, ch_subch, ch_ts;
 	uint8_t before_time = 0;
-	uint16_t ma[64];
-	uint8_t ma_len;
 	uint32_t start_mili = 0;
 	uint8_t cause;
 	struct msgb *nmsg;
@@ -5095,6 +5281,8 @@ static int gsm48_rr_rx_hando_cmd(struct osmocom_ms *ms, struct msgb *msg)
 
 	/* cell description */
 	gsm48_decode_cell_desc(&ho->cell_desc, &arfcn, &ncc, &bcc);
+	arfcn = gsm_arfcn_refer_pcs(cs->arfcn, s, arfcn);
+	gsm48_rr_ho_nb_find(ms, arfcn, (ncc << 3) | bcc);
 
 	/* handover reference */
 	rr->chan_req_val = ho->ho_ref;
@@ -5354,11 +5542,12 @@ static int gsm48_rr_rx_hando_cmd(struct osmocom_ms *ms, struct msgb *msg)
 
 	/* check if channels are valid */
 	if (before_time) {
-		cause = gsm48_rr_render_ma(ms, cdb, ma, &ma_len);
+		cause = gsm48_rr_render_ma(ms, cdb, rr->ma_before,
+			&rr->ma_before_len);
 		if (cause)
 			return gsm48_rr_tx_hando_fail(ms, cause, RSL_MT_DATA_REQ);
 	}
-	cause = gsm48_rr_render_ma(ms, cda, ma, &ma_len);
+	cause = gsm48_rr_render_ma(ms, cda, rr->ma_after, &rr->ma_after_len);
 	if (cause)
 		return gsm48_rr_tx_hando_fail(ms, cause, RSL_MT_DATA_REQ);
 
@@ -5376,6 +5565,7 @@ static int gsm48_rr_rx_hando_cmd(struct osmocom_ms *ms, struct msgb *msg)
 	memcpy(cdb, cda, sizeof(*cdb));
 	cdb->h = 0;
 	cdb->arfcn = 0;
+	rr->ma_before_len = 0;
 #endif
 
 	/* schedule start of handover */
@@ -5412,28 +5602,186 @@ static int gsm48_rr_tx_rand_acc_dedicated(struct osmocom_ms *ms, uint8_t ref, ui
 	return l1ctl_tx_rach_req(ms, rr->cd_now.chan_nr, 0x00, ref, 0, offset, uic);
 }
 
-/* send all queued messages down to layer 2 */
+/* a message in the RR downlink queue, with the time it was queued */
+struct gsm48_rr_dq_msg {
+	struct llist_head	list;
+	struct msgb		*msg;
+	struct timespec		queued;
+};
+
+static uint32_t gsm48_rr_dq_since(const struct timespec *then,
+	const struct timespec *now)
+{
+	return (now->tv_sec - then->tv_sec) * 1000000
+		+ (now->tv_nsec - then->tv_nsec) / 1000;
+}
+
+/* queue a message for layer 2, the RR header is already pulled */
+static int gsm48_rr_dq_enqueue(struct gsm48_rrlayer *rr, struct msgb *msg,
+	uint8_t sapi)
+{
+	struct gsm48_rr_dq *dq =
+		&rr->dq[sapi ? GSM48_RR_DQ_SAPI3 : GSM48_RR_DQ_SAPI0];
+	struct gsm48_rr_dq_msg *qm;
+
+	qm = talloc_zero(rr->ms, struct gsm48_rr_dq_msg);
+	if (!qm) {
+		msgb_free(msg);
+		dq->dropped++;
+		return -ENOMEM;
+	}
+	qm->msg = msg;
+	clock_gettime(CLOCK_MONOTONIC, &qm->queued);
+	llist_add_tail(&qm->list, &dq->queue);
+	if (++dq->depth > dq->depth_max)
+		dq->depth_max = dq->depth;
+
+	return 0;
+}
+
+static struct msgb *gsm48_rr_dq_dequeue(struct gsm48_rr_dq *dq,
+	const struct timespec *now)
+{
+	struct gsm48_rr_dq_msg *qm;
+	struct msgb *msg;
+	uint32_t wait;
+
+	if (llist_empty(&dq->queue))
+		return NULL;
+	qm = llist_first_entry(&dq->queue, struct gsm48_rr_dq_msg, list);
+	llist_del(&qm->list);
+	msg = qm->msg;
+	dq->depth--;
+	wait = gsm48_rr_dq_since(&qm->queued, now);
+	dq->wait_sum += wait;
+	if (wait > dq->wait_max)
+		dq->wait_max = wait;
+	talloc_free(qm);
+
+	return msg;
+}
+
+static void gsm48_rr_dq_flush(struct gsm48_rrlayer *rr)
+{
+	struct gsm48_rr_dq_msg *qm, *tmp;
+	int i;
+
+	if (osmo_timer_pending(&rr->t_dq))
+		osmo_timer_del(&rr->t_dq);
+	for (i = 0; i < GSM48_RR_DQ_NUM; i++) {
+		llist_for_each_entry_safe(qm, tmp, &rr->dq[i].queue, list) {
+			llist_del(&qm->list);
+			msgb_free(qm->msg);
+			talloc_free(qm);
+		}
+		rr->dq[i].depth = 0;
+		rr->dq[i].l2_out = 0;
+	}
+}
+
+/* a message of the class is passed to layer 2 */
+static void gsm48_rr_dq_l2_sent(struct gsm48_rr_dq *dq,
+	const struct timespec *now)
+{
+	dq->sent++;
+	dq->l2_out++;
+	dq->l2_last = *now;
+}
+
+/* Layer 2 has no message of the class to send or to be acknowledged, as
+ * far as RR can tell from the primitives: an I frame of the network
+ * acknowledges ours on the same SAPI, else they are taken as done after
+ * GSM48_RR_DQ_L2_WAIT. */
+static bool gsm48_rr_dq_l2_idle(const struct gsm48_rr_dq *dq,
+	const struct timespec *now)
+{
+	return !dq->l2_out || gsm48_rr_dq_since(&dq->l2_last, now)
+		>= GSM48_RR_DQ_L2_WAIT * 1000;
+}
+
+static int gsm48_rr_dequeue_down(struct osmocom_ms *ms);
+
+static void timeout_rr_dq(void *arg)
+{
+	struct gsm48_rrlayer *rr = arg;
+
+	if (rr->state != GSM48_RR_ST_DEDICATED
+	 || rr->modify_state == GSM48_RR_MOD_ASSIGN
+	 || rr->modify_state == GSM48_RR_MOD_HANDO)
+		return;
+	gsm48_rr_dequeue_down(rr->ms);
+}
+
+/* send queued messages down to layer 2: all of SAPI 0, then SAPI 3 in
+ * order. If SAPI 3 shares the main DCCH, it is passed one message at a
+ * time and only while SAPI 0 is idle, so that layer 2 does not
+ * interleave SAPI 0 frames with a backlog of SAPI 3 frames. A message
+ * that waited GSM48_RR_DQ_SAPI3_WAIT is passed anyway. */
 static int gsm48_rr_dequeue_down(struct osmocom_ms *ms)
 {
 	struct gsm48_rrlayer *rr = &ms->rrlayer;
+	struct gsm48_rr_dq *dq;
+	struct gsm48_rr_dq_msg *qm;
+	struct timespec now;
 	struct msgb *msg;
 
-	while((msg = msgb_dequeue(&rr->downqueue))) {
-		struct gsm48_rr_hdr *rrh = (struct gsm48_rr_hdr *) msg->data;
-		uint8_t sapi = rrh->sapi;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	dq = &rr->dq[GSM48_RR_DQ_SAPI0];
+	while ((msg = gsm48_rr_dq_dequeue(dq, &now))) {
+		gsm48_rr_dq_l2_sent(dq, &now);
+		gsm48_send_rsl(ms, RSL_MT_DATA_REQ, msg, 0);
+	}
 
-		LOGP(DRR, LOGL_INFO, "Sending queued message.\n");
-		if (sapi && rr->sapi3_state != GSM48_RR_SAPI3ST_ESTAB) {
+	dq = &rr->dq[GSM48_RR_DQ_SAPI3];
+	while (!llist_empty(&dq->queue)) {
+		if (rr->sapi3_state != GSM48_RR_SAPI3ST_ESTAB) {
 			LOGP(DRR, LOGL_INFO, "Dropping SAPI 3 msg, no link!\n");
-			msgb_free(msg);
-			return 0;
+			msgb_free(gsm48_rr_dq_dequeue(dq, &now));
+			dq->dropped++;
+			continue;
 		}
-		gsm48_send_rsl(ms, RSL_MT_DATA_REQ, msg, 0);
+		qm = llist_first_entry(&dq->queue, struct gsm48_rr_dq_msg,
+			list);
+		if (!(rr->sapi3_link_id & 0x40)
+		 && (!gsm48_rr_dq_l2_idle(&rr->dq[GSM48_RR_DQ_SAPI0], &now)
+		  || !gsm48_rr_dq_l2_idle(dq, &now))
+		 && gsm48_rr_dq_since(&qm->queued, &now)
+				< GSM48_RR_DQ_SAPI3_WAIT * 1000) {
+			/* look again after about one block */
+			if (!osmo_timer_pending(&rr->t_dq)) {
+				rr->t_dq.cb = timeout_rr_dq;
+				rr->t_dq.data = rr;
+				osmo_timer_schedule(&rr->t_dq, 0, 20000);
+			}
+			break;
+		}
+		msg = gsm48_rr_dq_dequeue(dq, &now);
+		gsm48_rr_dq_l2_sent(dq, &now);
+		gsm48_send_rsl(ms, RSL_MT_DATA_REQ, msg, rr->sapi3_link_id);
 	}
 
 	return 0;
 }
 
+void gsm48_rr_dump_dq(struct osmocom_ms *ms,
+	void (*print)(void *, const char *, ...), void *priv)
+{
+	struct gsm48_rrlayer *rr = &ms->rrlayer;
+	struct gsm48_rr_dq *dq;
+	int i;
+
+	for (i = 0; i < GSM48_RR_DQ_NUM; i++) {
+		dq = &rr->dq[i];
+		print(priv, "SAPI %d: depth %u (max %u), sent %u, dropped %u, "
+			"outstanding %u\n", i ? 3 : 0, dq->depth,
+			dq->depth_max, dq->sent, dq->dropped, dq->l2_out);
+		print(priv, "  wait avg %lu us, max %u us\n",
+			dq->sent ? (unsigned long)(dq->wait_sum / dq->sent) : 0UL,
+			dq->wait_max);
+	}
+}
+
 /* Channel is resumed in dedicated mode or uplink is estabished. */
 static int gsm48_rr_estab_cnf_dedicated(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -5450,6 +5798,9 @@ static int gsm48_rr_estab_cnf_dedicated(struct osmocom_ms *ms, struct msgb *msg)
 	} else {
 		LOGP(DRR, LOGL_INFO, "data link is resumed\n");
 
+		if (rr->modify_state == GSM48_RR_MOD_HANDO)
+			gsm48_rr_ho_int_add(rr);
+
 		/* transmit queued frames during ho / ass transition */
 		gsm48_rr_dequeue_down(ms);
 
@@ -5465,12 +5816,11 @@ static int gsm48_rr_susp_cnf_dedicated(struct osmocom_ms *ms, struct msgb *msg)
 	struct gsm48_rrlayer *rr = &ms->rrlayer;
 
 	if (rr->modify_state) {
-		uint16_t ma[64];
-		uint8_t ma_len;
-
 		/* deactivating dedicated mode */
 		LOGP(DRR, LOGL_INFO, "suspension coplete, leaving dedicated "
 			"mode\n");
+		if (rr->modify_state == GSM48_RR_MOD_HANDO)
+			clock_gettime(CLOCK_MONOTONIC, &rr->ho_rel);
 		l1ctl_tx_dm_rel_req(ms);
 		ms->meas.rl_fail = 0;
 		rr->dm_est = 0;
@@ -5482,26 +5832,20 @@ static int gsm48_rr_susp_cnf_dedicated(struct osmocom_ms *ms, struct msgb *msg)
 		/* copy channel description "after time" */
 		memcpy(&rr->cd_now, &rr->cd_after, sizeof(rr->cd_now));
 
+		/* the MAs were rendered when the command was checked */
 		if (rr->cd_after.start) {
-			/* render channel "before time" */
-			gsm48_rr_render_ma(ms, &rr->cd_before, ma, &ma_len);
+			/* activate channel "before time" */
+			gsm48_rr_activate_channel(ms, &rr->cd_before,
+				rr->ma_before, rr->ma_before_len);
 
-			/* activate channel */
-			gsm48_rr_activate_channel(ms, &rr->cd_before, ma,
-				ma_len);
-
-			/* render channel "after time" */
-			gsm48_rr_render_ma(ms, &rr->cd_now, ma, &ma_len);
-
-			/* schedule change of channel */
-			gsm48_rr_channel_after_time(ms, &rr->cd_now, ma, ma_len,
+			/* schedule change of channel "after time" */
+			gsm48_rr_channel_after_time(ms, &rr->cd_now,
+				rr->ma_after, rr->ma_after_len,
 				rr->cd_now.start_tm.fn);
 		} else {
-			/* render channel "after time" */
-			gsm48_rr_render_ma(ms, &rr->cd_now, ma, &ma_len);
-
-			/* activate channel */
-			gsm48_rr_activate_channel(ms, &rr->cd_now, ma, ma_len);
+			/* activate channel "after time" */
+			gsm48_rr_activate_channel(ms, &rr->cd_now,
+				rr->ma_after, rr->ma_after_len);
 		}
 
 		/* send DL-RESUME REQUEST */
@@ -5971,19 +6315,20 @@ static int gsm48_rr_data_req(struct osmocom_ms *ms, struct msgb *msg)
 	if (rr->modify_state == GSM48_RR_MOD_ASSIGN
 	 || rr->modify_state == GSM48_RR_MOD_HANDO) {
 		LOGP(DRR, LOGL_INFO, "Queueing message during suspend.\n");
-		msgb_enqueue(&rr->downqueue, msg);
-		return 0;
+		return gsm48_rr_dq_enqueue(rr, msg, sapi);
 	}
 
 	if (sapi && rr->sapi3_state != GSM48_RR_SAPI3ST_ESTAB) {
 		LOGP(DRR, LOGL_INFO, "Dropping SAPI 3 msg, no link!\n");
 		msgb_free(msg);
+		rr->dq[GSM48_RR_DQ_SAPI3].dropped++;
 		return 0;
 	}
 
-	/* forward message */
-	return gsm48_send_rsl(ms, RSL_MT_DATA_REQ, msg,
-					sapi ? rr->sapi3_link_id : 0);
+	/* forward message, SAPI 3 may wait for SAPI 0 */
+	if (gsm48_rr_dq_enqueue(rr, msg, sapi) < 0)
+		return -ENOMEM;
+	return gsm48_rr_dequeue_down(ms);
 }
 
 /*
@@ -6769,6 +7114,11 @@ static int gsm48_rcv_rll(struct osmocom_ms *ms, struct msgb *msg)
 		"%s (link_id 0x%x)\n", ms->name, rsl_msg_name(msg_type),
 		gsm48_rr_state_names[rr->state], link_id);
 
+	/* an I frame of the network acknowledges ours on the same SAPI */
+	if (msg_type == RSL_MT_DATA_IND)
+		rr->dq[(link_id & 7) ? GSM48_RR_DQ_SAPI3
+				     : GSM48_RR_DQ_SAPI0].l2_out = 0;
+
 	/* find function for current state and message */
 	if (!(link_id & 7)) {
 		/* SAPI 0 */
@@ -6982,6 +7332,7 @@ int gsm48_rr_downmsg(struct osmocom_ms *ms, struct msgb *msg)
 int gsm48_rr_init(struct osmocom_ms *ms)
 {
 	struct gsm48_rrlayer *rr = &ms->rrlayer;
+	int i;
 
 	memset(rr, 0, sizeof(*rr));
 	rr->ms = ms;
@@ -6989,7 +7340,8 @@ int gsm48_rr_init(struct osmocom_ms *ms)
 	LOGP(DRR, LOGL_INFO, "init Radio Ressource process\n");
 
 	INIT_LLIST_HEAD(&rr->rsl_upqueue);
-	INIT_LLIST_HEAD(&rr->downqueue);
+	for (i = 0; i < GSM48_RR_DQ_NUM; i++)
+		INIT_LLIST_HEAD(&rr->dq[i].queue);
 	/* downqueue is handled here, so don't add_work */
 
 	lapdm_channel_set_l3(&ms->lapdm_channel, &rcv_rsl, ms);
@@ -7015,8 +7367,7 @@ int gsm48_rr_exit(struct osmocom_ms *ms)
 	/* flush queues */
 	while ((msg = msgb_dequeue(&rr->rsl_upqueue)))
 		msgb_free(msg);
-	while ((msg = msgb_dequeue(&rr->downqueue)))
-		msgb_free(msg);
+	gsm48_rr_dq_flush(rr);
 
 	if (rr->rr_est_msg) {
 		msgb_free(rr->rr_est_msg);
@@ -24,6 +24,8 @@
 #include <osmocom/bb/common/logging.h>
 
 #include <osmocom/bb/mobile/primitives.h>
+#include <osmocom/bb/mobile/gsm411_sms.h>
+#include <osmocom/bb/mobile/sms_store.h>
 
 #include <osmocom/core/select.h>
 #include <osmocom/vty/misc.h>
@@ -416,6 +418,84 @@ static int lua_ms_sms_send_simple(lua_State *L)
 	return 1;
 }
 
+static int lua_sms_query_rec(void *priv, const struct sms_store_rec *rec)
+{
+	lua_State *L = priv;
+
+	lua_createtable(L, 0, 12);
+
+	lua_pushinteger(L, rec->rx_time);
+	lua_setfield(L, -2, "rx_time");
+
+	lua_pushinteger(L, rec->scts);
+	lua_setfield(L, -2, "time");
+
+	lua_pushinteger(L, rec->protocol_id);
+	lua_setfield(L, -2, "protocol_id");
+
+	lua_pushinteger(L, rec->data_coding_scheme);
+	lua_setfield(L, -2, "data_coding_scheme");
+
+	lua_pushinteger(L, rec->msg_ref);
+	lua_setfield(L, -2, "msg_ref");
+
+	lua_pushinteger(L, !!(rec->flags & SMS_STORE_F_UDHI));
+	lua_setfield(L, -2, "ud_hdr_ind");
+
+	lua_pushstring(L, rec->address);
+	lua_setfield(L, -2, "address");
+
+	lua_pushlstring(L, (char *) rec->user_data, rec->ud_octets);
+	lua_setfield(L, -2, "user_data");
+
+	lua_pushstring(L, rec->text);
+	lua_setfield(L, -2, "text");
+
+	if ((rec->flags & SMS_STORE_F_CONCAT)) {
+		lua_pushinteger(L, rec->concat_ref);
+		lua_setfield(L, -2, "concat_ref");
+
+		lua_pushinteger(L, rec->concat_total);
+		lua_setfield(L, -2, "concat_total");
+
+		lua_pushinteger(L, rec->concat_seq);
+		lua_setfield(L, -2, "concat_seq");
+	}
+
+	/* append to the result table below */
+	lua_rawseti(L, -2, lua_rawlen(L, -2) + 1);
+	return 0;
+}
+
+/* Query the received SMS: sender (or nil), from, to, max. Returns a table
+ * of SMS, latest first. */
+static int lua_ms_sms_query(lua_State *L)
+{
+	struct osmocom_ms *ms = get_primitive(L)->ms;
+	struct sms_store *st;
+	const char *sender = NULL;
+	lua_Integer from, to, max;
+
+	luaL_argcheck(L, lua_isnumber(L, -1), 4, "max needs to be a number");
+	luaL_argcheck(L, lua_isnumber(L, -2), 3, "to needs to be a number");
+	luaL_argcheck(L, lua_isnumber(L, -3), 2, "from needs to be a number");
+	luaL_argcheck(L, lua_isnil(L, -4) || lua_isstring(L, -4), 1,
+		"sender must be a string or nil");
+
+	max = lua_tointeger(L, -1);
+	to = lua_tointeger(L, -2);
+	from = lua_tointeger(L, -3);
+	if (!lua_isnil(L, -4))
+		sender = lua_tostring(L, -4);
+
+	lua_newtable(L);
+	st = gsm411_sms_store(ms);
+	if (st && max > 0)
+		sms_store_query(st, sender, from, to, max, lua_sms_query_rec, L);
+
+	return 1;
+}
+
 static int lua_ms_name(lua_State *L)
 {
 	lua_pushstring(L, get_primitive(L)->ms->name);
@@ -552,6 +632,7 @@ static const struct luaL_Reg ms_funcs[] = {
 	{ "start", lua_ms_no_shutdown },
 	{ "stop", lua_ms_shutdown },
 	{ "sms_send_simple", lua_ms_sms_send_simple },
+	{ "sms_query", lua_ms_sms_query },
 	{ "number", lua_ms_name },
 	{ "reselect_network", lua_reselect_network },
 	{ NULL, NULL },
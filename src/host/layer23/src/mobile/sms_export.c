@@ -0,0 +1,96 @@
+/* Export of the SMS store as text */
+
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+
+#include <osmocom/bb/mobile/sms_store.h>
+
+struct export_state {
+	FILE *outfp;
+	const char *sender;
+};
+
+static void export_print(void *priv, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(priv, fmt, ap);
+	va_end(ap);
+}
+
+static int export_rec(void *priv, const struct sms_store_rec *rec)
+{
+	struct export_state *es = priv;
+
+	if (es->sender && strcmp(rec->address, es->sender))
+		return 0;
+	sms_store_print(rec, export_print, es->outfp);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct export_state es = {
+		.outfp = stdout,
+	};
+	int rc, out_rc;
+
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "Usage: %s <store> [<output> [<sender>]]\n",
+			argv[0]);
+		fprintf(stderr, "The SMS are written in the order they were "
+			"received, to stdout if no output or '-' is given.\n");
+		return EXIT_FAILURE;
+	}
+
+	if (argc > 2 && strcmp(argv[2], "-")) {
+		es.outfp = fopen(argv[2], "w");
+		if (!es.outfp) {
+			fprintf(stderr, "Failed to open '%s' for writing: %s\n",
+				argv[2], strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc > 3)
+		es.sender = argv[3];
+
+	rc = sms_store_read(argv[1], export_rec, &es);
+	if (rc < 0)
+		fprintf(stderr, "Failed to read '%s': %s\n", argv[1],
+			strerror(-rc));
+
+	/* a full disk shows up when the buffer is written */
+	if (es.outfp != stdout)
+		out_rc = fclose(es.outfp);
+	else
+		out_rc = fflush(stdout);
+	if (out_rc) {
+		fprintf(stderr, "Failed to write the output: %s\n",
+			strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	return rc < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
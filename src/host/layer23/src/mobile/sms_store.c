@@ -0,0 +1,694 @@
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/gsm/gsm_utils.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/mobile/sms_store.h>
+
+#define REC_HDR_LEN		4
+/* payload of the largest record */
+#define REC_MAX_LEN		(25 + 20 + 2 + 140 + 2 + SMS_TEXT_SIZE)
+
+#define STORE_BUF_SIZE		16384
+#define SCAN_BUF_SIZE		65536
+
+/* buckets of the sender index, power of two */
+#define SENDER_HASH		1024
+#define ENT_NONE		0xffffffff
+
+struct store_ent {
+	off_t off; /* of the record in the file */
+	time_t rx_time;
+	uint32_t sender; /* hash of the address */
+	uint32_t prev; /* previous record of the same bucket */
+};
+
+struct sms_store {
+	char *path;
+	int fd;
+	off_t size; /* of the file, including the buffered records */
+	struct osmo_timer_list flush_timer;
+	size_t len;
+	uint8_t buf[STORE_BUF_SIZE];
+
+	/* index, entries in the order of the file */
+	struct store_ent *ent;
+	uint32_t *by_time; /* entries sorted by receive time */
+	unsigned int num, alloc;
+	uint32_t sender_head[SENDER_HASH]; /* latest entry per bucket */
+};
+
+/* Fletcher-16 */
+static uint16_t rec_csum(const uint8_t *data, size_t len)
+{
+	uint16_t sum1 = 0, sum2 = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		sum1 = (sum1 + data[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+
+	return (sum2 << 8) | sum1;
+}
+
+/* FNV-1a */
+static uint32_t sender_hash(const char *address)
+{
+	uint32_t h = 2166136261u;
+
+	while (*address) {
+		h ^= (uint8_t)*address++;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+/*
+ * records
+ */
+
+/* encode a record, return its length */
+static size_t rec_encode(uint8_t *data, const struct sms_store_rec *rec)
+{
+	uint8_t *p = data + REC_HDR_LEN;
+	size_t alen = strlen(rec->address), tlen = strlen(rec->text);
+
+	osmo_store64le((uint64_t)rec->rx_time, p);
+	osmo_store64le((uint64_t)rec->scts, p + 8);
+	p[16] = rec->protocol_id;
+	p[17] = rec->data_coding_scheme;
+	p[18] = rec->msg_ref;
+	p[19] = rec->flags;
+	osmo_store16le(rec->concat_ref, p + 20);
+	p[22] = rec->concat_total;
+	p[23] = rec->concat_seq;
+	p[24] = alen;
+	p += 25;
+	memcpy(p, rec->address, alen);
+	p += alen;
+	*p++ = rec->user_data_len;
+	*p++ = rec->ud_octets;
+	memcpy(p, rec->user_data, rec->ud_octets);
+	p += rec->ud_octets;
+	osmo_store16le(tlen, p);
+	memcpy(p + 2, rec->text, tlen);
+	p += 2 + tlen;
+
+	osmo_store16le(p - data - REC_HDR_LEN, data);
+	osmo_store16le(rec_csum(data + REC_HDR_LEN, p - data - REC_HDR_LEN),
+		data + 2);
+
+	return p - data;
+}
+
+/* decode a record of the given total length */
+static int rec_decode(const uint8_t *data, size_t len,
+	struct sms_store_rec *rec)
+{
+	const uint8_t *p = data + REC_HDR_LEN, *end = data + len;
+	uint8_t alen;
+	uint16_t tlen;
+
+	if (osmo_load16le(data + 2) != rec_csum(p, end - p) || end - p < 25)
+		return -EBADMSG;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->rx_time = (int64_t)osmo_load64le(p);
+	rec->scts = (int64_t)osmo_load64le(p + 8);
+	rec->protocol_id = p[16];
+	rec->data_coding_scheme = p[17];
+	rec->msg_ref = p[18];
+	rec->flags = p[19];
+	rec->concat_ref = osmo_load16le(p + 20);
+	rec->concat_total = p[22];
+	rec->concat_seq = p[23];
+	alen = p[24];
+	p += 25;
+	if (alen >= sizeof(rec->address) || end - p < alen + 2)
+		return -EBADMSG;
+	memcpy(rec->address, p, alen);
+	p += alen;
+	rec->user_data_len = *p++;
+	rec->ud_octets = *p++;
+	if (rec->ud_octets > sizeof(rec->user_data)
+	 || end - p < rec->ud_octets + 2)
+		return -EBADMSG;
+	memcpy(rec->user_data, p, rec->ud_octets);
+	p += rec->ud_octets;
+	tlen = osmo_load16le(p);
+	p += 2;
+	if (tlen >= sizeof(rec->text) || end - p != tlen)
+		return -EBADMSG;
+	memcpy(rec->text, p, tlen);
+
+	return 0;
+}
+
+/* find the concatenation information element in the user data header */
+static void rec_concat(struct sms_store_rec *rec)
+{
+	const uint8_t *p, *end;
+	uint8_t iei, iel;
+
+	if (!(rec->flags & SMS_STORE_F_UDHI) || !rec->ud_octets
+	 || rec->user_data[0] + 1 > rec->ud_octets)
+		return;
+
+	p = rec->user_data + 1;
+	end = p + rec->user_data[0];
+	while (end - p >= 2) {
+		iei = p[0];
+		iel = p[1];
+		p += 2;
+		if (iel > end - p)
+			return;
+		if (iei == 0x00 && iel == 3) {
+			/* 8 bit reference */
+			rec->concat_ref = p[0];
+			rec->concat_total = p[1];
+			rec->concat_seq = p[2];
+			rec->flags |= SMS_STORE_F_CONCAT;
+			return;
+		}
+		if (iei == 0x08 && iel == 4) {
+			/* 16 bit reference */
+			rec->concat_ref = osmo_load16be(p);
+			rec->concat_total = p[2];
+			rec->concat_seq = p[3];
+			rec->flags |= SMS_STORE_F_CONCAT;
+			return;
+		}
+		p += iel;
+	}
+}
+
+static void rec_from_sms(struct sms_store_rec *rec, const struct gsm_sms *sms)
+{
+	unsigned int octets = sms->user_data_len;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->rx_time = time(NULL);
+	rec->scts = sms->time;
+	rec->protocol_id = sms->protocol_id;
+	rec->data_coding_scheme = sms->data_coding_scheme;
+	rec->msg_ref = sms->msg_ref;
+	if (sms->ud_hdr_ind)
+		rec->flags |= SMS_STORE_F_UDHI;
+	if (sms->status_rep_req)
+		rec->flags |= SMS_STORE_F_SRI;
+	if (sms->reply_path_req)
+		rec->flags |= SMS_STORE_F_RP;
+	OSMO_STRLCPY_ARRAY(rec->address, sms->address);
+
+	/* TP-UDL counts septets with the 7 bit alphabet */
+	rec->user_data_len = sms->user_data_len;
+	if (gsm338_get_sms_alphabet(sms->data_coding_scheme)
+						== DCS_7BIT_DEFAULT)
+		octets = (octets * 7 + 7) / 8;
+	rec->ud_octets = OSMO_MIN(octets, sizeof(rec->user_data));
+	memcpy(rec->user_data, sms->user_data, rec->ud_octets);
+	OSMO_STRLCPY_ARRAY(rec->text, sms->text);
+
+	rec_concat(rec);
+}
+
+/*
+ * file
+ */
+
+static int write_all(int fd, const uint8_t *data, size_t len)
+{
+	ssize_t rc;
+	size_t done = 0;
+
+	while (done < len) {
+		rc = write(fd, data + done, len - done);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return done ? done : -errno;
+		}
+		done += rc;
+	}
+
+	return done;
+}
+
+static int check_hdr(int fd)
+{
+	uint8_t hdr[SMS_STORE_HDR_LEN];
+
+	if (pread(fd, hdr, sizeof(hdr), 0) != sizeof(hdr))
+		return -EINVAL;
+	if (memcmp(hdr, SMS_STORE_MAGIC, sizeof(SMS_STORE_MAGIC)))
+		return -EINVAL;
+	if (osmo_load16le(hdr + 8) != SMS_STORE_VERSION)
+		return -EPROTONOSUPPORT;
+
+	return 0;
+}
+
+/* Call cb for each record, return the end of the last valid record in
+ * 'valid'. Records after one that is torn are not read. */
+static int store_scan(int fd, off_t *valid,
+	int (*cb)(void *priv, const struct sms_store_rec *rec, off_t off),
+	void *priv)
+{
+	struct sms_store_rec rec;
+	uint8_t *buf;
+	off_t base = SMS_STORE_HDR_LEN; /* file offset of buf[0] */
+	size_t len = 0, pos, rlen;
+	ssize_t rc;
+	int err = 0;
+
+	*valid = base;
+	buf = malloc(SCAN_BUF_SIZE);
+	if (!buf)
+		return -ENOMEM;
+
+	do {
+		rc = pread(fd, buf + len, SCAN_BUF_SIZE - len, base + len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			err = -errno;
+			break;
+		}
+		len += rc;
+
+		for (pos = 0; len - pos >= REC_HDR_LEN; pos += rlen) {
+			rlen = REC_HDR_LEN + osmo_load16le(buf + pos);
+			if (rlen > REC_HDR_LEN + REC_MAX_LEN)
+				goto out;
+			if (len - pos < rlen)
+				break;
+			if (rec_decode(buf + pos, rlen, &rec) < 0)
+				goto out;
+			err = cb(priv, &rec, base + pos);
+			if (err < 0)
+				goto out;
+			*valid = base + pos + rlen;
+		}
+		memmove(buf, buf + pos, len - pos);
+		base += pos;
+		len -= pos;
+	} while (rc);
+
+out:
+	free(buf);
+	return err;
+}
+
+/*
+ * index
+ */
+
+static int index_add(struct sms_store *st, off_t off, time_t rx_time,
+	const char *address)
+{
+	struct store_ent *ent;
+	uint32_t *by_time, n = st->num;
+	unsigned int lo, hi, mid, alloc;
+
+	/* the size is only taken when both arrays have it, so a failed
+	 * realloc leaves a consistent index */
+	if (st->num == st->alloc) {
+		alloc = st->alloc ? st->alloc * 2 : 256;
+		ent = talloc_realloc(st, st->ent, struct store_ent, alloc);
+		if (!ent)
+			return -ENOMEM;
+		st->ent = ent;
+		by_time = talloc_realloc(st, st->by_time, uint32_t, alloc);
+		if (!by_time)
+			return -ENOMEM;
+		st->by_time = by_time;
+		st->alloc = alloc;
+	}
+
+	ent = &st->ent[n];
+	ent->off = off;
+	ent->rx_time = rx_time;
+	ent->sender = sender_hash(address);
+	ent->prev = st->sender_head[ent->sender & (SENDER_HASH - 1)];
+	st->sender_head[ent->sender & (SENDER_HASH - 1)] = n;
+
+	/* usually the latest, unless the clock was set back */
+	lo = n;
+	if (n && st->ent[st->by_time[n - 1]].rx_time > rx_time) {
+		lo = 0;
+		hi = n;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (st->ent[st->by_time[mid]].rx_time <= rx_time)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		memmove(st->by_time + lo + 1, st->by_time + lo,
+			(n - lo) * sizeof(*st->by_time));
+	}
+	st->by_time[lo] = n;
+	st->num++;
+
+	return 0;
+}
+
+static int index_scan_cb(void *priv, const struct sms_store_rec *rec,
+	off_t off)
+{
+	return index_add(priv, off, rec->rx_time, rec->address);
+}
+
+/* read a record, it may still be in the buffer */
+static int store_read_rec(struct sms_store *st, off_t off,
+	struct sms_store_rec *rec)
+{
+	uint8_t data[REC_HDR_LEN + REC_MAX_LEN];
+	off_t buffered = st->size - st->len;
+	size_t rlen;
+
+	if (off >= buffered) {
+		rlen = REC_HDR_LEN + osmo_load16le(st->buf + (off - buffered));
+		return rec_decode(st->buf + (off - buffered), rlen, rec);
+	}
+
+	if (pread(st->fd, data, REC_HDR_LEN, off) != REC_HDR_LEN)
+		return -EIO;
+	rlen = REC_HDR_LEN + osmo_load16le(data);
+	if (rlen > sizeof(data)
+	 || pread(st->fd, data + REC_HDR_LEN, rlen - REC_HDR_LEN,
+		  off + REC_HDR_LEN) != rlen - REC_HDR_LEN)
+		return -EIO;
+
+	return rec_decode(data, rlen, rec);
+}
+
+/*
+ * store
+ */
+
+static void store_flush_cb(void *data)
+{
+	sms_store_flush(data);
+}
+
+/* open the store, create it if it does not exist */
+struct sms_store *sms_store_open(void *ctx, const char *path)
+{
+	struct sms_store *st;
+	uint8_t hdr[SMS_STORE_HDR_LEN];
+	struct stat st_buf;
+	off_t valid;
+	int rc, i;
+
+	st = talloc_zero(ctx, struct sms_store);
+	if (!st)
+		return NULL;
+	st->path = talloc_strdup(st, path);
+	for (i = 0; i < SENDER_HASH; i++)
+		st->sender_head[i] = ENT_NONE;
+	st->flush_timer.cb = store_flush_cb;
+	st->flush_timer.data = st;
+
+	st->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (st->fd < 0 || fstat(st->fd, &st_buf) < 0) {
+		rc = -errno;
+		goto error;
+	}
+
+	if (st_buf.st_size == 0) {
+		memset(hdr, 0, sizeof(hdr));
+		memcpy(hdr, SMS_STORE_MAGIC, sizeof(SMS_STORE_MAGIC));
+		osmo_store16le(SMS_STORE_VERSION, hdr + 8);
+		if (write_all(st->fd, hdr, sizeof(hdr)) != sizeof(hdr)) {
+			rc = -EIO;
+			goto error;
+		}
+		st->size = sizeof(hdr);
+		return st;
+	}
+
+	rc = check_hdr(st->fd);
+	if (rc < 0)
+		goto error;
+	rc = store_scan(st->fd, &valid, index_scan_cb, st);
+	if (rc < 0)
+		goto error;
+
+	/* a crash tears at most the buffer that was written last, more
+	 * garbage is not cut off, it may be a damaged record in between */
+	if (st_buf.st_size > valid) {
+		if (st_buf.st_size - valid > STORE_BUF_SIZE) {
+			rc = -EBADMSG;
+			goto error;
+		}
+		LOGP(DLSMS, LOGL_NOTICE, "SMS store '%s' has %lld torn octets "
+			"at the end, discarding.\n", path,
+			(long long)(st_buf.st_size - valid));
+		if (ftruncate(st->fd, valid) < 0) {
+			rc = -errno;
+			goto error;
+		}
+	}
+	st->size = valid;
+
+	LOGP(DLSMS, LOGL_INFO, "Opened SMS store '%s' (%u SMS)\n", path,
+		st->num);
+
+	return st;
+
+error:
+	LOGP(DLSMS, LOGL_ERROR, "Failed to open SMS store '%s': %s\n", path,
+		strerror(-rc));
+	if (st->fd >= 0)
+		close(st->fd);
+	talloc_free(st);
+	return NULL;
+}
+
+void sms_store_close(struct sms_store *st)
+{
+	if (!st)
+		return;
+
+	sms_store_flush(st);
+	osmo_timer_del(&st->flush_timer);
+	close(st->fd);
+	talloc_free(st);
+}
+
+/* write the buffer, what cannot be written stays there */
+int sms_store_flush(struct sms_store *st)
+{
+	int rc;
+
+	osmo_timer_del(&st->flush_timer);
+	if (!st->len)
+		return 0;
+
+	rc = write_all(st->fd, st->buf, st->len);
+	if (rc < 0 || rc < st->len) {
+		if (rc > 0) {
+			memmove(st->buf, st->buf + rc, st->len - rc);
+			st->len -= rc;
+		}
+		LOGP(DLSMS, LOGL_ERROR, "Failed to write SMS store '%s'\n",
+			st->path);
+		return -EIO;
+	}
+	st->len = 0;
+
+	return 0;
+}
+
+/* append a received SMS */
+int sms_store_add(struct sms_store *st, const struct gsm_sms *sms)
+{
+	struct sms_store_rec rec;
+	size_t rlen;
+	int rc;
+
+	if (st->len + REC_HDR_LEN + REC_MAX_LEN > sizeof(st->buf)) {
+		rc = sms_store_flush(st);
+		if (rc < 0)
+			return rc;
+	}
+
+	rec_from_sms(&rec, sms);
+	rlen = rec_encode(st->buf + st->len, &rec);
+
+	rc = index_add(st, st->size, rec.rx_time, rec.address);
+	if (rc < 0)
+		return rc;
+	st->len += rlen;
+	st->size += rlen;
+
+	if (!osmo_timer_pending(&st->flush_timer))
+		osmo_timer_schedule(&st->flush_timer, 0,
+			SMS_STORE_FLUSH_MS * 1000);
+
+	return 0;
+}
+
+unsigned int sms_store_count(const struct sms_store *st)
+{
+	return st->num;
+}
+
+/* Call cb for up to 'max' SMS received from 'from' to 'to', latest first.
+ * If 'sender' is given, only SMS of this sender are found. Return the
+ * number of SMS found. */
+int sms_store_query(struct sms_store *st, const char *sender, time_t from,
+	time_t to, unsigned int max, sms_store_cb cb, void *priv)
+{
+	struct sms_store_rec rec;
+	struct store_ent *ent;
+	unsigned int lo = 0, hi = st->num, mid, n = 0;
+	uint32_t h, i;
+	int rc;
+
+	if (sender) {
+		h = sender_hash(sender);
+		for (i = st->sender_head[h & (SENDER_HASH - 1)];
+		     i != ENT_NONE && n < max; i = ent->prev) {
+			ent = &st->ent[i];
+			if (ent->sender != h || ent->rx_time < from
+			 || ent->rx_time > to)
+				continue;
+			if (store_read_rec(st, ent->off, &rec) < 0
+			 || strcmp(rec.address, sender))
+				continue;
+			rc = cb(priv, &rec);
+			if (rc < 0)
+				return rc;
+			n++;
+		}
+		return n;
+	}
+
+	/* the first entry received after 'to' */
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (st->ent[st->by_time[mid]].rx_time <= to)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	while (lo-- > 0 && n < max) {
+		ent = &st->ent[st->by_time[lo]];
+		if (ent->rx_time < from)
+			break;
+		if (store_read_rec(st, ent->off, &rec) < 0)
+			continue;
+		rc = cb(priv, &rec);
+		if (rc < 0)
+			return rc;
+		n++;
+	}
+
+	return n;
+}
+
+/*
+ * reader
+ */
+
+struct read_state {
+	sms_store_cb cb;
+	void *priv;
+};
+
+static int read_scan_cb(void *priv, const struct sms_store_rec *rec,
+	off_t off)
+{
+	struct read_state *rs = priv;
+
+	return rs->cb(rs->priv, rec);
+}
+
+/* read all records of a store file in the order they were received */
+int sms_store_read(const char *path, sms_store_cb cb, void *priv)
+{
+	struct read_state rs = {
+		.cb = cb,
+		.priv = priv,
+	};
+	off_t valid;
+	int fd, rc;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	rc = check_hdr(fd);
+	if (rc == 0)
+		rc = store_scan(fd, &valid, read_scan_cb, &rs);
+	close(fd);
+
+	return rc;
+}
+
+static const char *print_time(char *buf, size_t len, time_t t)
+{
+	struct tm tm;
+
+	if (!gmtime_r(&t, &tm)
+	 || !strftime(buf, len, "%Y-%m-%d %H:%M:%S UTC", &tm))
+		snprintf(buf, len, "%lld", (long long)t);
+
+	return buf;
+}
+
+/* print a record as text */
+void sms_store_print(const struct sms_store_rec *rec,
+	void (*print)(void *, const char *, ...), void *priv)
+{
+	char rx[32], scts[32];
+
+	print(priv, "[SMS from %s, received %s, SCTS %s, PID 0x%02x, "
+		"DCS 0x%02x", rec->address,
+		print_time(rx, sizeof(rx), rec->rx_time),
+		print_time(scts, sizeof(scts), rec->scts), rec->protocol_id,
+		rec->data_coding_scheme);
+	if ((rec->flags & SMS_STORE_F_CONCAT))
+		print(priv, ", part %u/%u ref %u", rec->concat_seq,
+			rec->concat_total, rec->concat_ref);
+	print(priv, "]\n");
+
+	if (rec->text[0])
+		print(priv, "%s\n", rec->text);
+	else
+		print(priv, "UD %s\n", osmo_hexdump_nospc(rec->user_data,
+			rec->ud_octets));
+}
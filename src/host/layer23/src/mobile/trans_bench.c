@@ -0,0 +1,343 @@
+/* Benchmark of the transaction index */
+
+/*
+ * (C) 2026 by the OsmocomBB contributors
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/common/ms.h>
+#include <osmocom/bb/mobile/transaction.h>
+
+/* Transactions of CC, SS, SMS and GCC are allocated with IDs from
+ * trans_assign_trans_id(), and looked up by ID and callref, as inbound
+ * messages and MNCC primitives do. Each lookup is timed against a walk over
+ * the transaction list, which is what transaction.c did before it had an
+ * index, and both must give the same transaction. The IDs are checked
+ * against the bitmap of a list walk as well. */
+
+#define LOOKUPS		4096 /* lookups of the set */
+
+/* transaction.c calls the protocols to free their state */
+void _gsm48_cc_trans_free(struct gsm_trans *trans) { }
+void _gsm480_ss_trans_free(struct gsm_trans *trans) { }
+void _gsm411_sms_trans_free(struct gsm_trans *trans) { }
+void _gsm44068_gcc_bcc_trans_free(struct gsm_trans *trans) { }
+
+static const uint8_t protocols[] = {
+	GSM48_PDISC_CC, GSM48_PDISC_NC_SS, GSM48_PDISC_SMS,
+	GSM48_PDISC_GROUP_CC,
+};
+
+struct lookup {
+	uint8_t protocol;
+	uint8_t trans_id;
+	uint32_t callref;
+};
+
+static struct timespec start_time;
+
+static void bench_start(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+static void bench_stop(const char *what, unsigned long count)
+{
+	struct timespec now;
+	double secs;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	secs = (now.tv_sec - start_time.tv_sec)
+		+ (now.tv_nsec - start_time.tv_nsec) / 1e9;
+	printf("%-32s %10lu in %8.3f s, %8.1f ns each\n", what, count, secs,
+		count ? secs * 1e9 / count : 0.0);
+}
+
+static struct gsm_trans *walk_find_by_id(struct osmocom_ms *ms,
+	uint8_t proto, uint8_t trans_id)
+{
+	struct gsm_trans *trans;
+
+	llist_for_each_entry(trans, &ms->trans_list, entry) {
+		if (trans->protocol == proto &&
+		    trans->transaction_id == trans_id)
+			return trans;
+	}
+	return NULL;
+}
+
+static struct gsm_trans *walk_find_by_callref(struct osmocom_ms *ms,
+	uint8_t protocol, uint32_t callref)
+{
+	struct gsm_trans *trans;
+
+	llist_for_each_entry(trans, &ms->trans_list, entry) {
+		if (trans->protocol == protocol && trans->callref == callref)
+			return trans;
+	}
+	return NULL;
+}
+
+static int walk_assign_trans_id(struct osmocom_ms *ms, uint8_t protocol,
+	uint8_t ti_flag)
+{
+	struct gsm_trans *trans;
+	unsigned int used_tid_bitmask = 0;
+	int i, j, h;
+
+	if (ti_flag)
+		ti_flag = 0x8;
+
+	llist_for_each_entry(trans, &ms->trans_list, entry) {
+		if (trans->protocol != protocol ||
+		    trans->transaction_id == 0xff)
+			continue;
+		used_tid_bitmask |= (1 << trans->transaction_id);
+	}
+
+	for (h = 6; h > 0; h--)
+		if (used_tid_bitmask & (1 << (h | ti_flag)))
+			break;
+	for (i = 0; i < 7; i++) {
+		j = ((h + i) % 7) | ti_flag;
+		if ((used_tid_bitmask & (1 << j)) == 0)
+			return j;
+	}
+
+	return -1;
+}
+
+/* allocate a transaction with a new ID of the protocol, as MM and CC do */
+static struct gsm_trans *alloc_trans(struct osmocom_ms *ms, uint8_t protocol,
+	uint8_t ti_flag, uint32_t callref)
+{
+	int id;
+
+	id = trans_assign_trans_id(ms, protocol, ti_flag);
+	if (id != walk_assign_trans_id(ms, protocol, ti_flag)) {
+		fprintf(stderr, "Transaction ID %d differs\n", id);
+		return NULL;
+	}
+	if (id < 0)
+		return NULL;
+
+	return trans_alloc(ms, protocol, id, callref);
+}
+
+/* half of the lookups are for existing transactions */
+static void lookup_generate(struct osmocom_ms *ms, struct lookup *l,
+	unsigned int num)
+{
+	struct gsm_trans *trans;
+	unsigned int i, j;
+
+	for (i = 0; i < LOOKUPS; i++) {
+		l[i].protocol = protocols[random() % ARRAY_SIZE(protocols)];
+		l[i].trans_id = random() % 16;
+		l[i].callref = random();
+		if (random() % 2)
+			continue;
+		j = random() % num;
+		llist_for_each_entry(trans, &ms->trans_list, entry) {
+			if (!j--) {
+				l[i].protocol = trans->protocol;
+				l[i].trans_id = trans->transaction_id;
+				l[i].callref = trans->callref;
+				break;
+			}
+		}
+	}
+}
+
+static int bench_lookup(struct osmocom_ms *ms, const struct lookup *l,
+	unsigned long iterations)
+{
+	struct gsm_trans *found[LOOKUPS];
+	unsigned long i, j, count;
+
+	count = 0;
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < LOOKUPS; j++) {
+			found[j] = walk_find_by_id(ms, l[j].protocol,
+				l[j].trans_id);
+			count++;
+		}
+	}
+	bench_stop("find by ID, list", count);
+
+	count = 0;
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < LOOKUPS; j++) {
+			if (trans_find_by_id(ms, l[j].protocol, l[j].trans_id)
+					!= found[j]) {
+				fprintf(stderr, "Transaction %u/%u differs\n",
+					l[j].protocol, l[j].trans_id);
+				return -EFAULT;
+			}
+			count++;
+		}
+	}
+	bench_stop("find by ID, index", count);
+
+	count = 0;
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < LOOKUPS; j++) {
+			found[j] = walk_find_by_callref(ms, l[j].protocol,
+				l[j].callref);
+			count++;
+		}
+	}
+	bench_stop("find by callref, list", count);
+
+	count = 0;
+	bench_start();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < LOOKUPS; j++) {
+			if (trans_find_by_callref(ms, l[j].protocol,
+					l[j].callref) != found[j]) {
+				fprintf(stderr, "Transaction %u/%08x differs\n",
+					l[j].protocol, l[j].callref);
+				return -EFAULT;
+			}
+			count++;
+		}
+	}
+	bench_stop("find by callref, index", count);
+
+	return 0;
+}
+
+/* free a random transaction and allocate a new one of the same protocol
+ * and TI flag, so IDs and callrefs are reused */
+static int bench_churn(struct osmocom_ms *ms, unsigned int num,
+	unsigned long iterations)
+{
+	struct gsm_trans *trans, *victim;
+	unsigned long i, count = 0;
+	unsigned int j;
+	uint8_t protocol, ti_flag;
+
+	bench_start();
+	for (i = 0; i < iterations * num; i++) {
+		j = random() % num;
+		victim = NULL;
+		llist_for_each_entry(trans, &ms->trans_list, entry) {
+			if (!j--) {
+				victim = trans;
+				break;
+			}
+		}
+		protocol = victim->protocol;
+		ti_flag = victim->transaction_id & 0x8;
+		trans_free(victim);
+		trans = alloc_trans(ms, protocol, ti_flag, random());
+		if (!trans)
+			return -EFAULT;
+		if (random() % 4 == 0)
+			trans_set_callref(trans, random());
+		count++;
+	}
+	bench_stop("free and allocate", count);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct osmocom_ms *ms;
+	struct lookup *lookups;
+	unsigned long iterations = 1000;
+	unsigned int num = 16, i;
+	void *ctx;
+	int rc = 0;
+
+	if (argc > 3 || (argc > 1 && !strcmp(argv[1], "-h"))) {
+		fprintf(stderr, "Usage: %s [<iterations> [<transactions>]]\n",
+			argv[0]);
+		fprintf(stderr, "Up to 14 transactions per protocol, "
+			"default: %lu rounds of %u transactions\n", iterations,
+			num);
+		return 0;
+	}
+	if (argc > 1)
+		iterations = strtoul(argv[1], NULL, 0);
+	if (argc > 2)
+		num = atoi(argv[2]);
+	if (num < 1 || num > 14 * ARRAY_SIZE(protocols)) {
+		fprintf(stderr, "Transactions must be 1..%zu\n",
+			14 * ARRAY_SIZE(protocols));
+		return -EINVAL;
+	}
+
+	ctx = talloc_named_const(NULL, 0, "trans_bench");
+	/* no log target, only the index is timed */
+	log_init(&log_info, ctx);
+	srandom(1);
+
+	ms = talloc_zero(ctx, struct osmocom_ms);
+	lookups = talloc_array(ctx, struct lookup, LOOKUPS);
+	if (!ms || !lookups) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	ms->name = talloc_strdup(ms, "bench");
+	INIT_LLIST_HEAD(&ms->trans_list);
+
+	/* both TI flags of each protocol in turn, so the IDs wrap */
+	for (i = 0; i < num; i++) {
+		if (!alloc_trans(ms, protocols[i % ARRAY_SIZE(protocols)],
+				(i / ARRAY_SIZE(protocols)) % 2, random())) {
+			rc = -EFAULT;
+			goto out;
+		}
+	}
+
+	lookup_generate(ms, lookups, num);
+	rc = bench_lookup(ms, lookups, iterations);
+	if (rc < 0)
+		goto out;
+	rc = bench_churn(ms, num, iterations);
+	if (rc < 0)
+		goto out;
+	/* the index must still be right after the churn */
+	lookup_generate(ms, lookups, num);
+	rc = bench_lookup(ms, lookups, 1);
+
+out:
+	while (ms && !llist_empty(&ms->trans_list))
+		trans_free(llist_first_entry(&ms->trans_list, struct gsm_trans,
+			entry));
+	talloc_free(ctx);
+
+	if (rc < 0)
+		fprintf(stderr, "Benchmark failed: %s\n", strerror(-rc));
+
+	return rc;
+}
@@ -16,6 +16,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
 #include <osmocom/core/signal.h>
 #include <osmocom/core/talloc.h>
@@ -33,11 +34,92 @@ void _gsm480_ss_trans_free(struct gsm_trans *trans);
 void _gsm411_sms_trans_free(struct gsm_trans *trans);
 void _gsm44068_gcc_bcc_trans_free(struct gsm_trans *trans);
 
+#define CALLREF_HASH	64 /* power of two */
+
+/* Index of the transactions of an MS, so that inbound messages do not
+ * walk the list. Protocol discriminator and transaction ID have 4 bits
+ * each, so a table covers all of them. If several transactions share an
+ * ID, the one indexed first is found. */
+struct trans_index {
+	struct gsm_trans *by_id[16][16]; /* [protocol][transaction ID] */
+	uint8_t id_num[16][16]; /* transactions using the ID */
+	uint16_t id_used[16]; /* bitmap of used IDs per protocol */
+	struct llist_head callref_hash[CALLREF_HASH];
+};
+
+static struct trans_index *index_get(struct osmocom_ms *ms)
+{
+	struct trans_index *idx;
+	int i;
+
+	if (ms->trans_idx)
+		return ms->trans_idx;
+
+	idx = talloc_zero(ms, struct trans_index);
+	if (!idx)
+		return NULL;
+	for (i = 0; i < CALLREF_HASH; i++)
+		INIT_LLIST_HEAD(&idx->callref_hash[i]);
+	ms->trans_idx = idx;
+
+	return idx;
+}
+
+static struct llist_head *callref_bucket(struct trans_index *idx,
+					 uint8_t protocol, uint32_t callref)
+{
+	uint32_t h = (callref ^ ((uint32_t)protocol << 28)) * 0x9e3779b1;
+
+	return &idx->callref_hash[h >> 26];
+}
+
+static void index_add_id(struct trans_index *idx, struct gsm_trans *trans)
+{
+	uint8_t p = trans->protocol, t = trans->transaction_id;
+
+	/* unassigned (0xff) is not indexed */
+	if (p > 15 || t > 15)
+		return;
+	if (!idx->id_num[p][t]++)
+		idx->by_id[p][t] = trans;
+	idx->id_used[p] |= 1 << t;
+}
+
+static void index_del_id(struct trans_index *idx, struct gsm_trans *trans)
+{
+	uint8_t p = trans->protocol, t = trans->transaction_id;
+	struct gsm_trans *other;
+
+	if (p > 15 || t > 15)
+		return;
+	if (!--idx->id_num[p][t]) {
+		idx->by_id[p][t] = NULL;
+		idx->id_used[p] &= ~(1 << t);
+		return;
+	}
+	if (idx->by_id[p][t] != trans)
+		return;
+
+	/* the ID is shared, index the next one */
+	llist_for_each_entry(other, &trans->ms->trans_list, entry) {
+		if (other != trans && other->protocol == p
+		 && other->transaction_id == t) {
+			idx->by_id[p][t] = other;
+			break;
+		}
+	}
+}
+
 struct gsm_trans *trans_find_by_id(struct osmocom_ms *ms,
 				   uint8_t proto, uint8_t trans_id)
 {
 	struct gsm_trans *trans;
 
+	if (!ms->trans_idx)
+		return NULL;
+	if (proto <= 15 && trans_id <= 15)
+		return ms->trans_idx->by_id[proto][trans_id];
+
 	llist_for_each_entry(trans, &ms->trans_list, entry) {
 		if (trans->protocol == proto &&
 		    trans->transaction_id == trans_id)
@@ -51,7 +133,11 @@ struct gsm_trans *trans_find_by_callref(struct osmocom_ms *ms, uint8_t protocol,
 {
 	struct gsm_trans *trans;
 
-	llist_for_each_entry(trans, &ms->trans_list, entry) {
+	if (!ms->trans_idx)
+		return NULL;
+
+	llist_for_each_entry(trans, callref_bucket(ms->trans_idx, protocol,
+						   callref), callref_entry) {
 		if (trans->protocol == protocol && trans->callref == callref)
 			return trans;
 	}
@@ -62,8 +148,12 @@ struct gsm_trans *trans_alloc(struct osmocom_ms *ms,
 			      uint8_t protocol, uint8_t trans_id,
 			      uint32_t callref)
 {
+	struct trans_index *idx;
 	struct gsm_trans *trans;
 
+	idx = index_get(ms);
+	if (!idx)
+		return NULL;
 	trans = talloc_zero(ms, struct gsm_trans);
 	if (!trans)
 		return NULL;
@@ -79,6 +169,9 @@ struct gsm_trans *trans_alloc(struct osmocom_ms *ms,
 	trans->callref = callref;
 
 	llist_add_tail(&trans->entry, &ms->trans_list);
+	index_add_id(idx, trans);
+	llist_add_tail(&trans->callref_entry,
+		       callref_bucket(idx, protocol, callref));
 
 	osmo_signal_dispatch(SS_L23_TRANS, S_L23_CC_TRANS_ALLOC, trans);
 
@@ -108,30 +201,52 @@ void trans_free(struct gsm_trans *trans)
 	DEBUGP(DCC, "ms %s frees transaction (mem %p)\n", trans->ms->name,
 		trans);
 
+	index_del_id(trans->ms->trans_idx, trans);
+	llist_del(&trans->callref_entry);
 	llist_del(&trans->entry);
 
 	talloc_free(trans);
 }
 
+/* change the transaction ID, the index follows */
+void trans_set_id(struct gsm_trans *trans, uint8_t trans_id)
+{
+	if (trans->transaction_id == trans_id)
+		return;
+
+	index_del_id(trans->ms->trans_idx, trans);
+	trans->transaction_id = trans_id;
+	index_add_id(trans->ms->trans_idx, trans);
+}
+
+/* change the callref, the index follows */
+void trans_set_callref(struct gsm_trans *trans, uint32_t callref)
+{
+	struct trans_index *idx = trans->ms->trans_idx;
+
+	if (trans->callref == callref)
+		return;
+
+	llist_del(&trans->callref_entry);
+	trans->callref = callref;
+	llist_add_tail(&trans->callref_entry,
+		       callref_bucket(idx, trans->protocol, callref));
+}
+
 /* allocate an unused transaction ID
  * in the given protocol using the ti_flag specified */
 int trans_assign_trans_id(struct osmocom_ms *ms,
 			  uint8_t protocol, uint8_t ti_flag)
 {
-	struct gsm_trans *trans;
 	unsigned int used_tid_bitmask = 0;
 	int i, j, h;
 
 	if (ti_flag)
 		ti_flag = 0x8;
 
-	/* generate bitmask of already-used TIDs for this (proto) */
-	llist_for_each_entry(trans, &ms->trans_list, entry) {
-		if (trans->protocol != protocol ||
-		    trans->transaction_id == 0xff)
-			continue;
-		used_tid_bitmask |= (1 << trans->transaction_id);
-	}
+	/* bitmask of already-used TIDs for this (proto) */
+	if (ms->trans_idx && protocol <= 15)
+		used_tid_bitmask = ms->trans_idx->id_used[protocol];
 
 	/* find a new one, trying to go in a 'circular' pattern */
 	for (h = 6; h > 0; h--)
@@ -17,6 +17,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -32,6 +33,7 @@
 #include <osmocom/bb/common/ms.h>
 #include <osmocom/bb/common/networks.h>
 #include <osmocom/bb/common/gps.h>
+#include <osmocom/bb/common/paging_watch.h>
 #include <osmocom/bb/mobile/mncc.h>
 #include <osmocom/bb/mobile/mncc_ms.h>
 #include <osmocom/bb/mobile/transaction.h>
@@ -39,6 +41,7 @@
 #include <osmocom/bb/mobile/app_mobile.h>
 #include <osmocom/bb/mobile/gsm480_ss.h>
 #include <osmocom/bb/mobile/gsm411_sms.h>
+#include <osmocom/bb/mobile/sms_store.h>
 #include <osmocom/bb/mobile/gsm44068_gcc_bcc.h>
 #include <osmocom/vty/telnet_interface.h>
 #include <osmocom/vty/misc.h>
@@ -409,6 +412,138 @@ DEFUN(show_asci_neighbors, show_asci_neighbors_cmd, "show asci MS_NAME neighbors
 	return CMD_SUCCESS;
 }
 
+DEFUN(show_ia_latency, show_ia_latency_cmd,
+	"show random-access MS_NAME latency",
+	SHOW_STR "Display random access information\n"
+	"Name of MS (see \"show ms\")\n"
+	"Latency from IMMEDIATE ASSIGNMENT to channel activation\n")
+{
+	struct osmocom_ms *ms;
+
+	ms = l23_vty_get_ms(argv[0], vty);
+	if (!ms)
+		return CMD_WARNING;
+
+	gsm48_rr_dump_ia_lat(ms, l23_vty_printf, vty);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_hando, show_hando_cmd, "show handover MS_NAME",
+	SHOW_STR "Display handover context and interruption times\n"
+	"Name of MS (see \"show ms\")\n")
+{
+	struct osmocom_ms *ms;
+
+	ms = l23_vty_get_ms(argv[0], vty);
+	if (!ms)
+		return CMD_WARNING;
+
+	gsm48_rr_dump_hando(ms, l23_vty_printf, vty);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_dq, show_dq_cmd, "show downlink-queue MS_NAME",
+	SHOW_STR "Display RR queues towards layer 2\n"
+	"Name of MS (see \"show ms\")\n")
+{
+	struct osmocom_ms *ms;
+
+	ms = l23_vty_get_ms(argv[0], vty);
+	if (!ms)
+		return CMD_WARNING;
+
+	gsm48_rr_dump_dq(ms, l23_vty_printf, vty);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(show_sms_bulk, show_sms_bulk_cmd, "show sms-bulk MS_NAME",
+	SHOW_STR "Display bulk SMS submission\n"
+	"Name of MS (see \"show ms\")\n")
+{
+	struct osmocom_ms *ms;
+
+	ms = l23_vty_get_ms(argv[0], vty);
+	if (!ms)
+		return CMD_WARNING;
+
+	sms_bulk_dump(ms, l23_vty_printf, vty);
+
+	return CMD_SUCCESS;
+}
+
+static int vty_sms_store_rec(void *priv, const struct sms_store_rec *rec)
+{
+	sms_store_print(rec, l23_vty_printf, priv);
+	return 0;
+}
+
+/* show the latest SMS of the store that match */
+static int vty_sms_store_query(struct vty *vty, const char *name,
+	const char *sender, time_t from, time_t to, const char *max)
+{
+	struct osmocom_ms *ms;
+	struct sms_store *st;
+	int n;
+
+	ms = l23_vty_get_ms(name, vty);
+	if (!ms)
+		return CMD_WARNING;
+	st = gsm411_sms_store(ms);
+	if (!st) {
+		vty_out(vty, "Failed to open SMS store%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	n = sms_store_query(st, sender, from, to, max ? atoi(max) : 10,
+		vty_sms_store_rec, vty);
+	vty_out(vty, "%d of %u SMS shown%s", n, sms_store_count(st),
+		VTY_NEWLINE);
+
+	return CMD_SUCCESS;
+}
+
+#define SHOW_SMS_STORE_STR SHOW_STR "Display received SMS, latest first\n" \
+	"Name of MS (see \"show ms\")\n"
+
+DEFUN(show_sms_store, show_sms_store_cmd, "show sms-store MS_NAME [<1-10000>]",
+	SHOW_SMS_STORE_STR "Maximum number of SMS (default 10)\n")
+{
+	return vty_sms_store_query(vty, argv[0], NULL, 0, LONG_MAX,
+		(argc > 1) ? argv[1] : NULL);
+}
+
+DEFUN(show_sms_store_sender, show_sms_store_sender_cmd,
+	"show sms-store MS_NAME sender NUMBER [<1-10000>]",
+	SHOW_SMS_STORE_STR "Only SMS of a sender\nNumber of the sender\n"
+	"Maximum number of SMS (default 10)\n")
+{
+	return vty_sms_store_query(vty, argv[0], argv[1], 0, LONG_MAX,
+		(argc > 2) ? argv[2] : NULL);
+}
+
+DEFUN(show_sms_store_time, show_sms_store_time_cmd,
+	"show sms-store MS_NAME time <0-4294967295> <0-4294967295> "
+	"[<1-10000>]",
+	SHOW_SMS_STORE_STR "Only SMS received in a time range\n"
+	"Start, seconds since epoch\nEnd, seconds since epoch\n"
+	"Maximum number of SMS (default 10)\n")
+{
+	return vty_sms_store_query(vty, argv[0], NULL, strtoll(argv[1], NULL, 10),
+		strtoll(argv[2], NULL, 10), (argc > 3) ? argv[3] : NULL);
+}
+
+DEFUN(show_paging_watch, show_paging_watch_cmd, "show paging watch",
+	SHOW_STR "Paging\nWatch list of identities in paging\n")
+{
+	vty_out(vty, "Watching %u identities, %lu matches%s",
+		paging_watch_count(), paging_watch_events(), VTY_NEWLINE);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(monitor_network, monitor_network_cmd, "monitor network MS_NAME",
 	"Monitor...\nMonitor network information\nName of MS (see \"show ms\")")
 {
@@ -916,25 +1051,18 @@ DEFUN(call_params_data_async_parity,
 	return cfg_ms_tch_data_cp_async_parity(self, vty, argc - 1, argv + 1);
 }
 
-DEFUN(sms, sms_cmd, "sms MS_NAME NUMBER .LINE",
-	"Send an SMS\nName of MS (see \"show ms\")\nPhone number to send SMS "
-	"(Use digits '0123456789*#abc', and '+' to dial international)\n"
-	"SMS text\n")
+/* get service center and number of an SMS, NULL if not possible */
+static const char *vty_sms_sca(struct vty *vty, struct osmocom_ms *ms,
+	const char **number)
 {
-	struct osmocom_ms *ms;
-	struct gsm_settings *set;
+	struct gsm_settings *set = &ms->settings;
 	struct gsm_settings_abbrev *abbrev;
-	char *number, *sms_sca = NULL;
-
-	ms = l23_vty_get_ms(argv[0], vty);
-	if (!ms)
-		return CMD_WARNING;
-	set = &ms->settings;
+	const char *sms_sca = NULL;
 
 	if (!set->sms_ptp) {
 		vty_out(vty, "SMS not supported by this mobile, please enable "
 			"SMS support%s", VTY_NEWLINE);
-		return CMD_WARNING;
+		return NULL;
 	}
 
 	if (ms->subscr.sms_sca[0])
@@ -945,19 +1073,38 @@ DEFUN(sms, sms_cmd, "sms MS_NAME NUMBER .LINE",
 	if (!sms_sca) {
 		vty_out(vty, "SMS sms-service-center not defined on SIM card, "
 			"please define one at settings.%s", VTY_NEWLINE);
-		return CMD_WARNING;
+		return NULL;
 	}
 
-	number = (char *)argv[1];
 	llist_for_each_entry(abbrev, &set->abbrev, list) {
-		if (!strcmp(number, abbrev->abbrev)) {
-			number = abbrev->number;
-			vty_out(vty, "Using number '%s'%s", number,
+		if (!strcmp(*number, abbrev->abbrev)) {
+			*number = abbrev->number;
+			vty_out(vty, "Using number '%s'%s", *number,
 				VTY_NEWLINE);
 			break;
 		}
 	}
-	if (vty_check_number(vty, number))
+	if (vty_check_number(vty, *number))
+		return NULL;
+
+	return sms_sca;
+}
+
+DEFUN(sms, sms_cmd, "sms MS_NAME NUMBER .LINE",
+	"Send an SMS\nName of MS (see \"show ms\")\nPhone number to send SMS "
+	"(Use digits '0123456789*#abc', and '+' to dial international)\n"
+	"SMS text\n")
+{
+	struct osmocom_ms *ms;
+	const char *number, *sms_sca;
+
+	ms = l23_vty_get_ms(argv[0], vty);
+	if (!ms)
+		return CMD_WARNING;
+
+	number = argv[1];
+	sms_sca = vty_sms_sca(vty, ms, &number);
+	if (!sms_sca)
 		return CMD_WARNING;
 
 	sms_send(ms, sms_sca, number, argv_concat(argv, argc, 2), 42);
@@ -965,6 +1112,74 @@ DEFUN(sms, sms_cmd, "sms MS_NAME NUMBER .LINE",
 	return CMD_SUCCESS;
 }
 
+DEFUN(bulk_send, sms_bulk_send_cmd,
+	"sms-bulk MS_NAME send NUMBER <1-65535> .LINE",
+	"Submit SMS as fast as possible\nName of MS (see \"show ms\")\n"
+	"Queue copies of an SMS\nPhone number to send SMS "
+	"(Use digits '0123456789*#abc', and '+' to dial international)\n"
+	"Number of copies\nSMS text\n")
+{
+	struct osmocom_ms *ms;
+	const char *number, *sms_sca;
+	char *text;
+	int i, count = atoi(argv[2]);
+
+	ms = l23_vty_get_ms(argv[0], vty);
+	if (!ms)
+		return CMD_WARNING;
+
+	number = argv[1];
+	sms_sca = vty_sms_sca(vty, ms, &number);
+	if (!sms_sca)
+		return CMD_WARNING;
+
+	text = argv_concat(argv, argc, 3);
+	if (!text)
+		return CMD_WARNING;
+	for (i = 0; i < count; i++) {
+		if (sms_bulk_queue(ms, sms_sca, number, text) < 0) {
+			vty_out(vty, "Queued only %d SMS%s", i, VTY_NEWLINE);
+			break;
+		}
+	}
+	talloc_free(text);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(bulk_limit, sms_bulk_limit_cmd,
+	"sms-bulk MS_NAME limit <1-7> <0-6000>",
+	"Submit SMS as fast as possible\nName of MS (see \"show ms\")\n"
+	"Set limits of the submission\n"
+	"Number of SMS transactions at a time\n"
+	"SMS submitted per minute (0 = no limit)\n")
+{
+	struct osmocom_ms *ms;
+
+	ms = l23_vty_get_ms(argv[0], vty);
+	if (!ms)
+		return CMD_WARNING;
+
+	sms_bulk_limit(ms, atoi(argv[1]), atoi(argv[2]));
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(bulk_flush, sms_bulk_flush_cmd, "sms-bulk MS_NAME flush",
+	"Submit SMS as fast as possible\nName of MS (see \"show ms\")\n"
+	"Drop SMS that are not submitted yet\n")
+{
+	struct osmocom_ms *ms;
+
+	ms = l23_vty_get_ms(argv[0], vty);
+	if (!ms)
+		return CMD_WARNING;
+
+	sms_bulk_flush(ms);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(service, service_cmd, "service MS_NAME (*#06#|*#21#|*#67#|*#61#|*#62#"
 	"|*#002#|*#004#|*xx*number#|*xx#|#xx#|##xx#|STRING|hangup)",
 	"Send a Supplementary Service request\nName of MS (see \"show ms\")\n"
@@ -1190,6 +1405,85 @@ DEFUN(delete_forbidden_plmn, delete_forbidden_plmn_cmd,
 	return CMD_SUCCESS;
 }
 
+#define PAGING_WATCH_STR "Paging\nWatch list of identities in paging\n"
+
+/* DRX is off while the watch list has entries */
+static void paging_watch_drx_update(void)
+{
+	struct osmocom_ms *ms;
+
+	llist_for_each_entry(ms, &ms_list, entity)
+		gsm48_rr_drx_update(ms);
+}
+
+DEFUN(paging_watch_add_id, paging_watch_add_cmd, "paging watch add ID",
+	PAGING_WATCH_STR "Add an identity to the watch list\n"
+	"IMSI, or TMSI in hex with 0x prefix")
+{
+	int rc;
+
+	rc = paging_watch_add(argv[0]);
+	if (rc < 0) {
+		vty_out(vty, "Given identity invalid%s", VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	paging_watch_drx_update();
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(paging_watch_load_file, paging_watch_load_cmd, "paging watch load FILE",
+	PAGING_WATCH_STR "Add identities from a file, one per line\n"
+	"File name")
+{
+	int rc;
+
+	rc = paging_watch_load(argv[0]);
+	/* some may have been added before an error */
+	paging_watch_drx_update();
+	if (rc < 0) {
+		vty_out(vty, "Failed to load '%s': %s%s", argv[0],
+			strerror(-rc), VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+	vty_out(vty, "%d identities added%s", rc, VTY_NEWLINE);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(paging_watch_clear_all, paging_watch_clear_cmd, "paging watch clear",
+	PAGING_WATCH_STR "Remove all identities from the watch list\n")
+{
+	paging_watch_clear();
+	paging_watch_drx_update();
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(paging_watch_log, paging_watch_log_cmd, "paging watch log FILE",
+	PAGING_WATCH_STR "Append each match to a file\n"
+	"File name, - for stdout")
+{
+	int rc;
+
+	rc = paging_watch_open(argv[0]);
+	if (rc < 0) {
+		vty_out(vty, "Failed to open '%s': %s%s", argv[0],
+			strerror(-rc), VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_paging_watch_log, no_paging_watch_log_cmd, "no paging watch log",
+	NO_STR PAGING_WATCH_STR "Stop writing matches to a file\n")
+{
+	paging_watch_close();
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(network_show, network_show_cmd, "network show MS_NAME",
 	"Network ...\nShow results of network search (again)\n"
 	"Name of MS (see \"show ms\")")
@@ -2994,6 +3288,14 @@ int ms_vty_init(void)
 	install_element_ve(&show_forb_plmn_cmd);
 	install_element_ve(&show_asci_calls_cmd);
 	install_element_ve(&show_asci_neighbors_cmd);
+	install_element_ve(&show_paging_watch_cmd);
+	install_element_ve(&show_ia_latency_cmd);
+	install_element_ve(&show_hando_cmd);
+	install_element_ve(&show_dq_cmd);
+	install_element_ve(&show_sms_bulk_cmd);
+	install_element_ve(&show_sms_store_cmd);
+	install_element_ve(&show_sms_store_sender_cmd);
+	install_element_ve(&show_sms_store_time_cmd);
 	install_element_ve(&monitor_network_cmd);
 	install_element_ve(&no_monitor_network_cmd);
 	install_element(ENABLE_NODE, &off_cmd);
@@ -3012,6 +3314,9 @@ int ms_vty_init(void)
 	install_element(ENABLE_NODE, &call_params_data_async_nr_data_bits_cmd);
 	install_element(ENABLE_NODE, &call_params_data_async_parity_cmd);
 	install_element(ENABLE_NODE, &sms_cmd);
+	install_element(ENABLE_NODE, &sms_bulk_send_cmd);
+	install_element(ENABLE_NODE, &sms_bulk_limit_cmd);
+	install_element(ENABLE_NODE, &sms_bulk_flush_cmd);
 	install_element(ENABLE_NODE, &service_cmd);
 	install_element(ENABLE_NODE, &vgcs_enter_cmd);
 	install_element(ENABLE_NODE, &vgcs_direct_cmd);
@@ -3023,6 +3328,11 @@ int ms_vty_init(void)
 	install_element(VBS_NODE, &vbs_cmd);
 	install_element(ENABLE_NODE, &test_reselection_cmd);
 	install_element(ENABLE_NODE, &delete_forbidden_plmn_cmd);
+	install_element(ENABLE_NODE, &paging_watch_add_cmd);
+	install_element(ENABLE_NODE, &paging_watch_load_cmd);
+	install_element(ENABLE_NODE, &paging_watch_clear_cmd);
+	install_element(ENABLE_NODE, &paging_watch_log_cmd);
+	install_element(ENABLE_NODE, &no_paging_watch_log_cmd);
 
 #ifdef _HAVE_GPSD
 	install_element(CONFIG_NODE, &cfg_gps_host_cmd);
@@ -79,17 +79,7 @@ static uint8_t grr_gen_chan_req(bool single_block)
 static bool grr_match_req_ref(struct osmocom_ms *ms,
 			      const struct gsm48_req_ref *ref)
 {
-	struct gsm48_rrlayer *rr = &ms->rrlayer;
-
-	for (unsigned int i = 0; i < ARRAY_SIZE(rr->cr_hist); i++) {
-		const struct gsm48_cr_hist *hist = &rr->cr_hist[i];
-		if (!hist->valid)
-			continue;
-		if (memcmp(&hist->ref, ref, sizeof(*ref)) == 0)
-			return true;
-	}
-
-	return false;
+	return gsm48_cr_hist_match(&ms->rrlayer, ref, GSM48_CR_HIST_NUM);
 }
 
 static int forward_to_rlcmac(struct osmocom_ms *ms, struct msgb *msg)
@@ -465,7 +455,7 @@ static void handle_chan_access_req(struct osmo_fsm_inst *fi,
 		return;
 	}
 
-	memset(&rr->cr_hist[0], 0x00, sizeof(rr->cr_hist));
+	gsm48_cr_hist_clear(rr);
 	rr->chan_req_val = lp->rach_req.ra & ~0x07;
 	rr->n_chan_req = GRR_PACKET_ACCESS_MAX_CHAN_REQ;
 	rr->state = GSM48_RR_ST_CONN_PEND;
@@ -699,13 +689,8 @@ static void grr_st_packet_access_action(struct osmo_fsm_inst *fi,
 			return;
 		}
 
-		/* shift the CHANNEL REQUEST history buffer */
-		memmove(&rr->cr_hist[1], &rr->cr_hist[0],
-			sizeof(rr->cr_hist) - sizeof(rr->cr_hist[0]));
-		/* store the new entry */
-		rr->cr_hist[0].ref = *ref;
-		rr->cr_hist[0].ref.ra = rr->cr_ra;
-		rr->cr_hist[0].valid = 1;
+		/* store in the CHANNEL REQUEST history */
+		gsm48_cr_hist_add(rr, ref);
 		break;
 	}
 	case GRR_EV_PDCH_ESTABLISH_REQ: